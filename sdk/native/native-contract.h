@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: BSL-1.0
+//
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is released under the Boost Software License - Version 1.0
+
+#pragma once
+#include <stdint.h>
+
+// Exported even when building with -fvisibility=hidden.
+#define LOADSHEAR_EXPORT __attribute__((visibility("default")))
+
+#ifdef __cplusplus
+#define SET_CPP_NOEXCEPT noexcept
+extern "C" {
+#else
+#define SET_CPP_NOEXCEPT
+#endif
+
+// Bumped whenever a function below changes, plugins built against another
+// version are refused.
+#define LOADSHEAR_NATIVE_ABI 1
+
+    // One message read from the server. The pointers are only valid during the call.
+    struct loadshear_message
+    {
+        const uint8_t *header;
+        uint32_t header_size;
+        const uint8_t *body;
+        uint32_t body_size;
+
+        // Index of the session that read the message, from 0 to SESSIONS - 1.
+        uint32_t session_index;
+    };
+
+    // Must return LOADSHEAR_NATIVE_ABI.
+    LOADSHEAR_EXPORT uint32_t loadshear_abi_version(void) SET_CPP_NOEXCEPT;
+
+    // Optional, called once per shard on the shard's thread. The returned pointer is
+    // passed to every other call made by that shard, so it can hold per shard state
+    // without locks. Without it, state is NULL.
+    LOADSHEAR_EXPORT void *loadshear_create(void) SET_CPP_NOEXCEPT;
+
+    // Optional, releases what loadshear_create returned.
+    LOADSHEAR_EXPORT void loadshear_destroy(void *state) SET_CPP_NOEXCEPT;
+
+    // loadshear_handle_body writes the response to the message into response, which
+    // holds capacity bytes, and returns its size. A size of 0 sends no response.
+    //
+    // If the response does not fit, return the size it needs without writing more than
+    // capacity bytes, the call is then made again with enough room.
+    LOADSHEAR_EXPORT uint32_t loadshear_handle_body(void *state,
+                                                    const struct loadshear_message *message,
+                                                    uint8_t *response,
+                                                    uint32_t capacity) SET_CPP_NOEXCEPT;
+
+    // Optional, returns the size of the body that follows the header, or a negative
+    // value if the header is invalid.
+    //
+    // Like handle_header in wasm-contract.h, you may instead use LENGTHWIDTH in SETTINGS.
+    LOADSHEAR_EXPORT int32_t loadshear_handle_header(void *state,
+                                                     const uint8_t *header,
+                                                     uint32_t header_size) SET_CPP_NOEXCEPT;
+
+#ifdef __cplusplus
+}
+#endif
+
+#undef SET_CPP_NOEXCEPT
+#undef LOADSHEAR_EXPORT
@@ -0,0 +1,86 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include <cstring>
+
+#include "native-contract.h"
+
+// Native port of sdk/wasm/tcp-single-session-heartbeat.cpp, answers pings
+// with an empty ping response.
+
+enum class HeaderType : uint8_t
+{
+    Login,
+    Register,
+    Ping,
+    PingResponse,
+    SendDM
+};
+
+constexpr uint32_t expected_header_size = 5;
+
+uint32_t loadshear_abi_version() noexcept
+{
+    return LOADSHEAR_NATIVE_ABI;
+}
+
+// The header is given separately, the body is ignored.
+uint32_t loadshear_handle_body(void *state,
+                               const loadshear_message *message,
+                               uint8_t *response,
+                               uint32_t capacity) noexcept
+{
+    if (message->header_size < expected_header_size)
+    {
+        return 0;
+    }
+
+    if (static_cast<HeaderType>(message->header[0]) != HeaderType::Ping)
+    {
+        // Return nothing.
+        return 0;
+    }
+
+    if (capacity < expected_header_size)
+    {
+        return expected_header_size;
+    }
+
+    // Send ping response if we got pinged, with an empty payload.
+    response[0] = static_cast<uint8_t>(HeaderType::PingResponse);
+    std::memset(response + 1, 0, 4);
+
+    return expected_header_size;
+}
+
+// We defined the header size as 5 in the calling gtest function.
+int32_t loadshear_handle_header(void *state,
+                                const uint8_t *header,
+                                uint32_t header_size) noexcept
+{
+    if (header_size != expected_header_size)
+    {
+        return -1;
+    }
+
+    // Grab payload length
+    uint32_t payload_len = static_cast<uint32_t>(header[1])
+                                | (static_cast<uint32_t>(header[2]) << 8)
+                                | (static_cast<uint32_t>(header[3]) << 16)
+                                | (static_cast<uint32_t>(header[4]) << 24);
+
+    return static_cast<int32_t>(payload_len);
+}
@@ -0,0 +1,69 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "wasm-contract.h"
+
+extern unsigned char __heap_base[];
+static uint32_t heap_top = (uint32_t)(uintptr_t)__heap_base;
+
+// just move the pointer each time
+uint32_t alloc(uint32_t input_size)
+{
+    uint32_t res = heap_top;
+    heap_top = heap_top + input_size;
+
+    return res;
+}
+
+// Overwrite a message in place, it becomes its own response.
+static void fill_message(uint32_t index, uint32_t size)
+{
+    uint8_t *memory = (uint8_t *)(uintptr_t)index;
+    for (uint32_t i = 0; i < size; i++)
+    {
+        memory[i] = 0x55;
+    }
+}
+
+uint64_t handle_body(uint32_t input_index, uint32_t input_size)
+{
+    fill_message(input_index, input_size);
+
+    // Combine and send (order is based on the wasm contract).
+    return ((uint64_t)input_size << 32) | (uint64_t)input_index;
+}
+
+// Every message is answered in place, so the input table doubles as the
+// response table.
+uint64_t handle_batch(uint32_t table_index, uint32_t count)
+{
+    struct batch_entry *entries = (struct batch_entry *)(uintptr_t)table_index;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        fill_message(entries[i].index, entries[i].size);
+    }
+
+    uint32_t table_size = count * (uint32_t)sizeof(struct batch_entry);
+
+    return ((uint64_t)table_size << 32) | (uint64_t)table_index;
+}
+
+// Move the pointer back to the start, we are free to write over memory.
+void dealloc(uint32_t input_index, uint32_t input_size)
+{
+    heap_top = (uint32_t)(uintptr_t)__heap_base;
+}
@@ -0,0 +1,56 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "wasm-contract.h"
+
+extern unsigned char __heap_base[];
+static uint32_t heap_top = 0;
+
+// just move the pointer each time
+uint32_t alloc(uint32_t input_size)
+{
+    if (heap_top == 0)
+    {
+        heap_top = (uint32_t)(uintptr_t)__heap_base;
+    }
+
+    uint32_t res = heap_top;
+    heap_top = heap_top + input_size;
+
+    return res;
+}
+
+// Echoes every message, except ones starting with 0xFF which never return.
+// Used to check that HANDLERTIMEOUT and HANDLERFUEL cut off runaway handlers.
+uint64_t handle_body(uint32_t input_index, uint32_t input_size)
+{
+    volatile uint8_t *message = (volatile uint8_t *)(uintptr_t)input_index;
+
+    if (message[0] == 0xFF)
+    {
+        for (;;)
+        {
+        }
+    }
+
+    return ((uint64_t)input_size << 32) | (uint64_t)input_index;
+}
+
+// Move the pointer back to the start, we are free to write over memory.
+void dealloc(uint32_t input_index, uint32_t input_size)
+{
+    heap_top = (uint32_t)(uintptr_t)__heap_base;
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "wasm-contract.h"
+
+extern unsigned char __heap_base[];
+static uint32_t heap_top = 0;
+
+// just move the pointer each time
+uint32_t alloc(uint32_t input_size)
+{
+    if (heap_top == 0)
+    {
+        heap_top = (uint32_t)(uintptr_t)__heap_base;
+    }
+
+    uint32_t res = heap_top;
+    heap_top = heap_top + input_size;
+
+    return res;
+}
+
+// Responses are not looked at, this module only writes requests.
+uint64_t handle_body(uint32_t input_index, uint32_t input_size)
+{
+    return 0;
+}
+
+// Sends the payload behind a little endian header holding a sequence number
+// that is unique across the shard and the session that sent it.
+uint64_t generate_payload(uint32_t input_index, uint32_t input_size, uint32_t payload_index)
+{
+    uint32_t output_size = 12 + input_size;
+    uint8_t *output = (uint8_t *)(uintptr_t)alloc(output_size);
+
+    uint64_t sequence = (uint64_t)loadshear_counter_next(0);
+    uint32_t session = (uint32_t)loadshear_session_index();
+
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        output[i] = (uint8_t)(sequence >> (8 * i));
+    }
+
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        output[8 + i] = (uint8_t)(session >> (8 * i));
+    }
+
+    const uint8_t *input = (const uint8_t *)(uintptr_t)input_index;
+
+    for (uint32_t i = 0; i < input_size; i++)
+    {
+        output[12 + i] = input[i];
+    }
+
+    return ((uint64_t)output_size << 32) | (uint64_t)(uintptr_t)output;
+}
+
+// Move the pointer back to the start, we are free to write over memory.
+void dealloc(uint32_t input_index, uint32_t input_size)
+{
+    heap_top = (uint32_t)(uintptr_t)__heap_base;
+}
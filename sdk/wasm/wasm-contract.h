@@ -35,6 +35,52 @@ extern "C" {
     // you can make this a no-op and simply not export it.
     uint32_t handle_header(uint32_t input_index, uint32_t input_size) SET_CPP_NOEXCEPT;
 
+    // One message (or response) of a batch, stored little endian.
+    struct batch_entry
+    {
+        uint32_t index;
+        uint32_t size;
+    };
+
+    // handle_batch is optional, if exported it is called once per read with every message
+    // of that read, instead of handle_body per message.
+    //
+    // table_index points at count batch_entry, each pointing at a message (header + body)
+    // in the same allocation. The return is a packed index and size like handle_body, of a
+    // table with count batch_entry responses. An entry with size 0 sends no response.
+    uint64_t handle_batch(uint32_t table_index, uint32_t count) SET_CPP_NOEXCEPT;
+
+    // generate_payload is optional, if exported it is called before every payload is sent
+    // with the payload's bytes and its index in the session's schedule.
+    //
+    // The return is a packed index and size like handle_body, the bytes are sent instead
+    // of the payload. A size of 0 sends the payload unchanged. Both the input and the
+    // output are passed to dealloc afterwards.
+    uint64_t generate_payload(uint32_t input_index,
+                              uint32_t input_size,
+                              uint32_t payload_index) SET_CPP_NOEXCEPT;
+
+    // Host imports, optional. Declare (call) only the ones you use.
+#define LOADSHEAR_IMPORT(name) __attribute__((import_module("loadshear"), import_name(name)))
+
+    // Nanoseconds since the Unix epoch, read once per call into the module so it
+    // does not change while a message (or batch) is being handled.
+    LOADSHEAR_IMPORT("clock_ns") int64_t loadshear_clock_ns(void) SET_CPP_NOEXCEPT;
+
+    // Returns the value of counter id (0 to 15) then increments it, counters start at 0.
+    //
+    // Counters belong to the shard, so they are unique across the shard's sessions
+    // but not across shards. Any other id traps.
+    LOADSHEAR_IMPORT("counter_next") int64_t loadshear_counter_next(int32_t id) SET_CPP_NOEXCEPT;
+
+    // Index of the session whose message is being handled, from 0 to SESSIONS - 1.
+    LOADSHEAR_IMPORT("session_index") int32_t loadshear_session_index(void) SET_CPP_NOEXCEPT;
+
+    // Fast pseudo random numbers, not suitable for cryptography.
+    LOADSHEAR_IMPORT("random_u64") uint64_t loadshear_random_u64(void) SET_CPP_NOEXCEPT;
+
+#undef LOADSHEAR_IMPORT
+
 #ifdef __cplusplus
 }
 #endif
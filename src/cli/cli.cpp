@@ -144,109 +144,30 @@ int CLI::execute_script(const DSLData & script)
     {
         protocol = ProtocolType::UDP;
     }
+    else if (script.settings.session_protocol == "TCP_URING")
+    {
+        protocol = ProtocolType::TCP_URING;
+    }
 
     switch (protocol)
     {
         // Create TCP specific plan and execute.
         case ProtocolType::TCP:
         {
-            auto plan_tmp = generate_execution_plan<TCPSession>(script,
-                                                                &arena_);
-
-            // Handle unexpected value.
-            if (!plan_tmp)
-            {
-                std::string e_msg = plan_tmp.error();
-                Logger::error(std::move(e_msg));
-                return 1;
-            }
-
-            ExecutionPlan<TCPSession> plan = *plan_tmp;
-
-            // If we have dry_run set, do this and exit.
-            if (cli_ops_.dry_run)
-            {
-                dry_run(plan, script);
-                return 0;
-            }
-
-            bool ack = false;
-
-            // Ensure the user knows what is about to happen.
-            if (!cli_ops_.acknowledged_responsibility)
-            {
-                ack = request_acknowledgement(plan.dump_endpoint_list());
-            }
-            else
-            {
-                ack = true;
-            }
-
-            if (!ack)
-            {
-                return 0;
-            }
-
-            // Disable output besides warnings after showing disclaimer.
-            if (cli_ops_.quiet)
-            {
-                Logger::set_level(LogLevel::WARN);
-                return start_orchestrator_loop_uninteractive(std::move(plan));
-            }
-
-            // Now, start the program's main loop
-            return start_orchestrator_loop(std::move(plan));
+            return execute_plan<TCPSession>(script);
         }
         // Create UDP specific plan and execute.
         case ProtocolType::UDP:
         {
-            auto plan_tmp = generate_execution_plan<UDPSession>(script,
-                                                                &arena_);
-
-            // Handle unexpected value.
-            if (!plan_tmp)
-            {
-                std::string e_msg = plan_tmp.error();
-                Logger::error(std::move(e_msg));
-                return 1;
-            }
-
-            ExecutionPlan<UDPSession> plan = *plan_tmp;
-
-            // If we have dry_run set, do this and exit.
-            if (cli_ops_.dry_run)
-            {
-                dry_run(plan, script);
-                return 0;
-            }
-
-            bool ack = false;
-
-            // Ensure the user knows what is about to happen.
-            if (!cli_ops_.acknowledged_responsibility)
-            {
-                ack = request_acknowledgement(plan.dump_endpoint_list());
-            }
-            else
-            {
-                ack = true;
-            }
-
-            if (!ack)
-            {
-                return 0;
-            }
-
-            // Disable output besides warnings after showing disclaimer.
-            if (cli_ops_.quiet)
-            {
-                Logger::set_level(LogLevel::WARN);
-                return start_orchestrator_loop_uninteractive(std::move(plan));
-            }
-
-            // Now, start the program's main loop
-            return start_orchestrator_loop(std::move(plan));
+            return execute_plan<UDPSession>(script);
+        }
+#ifdef __linux__
+        // Create io_uring TCP specific plan and execute.
+        case ProtocolType::TCP_URING:
+        {
+            return execute_plan<TCPUringSession>(script);
         }
+#endif
         // Error in script protocol.
         default:
         {
@@ -262,6 +183,56 @@ int CLI::execute_script(const DSLData & script)
 
 }
 
+template <typename Session>
+int CLI::execute_plan(const DSLData & script)
+{
+    auto plan_tmp = generate_execution_plan<Session>(script, &arena_);
+
+    // Handle unexpected value.
+    if (!plan_tmp)
+    {
+        std::string e_msg = plan_tmp.error();
+        Logger::error(std::move(e_msg));
+        return 1;
+    }
+
+    ExecutionPlan<Session> plan = *plan_tmp;
+
+    // If we have dry_run set, do this and exit.
+    if (cli_ops_.dry_run)
+    {
+        dry_run(plan, script);
+        return 0;
+    }
+
+    bool ack = false;
+
+    // Ensure the user knows what is about to happen.
+    if (!cli_ops_.acknowledged_responsibility)
+    {
+        ack = request_acknowledgement(plan.dump_endpoint_list());
+    }
+    else
+    {
+        ack = true;
+    }
+
+    if (!ack)
+    {
+        return 0;
+    }
+
+    // Disable output besides warnings after showing disclaimer.
+    if (cli_ops_.quiet)
+    {
+        Logger::set_level(LogLevel::WARN);
+        return start_orchestrator_loop_uninteractive(std::move(plan));
+    }
+
+    // Now, start the program's main loop
+    return start_orchestrator_loop(std::move(plan));
+}
+
 template <typename Session>
 int CLI::start_orchestrator_loop(ExecutionPlan<Session> plan)
 {
@@ -314,6 +285,79 @@ int CLI::start_orchestrator_loop(ExecutionPlan<Session> plan)
                                  deltas.bytes_read)
         });
 
+        // Display packet metrics, per call ratios show how well we batch.
+        auto packets_header = text("Packets") | bold | center;
+
+        auto packets_box = vbox({
+            create_numeric_display("sent: ",
+                                   totals.packets_sent,
+                                   deltas.packets_sent),
+            create_numeric_display("read: ",
+                                   totals.packets_read,
+                                   deltas.packets_read),
+            create_ratio_display("sent / call: ",
+                                 totals.packets_sent,
+                                 totals.send_calls),
+            create_ratio_display("read / call: ",
+                                 totals.packets_read,
+                                 totals.read_calls),
+            create_numeric_display("gso sends: ",
+                                   totals.gso_sends,
+                                   deltas.gso_sends)
+        });
+
+        // Display body buffer leases, misses are new allocations.
+        auto buffers_header = text("Body Buffers") | bold | center;
+
+        auto buffers_box = vbox({
+            create_numeric_display("hits: ",
+                                   totals.buffer_hits,
+                                   deltas.buffer_hits),
+            create_numeric_display("misses: ",
+                                   totals.buffer_misses,
+                                   deltas.buffer_misses),
+            create_bytes_display("high water: ",
+                                 totals.buffer_high_water,
+                                 deltas.buffer_high_water)
+        });
+
+        // Display response queue metrics.
+        auto responses_header = text("Responses") | bold | center;
+
+        auto responses_box = vbox({
+            create_numeric_display("queued: ",
+                                   totals.responses_queued,
+                                   deltas.responses_queued),
+            create_numeric_display("dropped: ",
+                                   totals.responses_dropped,
+                                   deltas.responses_dropped),
+            create_numeric_display("read pauses: ",
+                                   totals.read_pauses,
+                                   deltas.read_pauses),
+            create_numeric_display("peak depth: ",
+                                   totals.response_queue_peak,
+                                   deltas.response_queue_peak)
+        });
+
+        // Display WASM handler failures and HANDLERTHREADS jobs, the call
+        // and queue wait times are histograms.
+        auto handler_header = text("Handler") | bold | center;
+
+        auto handler_box = vbox({
+            create_numeric_display("traps: ",
+                                   totals.handler_traps,
+                                   deltas.handler_traps),
+            create_numeric_display("timeouts: ",
+                                   totals.handler_timeouts,
+                                   deltas.handler_timeouts),
+            create_numeric_display("jobs: ",
+                                   totals.handler_jobs,
+                                   deltas.handler_jobs),
+            create_numeric_display("queue peak: ",
+                                   totals.handler_queue_peak,
+                                   deltas.handler_queue_peak)
+        });
+
         // Display connection metrics.
         auto connections_header = text("Connections") | bold | center;
 
@@ -338,6 +382,18 @@ int CLI::start_orchestrator_loop(ExecutionPlan<Session> plan)
             separator(),
             bytes_box,
             separator(),
+            packets_header,
+            separator(),
+            packets_box,
+            separator(),
+            buffers_header,
+            separator(),
+            buffers_box,
+            separator(),
+            responses_header,
+            separator(),
+            responses_box,
+            separator(),
             connections_header,
             separator(),
             connections_box
@@ -346,6 +402,9 @@ int CLI::start_orchestrator_loop(ExecutionPlan<Session> plan)
         Element hist;
         Element send_hist;
         Element read_hist;
+        Element handler_hist;
+        Element wait_hist;
+        Element generate_hist;
 
         if (tui_state->mode == TUIState::Mode::Totals)
         {
@@ -357,6 +416,27 @@ int CLI::start_orchestrator_loop(ExecutionPlan<Session> plan)
 
             read_hist = generate_histogram(totals.read_latency_buckets,
                                            "Read Latency (totals)");
+
+            handler_hist = generate_histogram(totals.handler_time_buckets,
+                                              "Handler Time (totals)",
+                                              8,
+                                              4,
+                                              handler_time_labels,
+                                              handler_unit_labels);
+
+            wait_hist = generate_histogram(totals.handler_wait_buckets,
+                                           "Handler Queue Wait (totals)",
+                                           8,
+                                           4,
+                                           handler_time_labels,
+                                           handler_unit_labels);
+
+            generate_hist = generate_histogram(totals.generate_time_buckets,
+                                               "Payload Generation (totals)",
+                                               8,
+                                               4,
+                                               handler_time_labels,
+                                               handler_unit_labels);
         }
         else
         {
@@ -368,12 +448,39 @@ int CLI::start_orchestrator_loop(ExecutionPlan<Session> plan)
 
             read_hist = generate_histogram(deltas.read_latency_buckets,
                                            "Read Latency (latest)");
+
+            handler_hist = generate_histogram(deltas.handler_time_buckets,
+                                              "Handler Time (latest)",
+                                              8,
+                                              4,
+                                              handler_time_labels,
+                                              handler_unit_labels);
+
+            wait_hist = generate_histogram(deltas.handler_wait_buckets,
+                                           "Handler Queue Wait (latest)",
+                                           8,
+                                           4,
+                                           handler_time_labels,
+                                           handler_unit_labels);
+
+            generate_hist = generate_histogram(deltas.generate_time_buckets,
+                                               "Payload Generation (latest)",
+                                               8,
+                                               4,
+                                               handler_time_labels,
+                                               handler_unit_labels);
         }
 
         auto columns = gridbox({
             {metrics_box | xflex | yflex, separator(), hist | xflex | yflex},
             {separator(), separator(), separator()},
-            {send_hist | xflex | yflex, separator(), read_hist | xflex | yflex}
+            {send_hist | xflex | yflex, separator(), read_hist | xflex | yflex},
+            {separator(), separator(), separator()},
+            {vbox({handler_header, separator(), handler_box}) | xflex | yflex,
+             separator(),
+             handler_hist | xflex | yflex},
+            {separator(), separator(), separator()},
+            {generate_hist | xflex | yflex, separator(), wait_hist | xflex | yflex}
         });
 
         auto footer = text("Press q to quit, Left / Right arrows to cycle histograms.") | dim;
@@ -529,6 +636,58 @@ int CLI::start_orchestrator_loop_uninteractive(ExecutionPlan<Session> plan)
     return 0;
 }
 
+// Microseconds as milliseconds with three decimals.
+static std::string us_to_ms_string(int64_t us)
+{
+    std::string fraction = std::to_string(us % 1000);
+    fraction.insert(0, 3 - fraction.size(), '0');
+
+    return std::to_string(us / 1000) + "." + fraction + "ms";
+}
+
+template <typename Session>
+void CLI::report_startup(const ExecutionPlan<Session> & plan)
+{
+    const auto & startup = plan.startup;
+
+    if (!startup.wasm)
+    {
+        return;
+    }
+
+    std::string startup_msg = "Handler module "
+                              + std::string(startup.cached ? "loaded from cache"
+                                                           : "compiled")
+                              + " in "
+                              + us_to_ms_string(startup.load_time.count());
+
+    Logger::info(std::move(startup_msg));
+
+    // Every shard makes its own handler, time one of them.
+    auto start = std::chrono::steady_clock::now();
+
+    try
+    {
+        auto handler = plan.config.handler_factory_();
+    }
+    catch (const std::exception & e)
+    {
+        Logger::warn("Handler could not be instantiated: " + std::string(e.what()));
+        return;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start);
+
+    std::string instance_msg = "Handler instantiated in "
+                               + us_to_ms_string(elapsed.count())
+                               + " per shard ("
+                               + std::to_string(plan.config.shard_count)
+                               + " shards)\n";
+
+    Logger::info(std::move(instance_msg));
+}
+
 template <typename Session>
 void CLI::dry_run(const ExecutionPlan<Session> & plan,
                   const DSLData & data)
@@ -542,7 +701,10 @@ void CLI::dry_run(const ExecutionPlan<Session> & plan,
 
     Logger::info(plan.dump_endpoint_list());
 
+    report_startup(plan);
+
     size_t current_payload_id = 0;
+    size_t current_send = 0;
 
     for (size_t i = 0; i < plan.actions.size(); i++)
     {
@@ -578,19 +740,30 @@ void CLI::dry_run(const ExecutionPlan<Session> & plan,
                               + " with payload data\n"
                               + "                ";
 
-                // We need to store action.count copies of a payload
-                // since the descriptors are cheap and this allows
-                // straight up linear iteration versus branching.
-                //
-                // But, this must be accounted for when we parse the plan.
-                if (current_payload_id > plan.payloads.size())
+                // Each SEND has one descriptor covering all its copies,
+                // or one per file when the packet is a directory.
+                if (current_send >= plan.send_payloads.size()
+                    || current_payload_id >= plan.payloads.size())
                 {
                     Logger::warn("Application has a logic error");
                     break;
                 }
 
+                size_t packet_count = plan.send_payloads[current_send];
                 const auto & payload = plan.payloads[current_payload_id];
 
+                if (packet_count > 1)
+                {
+                    action_msg += "("
+                                  + std::to_string(packet_count)
+                                  + " packets from directory) ";
+                }
+
+                if (payload.file)
+                {
+                    action_msg += "(sent from disk) ";
+                }
+
                 for (const auto & op : payload.ops)
                 {
                     action_msg += "<"
@@ -600,7 +773,8 @@ void CLI::dry_run(const ExecutionPlan<Session> & plan,
                                   + "> ";
                 }
 
-                current_payload_id += action.count;
+                current_payload_id += packet_count;
+                current_send++;
                 break;
             }
             case ActionType::FLOOD:
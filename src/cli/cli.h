@@ -32,6 +32,9 @@ public:
 private:
     int execute_script(const DSLData & script);
 
+    template <typename Session>
+    int execute_plan(const DSLData & script);
+
     template <typename Session>
     int start_orchestrator_loop(ExecutionPlan<Session> plan);
 
@@ -42,6 +45,10 @@ private:
     void dry_run(const ExecutionPlan<Session> & plan,
                  const DSLData & data);
 
+    // Handler load and per shard instantiation times.
+    template <typename Session>
+    void report_startup(const ExecutionPlan<Session> & plan);
+
     bool request_acknowledgement(std::string endpoints_list);
 
     void metric_sink(MetricsAggregate data);
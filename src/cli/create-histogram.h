@@ -37,6 +37,19 @@ const std::array<std::string, 16> unit_labels = {
     "ms ", "ms ", "s  ", "s  "
 };
 
+// Handler times start at 1us instead of 64us.
+const std::array<std::string, 16> handler_time_labels = {
+    "1  ", "2  ", "4  ", "8  ", "16 ", "32 ",
+    "64 ", "128", "256", "512", "1  ", "2  ",
+    "4  ", "8  ", "16 ", ">16"
+};
+
+const std::array<std::string, 16> handler_unit_labels = {
+    "us ", "us ", "us ", "us ", "us ", "us ",
+    "us ", "us ", "us ", "us ", "ms ", "ms ",
+    "ms ", "ms ", "ms ", "ms "
+};
+
 static const std::array<ftxui::Color, 5> hist_colors =
                 {
                     scheme_light_teal, scheme_teal, scheme_teal,
@@ -56,7 +69,9 @@ template<typename BucketType>
 inline ftxui::Element generate_histogram(const BucketType & buckets,
                                          std::string title,
                                          int height = 8,
-                                         int bin_width = 4)
+                                         int bin_width = 4,
+                                         const std::array<std::string, 16> & labels = latency_labels,
+                                         const std::array<std::string, 16> & units = unit_labels)
 {
     using namespace ftxui;
 
@@ -148,8 +163,8 @@ inline ftxui::Element generate_histogram(const BucketType & buckets,
         rows.push_back(text(std::string(bin_width, ' ')) | center);
 
         // Add labels.
-        rows.push_back(text(latency_labels[i]) | center);
-        rows.push_back(text(unit_labels[i]) | center);
+        rows.push_back(text(labels[i]) | center);
+        rows.push_back(text(units[i]) | center);
 
         // push back column.
         columns.push_back(vbox(std::move(rows)));
@@ -18,6 +18,7 @@
 
 #include <string>
 #include <sstream>
+#include <iomanip>
 
 #include <ftxui/dom/elements.hpp>
 
@@ -84,3 +85,29 @@ inline ftxui::Element create_numeric_display(std::string title,
 
     return numeric_element;
 }
+
+// Show how many items we moved per unit (packets per call, etc).
+inline ftxui::Element create_ratio_display(std::string title,
+                                           uint64_t numerator,
+                                           uint64_t denominator)
+{
+    using namespace ftxui;
+
+    // Nothing measured yet (or transport does not report calls).
+    if (denominator == 0)
+    {
+        return hbox({
+            text(title),
+            text("-")
+        });
+    }
+
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1)
+        << static_cast<double>(numerator) / static_cast<double>(denominator);
+
+    return hbox({
+        text(title),
+        text(oss.str())
+    });
+}
@@ -18,14 +18,31 @@
 
 #include "all-transports.h"
 #include "wasm-message-handler.h"
+#include "wasm-instance-pre.h"
+#include "wasm-module-cache.h"
+#include "epoch-ticker.h"
+#include "handler-pool.h"
+#include "pooled-message-handler.h"
 #include "nop-message-handler.h"
+#include "native-message-handler.h"
+#include "length-field.h"
 #include "resolver.h"
 #include "logger.h"
+#include "version.h"
 
 #include <wasmtime.hh>
 
+#include <chrono>
+#include <limits>
+#include <optional>
+#include <span>
 #include <unordered_map>
 #include <unordered_set>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
 
 // To map valid timestamp format strings to their enum values.
 const std::unordered_map<std::string, TimestampFormat> ts_format_lookup
@@ -36,6 +53,393 @@ const std::unordered_map<std::string, TimestampFormat> ts_format_lookup
     {"nanoseconds", TimestampFormat::Nanoseconds}
 };
 
+// Operation lengths are 32 bit, so split static data from larger
+// (file backed) packets into several IDENTITY operations.
+static void push_identity(std::vector<PacketOperation> & ops, uint64_t bytes)
+{
+    while (bytes > 0)
+    {
+        uint32_t length = static_cast<uint32_t>
+                            (
+                                std::min<uint64_t>(bytes,
+                                                   PacketOperation::MAX_LENGTH)
+                            );
+
+        PacketOperation identity;
+        identity.make_identity(length);
+
+        ops.push_back(std::move(identity));
+        bytes -= length;
+    }
+}
+
+// Where the bytes of one packet file live for the run.
+struct PacketSource
+{
+    static constexpr size_t NO_ARENA = SIZE_MAX;
+
+    // Into the arena or a mapping, empty for packets left on disk.
+    std::span<const uint8_t> data;
+    const PacketFile *file{nullptr};
+    uint64_t size{0};
+
+    // Arena packets get their data once every packet has been read.
+    size_t arena_index{NO_ARENA};
+};
+
+// Operations for one packet of a SEND. Modifications are applied in the
+// order they were declared, the bytes between them are sent as they are.
+static std::expected<std::vector<PacketOperation>, std::string>
+make_payload_ops(const Action & action, uint64_t packet_size)
+{
+    std::vector<PacketOperation> ops;
+
+    size_t ts_idx = 0;
+    size_t c_idx = 0;
+    size_t data_index = 0;
+
+    for (const auto & mod : action.mod_order)
+    {
+        if (mod == ModificationType::Counter)
+        {
+            const auto & c_mod = action.counter_mods[c_idx];
+            c_idx++;
+
+            // First, insert the previous "identity" payload
+            // of all bytes between this mod and the last.
+            //
+            // This is the counter start index minus the
+            // previous index from other operations.
+            size_t prev_bytes = c_mod.counter_bytes.start - data_index;
+
+            if (prev_bytes > 0)
+            {
+                push_identity(ops, prev_bytes);
+                data_index += prev_bytes;
+            }
+
+            // Turn this counter into a packet operation.
+            PacketOperation counter;
+            counter.make_counter(c_mod.counter_bytes.second,
+                                 c_mod.little_endian);
+
+            ops.push_back(std::move(counter));
+
+            // Increment the index.
+            data_index += c_mod.counter_bytes.second;
+        }
+        else if (mod == ModificationType::Timestamp)
+        {
+            const auto & ts_mod = action.timestamp_mods[ts_idx];
+            ts_idx++;
+
+            size_t prev_bytes = ts_mod.timestamp_bytes.start - data_index;
+
+            if (prev_bytes > 0)
+            {
+                push_identity(ops, prev_bytes);
+                data_index += prev_bytes;
+            }
+
+            // We need to resolve the time format here.
+            //
+            // This should be valid from previous checks when
+            // parsing the script, but it is good to ensure
+            // correctness here as well.
+            auto format_iter = ts_format_lookup.find(ts_mod.format_name);
+
+            if (format_iter == ts_format_lookup.end())
+            {
+                std::string e_msg = "Failed to resolve "
+                                    "timestamp format "
+                                    "for value "
+                                    + ts_mod.format_name
+                                    + " (this should have "
+                                    "been caught by the "
+                                    "DSL validator)";
+
+                return std::unexpected{e_msg};
+            }
+
+            PacketOperation timestamp;
+            timestamp.make_timestamp(ts_mod.timestamp_bytes.second,
+                                     ts_mod.little_endian,
+                                     format_iter->second);
+
+            ops.push_back(std::move(timestamp));
+
+            // Increment the index.
+            data_index += ts_mod.timestamp_bytes.second;
+        }
+    }
+
+    // Insert the remaining bytes if any exist.
+    if (data_index < packet_size)
+    {
+        push_identity(ops, packet_size - data_index);
+    }
+
+    return ops;
+}
+
+// Map a packet read only with the MMAP mode, the page cache backs it
+// instead of the arena so every process sending it shares the memory.
+static std::expected<std::shared_ptr<PacketMapping>, std::string>
+map_packet_file(const std::filesystem::path & path,
+                size_t size,
+                const std::string & mode)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+        std::string error_msg = "Failed to open packet file "
+                                + path.string()
+                                + " (got error: "
+                                + std::strerror(errno)
+                                + ")";
+        return std::unexpected{std::move(error_msg)};
+    }
+
+    int flags = MAP_SHARED;
+
+#ifdef MAP_POPULATE
+    // Fault every page in now instead of on the first sends.
+    if (mode != "ON")
+    {
+        flags |= MAP_POPULATE;
+    }
+#endif
+
+    void *data = ::mmap(nullptr, size, PROT_READ, flags, fd, 0);
+    int map_error = errno;
+
+    // The mapping keeps its own reference to the file.
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        std::string error_msg = "Failed to map packet file "
+                                + path.string()
+                                + " (got error: "
+                                + std::strerror(map_error)
+                                + ")";
+        return std::unexpected{std::move(error_msg)};
+    }
+
+    auto mapping = std::make_shared<PacketMapping>(data, size);
+
+#ifdef MADV_HUGEPAGE
+    // Only a hint, most filesystems ignore it.
+    if (mode == "HUGEPAGE")
+    {
+        ::madvise(data, size, MADV_HUGEPAGE);
+    }
+#endif
+
+    return mapping;
+}
+
+// Headers are parsed natively when the script describes the length field.
+static std::optional<LengthField> make_length_field(const SettingsBlock & settings)
+{
+    if (settings.length_width == 0)
+    {
+        return std::nullopt;
+    }
+
+    LengthField field;
+    field.offset = settings.length_offset;
+    field.width = settings.length_width;
+    field.little_endian = settings.length_little_endian;
+    field.adjustment = settings.length_adjust;
+    field.includes_header = settings.length_includes_header;
+
+    return field;
+}
+
+// Compiled handler shared by every shard's message handler factory.
+struct WASMHandlerModule
+{
+    std::shared_ptr<wasmtime::Engine> engine;
+    std::shared_ptr<wasmtime::Module> module;
+    std::shared_ptr<const WASMInstancePre> instance_pre;
+
+    // The module exports generate_payload, so it is needed even without READ.
+    bool generates{false};
+
+    // Only running with HANDLERTIMEOUT, stops once the last factory is gone.
+    std::shared_ptr<EpochTicker> ticker;
+};
+
+// Compiled modules are only valid for the engine settings they were
+// compiled with, anything that changes the wasmtime::Config goes here.
+static std::string make_engine_key(const SettingsBlock & settings)
+{
+    return "loadshear " + std::string(LOADSHEAR_VERSION)
+           + (settings.handler_timeout_ms != 0 ? " epoch" : "")
+           + (settings.handler_fuel != 0 ? " fuel" : "");
+}
+
+// Handler limits from the settings, the engine must match make_engine_key.
+static void set_handler_limits(const SettingsBlock & settings,
+                               const WASMHandlerModule & handler_module,
+                               WASMHandlerOptions & options)
+{
+    if (handler_module.ticker)
+    {
+        options.epoch_deadline = settings.handler_timeout_ms
+                                 / EpochTicker::TICK.count();
+    }
+
+    options.fuel = settings.handler_fuel;
+}
+
+// The TSC is calibrated here so shards don't wait on it, and dropped with a
+// warning when it can't be trusted.
+static ClockMode make_clock_mode(const SettingsBlock & settings)
+{
+    if (settings.clock == "COARSE")
+    {
+        return ClockMode::Coarse;
+    }
+
+    if (settings.clock != "TSC")
+    {
+        return ClockMode::System;
+    }
+
+    if (!ShardClock::tsc_available())
+    {
+        Logger::warn("CLOCK = \"TSC\" but this CPU has no invariant TSC, "
+                     "using \"COARSE\" instead");
+        return ClockMode::Coarse;
+    }
+
+    return ClockMode::TSC;
+}
+
+// With HANDLERTHREADS, every shard hands its messages to one shared pool
+// whose threads each make their own handler with factory.
+static HandlerPool::HandlerFactory pool_handlers(const SettingsBlock & settings,
+                                                 HandlerPool::HandlerFactory factory)
+{
+    if (settings.handler_threads == 0)
+    {
+        return factory;
+    }
+
+    auto pool = std::make_shared<HandlerPool>(settings.handler_threads, factory);
+
+    return [pool, factory]() -> std::unique_ptr<MessageHandler>
+    {
+        return std::make_unique<PooledMessageHandler>(pool, factory());
+    };
+}
+
+// Load the HANDLER module, from the compile cache if possible, and
+// resolve its imports once for all shards.
+static std::expected<WASMHandlerModule, std::string>
+load_handler_module(const SettingsBlock & settings, HandlerStartup & startup)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    wasmtime::Config WASM_config;
+    WASM_config.epoch_interruption(settings.handler_timeout_ms != 0);
+    WASM_config.consume_fuel(settings.handler_fuel != 0);
+
+    auto engine = std::make_shared<wasmtime::Engine>(std::move(WASM_config));
+
+    std::string error_msg;
+
+    auto path = Resolver::resolve_file(settings.handler_value, error_msg);
+
+    if (!error_msg.empty())
+    {
+        // If we could not resolve, stop now.
+        return std::unexpected{error_msg};
+    }
+
+    auto wasm_bytes = Resolver::read_binary_file(path, error_msg);
+
+    if (!error_msg.empty())
+    {
+        // If we could not read, stop now.
+        return std::unexpected{error_msg};
+    }
+
+    WASMModuleCache cache(WASMModuleCache::default_directory(),
+                          make_engine_key(settings));
+
+    bool cached = false;
+    auto module_tmp = cache.load(*engine, wasm_bytes, cached);
+
+    if (!module_tmp)
+    {
+        // If we can't make the module, stop now.
+        error_msg = "Failed to compile WASM module for file "
+                    + path.string()
+                    + " ("
+                    + module_tmp.error()
+                    + ")";
+        return std::unexpected{error_msg};
+    }
+
+    auto wasm_module = std::make_shared<wasmtime::Module>(std::move(*module_tmp));
+
+    auto instance_pre = WASMInstancePre::create(*engine, *wasm_module);
+
+    if (!instance_pre)
+    {
+        return std::unexpected{instance_pre.error()};
+    }
+
+    startup.wasm = true;
+    startup.cached = cached;
+    startup.load_time = std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - start);
+
+    bool generates = false;
+
+    for (const auto & export_type : wasm_module->exports())
+    {
+        if (export_type.name() == "generate_payload")
+        {
+            generates = true;
+        }
+    }
+
+    std::shared_ptr<EpochTicker> ticker;
+
+    if (settings.handler_timeout_ms != 0)
+    {
+        ticker = std::make_shared<EpochTicker>(engine);
+    }
+
+    return WASMHandlerModule{std::move(engine),
+                             std::move(wasm_module),
+                             std::move(*instance_pre),
+                             generates,
+                             std::move(ticker)};
+}
+
+// Load a native HANDLER plugin once, every shard shares it.
+static std::expected<std::shared_ptr<const NativeLibrary>, std::string>
+load_native_library(const SettingsBlock & settings)
+{
+    std::string error_msg;
+
+    auto path = Resolver::resolve_file(settings.handler_value, error_msg);
+
+    if (!error_msg.empty())
+    {
+        // If we could not resolve, stop now.
+        return std::unexpected{error_msg};
+    }
+
+    return NativeLibrary::open(path);
+}
+
 template std::expected<ExecutionPlan<TCPSession>, std::string>
 generate_execution_plan<TCPSession>(const DSLData &,
                                     std::pmr::memory_resource* memory);
@@ -44,6 +448,138 @@ template std::expected<ExecutionPlan<UDPSession>, std::string>
 generate_execution_plan<UDPSession>(const DSLData &,
                                     std::pmr::memory_resource* memory);
 
+#ifdef __linux__
+template std::expected<ExecutionPlan<TCPUringSession>, std::string>
+generate_execution_plan<TCPUringSession>(const DSLData &,
+                                         std::pmr::memory_resource* memory);
+#endif
+
+// Stream sessions share endpoint resolution and plan generation.
+template<typename Session>
+inline constexpr bool is_tcp_session{std::is_same_v<Session, TCPSession>
+#ifdef __linux__
+                                     || std::is_same_v<Session, TCPUringSession>
+#endif
+                                    };
+
+// Load one packet file, left on disk with SENDFILE, mapped with MMAP or
+// read into the arena.
+template<typename Session>
+static std::expected<PacketSource, std::string>
+load_packet(const std::filesystem::path & path,
+            const SettingsBlock & settings,
+            ExecutionPlan<Session> & plan,
+            std::pmr::memory_resource* memory)
+{
+    PacketSource source;
+
+    uintmax_t file_size = Resolver::get_file_size(path);
+
+    if (file_size == 0)
+    {
+        std::string error_msg = "File "
+                                + path.string()
+                                + " has zero bytes to read!";
+        return std::unexpected{std::move(error_msg)};
+    }
+
+    source.size = file_size;
+
+    // Large packets stay on disk and are sent from the file.
+    if (settings.sendfile_threshold != 0
+        && file_size >= settings.sendfile_threshold)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0)
+        {
+            std::string error_msg = "Failed to open packet file "
+                                    + path.string()
+                                    + " (got error: "
+                                    + std::strerror(errno)
+                                    + ")";
+            return std::unexpected{std::move(error_msg)};
+        }
+
+        // Every send reads the file front to back.
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        plan.packet_files.push_back(std::make_shared<PacketFile>(fd,
+                                                                 file_size));
+        source.file = plan.packet_files.back().get();
+        return source;
+    }
+
+    if (file_size > static_cast<uintmax_t>
+                    (std::numeric_limits<size_t>::max()))
+    {
+        std::string error_msg = "File "
+                                + path.string()
+                                + " is too large for your platform's "
+                                    "memory (exceeds size_t)";
+        return std::unexpected{std::move(error_msg)};
+    }
+
+    // Anything but a mapping mode (OFF or unset) reads into the arena.
+    if (settings.mmap == "ON"
+        || settings.mmap == "POPULATE"
+        || settings.mmap == "HUGEPAGE")
+    {
+        auto mapping = map_packet_file(path,
+                                       static_cast<size_t>(file_size),
+                                       settings.mmap);
+
+        if (!mapping)
+        {
+            return std::unexpected{std::move(mapping.error())};
+        }
+
+        source.data = (*mapping)->bytes();
+        plan.packet_mappings.push_back(std::move(*mapping));
+        return source;
+    }
+
+    // Allocate memory in the pmr vector.
+    std::pmr::vector<uint8_t> buf{memory};
+
+    // If this fails, we are OOM.
+    try
+    {
+        buf.resize(static_cast<size_t>(file_size));
+    }
+    catch (const std::exception & error)
+    {
+        std::string error_msg = "Failed to allocate memory ("
+                                + std::to_string(file_size)
+                                + " bytes) for packet file "
+                                + path.string();
+        return std::unexpected{std::move(error_msg)};
+    }
+
+    // Try to write to the contiguous buffer.
+    std::string error_msg = Resolver::read_bytes_to_contiguous
+                                (
+                                    path,
+                                    {buf.data(), buf.size()}
+                                );
+
+    if (!error_msg.empty())
+    {
+        std::string e_msg = "Failed to read data for packet "
+                            + path.string()
+                            + " (got error: "
+                            + error_msg
+                            + ")";
+        return std::unexpected{std::move(e_msg)};
+    }
+
+    // Place this vector into our vector of packets.
+    source.arena_index = plan.packet_data.size();
+    plan.packet_data.push_back(std::move(buf));
+
+    return source;
+}
+
 template<typename Session>
 std::expected<ExecutionPlan<Session>, std::string>
 generate_plan_common(const DSLData & script,
@@ -60,6 +596,17 @@ generate_plan_common(const DSLData & script,
                                  settings.repeat,
                                  settings.packet_sample_rate);
 
+    session_config.batch_size = settings.batch_size;
+    session_config.udp_gso = settings.gso;
+    session_config.udp_gro = settings.gro;
+    session_config.shared_buffers = settings.shared_buffers;
+    session_config.zerocopy_threshold = settings.zerocopy_threshold;
+    session_config.response_queue_size = settings.response_queue_size;
+    session_config.drop_responses = (settings.backpressure == "DROP");
+    session_config.coalesce_limit = settings.coalesce_limit;
+    session_config.counter_block = settings.counter_block;
+    session_config.clock_mode = make_clock_mode(settings);
+
     // Put this all into our plan's orchestrator config.
     ExecutionPlan<Session> plan
                     (
@@ -72,18 +619,19 @@ generate_plan_common(const DSLData & script,
                     );
 
 
-    // Vector index for our std::pmr values.
-    std::unordered_map<std::string, size_t> identity_map;
+    // Packets for each identifier, more than one for a directory.
+    std::unordered_map<std::string, std::vector<PacketSource>> packet_sources;
 
     // Duplicate detection based on file paths.
-    std::unordered_set<std::filesystem::path> all_packets;
+    std::unordered_map<std::filesystem::path, PacketSource> loaded_packets;
 
     // Reserve now, we have good estimates for how many elements we need.
-    all_packets.reserve(settings.packet_identifiers.size());
-    identity_map.reserve(settings.packet_identifiers.size());
+    packet_sources.reserve(settings.packet_identifiers.size());
+    loaded_packets.reserve(settings.packet_identifiers.size());
     plan.packet_data.reserve(settings.packet_identifiers.size());
 
-    // Read every packet we need into our arena allocator.
+    // Load every packet we need, into our arena allocator unless it is
+    // mapped or left on disk.
     for (const auto & [identifier, filename] : settings.packet_identifiers)
     {
         // Resolve the file
@@ -100,95 +648,68 @@ generate_plan_common(const DSLData & script,
             return std::unexpected(std::move(error_msg));
         }
 
-        // If we have already read the packet, map the identifier
-        // to this packet data.
-        if (all_packets.contains(path))
+        std::vector<std::filesystem::path> files{path};
+
+        // A directory is a corpus, every file in it is its own packet.
+        std::error_code ec;
+
+        if (std::filesystem::is_directory(path, ec))
         {
-            auto dupe_iter = identity_map.find(filename);
+            files = Resolver::list_directory_files(path, error_str);
 
-            // Prevent running the application if we found a dupe
-            // but also never read this into memory. This should
-            // never happen so we should abort now.
-            if (dupe_iter == identity_map.end())
+            if (files.empty())
             {
-                std::string error_msg = "Application identified a packet "
-                                        "as a duplicate but no memory "
-                                        "was allocated. This is an error "
-                                        "with the application code.";
-                return std::unexpected{std::move(error_msg)};
-            }
-
-            // identity for packet -> index into vector we already read.
-            identity_map[identifier] = dupe_iter->second;
-            continue;
-        }
+                std::string error_msg = "Packet directory "
+                                        + path.string()
+                                        + " has no files to read";
 
-        // If we haven't seen this packet, insert into the map,
-        // read the packet into our vector, and set the index.
-        all_packets.insert(path);
+                if (!error_str.empty())
+                {
+                    error_msg += " (got error: " + error_str + ")";
+                }
 
-        size_t this_index = plan.packet_data.size();
+                return std::unexpected(std::move(error_msg));
+            }
+        }
 
-        // We need to get enough space for this vector's data.
-        uintmax_t file_size = Resolver::get_file_size(path);
+        auto & sources = packet_sources[identifier];
+        sources.reserve(files.size());
 
-        if (file_size == 0)
+        for (const auto & file : files)
         {
-            std::string error_msg = "File "
-                                    + path.string()
-                                    + " has zero bytes to read!";
-            return std::unexpected{std::move(error_msg)};
-        }
+            // If we have already loaded the packet, share its data.
+            auto loaded_iter = loaded_packets.find(file);
 
-        if (file_size > static_cast<uintmax_t>
-                        (std::numeric_limits<size_t>::max()))
-        {
-            std::string error_msg = "File "
-                                    + path.string()
-                                    + " is too large for your platform's "
-                                        "memory (exceeds size_t)";
-            return std::unexpected{std::move(error_msg)};
-        }
+            if (loaded_iter != loaded_packets.end())
+            {
+                sources.push_back(loaded_iter->second);
+                continue;
+            }
 
-        // Allocate memory in the pmr vector.
-        std::pmr::vector<uint8_t> buf{memory};
+            auto source = load_packet(file, settings, plan, memory);
 
-        // If this fails, we are OOM.
-        try
-        {
-            buf.resize(static_cast<size_t>(file_size));
-        }
-        catch (const std::exception & error)
-        {
-            std::string error_msg = "Failed to allocate memory ("
-                                    + std::to_string(file_size)
-                                    + " bytes) for packet file "
-                                    + path.string();
-            return std::unexpected{std::move(error_msg)};
-        }
+            if (!source)
+            {
+                return std::unexpected{std::move(source.error())};
+            }
 
-        // Try to write to the contiguous buffer.
-        std::string error_msg = Resolver::read_bytes_to_contiguous
-                                    (
-                                        path,
-                                        {buf.data(), buf.size()}
-                                    );
+            loaded_packets.emplace(file, *source);
+            sources.push_back(*source);
+        }
+    }
 
-        if (!error_msg.empty())
+    // Arena packets are only pointed to once every packet is read, since
+    // packet_data may move its vectors while it grows.
+    for (auto & [identifier, sources] : packet_sources)
+    {
+        for (auto & source : sources)
         {
-            std::string e_msg = "Failed to read data for packet "
-                                + path.string()
-                                + " (got error: "
-                                + error_msg
-                                + ")";
-            return std::unexpected{std::move(e_msg)};
+            if (source.arena_index != PacketSource::NO_ARENA)
+            {
+                const auto & buf = plan.packet_data[source.arena_index];
+                source.data = {buf.data(), buf.size()};
+            }
         }
-
-        // Place this vector into our vector of packets.
-        plan.packet_data.push_back(buf);
-
-        // Save the packet ID to data mapping.
-        identity_map[identifier] = this_index;
     }
 
     // Store the current offset.
@@ -223,21 +744,13 @@ generate_plan_common(const DSLData & script,
             }
             case ActionType::SEND:
             {
-                desc.make_send(action.range.start,
-                                action.range.second,
-                                action.count,
-                                curr_offset);
-
-                // For SEND, we must setup a payload.
-                PayloadDescriptor payload;
+                // Resolve the packet ID to what we loaded for it, one
+                // packet for a file or one per file of a directory.
+                auto s_iter = packet_sources.find(action.packet_identifier);
 
-                // Resolve the packet ID to one of
-                // our arena allocated packets.
-                auto p_iter = identity_map.find(action.packet_identifier);
-
-                // If we can't find the index, there is something wrong,
+                // If we can't find the packets, there is something wrong,
                 // under normal operation the program should not do this.
-                if (p_iter == identity_map.end())
+                if (s_iter == packet_sources.end())
                 {
                     std::string e_msg = "Failed to map packet identity "
                                         + action.packet_identifier
@@ -246,161 +759,66 @@ generate_plan_common(const DSLData & script,
                     return std::unexpected{std::move(e_msg)};
                 }
 
-                size_t p_index = p_iter->second;
-                const auto & buf = plan.packet_data[p_index];
-
-                // Create the const span to the data. This packet
-                // MUST NOT be modified from now on.
-                payload.packet_data = {buf.data(), buf.size()};
+                // Each session sends every packet of a directory COPIES
+                // times, in the order the files were listed.
+                uint64_t send_count = static_cast<uint64_t>(action.count)
+                                      * s_iter->second.size();
 
-                size_t ts_idx = 0;
-                size_t c_idx = 0;
-                size_t data_index = 0;
-
-                // If we have no modifications, mark the payload
-                // as one static read and continue to the next action.
-                if (action.mod_order.empty())
+                if (send_count > std::numeric_limits<uint32_t>::max())
                 {
-                    PacketOperation identity;
-                    identity.make_identity(buf.size());
-
-                    payload.ops.push_back(std::move(identity));
-
-                    // Set counter step as none for this payload.
-                    //
-                    // We store a counter per payload descriptor to allow O(1)
-                    // contiguous access during runtime at the
-                    // cost of a few bytes.
-                    //
-                    // These are cheap descriptors, so we just dupe them
-                    // because even at 1 million payloads (gross misuse)
-                    // we would only have ~230 MiB of data.
-                    //
-                    // Users can reduce this by simply enabling looping.
-                    //
-                    // See packets/payload-manager.cpp
-                    for (size_t i = 0; i < action.count; i++)
-                    {
-                        std::vector<uint16_t> empty_counters;
-
-                        plan.counter_steps.push_back(empty_counters);
-                        plan.payloads.push_back(payload);
-                    }
-                    break;
+                    std::string e_msg = "SEND of "
+                                        + action.packet_identifier
+                                        + " would make "
+                                        + std::to_string(send_count)
+                                        + " sends per session, the limit is "
+                                        + std::to_string(
+                                            std::numeric_limits<uint32_t>::max());
+                    return std::unexpected{std::move(e_msg)};
                 }
-                // Fetch the operations to be applied for this payload.
+
+                desc.make_send(action.range.start,
+                                action.range.second,
+                                static_cast<uint32_t>(send_count),
+                                curr_offset);
 
                 // For each COUNTER declared, we store a counter.
                 std::vector<uint16_t> counter_list;
                 counter_list.reserve(action.counter_mods.size());
 
-                for (const auto & mod : action.mod_order)
+                for (const auto & c_mod : action.counter_mods)
                 {
-                    if (mod == ModificationType::Counter)
-                    {
-                        const auto & c_mod = action.counter_mods[c_idx];
-                        c_idx++;
-
-                        // First, insert the previous "identity" payload
-                        // of all bytes between this mod and the last.
-                        //
-                        // This is the counter start index minus the
-                        // previous index from other operations.
-                        size_t prev_bytes = c_mod.counter_bytes.start
-                                            - data_index;
-
-                        if (prev_bytes > 0)
-                        {
-                            PacketOperation identity;
-                            identity.make_identity(prev_bytes);
-
-                            payload.ops.push_back(std::move(identity));
-                            data_index += prev_bytes;
-                        }
-
-                        // Turn this counter into a packet operation.
-                        PacketOperation counter;
-                        counter.make_counter(c_mod.counter_bytes.second,
-                                             c_mod.little_endian);
-
-                        // Push these operations and the counter step.
-                        payload.ops.push_back(std::move(counter));
-
-                        counter_list.push_back(c_mod.counter_step);
-
-                        // Increment the index.
-                        data_index += c_mod.counter_bytes.second;
-                    }
-                    else if (mod == ModificationType::Timestamp)
-                    {
-                        const auto & ts_mod = action.timestamp_mods[ts_idx];
-                        ts_idx++;
-
-                        size_t prev_bytes = ts_mod.timestamp_bytes.start
-                                            - data_index;
-
-                        if (prev_bytes > 0)
-                        {
-                            PacketOperation identity;
-                            identity.make_identity(prev_bytes);
-
-                            payload.ops.push_back(std::move(identity));
-                            data_index += prev_bytes;
-                        }
-
-                        // We need to resolve the time format here.
-                        //
-                        // This should be valid from previous checks when
-                        // parsing the script, but it is good to ensure
-                        // correctness here as well.
-                        auto format_iter = ts_format_lookup
-                                                .find(ts_mod.format_name);
-
-                        if (format_iter == ts_format_lookup.end())
-                        {
-                            std::string e_msg = "Failed to resolve "
-                                                "timestamp format "
-                                                "for value "
-                                                + ts_mod.format_name
-                                                + " (this should have "
-                                                "been caught by the "
-                                                "DSL validator)";
-
-                            return std::unexpected{e_msg};
-                        }
-
-                        TimestampFormat ts_format = format_iter->second;
-
-                        PacketOperation timestamp;
-                        timestamp.make_timestamp(ts_mod.timestamp_bytes.second,
-                                                 ts_mod.little_endian,
-                                                 ts_format);
-
-                        payload.ops.push_back(std::move(timestamp));
-
-                        // Increment the index.
-                        data_index += ts_mod.timestamp_bytes.second;
-                    }
+                    counter_list.push_back(c_mod.counter_step);
                 }
 
-                // Insert the remaining bytes if any exist.
-                if (data_index < buf.size())
+                for (const auto & source : s_iter->second)
                 {
-                    size_t remaining = buf.size() - data_index;
+                    PayloadDescriptor payload;
 
-                    PacketOperation identity;
-                    identity.make_identity(remaining);
-                    payload.ops.push_back(std::move(identity));
-                }
+                    // This packet MUST NOT be modified from now on.
+                    payload.packet_data = source.data;
+                    payload.file = source.file;
 
-                // See prior discussion on why we duplicate here, each send
-                // copy needs its own descriptor and counters.
-                for (size_t i = 0; i < action.count; i++)
-                {
+                    auto ops = make_payload_ops(action, source.size);
+
+                    if (!ops)
+                    {
+                        return std::unexpected{std::move(ops.error())};
+                    }
+
+                    payload.ops = std::move(*ops);
+
+                    // One descriptor stands for every copy, the payload
+                    // manager maps payload indices back to it.
+                    //
+                    // See packets/payload-manager.cpp
+                    payload.copies = action.count;
+
+                    // Counters are kept per file, its copies share them.
                     plan.counter_steps.push_back(counter_list);
-                    plan.payloads.push_back(payload);
+                    plan.payloads.push_back(std::move(payload));
                 }
 
+                plan.send_payloads.push_back(s_iter->second.size());
                 break;
             }
             case ActionType::FLOOD:
@@ -442,67 +860,86 @@ generate_execution_plan(const DSLData & script,
 {
     const auto & settings = script.settings;
 
+    HandlerStartup startup;
+
     // Handle generating plan for TCPSession execution.
-    if constexpr (std::is_same_v<Session, TCPSession>)
+    if constexpr (is_tcp_session<Session>)
     {
         using tcp = asio::ip::tcp;
 
-        // Create the message handler factory.
-        typename Shard<Session>::MessageHandlerFactory factory;
-
-        if (!settings.read
-            || settings.handler_value == "NOP")
+#ifdef __linux__
+        // Fail early instead of having every session fail to connect.
+        if constexpr (std::is_same_v<Session, TCPUringSession>)
         {
-            factory = []() -> std::unique_ptr<MessageHandler>
+            if (!IoUringService::supported())
             {
-                return std::make_unique<NOPMessageHandler>();
-            };
+                std::string error_msg = "TCP_URING was requested but io_uring "
+                                        "is not available on this system";
+                return std::unexpected{error_msg};
+            }
         }
-        else if (settings.handler_value.ends_with(".wasm"))
-        {
-            // Create the WASM engine and module.
-            wasmtime::Config WASM_config;
-            auto engine = std::make_shared<wasmtime::Engine>(
-                                std::move(WASM_config));
+#endif
+
+        // Create the message handler factory.
+        typename Shard<Session>::MessageHandlerFactory factory;
 
-            std::vector<uint8_t> wasm_bytes;
-            std::string error_msg;
+        auto length_field = make_length_field(settings);
 
-            auto path = Resolver::resolve_file(settings.handler_value,
-                                               error_msg);
+        // Without READ a module is only used if it generates payloads.
+        if (settings.handler_value.ends_with(".wasm"))
+        {
+            auto handler_module = load_handler_module(settings, startup);
 
-            if (!error_msg.empty())
+            if (!handler_module)
             {
-                // If we could not resolve, stop now.
-                return std::unexpected{error_msg};
+                return std::unexpected{handler_module.error()};
             }
 
-            wasm_bytes = Resolver::read_binary_file(path, error_msg);
-
-            if (!error_msg.empty())
+            if (settings.read || handler_module->generates)
             {
-                // If we could not read, stop now.
-                return std::unexpected{error_msg};
+                WASMHandlerOptions options;
+                options.length_field = length_field;
+                options.guest_memory = settings.guest_memory;
+                options.instance_pre = handler_module->instance_pre;
+                set_handler_limits(settings, *handler_module, options);
+
+                factory = pool_handlers(settings,
+                                        [handler_module = std::move(*handler_module), options]()
+                                        -> std::unique_ptr<MessageHandler>
+                                        {
+                                            return std::make_unique<WASMMessageHandler>(handler_module.engine,
+                                                                                        handler_module.module,
+                                                                                        options);
+                                        });
             }
+        }
+        else if (settings.read && settings.handler_value.ends_with(".so"))
+        {
+            auto library = load_native_library(settings);
 
-            auto module_tmp = wasmtime::Module::compile(*engine, wasm_bytes);
-
-            if (!module_tmp)
+            if (!library)
             {
-                // If we can't make the module, stop now.
-                error_msg = "Failed to compile WASM module for file "
-                            + path.string();
-                return std::unexpected{error_msg};
+                return std::unexpected{library.error()};
             }
 
-            auto wasm_module = std::make_shared<wasmtime::Module>(
-                                            module_tmp.unwrap());
+            factory = [library = std::move(*library), length_field]()
+                      -> std::unique_ptr<MessageHandler>
+            {
+                return std::make_unique<NativeMessageHandler>(library, length_field);
+            };
+        }
 
-            factory = [engine, wasm_module]() -> std::unique_ptr<MessageHandler>
-                      {
-                          return std::make_unique<WASMMessageHandler>(engine,
-                                                                      wasm_module);
-                      };
+        if (!factory)
+        {
+            factory = [length_field]() -> std::unique_ptr<MessageHandler>
+            {
+                if (length_field)
+                {
+                    return std::make_unique<NOPMessageHandler>(*length_field);
+                }
+
+                return std::make_unique<NOPMessageHandler>();
+            };
         }
 
         // Get host data.
@@ -567,8 +1004,11 @@ generate_execution_plan(const DSLData & script,
             return std::unexpected(std::move(e_msg));
         }
 
+        auto plan = *possible_plan;
+        plan.startup = startup;
+
         // Return the computed plan.
-        return *possible_plan;
+        return plan;
     }
     // Handle generating plan for UDPSession execution.
     else if constexpr (std::is_same_v<Session, UDPSession>)
@@ -578,59 +1018,53 @@ generate_execution_plan(const DSLData & script,
         // Create the message handler factory.
         typename Shard<Session>::MessageHandlerFactory factory;
 
-        if (!settings.read
-            || settings.handler_value == "NOP")
-        {
-            factory = []() -> std::unique_ptr<MessageHandler>
-            {
-                return std::make_unique<NOPMessageHandler>();
-            };
-        }
-        else if (settings.handler_value.ends_with(".wasm"))
+        // Without READ a module is only used if it generates payloads.
+        if (settings.handler_value.ends_with(".wasm"))
         {
-            // Create the WASM engine and module.
-            wasmtime::Config WASM_config;
-            auto engine = std::make_shared<wasmtime::Engine>(
-                                std::move(WASM_config));
+            auto handler_module = load_handler_module(settings, startup);
 
-            std::vector<uint8_t> wasm_bytes;
-            std::string error_msg;
-
-            auto path = Resolver::resolve_file(settings.handler_value,
-                                               error_msg);
-
-            if (!error_msg.empty())
+            if (!handler_module)
             {
-                // If we could not resolve, stop now.
-                return std::unexpected{error_msg};
+                return std::unexpected{handler_module.error()};
             }
 
-            wasm_bytes = Resolver::read_binary_file(path, error_msg);
-
-            if (!error_msg.empty())
+            if (settings.read || handler_module->generates)
             {
-                // If we could not read, stop now.
-                return std::unexpected{error_msg};
+                WASMHandlerOptions options;
+                options.instance_pre = handler_module->instance_pre;
+                set_handler_limits(settings, *handler_module, options);
+
+                factory = pool_handlers(settings,
+                                        [handler_module = std::move(*handler_module), options]()
+                                        -> std::unique_ptr<MessageHandler>
+                                        {
+                                            return std::make_unique<WASMMessageHandler>(handler_module.engine,
+                                                                                        handler_module.module,
+                                                                                        options);
+                                        });
             }
+        }
+        else if (settings.read && settings.handler_value.ends_with(".so"))
+        {
+            auto library = load_native_library(settings);
 
-            auto module_tmp = wasmtime::Module::compile(*engine, wasm_bytes);
-
-            if (!module_tmp)
+            if (!library)
             {
-                // If we can't make the module, stop now.
-                error_msg = "Failed to compile WASM module for file "
-                            + path.string();
-                return std::unexpected{error_msg};
+                return std::unexpected{library.error()};
             }
 
-            auto wasm_module = std::make_shared<wasmtime::Module>(
-                                            module_tmp.unwrap());
+            factory = [library = std::move(*library)]() -> std::unique_ptr<MessageHandler>
+            {
+                return std::make_unique<NativeMessageHandler>(library);
+            };
+        }
 
-            factory = [engine, wasm_module]() -> std::unique_ptr<MessageHandler>
-                      {
-                          return std::make_unique<WASMMessageHandler>(engine,
-                                                                      wasm_module);
-                      };
+        if (!factory)
+        {
+            factory = []() -> std::unique_ptr<MessageHandler>
+            {
+                return std::make_unique<NOPMessageHandler>();
+            };
         }
 
         // Get host data.
@@ -688,6 +1122,7 @@ generate_execution_plan(const DSLData & script,
         }
 
         auto plan = *possible_plan;
+        plan.startup = startup;
 
         bool oversized = false;
 
@@ -732,10 +1167,14 @@ template std::string ExecutionPlan<TCPSession>::dump_endpoint_list() const;
 
 template std::string ExecutionPlan<UDPSession>::dump_endpoint_list() const;
 
+#ifdef __linux__
+template std::string ExecutionPlan<TCPUringSession>::dump_endpoint_list() const;
+#endif
+
 template<typename Session>
 inline std::string ExecutionPlan<Session>::dump_endpoint_list() const
 {
-    if constexpr (std::is_same_v<Session, TCPSession>)
+    if constexpr (is_tcp_session<Session>)
     {
         std::string endpoint_list;
 
@@ -22,16 +22,31 @@
 #include "orchestrator-config.h"
 #include "payload-structs.h"
 
+#include <chrono>
 #include <expected>
+#include <memory>
 #include <memory_resource>
 
 enum class ProtocolType : uint8_t
 {
     TCP,
     UDP,
+    TCP_URING,
     UNDEFINED
 };
 
+// How long the message handler took to get ready, shown by --dry-run.
+struct HandlerStartup
+{
+    bool wasm{false};
+
+    // The compiled module came from the on disk cache.
+    bool cached{false};
+
+    // Compile (or cache load) and import resolution.
+    std::chrono::microseconds load_time{0};
+};
+
 template<typename Session>
 struct ExecutionPlan
 {
@@ -53,11 +68,22 @@ public:
     std::vector<PayloadDescriptor> payloads;
     std::vector<std::vector<uint16_t>> counter_steps;
 
+    // Payload descriptors made by each SEND, one per file of a packet directory.
+    std::vector<size_t> send_payloads;
+
     // Settings for the orchestrator ripped from the script.
     OrchestratorConfig<Session> config;
 
     // Arena allocated packet buffers.
     std::pmr::vector<std::pmr::vector<uint8_t>> packet_data;
+
+    // Packets left on disk, shared between copies of the plan.
+    std::vector<std::shared_ptr<PacketFile>> packet_files;
+
+    // Read only packet mappings, shared between copies of the plan.
+    std::vector<std::shared_ptr<PacketMapping>> packet_mappings;
+
+    HandlerStartup startup;
 };
 
 template<typename Session>
@@ -19,6 +19,7 @@
 #include "lexer.h"
 #include "parser.h"
 #include "resolver.h"
+#include "length-field.h"
 
 #include <fstream>
 #include <thread>
@@ -181,6 +182,38 @@ void Interpreter::set_script_defaults()
     {
         settings.packet_sample_rate = DEFAULT_PACKET_SAMPLE_RATE;
     }
+
+    // If the batch size is 0, send one packet per call unless we
+    // have GSO enabled, which needs a batch to join.
+    if (settings.batch_size == 0)
+    {
+        settings.batch_size = settings.gso ? DEFAULT_GSO_BATCH_SIZE
+                                           : DEFAULT_BATCH_SIZE;
+    }
+
+    // If the response queue size is 0, set to default.
+    if (settings.response_queue_size == 0)
+    {
+        settings.response_queue_size = DEFAULT_RESPONSE_QUEUE_SIZE;
+    }
+
+    // Stop reading instead of dropping responses unless asked.
+    if (settings.backpressure.empty())
+    {
+        settings.backpressure = "PAUSE";
+    }
+
+    // Every clock read asks the OS unless asked.
+    if (settings.clock.empty())
+    {
+        settings.clock = "SYSTEM";
+    }
+
+    // Packets are read into the arena unless asked.
+    if (settings.mmap.empty())
+    {
+        settings.mmap = "OFF";
+    }
     
     // We already default the orchestrator actions during parse since we
     // validate the data is possibly correct (but not validated yet).
@@ -211,13 +244,20 @@ ParseResult Interpreter::verify_script()
                                             PrintStyle::BadValue)
                             + " (expected one of "
                             + styled_string("TCP", PrintStyle::Expected)
+                            + ", "
+                            + styled_string("UDP", PrintStyle::Expected)
+#ifdef __linux__
+                            + ", "
+                            + styled_string("TCP_URING", PrintStyle::Expected)
+#endif
                             + ")";
         return arbitrary_error(std::move(e_msg));
     }
 
     // Ensure we have a valid port if needed.
     if (settings.session_protocol == "TCP"
-        || settings.session_protocol == "UDP")
+        || settings.session_protocol == "UDP"
+        || settings.session_protocol == "TCP_URING")
     {
         if (settings.port == 0)
         {
@@ -272,6 +312,406 @@ ParseResult Interpreter::verify_script()
         return arbitrary_error(std::move(e_msg));
     }
 
+    // Keep batches within what a single sendmmsg/recvmmsg call accepts.
+    if (settings.batch_size > MAX_BATCH_SIZE)
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("BATCHSIZE", PrintStyle::BadField)
+                            + " set to "
+                            + styled_string(std::to_string(settings.batch_size),
+                                            PrintStyle::BadValue)
+                            + " (value must be between "
+                            + styled_string("1", PrintStyle::Limits)
+                            + " and "
+                            + styled_string(std::to_string(MAX_BATCH_SIZE),
+                                            PrintStyle::Limits)
+                            + ")";
+        return arbitrary_error(std::move(e_msg));
+    }
+
+#ifndef __linux__
+    // Segmentation offloads are Linux socket options.
+    if (settings.gso || settings.gro)
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string(settings.gso ? "GSO" : "GRO",
+                                            PrintStyle::BadField)
+                            + " enabled but it is only supported on Linux";
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    // MSG_ZEROCOPY is a Linux socket flag.
+    if (settings.zerocopy_threshold != 0)
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("ZEROCOPY", PrintStyle::BadField)
+                            + " set but it is only supported on Linux";
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    // sendfile differs between platforms, only Linux is handled.
+    if (settings.sendfile_threshold != 0)
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("SENDFILE", PrintStyle::BadField)
+                            + " set but it is only supported on Linux";
+        return arbitrary_error(std::move(e_msg));
+    }
+#endif
+
+    // Only TCPSession knows how to send packets from disk.
+    if (settings.sendfile_threshold != 0
+        && settings.session_protocol != "TCP")
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("SENDFILE", PrintStyle::BadField)
+                            + " set but "
+                            + styled_string("SESSION", PrintStyle::Keyword)
+                            + " is "
+                            + styled_string(settings.session_protocol,
+                                            PrintStyle::BadValue)
+                            + " (expected "
+                            + styled_string("TCP", PrintStyle::Expected)
+                            + ")";
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    // io_uring reads are submitted ahead of time, so they need their own buffer.
+    if (settings.shared_buffers && settings.session_protocol == "TCP_URING")
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("SHAREDBUFFERS", PrintStyle::BadField)
+                            + " enabled but "
+                            + styled_string("SESSION", PrintStyle::Keyword)
+                            + " is "
+                            + styled_string(settings.session_protocol,
+                                            PrintStyle::BadValue);
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    // Batched UDP reads hold datagrams across handlers, which a shared buffer can't.
+    if (settings.shared_buffers
+        && settings.session_protocol == "UDP"
+        && (settings.batch_size > 1 || settings.gso || settings.gro))
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("SHAREDBUFFERS", PrintStyle::BadField)
+                            + " enabled along with "
+                            + styled_string("BATCHSIZE", PrintStyle::Keyword)
+                            + " above "
+                            + styled_string("1", PrintStyle::Limits)
+                            + ", "
+                            + styled_string("GSO", PrintStyle::Keyword)
+                            + " or "
+                            + styled_string("GRO", PrintStyle::Keyword);
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    // Keep a session from queueing an unreasonable number of responses.
+    if (settings.response_queue_size > MAX_RESPONSE_QUEUE_SIZE)
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("RESPONSEQUEUE", PrintStyle::BadField)
+                            + " set to "
+                            + styled_string(std::to_string(settings.response_queue_size),
+                                            PrintStyle::BadValue)
+                            + " (value must be between "
+                            + styled_string("1", PrintStyle::Limits)
+                            + " and "
+                            + styled_string(std::to_string(MAX_RESPONSE_QUEUE_SIZE),
+                                            PrintStyle::Limits)
+                            + ")";
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    if (VALID_BACKPRESSURE.find(settings.backpressure)
+        == VALID_BACKPRESSURE.end())
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block had invalid "
+                            + styled_string("BACKPRESSURE", PrintStyle::BadField)
+                            + " "
+                            + styled_string(settings.backpressure,
+                                            PrintStyle::BadValue)
+                            + " (expected one of "
+                            + styled_string("PAUSE", PrintStyle::Expected)
+                            + ", "
+                            + styled_string("DROP", PrintStyle::Expected)
+                            + ")";
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    if (VALID_CLOCKS.find(settings.clock) == VALID_CLOCKS.end())
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block had invalid "
+                            + styled_string("CLOCK", PrintStyle::BadField)
+                            + " "
+                            + styled_string(settings.clock,
+                                            PrintStyle::BadValue)
+                            + " (expected one of "
+                            + styled_string("SYSTEM", PrintStyle::Expected)
+                            + ", "
+                            + styled_string("COARSE", PrintStyle::Expected)
+                            + ", "
+                            + styled_string("TSC", PrintStyle::Expected)
+                            + ")";
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    if (VALID_MMAP.find(settings.mmap) == VALID_MMAP.end())
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block had invalid "
+                            + styled_string("MMAP", PrintStyle::BadField)
+                            + " "
+                            + styled_string(settings.mmap,
+                                            PrintStyle::BadValue)
+                            + " (expected one of "
+                            + styled_string("OFF", PrintStyle::Expected)
+                            + ", "
+                            + styled_string("ON", PrintStyle::Expected)
+                            + ", "
+                            + styled_string("POPULATE", PrintStyle::Expected)
+                            + ", "
+                            + styled_string("HUGEPAGE", PrintStyle::Expected)
+                            + ")";
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    // Datagrams can't be joined, every response is its own send.
+    if (settings.coalesce_limit != 0 && settings.session_protocol == "UDP")
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("COALESCE", PrintStyle::BadField)
+                            + " set but "
+                            + styled_string("SESSION", PrintStyle::Keyword)
+                            + " is "
+                            + styled_string(settings.session_protocol,
+                                            PrintStyle::BadValue)
+                            + " (expected "
+                            + styled_string("TCP", PrintStyle::Expected)
+                            + " or "
+                            + styled_string("TCP_URING", PrintStyle::Expected)
+                            + ")";
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    // The length field has to fit in the header.
+    if (settings.length_width > LengthField::MAX_WIDTH)
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("LENGTHWIDTH", PrintStyle::BadField)
+                            + " set to "
+                            + styled_string(std::to_string(settings.length_width),
+                                            PrintStyle::BadValue)
+                            + " (value must be between "
+                            + styled_string("1", PrintStyle::Limits)
+                            + " and "
+                            + styled_string(std::to_string(LengthField::MAX_WIDTH),
+                                            PrintStyle::Limits)
+                            + ")";
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    if (settings.length_width != 0
+        && static_cast<uint64_t>(settings.length_offset) + settings.length_width
+           > settings.header_size)
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("LENGTHOFFSET", PrintStyle::BadField)
+                            + " "
+                            + styled_string(std::to_string(settings.length_offset),
+                                            PrintStyle::BadValue)
+                            + " and "
+                            + styled_string("LENGTHWIDTH", PrintStyle::BadField)
+                            + " "
+                            + styled_string(std::to_string(settings.length_width),
+                                            PrintStyle::BadValue)
+                            + " past the end of "
+                            + styled_string("HEADERSIZE", PrintStyle::Keyword)
+                            + " "
+                            + styled_string(std::to_string(settings.header_size),
+                                            PrintStyle::Limits);
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    // Datagrams have no header to parse.
+    if (settings.length_width != 0 && settings.session_protocol == "UDP")
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("LENGTHWIDTH", PrintStyle::BadField)
+                            + " set but "
+                            + styled_string("SESSION", PrintStyle::Keyword)
+                            + " is "
+                            + styled_string(settings.session_protocol,
+                                            PrintStyle::BadValue)
+                            + " (expected "
+                            + styled_string("TCP", PrintStyle::Expected)
+                            + " or "
+                            + styled_string("TCP_URING", PrintStyle::Expected)
+                            + ")";
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    // Only the asio TCP session reads into the handler's memory, io_uring
+    // requests may outlive the handler and datagrams arrive unsized.
+    if (settings.guest_memory && settings.session_protocol != "TCP")
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("GUESTMEMORY", PrintStyle::BadField)
+                            + " enabled but "
+                            + styled_string("SESSION", PrintStyle::Keyword)
+                            + " is "
+                            + styled_string(settings.session_protocol,
+                                            PrintStyle::BadValue)
+                            + " (expected "
+                            + styled_string("TCP", PrintStyle::Expected)
+                            + ")";
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    if (settings.guest_memory && !settings.handler_value.ends_with(".wasm"))
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("GUESTMEMORY", PrintStyle::BadField)
+                            + " enabled but "
+                            + styled_string("HANDLER", PrintStyle::Keyword)
+                            + " is "
+                            + styled_string(settings.handler_value,
+                                            PrintStyle::BadValue)
+                            + " (expected a "
+                            + styled_string(".wasm", PrintStyle::Expected)
+                            + " module)";
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    if (settings.handler_timeout_ms > MAX_HANDLER_TIMEOUT_MS)
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("HANDLERTIMEOUT", PrintStyle::BadField)
+                            + " set to "
+                            + styled_string(std::to_string(settings.handler_timeout_ms),
+                                            PrintStyle::BadValue)
+                            + " (value must be between "
+                            + styled_string("0", PrintStyle::Limits)
+                            + " and "
+                            + styled_string(std::to_string(MAX_HANDLER_TIMEOUT_MS),
+                                            PrintStyle::Limits)
+                            + ")";
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    // Deadlines only apply to guest code.
+    if ((settings.handler_timeout_ms != 0 || settings.handler_fuel != 0)
+        && !settings.handler_value.ends_with(".wasm"))
+    {
+        std::string field = settings.handler_timeout_ms != 0 ? "HANDLERTIMEOUT"
+                                                             : "HANDLERFUEL";
+
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string(field, PrintStyle::BadField)
+                            + " set but "
+                            + styled_string("HANDLER", PrintStyle::Keyword)
+                            + " is "
+                            + styled_string(settings.handler_value,
+                                            PrintStyle::BadValue)
+                            + " (expected a "
+                            + styled_string(".wasm", PrintStyle::Expected)
+                            + " module)";
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    if (settings.handler_threads > MAX_HANDLER_THREADS)
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("HANDLERTHREADS", PrintStyle::BadField)
+                            + " set to "
+                            + styled_string(std::to_string(settings.handler_threads),
+                                            PrintStyle::BadValue)
+                            + " (value must be between "
+                            + styled_string("0", PrintStyle::Limits)
+                            + " and "
+                            + styled_string(std::to_string(MAX_HANDLER_THREADS),
+                                            PrintStyle::Limits)
+                            + ")";
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    if (settings.counter_block > MAX_COUNTER_BLOCK)
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("COUNTERBLOCK", PrintStyle::BadField)
+                            + " set to "
+                            + styled_string(std::to_string(settings.counter_block),
+                                            PrintStyle::BadValue)
+                            + " (value must be between "
+                            + styled_string("0", PrintStyle::Limits)
+                            + " and "
+                            + styled_string(std::to_string(MAX_COUNTER_BLOCK),
+                                            PrintStyle::Limits)
+                            + ")";
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    // Only guest code is worth moving off the shards.
+    if (settings.handler_threads != 0
+        && !settings.handler_value.ends_with(".wasm"))
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("HANDLERTHREADS", PrintStyle::BadField)
+                            + " set but "
+                            + styled_string("HANDLER", PrintStyle::Keyword)
+                            + " is "
+                            + styled_string(settings.handler_value,
+                                            PrintStyle::BadValue)
+                            + " (expected a "
+                            + styled_string(".wasm", PrintStyle::Expected)
+                            + " module)";
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    // Messages are copied to the handler threads, they can't be read in place.
+    if (settings.guest_memory && settings.handler_threads != 0)
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("GUESTMEMORY", PrintStyle::BadField)
+                            + " enabled along with "
+                            + styled_string("HANDLERTHREADS", PrintStyle::Keyword);
+        return arbitrary_error(std::move(e_msg));
+    }
+
+    // Shared buffer reads never leave the shard's buffers.
+    if (settings.guest_memory && settings.shared_buffers)
+    {
+        std::string e_msg = styled_string("SETTINGS", PrintStyle::Keyword)
+                            + " block has "
+                            + styled_string("GUESTMEMORY", PrintStyle::BadField)
+                            + " enabled along with "
+                            + styled_string("SHAREDBUFFERS", PrintStyle::Keyword);
+        return arbitrary_error(std::move(e_msg));
+    }
+
     // Check that at least one endpoint exists.
     if (settings.endpoints.empty())
     {
@@ -328,8 +768,9 @@ ParseResult Interpreter::verify_script()
     if (settings.read && (VALID_MESSAGE_HANDLERS.find(settings.handler_value)
         == VALID_MESSAGE_HANDLERS.end()))
     {
-        // If we have a .wasm file, see that we can resolve it.
-        if (settings.handler_value.ends_with(".wasm"))
+        // If we have a .wasm module or .so plugin, see that we can resolve it.
+        if (settings.handler_value.ends_with(".wasm")
+            || settings.handler_value.ends_with(".so"))
         {
             std::string error_string;
             auto path = Resolver::resolve_file(settings.handler_value,
@@ -353,7 +794,7 @@ ParseResult Interpreter::verify_script()
                 return arbitrary_error(std::move(e_msg));
             }
         }
-        // No .wasm file and no alternative message handler,
+        // No handler file and no alternative message handler,
         // abort since we can't read yet read is enabled.
         else
         {
@@ -368,6 +809,8 @@ ParseResult Interpreter::verify_script()
                                 + styled_string("\"NOP\"", PrintStyle::Expected)
                                 + " or a file path ending in "
                                 + styled_string(".wasm", PrintStyle::Expected)
+                                + " or "
+                                + styled_string(".so", PrintStyle::Expected)
                                 + ")";
             return arbitrary_error(std::move(e_msg));
         }
@@ -679,7 +1122,8 @@ ParseResult Interpreter::verify_script()
                     return arbitrary_error(std::move(e_msg));
                 }
 
-                uintmax_t packet_size = Resolver::get_file_size(packet_path);
+                // Modifications must fit every file of a packet directory.
+                uintmax_t packet_size = Resolver::get_packet_size(packet_path);
 
                 if (packet_size == 0)
                 {
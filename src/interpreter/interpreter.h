@@ -29,6 +29,26 @@ class Interpreter
 public:
     static constexpr uint64_t DEFAULT_PACKET_SAMPLE_RATE = 100;
 
+    // sendmmsg and recvmmsg refuse more than UIO_MAXIOV messages per call.
+    static constexpr uint32_t DEFAULT_BATCH_SIZE = 1;
+    static constexpr uint32_t MAX_BATCH_SIZE = 1024;
+
+    // One full UDP_SEGMENT send worth of datagrams.
+    static constexpr uint32_t DEFAULT_GSO_BATCH_SIZE = 64;
+
+    // Responses a session may hold, slots are only allocated as it falls behind.
+    static constexpr uint32_t DEFAULT_RESPONSE_QUEUE_SIZE = 1024;
+    static constexpr uint32_t MAX_RESPONSE_QUEUE_SIZE = 65536;
+
+    // A handler call holds up its whole shard, a minute is already absurd.
+    static constexpr uint32_t MAX_HANDLER_TIMEOUT_MS = 60000;
+
+    // Each handler thread holds its own WASM instance.
+    static constexpr uint32_t MAX_HANDLER_THREADS = 256;
+
+    // Leased values are lost when a run ends, keep the gaps reasonable.
+    static constexpr uint32_t MAX_COUNTER_BLOCK = 1 << 20;
+
 public:
     ParseResult parse_script(std::string script_name);
 
@@ -338,6 +338,231 @@ ParseResult Parser::parse_settings(SettingsBlock & settings)
                     return int_res;
                 }
             }
+            else if (keyword.text == "BATCHSIZE")
+            {
+                ParseResult int_res = try_convert_int(value_token,
+                                                      settings.batch_size,
+                                                      "BATCHSIZE");
+                if (!int_res.success)
+                {
+                    return int_res;
+                }
+            }
+            else if (keyword.text == "GSO")
+            {
+                if (value_token.text == "true")
+                {
+                    settings.gso = true;
+                }
+                else if (value_token.text == "false")
+                {
+                    settings.gso = false;
+                }
+                else
+                {
+                    return bad_bool_error(value_token);
+                }
+            }
+            else if (keyword.text == "GRO")
+            {
+                if (value_token.text == "true")
+                {
+                    settings.gro = true;
+                }
+                else if (value_token.text == "false")
+                {
+                    settings.gro = false;
+                }
+                else
+                {
+                    return bad_bool_error(value_token);
+                }
+            }
+            else if (keyword.text == "SHAREDBUFFERS")
+            {
+                if (value_token.text == "true")
+                {
+                    settings.shared_buffers = true;
+                }
+                else if (value_token.text == "false")
+                {
+                    settings.shared_buffers = false;
+                }
+                else
+                {
+                    return bad_bool_error(value_token);
+                }
+            }
+            else if (keyword.text == "COALESCE")
+            {
+                ParseResult int_res = try_convert_int(value_token,
+                                                      settings.coalesce_limit,
+                                                      "COALESCE");
+                if (!int_res.success)
+                {
+                    return int_res;
+                }
+            }
+            else if (keyword.text == "RESPONSEQUEUE")
+            {
+                ParseResult int_res = try_convert_int(value_token,
+                                                      settings.response_queue_size,
+                                                      "RESPONSEQUEUE");
+                if (!int_res.success)
+                {
+                    return int_res;
+                }
+            }
+            else if (keyword.text == "BACKPRESSURE")
+            {
+                // Checked against VALID_BACKPRESSURE during verification.
+                settings.backpressure = value_token.text;
+            }
+            else if (keyword.text == "LENGTHOFFSET")
+            {
+                ParseResult int_res = try_convert_int(value_token,
+                                                      settings.length_offset,
+                                                      "LENGTHOFFSET");
+                if (!int_res.success)
+                {
+                    return int_res;
+                }
+            }
+            else if (keyword.text == "LENGTHWIDTH")
+            {
+                ParseResult int_res = try_convert_int(value_token,
+                                                      settings.length_width,
+                                                      "LENGTHWIDTH");
+                if (!int_res.success)
+                {
+                    return int_res;
+                }
+            }
+            else if (keyword.text == "LENGTHENDIAN")
+            {
+                if (value_token.text == "little")
+                {
+                    settings.length_little_endian = true;
+                }
+                else if (value_token.text == "big")
+                {
+                    settings.length_little_endian = false;
+                }
+                else
+                {
+                    return bad_endian_error(value_token);
+                }
+            }
+            else if (keyword.text == "LENGTHADJUST")
+            {
+                ParseResult int_res = try_convert_signed_int(value_token,
+                                                             settings.length_adjust,
+                                                             "LENGTHADJUST");
+                if (!int_res.success)
+                {
+                    return int_res;
+                }
+            }
+            else if (keyword.text == "LENGTHINCLUDESHEADER")
+            {
+                if (value_token.text == "true")
+                {
+                    settings.length_includes_header = true;
+                }
+                else if (value_token.text == "false")
+                {
+                    settings.length_includes_header = false;
+                }
+                else
+                {
+                    return bad_bool_error(value_token);
+                }
+            }
+            else if (keyword.text == "GUESTMEMORY")
+            {
+                if (value_token.text == "true")
+                {
+                    settings.guest_memory = true;
+                }
+                else if (value_token.text == "false")
+                {
+                    settings.guest_memory = false;
+                }
+                else
+                {
+                    return bad_bool_error(value_token);
+                }
+            }
+            else if (keyword.text == "HANDLERTIMEOUT")
+            {
+                ParseResult int_res = try_convert_int(value_token,
+                                                      settings.handler_timeout_ms,
+                                                      "HANDLERTIMEOUT");
+                if (!int_res.success)
+                {
+                    return int_res;
+                }
+            }
+            else if (keyword.text == "HANDLERFUEL")
+            {
+                ParseResult int_res = try_convert_int(value_token,
+                                                      settings.handler_fuel,
+                                                      "HANDLERFUEL");
+                if (!int_res.success)
+                {
+                    return int_res;
+                }
+            }
+            else if (keyword.text == "HANDLERTHREADS")
+            {
+                ParseResult int_res = try_convert_int(value_token,
+                                                      settings.handler_threads,
+                                                      "HANDLERTHREADS");
+                if (!int_res.success)
+                {
+                    return int_res;
+                }
+            }
+            else if (keyword.text == "MMAP")
+            {
+                // Checked against VALID_MMAP during verification.
+                settings.mmap = value_token.text;
+            }
+            else if (keyword.text == "CLOCK")
+            {
+                // Checked against VALID_CLOCKS during verification.
+                settings.clock = value_token.text;
+            }
+            else if (keyword.text == "COUNTERBLOCK")
+            {
+                ParseResult int_res = try_convert_int(value_token,
+                                                      settings.counter_block,
+                                                      "COUNTERBLOCK");
+                if (!int_res.success)
+                {
+                    return int_res;
+                }
+            }
+            else if (keyword.text == "ZEROCOPY")
+            {
+                ParseResult int_res = try_convert_int(value_token,
+                                                      settings.zerocopy_threshold,
+                                                      "ZEROCOPY");
+                if (!int_res.success)
+                {
+                    return int_res;
+                }
+            }
+            else if (keyword.text == "SENDFILE")
+            {
+                ParseResult int_res = try_convert_int(value_token,
+                                                      settings.sendfile_threshold,
+                                                      "SENDFILE");
+                if (!int_res.success)
+                {
+                    return int_res;
+                }
+            }
             else if (keyword.text == "SHARDS")
             {
                 ParseResult int_res = try_convert_int(value_token,
@@ -707,6 +932,23 @@ ParseResult Parser::try_convert_int(const Token & t,
     return good_parse();
 }
 
+ParseResult Parser::try_convert_signed_int(const Token & t,
+                                           int32_t & res,
+                                           const std::string & keyword)
+{
+    try
+    {
+        res = std::stoi(t.text);
+    }
+    catch (const std::exception & error)
+    {
+        // Return error
+        return bad_integer_error(t, keyword);
+    }
+
+    return good_parse();
+}
+
 ParseResult Parser::try_parse_range(const Token & first_value,
                                     Range & range,
                                     const std::string & keyword)
@@ -55,6 +55,11 @@ private:
                                 uint32_t & res,
                                 const std::string & keyword);
 
+    // Same as above, but negative values are allowed.
+    ParseResult try_convert_signed_int(const Token & t,
+                                       int32_t & res,
+                                       const std::string & keyword);
+
     // Try to parse [:][Value] from the token sequence, then convert.
     ParseResult try_parse_range(const Token & first_value,
                                 Range & range,
@@ -29,7 +29,31 @@ inline constexpr bool always_false{false};
 
 const std::unordered_set<std::string> VALID_PROTOCOLS {
     "TCP",
-    "UDP"
+    "UDP",
+#ifdef __linux__
+    "TCP_URING"
+#endif
+};
+
+// What a session does once its response queue is full.
+const std::unordered_set<std::string> VALID_BACKPRESSURE {
+    "PAUSE",
+    "DROP"
+};
+
+// Where shards read the time for timestamps and latency samples.
+const std::unordered_set<std::string> VALID_CLOCKS {
+    "SYSTEM",
+    "COARSE",
+    "TSC"
+};
+
+// How packets are loaded, read into memory or mapped from their files.
+const std::unordered_set<std::string> VALID_MMAP {
+    "OFF",
+    "ON",
+    "POPULATE",
+    "HUGEPAGE"
 };
 
 // Does not include user defined .wasm files.
@@ -155,6 +179,39 @@ struct SettingsBlock
     bool read{false};
     bool repeat{false};
     uint32_t packet_sample_rate{0};
+    uint32_t batch_size{0};
+    bool gso{false};
+    bool gro{false};
+    uint32_t zerocopy_threshold{0};
+    uint32_t sendfile_threshold{0};
+    bool shared_buffers{false};
+    uint32_t coalesce_limit{0};
+    uint32_t response_queue_size{0};
+    std::string backpressure;
+
+    // Native header length field, disabled while the width is 0.
+    uint32_t length_offset{0};
+    uint32_t length_width{0};
+    bool length_little_endian{false};
+    int32_t length_adjust{0};
+    bool length_includes_header{false};
+
+    // Read into and write out of WASM linear memory.
+    bool guest_memory{false};
+
+    // Limits on a single WASM handler call, disabled while 0.
+    uint32_t handler_timeout_ms{0};
+    uint32_t handler_fuel{0};
+
+    // Threads that run WASM handler calls off the shards, disabled while 0.
+    uint32_t handler_threads{0};
+
+    // COUNTER values leased per shard at once, strictly increasing while 0.
+    uint32_t counter_block{0};
+
+    std::string clock;
+
+    std::string mmap;
 
     uint32_t shards{0};
     uint16_t port{0};
@@ -30,6 +30,27 @@ const std::unordered_set<std::string> VALID_KEYWORDS {
     "READ",
     "REPEAT",
     "SAMPLERATE",
+    "BATCHSIZE",
+    "GSO",
+    "GRO",
+    "ZEROCOPY",
+    "SENDFILE",
+    "SHAREDBUFFERS",
+    "COALESCE",
+    "RESPONSEQUEUE",
+    "BACKPRESSURE",
+    "LENGTHOFFSET",
+    "LENGTHWIDTH",
+    "LENGTHENDIAN",
+    "LENGTHADJUST",
+    "LENGTHINCLUDESHEADER",
+    "GUESTMEMORY",
+    "HANDLERTIMEOUT",
+    "HANDLERFUEL",
+    "HANDLERTHREADS",
+    "COUNTERBLOCK",
+    "CLOCK",
+    "MMAP",
     "ENDPOINTS",
     "SHARDS",
     "PACKETS",
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <vector>
 #include <chrono>
 
@@ -37,17 +39,41 @@ public:
         bytes_sent += rhs.bytes_sent;
         bytes_read += rhs.bytes_read;
 
+        packets_sent += rhs.packets_sent;
+        packets_read += rhs.packets_read;
+        send_calls += rhs.send_calls;
+        read_calls += rhs.read_calls;
+        gso_sends += rhs.gso_sends;
+
         connection_attempts += rhs.connection_attempts;
         failed_connections += rhs.failed_connections;
         finished_connections += rhs.finished_connections;
 
         connected_sessions += rhs.connected_sessions;
 
+        buffer_hits += rhs.buffer_hits;
+        buffer_misses += rhs.buffer_misses;
+        buffer_high_water += rhs.buffer_high_water;
+
+        responses_queued += rhs.responses_queued;
+        responses_dropped += rhs.responses_dropped;
+        read_pauses += rhs.read_pauses;
+        response_queue_peak += rhs.response_queue_peak;
+
+        handler_traps += rhs.handler_traps;
+        handler_timeouts += rhs.handler_timeouts;
+
+        handler_jobs += rhs.handler_jobs;
+        handler_queue_peak = std::max(handler_queue_peak, rhs.handler_queue_peak);
+
         for (size_t i = 0; i < NUM_BUCKETS; i++)
         {
             connection_latency_buckets[i] += rhs.connection_latency_buckets[i];
             send_latency_buckets[i] += rhs.send_latency_buckets[i];
             read_latency_buckets[i] += rhs.read_latency_buckets[i];
+            handler_time_buckets[i] += rhs.handler_time_buckets[i];
+            handler_wait_buckets[i] += rhs.handler_wait_buckets[i];
+            generate_time_buckets[i] += rhs.generate_time_buckets[i];
         }
 
         return *this;
@@ -56,6 +82,12 @@ public:
     uint64_t bytes_sent{0};
     uint64_t bytes_read{0};
 
+    uint64_t packets_sent{0};
+    uint64_t packets_read{0};
+    uint64_t send_calls{0};
+    uint64_t read_calls{0};
+    uint64_t gso_sends{0};
+
     uint64_t connection_attempts{0};
     uint64_t failed_connections{0};
     uint64_t finished_connections{0};
@@ -65,9 +97,36 @@ public:
     // SessionPool to grab the data.
     uint64_t connected_sessions{0};
 
+    // Body buffer leases, also filled by the shards from their BufferService.
+    uint64_t buffer_hits{0};
+    uint64_t buffer_misses{0};
+    uint64_t buffer_high_water{0};
+
+    uint64_t responses_queued{0};
+    uint64_t responses_dropped{0};
+    uint64_t read_pauses{0};
+
+    // Deepest any session's response queue has been.
+    uint64_t response_queue_peak{0};
+
+    // WASM handler calls that failed, timeouts were cut off by HANDLERTIMEOUT
+    // or HANDLERFUEL and are not counted as traps.
+    uint64_t handler_traps{0};
+    uint64_t handler_timeouts{0};
+
+    // Messages sent to the HANDLERTHREADS pool, the peak is the longest the
+    // pool's queue has been. Shards share the pool, so it is not summed.
+    uint64_t handler_jobs{0};
+    uint64_t handler_queue_peak{0};
+
     std::array<uint64_t, NUM_BUCKETS> connection_latency_buckets{};
     std::array<uint64_t, NUM_BUCKETS> send_latency_buckets{};
     std::array<uint64_t, NUM_BUCKETS> read_latency_buckets{};
+
+    // Unlike the latencies, these start at 1us (see ShardMetrics).
+    std::array<uint64_t, NUM_BUCKETS> handler_time_buckets{};
+    std::array<uint64_t, NUM_BUCKETS> handler_wait_buckets{};
+    std::array<uint64_t, NUM_BUCKETS> generate_time_buckets{};
 };
 
 // Signed version of MetricsSnapshot, most fields should never be negative
@@ -84,6 +143,12 @@ public:
     int64_t bytes_sent{0};
     int64_t bytes_read{0};
 
+    int64_t packets_sent{0};
+    int64_t packets_read{0};
+    int64_t send_calls{0};
+    int64_t read_calls{0};
+    int64_t gso_sends{0};
+
     int64_t connection_attempts{0};
     int64_t failed_connections{0};
     int64_t finished_connections{0};
@@ -91,9 +156,27 @@ public:
     // It's likely this will be negative when winding down.
     int64_t connected_sessions{0};
 
+    int64_t buffer_hits{0};
+    int64_t buffer_misses{0};
+    int64_t buffer_high_water{0};
+
+    int64_t responses_queued{0};
+    int64_t responses_dropped{0};
+    int64_t read_pauses{0};
+    int64_t response_queue_peak{0};
+
+    int64_t handler_traps{0};
+    int64_t handler_timeouts{0};
+
+    int64_t handler_jobs{0};
+    int64_t handler_queue_peak{0};
+
     std::array<int64_t, NUM_BUCKETS> connection_latency_buckets{};
     std::array<int64_t, NUM_BUCKETS> send_latency_buckets{};
     std::array<int64_t, NUM_BUCKETS> read_latency_buckets{};
+    std::array<int64_t, NUM_BUCKETS> handler_time_buckets{};
+    std::array<int64_t, NUM_BUCKETS> handler_wait_buckets{};
+    std::array<int64_t, NUM_BUCKETS> generate_time_buckets{};
 };
 
 inline void MetricsDelta::compute_difference(const MetricsSnapshot & current,
@@ -106,6 +189,21 @@ inline void MetricsDelta::compute_difference(const MetricsSnapshot & current,
     bytes_read = static_cast<int64_t>(current.bytes_read)
                  - static_cast<int64_t>(previous.bytes_read);
 
+    packets_sent = static_cast<int64_t>(current.packets_sent)
+                   - static_cast<int64_t>(previous.packets_sent);
+
+    packets_read = static_cast<int64_t>(current.packets_read)
+                   - static_cast<int64_t>(previous.packets_read);
+
+    send_calls = static_cast<int64_t>(current.send_calls)
+                 - static_cast<int64_t>(previous.send_calls);
+
+    read_calls = static_cast<int64_t>(current.read_calls)
+                 - static_cast<int64_t>(previous.read_calls);
+
+    gso_sends = static_cast<int64_t>(current.gso_sends)
+                - static_cast<int64_t>(previous.gso_sends);
+
     connection_attempts = static_cast<int64_t>(current.connection_attempts)
                           - static_cast<int64_t>(previous.connection_attempts);
 
@@ -118,6 +216,39 @@ inline void MetricsDelta::compute_difference(const MetricsSnapshot & current,
     connected_sessions = static_cast<int64_t>(current.connected_sessions)
                          - static_cast<int64_t>(previous.connected_sessions);
 
+    buffer_hits = static_cast<int64_t>(current.buffer_hits)
+                  - static_cast<int64_t>(previous.buffer_hits);
+
+    buffer_misses = static_cast<int64_t>(current.buffer_misses)
+                    - static_cast<int64_t>(previous.buffer_misses);
+
+    buffer_high_water = static_cast<int64_t>(current.buffer_high_water)
+                        - static_cast<int64_t>(previous.buffer_high_water);
+
+    responses_queued = static_cast<int64_t>(current.responses_queued)
+                       - static_cast<int64_t>(previous.responses_queued);
+
+    responses_dropped = static_cast<int64_t>(current.responses_dropped)
+                        - static_cast<int64_t>(previous.responses_dropped);
+
+    read_pauses = static_cast<int64_t>(current.read_pauses)
+                  - static_cast<int64_t>(previous.read_pauses);
+
+    response_queue_peak = static_cast<int64_t>(current.response_queue_peak)
+                          - static_cast<int64_t>(previous.response_queue_peak);
+
+    handler_traps = static_cast<int64_t>(current.handler_traps)
+                    - static_cast<int64_t>(previous.handler_traps);
+
+    handler_timeouts = static_cast<int64_t>(current.handler_timeouts)
+                       - static_cast<int64_t>(previous.handler_timeouts);
+
+    handler_jobs = static_cast<int64_t>(current.handler_jobs)
+                   - static_cast<int64_t>(previous.handler_jobs);
+
+    handler_queue_peak = static_cast<int64_t>(current.handler_queue_peak)
+                         - static_cast<int64_t>(previous.handler_queue_peak);
+
     for (size_t i = 0; i < NUM_BUCKETS; i++)
     {
         connection_latency_buckets[i] = static_cast<int64_t>
@@ -146,6 +277,33 @@ inline void MetricsDelta::compute_difference(const MetricsSnapshot & current,
                                             (
                                                 previous.read_latency_buckets[i]
                                             );
+
+        handler_time_buckets[i] = static_cast<int64_t>
+                                            (
+                                                current.handler_time_buckets[i]
+                                            )
+                                        - static_cast<int64_t>
+                                            (
+                                                previous.handler_time_buckets[i]
+                                            );
+
+        handler_wait_buckets[i] = static_cast<int64_t>
+                                            (
+                                                current.handler_wait_buckets[i]
+                                            )
+                                        - static_cast<int64_t>
+                                            (
+                                                previous.handler_wait_buckets[i]
+                                            );
+
+        generate_time_buckets[i] = static_cast<int64_t>
+                                            (
+                                                current.generate_time_buckets[i]
+                                            )
+                                        - static_cast<int64_t>
+                                            (
+                                                previous.generate_time_buckets[i]
+                                            );
     }
 }
 
@@ -16,6 +16,8 @@
 
 #include "shard-metrics.h"
 
+#include <utility>
+
 void ShardMetrics::record_connection_latency(uint64_t latency_us)
 {
     // Clamp to 64us, anything less is basically impossible to measure in our case.
@@ -88,6 +90,57 @@ void ShardMetrics::record_read_latency(uint64_t latency_us)
     read_latency_buckets[index] += 1;
 }
 
+// 1us = 2^0, so the bit width of the time in us is already the bucket.
+static unsigned int handler_bucket(uint64_t time_ns)
+{
+    unsigned int index = std::bit_width(time_ns / 1000);
+
+    // Handle overflow (very long time).
+    if (index >= 15)
+    {
+        index = 15;
+    }
+
+    return index;
+}
+
+void ShardMetrics::record_handler_time(uint64_t time_ns)
+{
+    handler_time_buckets[handler_bucket(time_ns)] += 1;
+}
+
+void ShardMetrics::record_handler_wait(uint64_t time_ns)
+{
+    handler_wait_buckets[handler_bucket(time_ns)] += 1;
+}
+
+void ShardMetrics::record_generate_time(uint64_t time_ns)
+{
+    generate_time_buckets[handler_bucket(time_ns)] += 1;
+}
+
+HandlerMetrics ShardMetrics::take_handler_metrics()
+{
+    HandlerMetrics res;
+
+    res.traps = std::exchange(handler_traps, 0);
+    res.timeouts = std::exchange(handler_timeouts, 0);
+    res.time_buckets = std::exchange(handler_time_buckets, {});
+
+    return res;
+}
+
+void ShardMetrics::add_handler_metrics(const HandlerMetrics & metrics)
+{
+    handler_traps += metrics.traps;
+    handler_timeouts += metrics.timeouts;
+
+    for (size_t i = 0; i < NUM_BUCKETS; i++)
+    {
+        handler_time_buckets[i] += metrics.time_buckets[i];
+    }
+}
+
 MetricsSnapshot ShardMetrics::fetch_snapshot()
 {
     MetricsSnapshot res;
@@ -95,13 +148,33 @@ MetricsSnapshot ShardMetrics::fetch_snapshot()
     res.bytes_sent = bytes_sent;
     res.bytes_read = bytes_read;
 
+    res.packets_sent = packets_sent;
+    res.packets_read = packets_read;
+    res.send_calls = send_calls;
+    res.read_calls = read_calls;
+    res.gso_sends = gso_sends;
+
     res.connection_attempts = connection_attempts;
     res.failed_connections = failed_connections;
     res.finished_connections = finished_connections;
 
+    res.responses_queued = responses_queued;
+    res.responses_dropped = responses_dropped;
+    res.read_pauses = read_pauses;
+    res.response_queue_peak = response_queue_peak;
+
+    res.handler_traps = handler_traps;
+    res.handler_timeouts = handler_timeouts;
+
+    res.handler_jobs = handler_jobs;
+    res.handler_queue_peak = handler_queue_peak;
+
     res.connection_latency_buckets = connection_latency_buckets;
     res.send_latency_buckets = send_latency_buckets;
     res.read_latency_buckets = read_latency_buckets;
+    res.handler_time_buckets = handler_time_buckets;
+    res.handler_wait_buckets = handler_wait_buckets;
+    res.generate_time_buckets = generate_time_buckets;
 
     return res;
 }
@@ -18,6 +18,7 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <algorithm>
 #include <array>
 #include <bit>
 
@@ -26,6 +27,15 @@
 // TODO <feature>: we could provide metrics for write-read response times if the
 //                 user knows the server responses are relevant (would use a setting).
 
+// Handler metrics gathered off the shard thread, see ShardMetrics::take_handler_metrics.
+struct HandlerMetrics
+{
+    uint64_t traps{0};
+    uint64_t timeouts{0};
+
+    std::array<uint64_t, MetricsSnapshot::NUM_BUCKETS> time_buckets{};
+};
+
 // Handle alignment for thread interference.
 //
 // We absolutely do not want any way for ShardMetrics for shard A and B to
@@ -42,26 +52,82 @@ public:
 
     void record_read_latency(uint64_t latency_us);
 
+    void record_handler_time(uint64_t time_ns);
+
+    void record_handler_wait(uint64_t time_ns);
+
+    void record_generate_time(uint64_t time_ns);
+
     inline void record_bytes_sent(uint64_t count);
 
     inline void record_bytes_read(uint64_t count);
 
+    inline void record_packets_sent(uint64_t count);
+
+    inline void record_packets_read(uint64_t count);
+
+    inline void record_send_call();
+
+    inline void record_gso_sends(uint64_t count);
+
+    inline void record_read_call();
+
     inline void record_connection_attempt();
 
     inline void record_connection_fail();
 
     inline void record_connection_success();
 
+    inline void record_response_queued(uint64_t depth);
+
+    inline void record_response_dropped();
+
+    inline void record_read_pause();
+
+    inline void record_handler_trap();
+
+    inline void record_handler_timeout();
+
+    inline void record_handler_queued(uint64_t depth);
+
+    // Moves the handler metrics out, for handlers that run on a HANDLERTHREADS
+    // worker. The shard adds them back with add_handler_metrics on its thread.
+    HandlerMetrics take_handler_metrics();
+
+    void add_handler_metrics(const HandlerMetrics & metrics);
+
     MetricsSnapshot fetch_snapshot();
 
 private:
     uint64_t bytes_sent{0};
     uint64_t bytes_read{0};
 
+    uint64_t packets_sent{0};
+    uint64_t packets_read{0};
+
+    // Syscalls used to move the packets, packets / call shows batching.
+    uint64_t send_calls{0};
+    uint64_t read_calls{0};
+
+    // Sent messages that carried several datagrams through UDP_SEGMENT.
+    uint64_t gso_sends{0};
+
     uint64_t connection_attempts{0};
     uint64_t failed_connections{0};
     uint64_t finished_connections{0};
 
+    // Responses waiting to be written, see ResponseQueue.
+    uint64_t responses_queued{0};
+    uint64_t responses_dropped{0};
+    uint64_t read_pauses{0};
+    uint64_t response_queue_peak{0};
+
+    uint64_t handler_traps{0};
+    uint64_t handler_timeouts{0};
+
+    uint64_t handler_jobs{0};
+    uint64_t handler_queue_peak{0};
+
     // We map time values to buckets based on log multiples of 64us.
     //
     // 0 : < 64us
@@ -76,6 +142,23 @@ private:
     std::array<uint64_t, NUM_BUCKETS> connection_latency_buckets{};
     std::array<uint64_t, NUM_BUCKETS> send_latency_buckets{};
     std::array<uint64_t, NUM_BUCKETS> read_latency_buckets{};
+
+    // Handler calls are much shorter, so these are log multiples of 1us.
+    //
+    // 0 : < 1us
+    // 1 : < 2us
+    // .
+    // .
+    // .
+    // 14 : < ~16ms
+    // 15 : ~16ms or more
+    std::array<uint64_t, NUM_BUCKETS> handler_time_buckets{};
+
+    // Time messages spent queued for a HANDLERTHREADS worker, same buckets.
+    std::array<uint64_t, NUM_BUCKETS> handler_wait_buckets{};
+
+    // Time spent in the generate_payload export, same buckets.
+    std::array<uint64_t, NUM_BUCKETS> generate_time_buckets{};
 };
 
 inline void ShardMetrics::record_bytes_sent(uint64_t count)
@@ -88,6 +171,31 @@ inline void ShardMetrics::record_bytes_read(uint64_t count)
     bytes_read += count;
 }
 
+inline void ShardMetrics::record_packets_sent(uint64_t count)
+{
+    packets_sent += count;
+}
+
+inline void ShardMetrics::record_packets_read(uint64_t count)
+{
+    packets_read += count;
+}
+
+inline void ShardMetrics::record_send_call()
+{
+    send_calls += 1;
+}
+
+inline void ShardMetrics::record_gso_sends(uint64_t count)
+{
+    gso_sends += count;
+}
+
+inline void ShardMetrics::record_read_call()
+{
+    read_calls += 1;
+}
+
 inline void ShardMetrics::record_connection_attempt()
 {
     connection_attempts += 1;
@@ -102,3 +210,36 @@ inline void ShardMetrics::record_connection_success()
 {
     finished_connections += 1;
 }
+
+// Depth is the size of the session's queue after the push.
+inline void ShardMetrics::record_response_queued(uint64_t depth)
+{
+    responses_queued += 1;
+    response_queue_peak = std::max(response_queue_peak, depth);
+}
+
+inline void ShardMetrics::record_response_dropped()
+{
+    responses_dropped += 1;
+}
+
+inline void ShardMetrics::record_read_pause()
+{
+    read_pauses += 1;
+}
+
+inline void ShardMetrics::record_handler_trap()
+{
+    handler_traps += 1;
+}
+
+inline void ShardMetrics::record_handler_timeout()
+{
+    handler_timeouts += 1;
+}
+
+inline void ShardMetrics::record_handler_queued(uint64_t depth)
+{
+    handler_jobs += 1;
+    handler_queue_peak = std::max(handler_queue_peak, depth);
+}
@@ -99,6 +99,9 @@ struct ActionDescriptor
     uint32_t sessions_start;
     uint32_t sessions_end;
 
+    // Script index of the shard's first session, set by the Orchestrator.
+    uint32_t first_session{0};
+
     // For SEND to specify copies.
     uint32_t count;
 
@@ -46,8 +46,12 @@ public:
     metrics_timer_(cntx_),
     actions_(std::move(actions)),
     config_(std::move(config)),
-    payload_manager_(std::make_shared<PayloadManager>(std::move(payloads),
-                                                      std::move(counter_steps))),
+    payload_manager_(std::make_shared<PayloadManager>(
+                        std::move(payloads),
+                        std::move(counter_steps),
+                        PayloadManager::render_limit(
+                            config_.session_config.zerocopy_threshold),
+                        config_.session_config.counter_block)),
     metrics_sink_(std::move(metrics_sink))
     {
         // Ensure we have data for the metric lists.
@@ -247,6 +251,7 @@ private:
             ActionDescriptor shard_action = action;
             shard_action.sessions_start = local_start;
             shard_action.sessions_end = local_start + session_count;
+            shard_action.first_session = shard_ranges_[k].first;
 
             // Send to this shard, repeat.
             bool success = shards_[k]->submit_work(shard_action);
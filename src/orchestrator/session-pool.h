@@ -26,6 +26,7 @@
 #include <boost/asio.hpp>
 
 #include "session-config.h"
+#include "session-ref.h"
 #include "shard-metrics.h"
 
 #ifdef DEV_BUILD
@@ -96,26 +97,29 @@ public:
         }
     }
 
+    // Script index of the first session made by create_sessions.
+    void set_first_index(uint32_t first_index)
+    {
+        first_index_ = first_index;
+    }
+
     template<typename... Args>
     bool create_sessions(size_t session_count, Args&&... args)
     {
         // Prevent creating a new pool if one is in use.
-        if (!sessions_.empty())
+        if (sessions_)
         {
             return false;
         }
 
-        // Create session_count new Session objects.
-        sessions_.reserve(session_count);
+        // Create session_count new Session objects next to each other.
+        sessions_ = SessionSlab<Session>::create(session_count, first_index_);
 
         on_done_callback_ = [this](){ disconnect_callback(); };
 
         for (size_t i = 0; i < session_count; i++)
         {
-            sessions_.emplace_back(
-                std::make_shared<Session>(std::forward<Args>(args)...,
-                                          on_done_callback_)
-            );
+            sessions_->emplace(std::forward<Args>(args)..., on_done_callback_);
         }
 
         return true;
@@ -136,7 +140,7 @@ public:
 
         for (size_t i = start; i < end; i++)
         {
-            sessions_[i]->start(endpoints);
+            (*sessions_)[i].start(endpoints);
         }
     }
 
@@ -150,7 +154,7 @@ public:
 
         for (size_t i = start; i < end; i++)
         {
-            sessions_[i]->send(N);
+            (*sessions_)[i].send(N);
         }
     }
 
@@ -164,7 +168,7 @@ public:
 
         for (size_t i = start; i < end; i++)
         {
-            sessions_[i]->flood();
+            (*sessions_)[i].flood();
         }
     }
 
@@ -178,7 +182,7 @@ public:
 
         for (size_t i = start; i < end; i++)
         {
-            sessions_[i]->drain();
+            (*sessions_)[i].drain();
         }
     }
 
@@ -192,18 +196,23 @@ public:
 
         for (size_t i = start; i < end; i++)
         {
-            sessions_[i]->stop();
+            (*sessions_)[i].stop();
         }
     }
 
     void start_all_sessions(const Session::Endpoints & endpoints)
     {
-        start_sessions_range(0, sessions_.size());
+        start_sessions_range(endpoints, 0, size());
     }
 
     void stop_all_sessions()
     {
-        stop_sessions_range(0, sessions_.size());
+        stop_sessions_range(0, size());
+    }
+
+    size_t size() const
+    {
+        return sessions_ ? sessions_->size() : 0;
     }
 
     size_t active_sessions() const
@@ -232,12 +241,10 @@ private:
     SessionConfig config_;
     Session::DisconnectCallback on_done_callback_;
 
-    // TODO <optimization>: We are allocating the pointers contiguously, but not Session memory.
-    //                      In theory, we should be able to allocate the Session objects and
-    //                      then point to this, but we likely need a custom shared_ptr type.
-    //
-    //                      This shouldn't be an intrusive re-write if we need to do it later.
-    std::vector<std::shared_ptr<Session>> sessions_;
+    // Session objects are allocated contiguously, handlers keep them alive
+    // through the slab's intrusive (non-atomic) reference counts.
+    SessionSlab<Session>::Owner sessions_;
+    uint32_t first_index_{0};
 
     // Count the number of active sessions.
     std::atomic<size_t> active_sessions_{0};
@@ -24,6 +24,7 @@
 #include <boost/asio.hpp>
 
 #include "session-pool.h"
+#include "buffer-service.h"
 #include "message-handler-interface.h"
 #include "payload-manager.h"
 #include "action-descriptor.h"
@@ -151,9 +152,14 @@ private:
             // Make our message handler with whatever the Orchestrator
             // decided we should use.
             message_handler_ = handler_factory_();
+            message_handler_->attach_metrics(metrics_);
+            message_handler_->attach_context(cntx_);
+
+            ShardClock & clock = asio::use_service<ShardClock>(cntx_);
+            clock.set_mode(config_.clock_mode);
 
             // Start the thread's work loop.
-            cntx_.run();
+            run_loop(clock);
         }
         catch (const std::exception & error)
         {
@@ -183,6 +189,41 @@ private:
 #endif
     }
 
+    // Without a cached clock the io_context simply runs. Otherwise we poll
+    // up to LOOP_HANDLERS ready handlers per iteration and mark the clock
+    // stale before each one, waiting for the next handler when none are ready.
+    void run_loop(ShardClock & clock)
+    {
+        if (clock.mode() == ClockMode::System)
+        {
+            cntx_.run();
+            return;
+        }
+
+        while (true)
+        {
+            clock.tick();
+
+            size_t handlers = 0;
+
+            while (handlers < LOOP_HANDLERS && cntx_.poll_one() != 0)
+            {
+                handlers++;
+            }
+
+            if (handlers != 0)
+            {
+                continue;
+            }
+
+            // The clock is still stale for the handler we wait for.
+            if (cntx_.run_one() == 0)
+            {
+                break;
+            }
+        }
+    }
+
     void handle_action(ActionDescriptor action)
     {
         switch (action.type)
@@ -190,6 +231,7 @@ private:
             case ActionType::CREATE:
             {
                 // Create requested number of sessions.
+                session_pool_.set_first_index(action.first_session);
                 session_pool_.create_sessions(action.sessions_end
                                               - action.sessions_start,
                                               cntx_,
@@ -286,11 +328,21 @@ private:
         // We also need to grab the current number of session's from the pool.
         snapshot.connected_sessions = session_pool_.active_sessions();
 
+        // Leases are counted by the shard's buffers, not the sessions.
+        BufferStats buffer_stats = asio::use_service<BufferService>(cntx_).stats();
+
+        snapshot.buffer_hits = buffer_stats.hits;
+        snapshot.buffer_misses = buffer_stats.misses;
+        snapshot.buffer_high_water = buffer_stats.high_water;
+
         shard_history.push_back(std::move(snapshot));
     }
 
 private:
 
+    // Bounds how old the cached clock gets while the shard stays busy.
+    static constexpr size_t LOOP_HANDLERS = 64;
+
     //
     // Generic execution flow members for a shard.
     //
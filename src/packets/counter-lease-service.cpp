@@ -0,0 +1,30 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "counter-lease-service.h"
+
+asio::execution_context::id CounterLeaseService::id;
+
+CounterLeaseService::CounterLeaseService(asio::io_context & cntx)
+:asio::execution_context::service(cntx)
+{
+}
+
+// Unused values of a lease are simply skipped.
+void CounterLeaseService::shutdown()
+{
+    leases_.clear();
+}
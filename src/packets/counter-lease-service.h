@@ -0,0 +1,82 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <boost/asio.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace asio = boost::asio;
+
+// A block of COUNTER values taken from the shared counter at once.
+struct CounterLease
+{
+    uint64_t next{0};
+    uint64_t remaining{0};
+};
+
+// COUNTER leases for every session on one io_context (so one per shard),
+// obtained with asio::use_service<CounterLeaseService>(cntx).
+//
+// Leases belong to one PayloadManager, they are dropped if another one
+// asks so its counters never hand out values leased from the last one.
+//
+// Not thread safe, every call must happen on the io_context thread.
+class CounterLeaseService : public asio::execution_context::service
+{
+public:
+    static asio::execution_context::id id;
+
+    explicit CounterLeaseService(asio::io_context & cntx);
+
+    CounterLeaseService(const CounterLeaseService &) = delete;
+    CounterLeaseService & operator=(const CounterLeaseService &) = delete;
+
+    // The lease of one counter, empty until the owner first fills it.
+    CounterLease & lease(const void *owner, size_t payload_index, size_t counter_index)
+    {
+        if (owner != owner_)
+        {
+            leases_.clear();
+            owner_ = owner;
+        }
+
+        if (payload_index >= leases_.size())
+        {
+            leases_.resize(payload_index + 1);
+        }
+
+        auto & counters = leases_[payload_index];
+
+        if (counter_index >= counters.size())
+        {
+            counters.resize(counter_index + 1);
+        }
+
+        return counters[counter_index];
+    }
+
+private:
+    void shutdown() override;
+
+private:
+    const void *owner_{nullptr};
+
+    // Indexed by payload, then by the payload's counter.
+    std::vector<std::vector<CounterLease>> leases_;
+};
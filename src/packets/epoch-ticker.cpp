@@ -0,0 +1,37 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "epoch-ticker.h"
+
+#include <condition_variable>
+#include <mutex>
+
+EpochTicker::EpochTicker(std::shared_ptr<wasmtime::Engine> engine)
+:engine_(std::move(engine))
+{
+    thread_ = std::jthread([engine = engine_.get()](std::stop_token stop){
+        std::mutex mutex;
+        std::condition_variable_any wake;
+
+        std::unique_lock lock(mutex);
+
+        // Only woken early by the stop request.
+        while (!wake.wait_for(lock, stop, TICK, [&stop]{ return stop.stop_requested(); }))
+        {
+            engine->increment_epoch();
+        }
+    });
+}
@@ -0,0 +1,47 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include <wasmtime.hh>
+
+// Advances an engine's epoch at a fixed rate, so a store's epoch deadline
+// can be given in ticks of roughly TICK each.
+//
+// The engine must have been configured with epoch interruption.
+class EpochTicker
+{
+public:
+    static constexpr std::chrono::milliseconds TICK{1};
+
+    explicit EpochTicker(std::shared_ptr<wasmtime::Engine> engine);
+
+    // Stops and joins the ticking thread.
+    ~EpochTicker() = default;
+
+    EpochTicker(const EpochTicker &) = delete;
+    EpochTicker & operator=(const EpochTicker &) = delete;
+
+private:
+    std::shared_ptr<wasmtime::Engine> engine_;
+
+    // Declared last so the thread stops before the engine is released.
+    std::jthread thread_;
+};
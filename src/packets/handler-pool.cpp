@@ -0,0 +1,167 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "handler-pool.h"
+
+#include <exception>
+#include <span>
+#include <string>
+
+#include "logger.h"
+
+HandlerPool::HandlerPool(size_t thread_count, HandlerFactory factory)
+:factory_(std::move(factory))
+{
+    workers_.reserve(thread_count);
+
+    for (size_t i = 0; i < thread_count; i++)
+    {
+        workers_.emplace_back([this](std::stop_token stop){ work(stop); });
+    }
+}
+
+HandlerPool::~HandlerPool()
+{
+    for (auto & worker : workers_)
+    {
+        worker.request_stop();
+    }
+
+    // The jthreads join once the queue is empty.
+    workers_.clear();
+}
+
+size_t HandlerPool::submit(Job job)
+{
+    size_t depth = 0;
+
+    {
+        std::lock_guard lock(mutex_);
+
+        jobs_.push_back(std::move(job));
+        depth = jobs_.size();
+    }
+
+    ready_.notify_one();
+
+    return depth;
+}
+
+void HandlerPool::work(std::stop_token stop)
+{
+    std::unique_ptr<MessageHandler> handler;
+
+    try
+    {
+        handler = factory_();
+    }
+    catch (const std::exception & error)
+    {
+        // Jobs are still answered (with nothing) so sessions keep going.
+        Logger::warn("Handler thread could not make its message handler: "
+                     + std::string(error.what()));
+    }
+
+    // Only touched by this thread, moved into each result.
+    ShardMetrics metrics;
+
+    if (handler)
+    {
+        handler->attach_metrics(metrics);
+    }
+
+    while (true)
+    {
+        Job job;
+
+        {
+            std::unique_lock lock(mutex_);
+
+            // Keeps going after a stop request until the queue is empty.
+            ready_.wait(lock, stop, [this]{ return !jobs_.empty(); });
+
+            if (jobs_.empty())
+            {
+                return;
+            }
+
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        run(handler.get(), metrics, job);
+    }
+}
+
+void HandlerPool::run(MessageHandler *handler, ShardMetrics & metrics, Job & job)
+{
+    Result result;
+    result.wait = std::chrono::steady_clock::now() - job.queued_at;
+
+    auto add_response = [&result](const ResponsePacket & response){
+        result.bytes.insert(result.bytes.end(),
+                            response.data(),
+                            response.data() + response.size());
+        result.sizes.push_back(static_cast<uint32_t>(response.size()));
+    };
+
+    if (handler)
+    {
+        handler->set_current_session(job.session_index);
+
+        std::vector<MessageView> views;
+        views.reserve(job.messages.size());
+
+        size_t offset = 0;
+
+        for (const MessageSize & message : job.messages)
+        {
+            std::span<const uint8_t> bytes(job.bytes.data() + offset,
+                                           message.header + message.body);
+
+            views.push_back({bytes.first(message.header), bytes.subspan(message.header)});
+            offset += bytes.size();
+        }
+
+        try
+        {
+            if (job.batch)
+            {
+                handler->parse_batch(views, [&](std::vector<ResponsePacket> responses){
+                    for (const ResponsePacket & response : responses)
+                    {
+                        add_response(response);
+                    }
+                });
+            }
+            else if (!views.empty())
+            {
+                handler->parse_message(views[0].header, views[0].body, add_response);
+            }
+        }
+        catch (const std::exception & error)
+        {
+            Logger::warn("Handler thread got exception: " + std::string(error.what()));
+        }
+    }
+
+    // Messages the handler did not answer get an empty response.
+    result.sizes.resize(job.messages.size(), 0);
+
+    result.metrics = metrics.take_handler_metrics();
+
+    job.on_done(std::move(result));
+}
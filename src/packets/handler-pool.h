@@ -0,0 +1,114 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "message-handler-interface.h"
+#include "shard-metrics.h"
+
+// Threads that run messages through their own message handler, shared by
+// every shard so handler work can be scaled apart from I/O (HANDLERTHREADS).
+//
+// Each worker makes its handler with the factory on its own thread, so WASM
+// handlers each get their own store. Jobs carry copies of their messages
+// since the session's buffers may move before a worker gets to them.
+//
+// Workers call a job's on_done from their own thread, the caller is
+// responsible for getting the result back to where it is needed, and for
+// keeping that destination alive until the job is done with.
+class HandlerPool
+{
+public:
+    using HandlerFactory = std::function<std::unique_ptr<MessageHandler>()>;
+
+    // Sizes of one message inside Job::bytes.
+    struct MessageSize
+    {
+        uint32_t header;
+        uint32_t body;
+    };
+
+    struct Result
+    {
+        // Every response back to back, response i is the next sizes[i] bytes.
+        std::vector<uint8_t> bytes;
+        std::vector<uint32_t> sizes;
+
+        // How long the job waited for a worker.
+        std::chrono::nanoseconds wait{0};
+
+        // Recorded by the worker's handler while running the job.
+        HandlerMetrics metrics;
+    };
+
+    struct Job
+    {
+        uint32_t session_index{0};
+
+        // Every message's header then body, back to back.
+        std::vector<uint8_t> bytes;
+        std::vector<MessageSize> messages;
+
+        // Run through parse_batch instead of parse_message.
+        bool batch{false};
+
+        std::chrono::steady_clock::time_point queued_at;
+
+        std::move_only_function<void(Result)> on_done;
+    };
+
+public:
+    HandlerPool(size_t thread_count, HandlerFactory factory);
+
+    // Runs every queued job, then joins the workers.
+    ~HandlerPool();
+
+    HandlerPool(const HandlerPool &) = delete;
+    HandlerPool & operator=(const HandlerPool &) = delete;
+
+    // Thread safe, returns how many jobs are waiting including this one.
+    size_t submit(Job job);
+
+    size_t thread_count() const
+    {
+        return workers_.size();
+    }
+
+private:
+    void work(std::stop_token stop);
+
+    static void run(MessageHandler *handler, ShardMetrics & metrics, Job & job);
+
+private:
+    HandlerFactory factory_;
+
+    std::mutex mutex_;
+    std::condition_variable_any ready_;
+    std::deque<Job> jobs_;
+
+    // Declared last so the workers stop before the queue is gone.
+    std::vector<std::jthread> workers_;
+};
@@ -0,0 +1,80 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+#include "header-result.h"
+
+// Native header parsing for headers that carry the body length as an
+// integer, described by the LENGTH* settings. Used by every message handler
+// instead of calling into WASM for each header.
+struct LengthField
+{
+    // Lengths are read into a 64 bit integer, also the limit on LENGTHWIDTH.
+    static constexpr size_t MAX_WIDTH = 8;
+
+    // Where the length is in the header, width is 1 to 8 bytes.
+    size_t offset{0};
+    size_t width{0};
+    bool little_endian{false};
+
+    // Added to the decoded value, may be negative.
+    int64_t adjustment{0};
+
+    // The decoded length also counts the header.
+    bool includes_header{false};
+
+    HeaderResult decode(std::span<const uint8_t> header) const
+    {
+        if (width == 0 || width > MAX_WIDTH || offset + width > header.size())
+        {
+            return {0, HeaderResult::Status::ERROR};
+        }
+
+        uint64_t value = 0;
+
+        for (size_t i = 0; i < width; i++)
+        {
+            size_t index = little_endian ? offset + width - 1 - i : offset + i;
+
+            value = (value << 8) | header[index];
+        }
+
+        if (value > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+        {
+            return {0, HeaderResult::Status::ERROR};
+        }
+
+        int64_t length = static_cast<int64_t>(value) + adjustment;
+
+        if (includes_header)
+        {
+            length -= static_cast<int64_t>(header.size());
+        }
+
+        if (length < 0)
+        {
+            return {0, HeaderResult::Status::ERROR};
+        }
+
+        return {static_cast<size_t>(length), HeaderResult::Status::OK};
+    }
+};
@@ -16,18 +16,119 @@
 
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
 #include "header-result.h"
 #include "response-packet.h"
 
+struct ShardMetrics;
+struct PreparedPayload;
+
+namespace boost::asio
+{
+    class io_context;
+}
+
+// One framed message out of a read that carried several.
+struct MessageView
+{
+    std::span<const uint8_t> header;
+    std::span<const uint8_t> body;
+};
+
 struct MessageHandler
 {
 public:
+    // The callback may also run later on the shard's io_context (see
+    // PooledMessageHandler), sessions wait for it before reading on.
     virtual void parse_message(std::span<const uint8_t> header,
                                std::span<const uint8_t> body,
                                std::function<void(ResponsePacket)> callback) const = 0;
 
     virtual HeaderResult parse_header(std::span<const uint8_t> buffer) const = 0;
 
+    // Space for a whole message (header + body) that the session reads
+    // into directly, returned to parse_reserved or release_reserved.
+    //
+    // Empty if the handler has no such space, use parse_message instead.
+    virtual std::span<uint8_t> reserve_message(size_t length) const
+    {
+        return {};
+    }
+
+    // Handle a message read into the span from reserve_message.
+    virtual void parse_reserved(std::span<uint8_t> message,
+                                std::function<void(ResponsePacket)> callback) const
+    {
+        callback({});
+    }
+
+    // Give back a reservation that will never be parsed.
+    virtual void release_reserved(std::span<uint8_t> message) const
+    {
+    }
+
+    // Whether parse_batch is cheaper than a parse_message per message,
+    // sessions only gather batches for handlers that say so.
+    virtual bool batches() const
+    {
+        return false;
+    }
+
+    // Handle every message of one read at once, responses[i] answers
+    // messages[i]. The spans are only valid until this returns.
+    //
+    // By default each message goes through parse_message, which must call
+    // back before returning.
+    virtual void parse_batch(std::span<const MessageView> messages,
+                             std::function<void(std::vector<ResponsePacket>)> callback) const
+    {
+        std::vector<ResponsePacket> responses;
+        responses.reserve(messages.size());
+
+        for (const MessageView & message : messages)
+        {
+            parse_message(message.header,
+                          message.body,
+                          [&responses](ResponsePacket response){
+                              responses.push_back(std::move(response));
+                          });
+        }
+
+        callback(std::move(responses));
+    }
+
+    // Called by sessions right before sending a payload filled by the
+    // PayloadManager, payload_index is the SEND packet's index. Handlers
+    // may replace the payload, by default it is sent as is.
+    virtual void generate_payload(uint32_t session_index,
+                                  size_t payload_index,
+                                  PreparedPayload & payload) const
+    {
+    }
+
+    // Called by the shard once the handler is made, for handlers that
+    // report their own metrics. The metrics stay valid while the handler
+    // is in use.
+    virtual void attach_metrics(ShardMetrics & metrics)
+    {
+    }
+
+    // Called by the shard once the handler is made, for handlers that
+    // answer from other threads and must post the response back.
+    virtual void attach_context(boost::asio::io_context & cntx)
+    {
+    }
+
+    // Sessions call this with their script index before handing over
+    // messages (and before parse_header), for handlers that expose it.
+    virtual void set_current_session(uint32_t session_index) const
+    {
+    }
+
     virtual ~MessageHandler() = default;
 
 private:
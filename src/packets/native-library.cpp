@@ -0,0 +1,102 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "native-library.h"
+
+#include <dlfcn.h>
+
+// Resolve name from the plugin, nullptr if it is not exported.
+template<typename Function>
+static Function find_symbol(void *handle, const char *name)
+{
+    return reinterpret_cast<Function>(::dlsym(handle, name));
+}
+
+static std::string last_dl_error()
+{
+    const char *error = ::dlerror();
+
+    return error ? error : "unknown error";
+}
+
+std::expected<std::shared_ptr<const NativeLibrary>, std::string>
+NativeLibrary::open(const std::filesystem::path & path)
+{
+    // A path without a slash would be searched for in the library paths.
+    std::string absolute = std::filesystem::absolute(path).string();
+
+    // Resolve every symbol now so missing ones fail here, not mid run.
+    void *handle = ::dlopen(absolute.c_str(), RTLD_NOW | RTLD_LOCAL);
+
+    if (!handle)
+    {
+        return std::unexpected{"Failed to load native handler "
+                               + absolute
+                               + " ("
+                               + last_dl_error()
+                               + ")"};
+    }
+
+    // Owns the handle from here, so every return below closes it.
+    std::shared_ptr<NativeLibrary> library(new NativeLibrary(handle));
+
+    using VersionFunction = uint32_t (*)();
+
+    auto version = find_symbol<VersionFunction>(handle, "loadshear_abi_version");
+
+    if (!version)
+    {
+        return std::unexpected{"Native handler " + absolute
+                               + " does not export loadshear_abi_version"};
+    }
+
+    if (version() != LOADSHEAR_NATIVE_ABI)
+    {
+        return std::unexpected{"Native handler " + absolute
+                               + " was built for ABI version "
+                               + std::to_string(version())
+                               + " (expected "
+                               + std::to_string(LOADSHEAR_NATIVE_ABI)
+                               + ")"};
+    }
+
+    library->handle_body_ = find_symbol<BodyFunction>(handle, "loadshear_handle_body");
+
+    if (!library->handle_body_)
+    {
+        return std::unexpected{"Native handler " + absolute
+                               + " does not export loadshear_handle_body"};
+    }
+
+    library->create_ = find_symbol<CreateFunction>(handle, "loadshear_create");
+    library->destroy_ = find_symbol<DestroyFunction>(handle, "loadshear_destroy");
+    library->handle_header_ = find_symbol<HeaderFunction>(handle, "loadshear_handle_header");
+
+    return library;
+}
+
+NativeLibrary::NativeLibrary(void *handle)
+:handle_(handle)
+{
+}
+
+NativeLibrary::~NativeLibrary()
+{
+    if (handle_)
+    {
+        ::dlclose(handle_);
+    }
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "native-contract.h"
+
+// A HANDLER plugin loaded with dlopen, see sdk/native/native-contract.h.
+//
+// Shared by every shard's NativeMessageHandler, the library is closed once
+// the last one is gone. Plugins run in our process without any isolation,
+// so only load code you trust.
+class NativeLibrary
+{
+public:
+    using CreateFunction = void *(*)();
+    using DestroyFunction = void (*)(void *);
+    using BodyFunction = uint32_t (*)(void *, const loadshear_message *, uint8_t *, uint32_t);
+    using HeaderFunction = int32_t (*)(void *, const uint8_t *, uint32_t);
+
+    static std::expected<std::shared_ptr<const NativeLibrary>, std::string>
+    open(const std::filesystem::path & path);
+
+    ~NativeLibrary();
+
+    NativeLibrary(const NativeLibrary &) = delete;
+    NativeLibrary & operator=(const NativeLibrary &) = delete;
+    NativeLibrary(NativeLibrary &&) = delete;
+    NativeLibrary & operator=(NativeLibrary &&) = delete;
+
+    // Per shard state from loadshear_create, nullptr if not exported.
+    void * create() const
+    {
+        return create_ ? create_() : nullptr;
+    }
+
+    void destroy(void *state) const
+    {
+        if (destroy_)
+        {
+            destroy_(state);
+        }
+    }
+
+    uint32_t handle_body(void *state,
+                         const loadshear_message & message,
+                         uint8_t *response,
+                         uint32_t capacity) const
+    {
+        return handle_body_(state, &message, response, capacity);
+    }
+
+    // True if the plugin exports loadshear_handle_header.
+    bool has_header() const
+    {
+        return handle_header_ != nullptr;
+    }
+
+    int32_t handle_header(void *state, const uint8_t *header, uint32_t size) const
+    {
+        return handle_header_(state, header, size);
+    }
+
+private:
+    explicit NativeLibrary(void *handle);
+
+private:
+    void *handle_{nullptr};
+
+    CreateFunction create_{nullptr};
+    DestroyFunction destroy_{nullptr};
+    BodyFunction handle_body_{nullptr};
+    HeaderFunction handle_header_{nullptr};
+};
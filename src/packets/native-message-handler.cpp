@@ -0,0 +1,116 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "native-message-handler.h"
+
+#include <string>
+
+#include "logger.h"
+
+NativeMessageHandler::NativeMessageHandler(std::shared_ptr<const NativeLibrary> library,
+                                           std::optional<LengthField> length_field)
+:library_(std::move(library)),
+length_field_(length_field),
+response_(INITIAL_RESPONSE_CAPACITY),
+packets_(PacketPool::create())
+{
+    state_ = library_->create();
+}
+
+NativeMessageHandler::~NativeMessageHandler()
+{
+    library_->destroy(state_);
+}
+
+void NativeMessageHandler::parse_message(std::span<const uint8_t> header,
+                                         std::span<const uint8_t> body,
+                                         std::function<void(ResponsePacket)> callback)
+                                                                              const
+{
+    loadshear_message message{header.data(),
+                              static_cast<uint32_t>(header.size()),
+                              body.data(),
+                              static_cast<uint32_t>(body.size()),
+                              session_index_};
+
+    uint32_t capacity = static_cast<uint32_t>(response_.size());
+    uint32_t size = library_->handle_body(state_, message, response_.data(), capacity);
+
+    // Too small, the plugin told us how much it needs so ask once more.
+    if (size > capacity)
+    {
+        response_.resize(size);
+
+        capacity = size;
+        size = library_->handle_body(state_, message, response_.data(), capacity);
+    }
+
+    if (size == 0)
+    {
+        callback({});
+        return;
+    }
+
+    if (size > capacity)
+    {
+        std::string e_msg = "Native handler asked for a larger response buffer "
+                            "twice. Your plugin violates the contract.";
+
+        Logger::warn(std::move(e_msg));
+
+        callback({});
+        return;
+    }
+
+    // Copied into a buffer recycled from an earlier response.
+    callback(packets_->copy(std::span<const uint8_t>(response_.data(), size)));
+}
+
+HeaderResult NativeMessageHandler::parse_header(std::span<const uint8_t> buffer) const
+{
+    if (length_field_)
+    {
+        // Native length field from the settings, no plugin call needed.
+        return length_field_->decode(buffer);
+    }
+
+    if (!library_->has_header())
+    {
+        std::string e_string = "No header parse function was found! Either "
+                               "provide a loadshear_handle_header export or "
+                               "provide LENGTHWIDTH in SETTINGS!";
+
+        Logger::warn(std::move(e_string));
+
+        return {0, HeaderResult::Status::ERROR};
+    }
+
+    int32_t size = library_->handle_header(state_,
+                                           buffer.data(),
+                                           static_cast<uint32_t>(buffer.size()));
+
+    if (size < 0)
+    {
+        return {0, HeaderResult::Status::ERROR};
+    }
+
+    return {static_cast<size_t>(size), HeaderResult::Status::OK};
+}
+
+void NativeMessageHandler::set_current_session(uint32_t session_index) const
+{
+    session_index_ = session_index;
+}
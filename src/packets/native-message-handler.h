@@ -0,0 +1,69 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "length-field.h"
+#include "message-handler-interface.h"
+#include "native-library.h"
+#include "packet-pool.h"
+
+// Runs a trusted HANDLER plugin (.so) in the shard's thread at native speed.
+//
+// Each shard makes its own handler, so the plugin's loadshear_create state
+// is only ever used by one thread.
+class NativeMessageHandler : public MessageHandler
+{
+public:
+    // Responses are written here first, grown if a plugin asks for more.
+    static constexpr size_t INITIAL_RESPONSE_CAPACITY = 4096;
+
+public:
+    // Headers are parsed with length_field instead of the plugin if set.
+    NativeMessageHandler(std::shared_ptr<const NativeLibrary> library,
+                         std::optional<LengthField> length_field = std::nullopt);
+
+    ~NativeMessageHandler();
+
+    NativeMessageHandler(const NativeMessageHandler &) = delete;
+    NativeMessageHandler & operator=(const NativeMessageHandler &) = delete;
+
+    void parse_message(std::span<const uint8_t> header,
+                       std::span<const uint8_t> body,
+                       std::function<void(ResponsePacket)> callback) const override;
+
+    HeaderResult parse_header(std::span<const uint8_t> buffer) const override;
+
+    void set_current_session(uint32_t session_index) const override;
+
+private:
+    std::shared_ptr<const NativeLibrary> library_;
+
+    std::optional<LengthField> length_field_;
+
+    // From loadshear_create, owned by this handler.
+    void *state_{nullptr};
+
+    mutable uint32_t session_index_{0};
+
+    mutable std::vector<uint8_t> response_;
+
+    PacketPool::Owner packets_;
+};
@@ -16,18 +16,25 @@
 
 #include "nop-message-handler.h"
 
+NOPMessageHandler::NOPMessageHandler(LengthField length_field)
+:length_field_(length_field)
+{
+}
+
 void NOPMessageHandler::parse_message(std::span<const uint8_t> header,
                                       std::span<const uint8_t> body,
                                       std::function<void(ResponsePacket)> callback)
                                                                               const
 {
-    static const std::shared_ptr<std::vector<uint8_t>> unused
-        = std::make_shared<std::vector<uint8_t>>();
-
-    callback({std::move(unused)});
+    callback({});
 }
 
 HeaderResult NOPMessageHandler::parse_header(std::span<const uint8_t> buffer) const
 {
+    if (length_field_)
+    {
+        return length_field_->decode(buffer);
+    }
+
     return {0, HeaderResult::Status::OK};
 }
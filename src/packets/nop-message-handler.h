@@ -17,8 +17,10 @@
 #pragma once
 
 #include <functional>
+#include <optional>
 #include <span>
 
+#include "length-field.h"
 #include "message-handler-interface.h"
 
 class NOPMessageHandler : public MessageHandler
@@ -27,6 +29,11 @@ public:
     using HeaderParseFunction = std::function<HeaderResult(
                                         std::span<const uint8_t>)>;
 
+    NOPMessageHandler() = default;
+
+    // Headers are parsed natively, bodies are still ignored.
+    explicit NOPMessageHandler(LengthField length_field);
+
     // Do nothing.
     void parse_message(std::span<const uint8_t> header,
                        std::span<const uint8_t> body,
@@ -34,6 +41,6 @@ public:
 
     HeaderResult parse_header(std::span<const uint8_t> buffer) const override;
 
-public:
-
+private:
+    std::optional<LengthField> length_field_;
 };
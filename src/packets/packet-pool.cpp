@@ -0,0 +1,157 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "packet-pool.h"
+
+#include <cstring>
+#include <utility>
+
+void ResponsePacket::reset()
+{
+    PacketBuffer *buffer = std::exchange(buffer_, nullptr);
+
+    if (!buffer)
+    {
+        return;
+    }
+
+    buffer->refs -= 1;
+
+    if (buffer->refs == 0)
+    {
+        buffer->pool->recycle(buffer);
+    }
+}
+
+PacketPool::Owner PacketPool::create(ReturnFunction on_return)
+{
+    return Owner(new PacketPool(std::move(on_return)));
+}
+
+PacketPool::PacketPool(ReturnFunction on_return)
+:on_return_(std::move(on_return))
+{
+}
+
+PacketPool::~PacketPool()
+{
+    for (PacketBuffer *buffer : free_)
+    {
+        delete buffer;
+    }
+}
+
+ResponsePacket PacketPool::copy(std::span<const uint8_t> bytes)
+{
+    if (bytes.empty())
+    {
+        return {};
+    }
+
+    PacketBuffer *buffer = next_buffer();
+
+    if (buffer->capacity < bytes.size())
+    {
+        buffer->bytes = std::make_unique_for_overwrite<uint8_t[]>(bytes.size());
+        buffer->capacity = bytes.size();
+    }
+
+    std::memcpy(buffer->bytes.get(), bytes.data(), bytes.size());
+    buffer->size = bytes.size();
+    buffer->data = buffer->bytes.get();
+
+    return ResponsePacket(buffer);
+}
+
+ResponsePacket PacketPool::lend(std::span<const uint8_t> bytes)
+{
+    if (bytes.empty())
+    {
+        return {};
+    }
+
+    PacketBuffer *buffer = next_buffer();
+
+    buffer->size = bytes.size();
+    buffer->data = bytes.data();
+    buffer->lent = true;
+
+    return ResponsePacket(buffer);
+}
+
+PacketBuffer * PacketPool::next_buffer()
+{
+    PacketBuffer *buffer = nullptr;
+
+    if (!free_.empty())
+    {
+        buffer = free_.back();
+        free_.pop_back();
+    }
+    else
+    {
+        buffer = new PacketBuffer();
+        buffer->pool = this;
+    }
+
+    live_ += 1;
+
+    return buffer;
+}
+
+void PacketPool::recycle(PacketBuffer *buffer)
+{
+    live_ -= 1;
+
+    if (abandoned_)
+    {
+        delete buffer;
+
+        if (live_ == 0)
+        {
+            delete this;
+        }
+
+        return;
+    }
+
+    if (buffer->lent && on_return_)
+    {
+        on_return_(std::span<const uint8_t>(buffer->data, buffer->size));
+    }
+
+    if (buffer->capacity > MAX_KEPT_CAPACITY)
+    {
+        buffer->bytes.reset();
+        buffer->capacity = 0;
+    }
+
+    buffer->size = 0;
+    buffer->data = nullptr;
+    buffer->lent = false;
+
+    free_.push_back(buffer);
+}
+
+void PacketPool::abandon()
+{
+    abandoned_ = true;
+
+    if (live_ == 0)
+    {
+        delete this;
+    }
+}
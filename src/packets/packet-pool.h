@@ -0,0 +1,88 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "response-packet.h"
+
+// Response buffers for one message handler (so one per shard).
+//
+// Released packets keep their memory for the next response, so once the
+// pool has seen the largest response and the most packets in flight at once
+// no more allocations are made.
+//
+// Like SessionSlab, the owner may let go while sessions still hold packets,
+// the pool is freed once the last one is released.
+class PacketPool
+{
+    struct Abandon
+    {
+        void operator()(PacketPool *pool) const
+        {
+            pool->abandon();
+        }
+    };
+
+public:
+    using Owner = std::unique_ptr<PacketPool, Abandon>;
+
+    // Gives lent bytes back to the owner once the last copy is released.
+    using ReturnFunction = std::function<void(std::span<const uint8_t>)>;
+
+    // Larger buffers are freed instead of kept around for the next packet.
+    static constexpr size_t MAX_KEPT_CAPACITY = 1024 * 1024;
+
+    static Owner create(ReturnFunction on_return = {});
+
+    PacketPool(const PacketPool &) = delete;
+    PacketPool & operator=(const PacketPool &) = delete;
+
+    // A packet holding a copy of bytes, empty packets don't use the pool.
+    ResponsePacket copy(std::span<const uint8_t> bytes);
+
+    // A packet pointing at bytes the owner keeps alive until on_return is
+    // called with them. Packets released after the owner let go are not
+    // returned, the owner's memory is assumed to be gone.
+    ResponsePacket lend(std::span<const uint8_t> bytes);
+
+private:
+    friend class ResponsePacket;
+
+    explicit PacketPool(ReturnFunction on_return);
+
+    ~PacketPool();
+
+    // Called when a packet's last copy is destroyed.
+    void recycle(PacketBuffer *buffer);
+
+    void abandon();
+
+    PacketBuffer * next_buffer();
+
+private:
+    ReturnFunction on_return_;
+
+    std::vector<PacketBuffer *> free_;
+
+    // Buffers that have not been recycled yet.
+    size_t live_{0};
+    bool abandoned_{false};
+};
@@ -18,14 +18,28 @@
 
 #include "logger.h"
 
-#include <chrono>
+#include <cstring>
 #include <iostream>
 
 PayloadManager::PayloadManager(std::vector<PayloadDescriptor> payloads,
-                               std::vector<std::vector<uint16_t>> steps)
+                               std::vector<std::vector<uint16_t>> steps,
+                               size_t render_limit,
+                               uint32_t counter_block)
 :payloads_(std::move(payloads)),
-counters_(payloads_.size())
+counters_(payloads_.size()),
+counter_block_(counter_block)
 {
+    programs_.reserve(payloads_.size());
+    first_index_.reserve(payloads_.size());
+
+    for (const auto & descriptor : payloads_)
+    {
+        programs_.push_back(compile(descriptor, render_limit));
+
+        first_index_.push_back(payload_count_);
+        payload_count_ += descriptor.copies;
+    }
+
     // Should basically never happen.
     if (payloads_.size() > steps.size())
     {
@@ -53,130 +67,212 @@ counters_(payloads_.size())
     }
 }
 
-bool PayloadManager::fill_payload(size_t index, PreparedPayload & payload) const
+PayloadProgram PayloadManager::compile(const PayloadDescriptor & descriptor,
+                                       size_t render_limit)
 {
-    if (index >= payloads_.size())
+    PayloadProgram program;
+
+    size_t counter_index = 0;
+
+    for (const auto & op : descriptor.ops)
+    {
+        // Nothing to send.
+        if (op.length == 0)
+        {
+            counter_index += (op.type == PacketOperationType::COUNTER);
+            continue;
+        }
+
+        PayloadStep step{op.type,
+                         op.little_endian,
+                         op.time_format,
+                         op.length,
+                         program.total_size,
+                         program.temp_size,
+                         counter_index};
+
+        program.total_size += op.length;
+
+        if (op.type == PacketOperationType::IDENTITY)
+        {
+            // Neighbouring static ranges are sent as one slice, as long as
+            // the joined length still fits in one operation.
+            if (!program.steps.empty()
+                && program.steps.back().type == PacketOperationType::IDENTITY
+                && static_cast<uint64_t>(program.steps.back().length) + op.length
+                   <= PacketOperation::MAX_LENGTH)
+            {
+                program.steps.back().length += op.length;
+                continue;
+            }
+        }
+        else
+        {
+            program.temp_size += op.length;
+            counter_index += (op.type == PacketOperationType::COUNTER);
+
+            if (op.type == PacketOperationType::TIMESTAMP)
+            {
+                program.timestamps = true;
+                program.precise_timestamps |= (op.time_format == TimestampFormat::Microseconds
+                                               || op.time_format == TimestampFormat::Nanoseconds);
+            }
+        }
+
+        program.steps.push_back(step);
+    }
+
+    program.slice_count = program.steps.size();
+
+    // Only packets held in memory can be copied, the copy must stay inside it.
+    program.rendered = !descriptor.file
+                       && program.temp_size != 0
+                       && program.total_size < render_limit
+                       && program.total_size <= descriptor.packet_data.size();
+
+    if (program.rendered)
+    {
+        std::erase_if(program.steps, [](const PayloadStep & step){
+            return step.type == PacketOperationType::IDENTITY;
+        });
+
+        program.temp_size = program.total_size;
+        program.slice_count = 1;
+    }
+
+    return program;
+}
+
+size_t PayloadManager::resolve(uint64_t index) const
+{
+    // Without COPIES every descriptor is one index.
+    if (payload_count_ == payloads_.size())
+    {
+        return index;
+    }
+
+    // The last descriptor starting at or before index, descriptors without
+    // copies start where the next one does and are never picked.
+    auto after = std::upper_bound(first_index_.begin(), first_index_.end(), index);
+
+    return static_cast<size_t>(after - first_index_.begin()) - 1;
+}
+
+bool PayloadManager::fill_payload(size_t payload_index,
+                                  PreparedPayload & payload,
+                                  CounterLeaseService *leases,
+                                  ShardClock *clock) const
+{
+    if (payload_index >= payload_count_)
     {
         return false;
     }
 
+    size_t index = resolve(payload_index);
+
     const auto & descriptor = payloads_[index];
-    const auto & ops = descriptor.ops;
+    const auto & program = programs_[index];
+
+    payload.packet_slices.clear();
+    payload.file_slices.clear();
 
-    // First, call payload.clear() to reset the payload (keeps allocation).
-    payload.clear();
+    // Sized once for the whole fill so slices into it are never invalidated.
+    // Only grown bytes are zeroed, every byte we use is written below.
+    payload.temps.resize(program.temp_size);
 
-    // Next, calculate how much capacity we need, allocate if necessary.
-    size_t total_temp_bytes = 0;
+    uint8_t *temps = payload.temps.data();
 
-    for (const auto & op : ops)
+    std::chrono::system_clock::duration now{};
+
+    if (program.timestamps && clock)
     {
-        // Only count dynamic data, ignore identity data.
-        if (op.type != PacketOperationType::IDENTITY)
-        {
-            total_temp_bytes += op.length;
-        }
+        now = clock->timestamp_now(program.precise_timestamps);
+    }
+    else if (program.timestamps)
+    {
+        now = std::chrono::system_clock::now().time_since_epoch();
     }
 
-    // We need to allocate this ahead of time to prevent pointer invalidation.
-    payload.temps.reserve(total_temp_bytes);
+    if (program.rendered)
+    {
+        std::memcpy(temps, descriptor.packet_data.data(), program.total_size);
 
-    // For each operation, we insert data (either static or dynamic).
-    payload.packet_slices.reserve(ops.size());
+        for (const auto & step : program.steps)
+        {
+            write_dynamic(step, index, now, leases, temps + step.packet_offset);
+        }
 
-    // Keep track of where we are.
-    size_t current_offset = 0;
-    size_t current_counter_idx = 0;
+        payload.packet_slices.emplace_back(temps, program.total_size);
+        return true;
+    }
+
+    payload.packet_slices.reserve(program.slice_count);
 
     const auto & view = descriptor.packet_data;
 
-    // Iterate over the operations to create the packet.
-    for (const auto & op : ops)
+    for (const auto & step : program.steps)
     {
-        switch (op.type)
+        if (step.type == PacketOperationType::IDENTITY)
         {
-            // Insert the static data from the span.
-            case PacketOperationType::IDENTITY:
+            // File backed packets are sent from disk by the session.
+            if (descriptor.file)
             {
-                payload.packet_slices.emplace_back(view.data() + current_offset,
-                                                   op.length);
-                current_offset += op.length;
-                break;
+                payload.file_slices.push_back({descriptor.file->fd,
+                                               step.packet_offset,
+                                               step.length,
+                                               payload.packet_slices.size()});
+                continue;
             }
-            // Create counter data and insert it.
-            case PacketOperationType::COUNTER:
-            {
-                auto & payload_counter = counters_[index];
-                auto & curr_counter = payload_counter[current_counter_idx];
-                current_counter_idx += 1;
 
-                uint64_t val = curr_counter.counter.fetch_add(
-                                    curr_counter.step, std::memory_order_relaxed);
+            payload.packet_slices.emplace_back(view.data() + step.packet_offset,
+                                               step.length);
+            continue;
+        }
 
-                size_t write_index = payload.temps.size();
+        uint8_t *start = temps + step.temp_offset;
 
-                // Resize is safe here because we already reserved enough room.
-                payload.temps.resize(write_index + op.length);
+        write_dynamic(step, index, now, leases, start);
 
-                // Grab the start of where we want to insert the number.
-                uint8_t *start = payload.temps.data() + write_index;
+        payload.packet_slices.emplace_back(start, step.length);
+    }
 
-                write_numeric(start, val, op.length, op.little_endian);
+    return true;
+}
 
-                // Add to the buffer's view.
-                payload.packet_slices.emplace_back(start, op.length);
+void PayloadManager::write_dynamic(const PayloadStep & step,
+                                   size_t index,
+                                   std::chrono::system_clock::duration now,
+                                   CounterLeaseService *leases,
+                                   uint8_t *start) const
+{
+    uint64_t value = 0;
 
-                current_offset += op.length;
+    if (step.type == PacketOperationType::COUNTER)
+    {
+        value = next_counter(index, step.counter_index, leases);
+    }
+    else
+    {
+        switch (step.time_format)
+        {
+            case TimestampFormat::Seconds:
+            {
+                value = std::chrono::duration_cast<std::chrono::seconds>(now).count();
                 break;
             }
-            case PacketOperationType::TIMESTAMP:
+            case TimestampFormat::Milliseconds:
             {
-                auto now = std::chrono::system_clock::now().time_since_epoch();
-
-                size_t ts_value = 0;
-
-                // Interpret as an 8 byte seconds based timestamp.
-                switch (op.time_format)
-                {
-                    case TimestampFormat::Seconds:
-                    {
-                        ts_value = std::chrono::duration_cast<std::chrono::seconds>(now).count();
-                        break;
-                    }
-                    case TimestampFormat::Milliseconds:
-                    {
-                        ts_value = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
-                        break;
-                    }
-                    case TimestampFormat::Microseconds:
-                    {
-                        ts_value = std::chrono::duration_cast<std::chrono::microseconds>(now).count();
-                        break;
-                    }
-                    case TimestampFormat::Nanoseconds:
-                    {
-                        ts_value = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
-                        break;
-                    }
-                    default:
-                    {
-                        break;
-                    }
-                }
-
-                size_t write_index = payload.temps.size();
-
-                // Resize is safe here because we already reserved enough room.
-                payload.temps.resize(write_index + op.length);
-
-                uint8_t *start = payload.temps.data() + write_index;
-
-                write_numeric(start, ts_value, op.length, op.little_endian);
-
-                // Add to the buffer's view.
-                payload.packet_slices.emplace_back(start, op.length);
-
-                current_offset += op.length;
+                value = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+                break;
+            }
+            case TimestampFormat::Microseconds:
+            {
+                value = std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+                break;
+            }
+            case TimestampFormat::Nanoseconds:
+            {
+                value = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
                 break;
             }
             default:
@@ -186,7 +282,37 @@ bool PayloadManager::fill_payload(size_t index, PreparedPayload & payload) const
         }
     }
 
-    return true;
+    write_numeric(start, value, step.length, step.little_endian);
+}
+
+uint64_t PayloadManager::next_counter(size_t index,
+                                      size_t counter_index,
+                                      CounterLeaseService *leases) const
+{
+    auto & counter = counters_[index][counter_index];
+
+    if (counter_block_ <= 1 || !leases)
+    {
+        return counter.counter.fetch_add(counter.step, std::memory_order_relaxed);
+    }
+
+    CounterLease & lease = leases->lease(this, index, counter_index);
+
+    // Only touch the shared cache line once per block.
+    if (lease.remaining == 0)
+    {
+        uint64_t block_size = static_cast<uint64_t>(counter.step) * counter_block_;
+
+        lease.next = counter.counter.fetch_add(block_size, std::memory_order_relaxed);
+        lease.remaining = counter_block_;
+    }
+
+    uint64_t value = lease.next;
+
+    lease.next += counter.step;
+    lease.remaining -= 1;
+
+    return value;
 }
 
 // Write numeric from little endian host to buffer.
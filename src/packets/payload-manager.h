@@ -16,30 +16,125 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+
+#include "counter-lease-service.h"
 #include "payload-structs.h"
+#include "shard-clock.h"
+
+// One PacketOperation with its offsets worked out ahead of time.
+struct PayloadStep
+{
+    PacketOperationType type;
+    bool little_endian;
+    TimestampFormat time_format;
+    uint32_t length;
+
+    // Where the bytes start in the packet, and in temps for dynamic steps.
+    size_t packet_offset;
+    size_t temp_offset;
+
+    // Index into the payload's counters for COUNTER steps.
+    size_t counter_index;
+};
+
+// A PayloadDescriptor compiled once by the PayloadManager, so each fill
+// only runs its steps instead of working out sizes and offsets again.
+struct PayloadProgram
+{
+    // Every step, or only the dynamic ones for rendered payloads.
+    std::vector<PayloadStep> steps;
+
+    // Bytes sent, and bytes of temps each fill needs.
+    size_t total_size{0};
+    size_t temp_size{0};
+
+    size_t slice_count{0};
+
+    // Small packets are copied whole into temps and sent as one slice.
+    bool rendered{false};
+
+    bool timestamps{false};
+
+    // A timestamp finer than milliseconds, the shard's cached time won't do.
+    bool precise_timestamps{false};
+};
 
 class PayloadManager
 {
 public:
+    // Packets smaller than this are rendered into one contiguous buffer,
+    // the copy is cheaper than the extra slices for the kernel to gather.
+    static constexpr size_t RENDER_LIMIT = 1024;
+
+    // ZEROCOPY only pins slices of the plan's data, so packets it would
+    // send in place are left as slices.
+    static constexpr size_t render_limit(size_t zerocopy_threshold)
+    {
+        return zerocopy_threshold != 0 ? std::min(RENDER_LIMIT, zerocopy_threshold)
+                                       : RENDER_LIMIT;
+    }
+
     // We expect a list of payload descriptors, and for each payload descriptor
     // we expect a index matched list of counter step values.
     //
     // So, for payload descriptor 1, we expect a vector of uint16_t with one value
     // per COUNTER declared in the underlying SEND operation.
+    //
+    // Each descriptor covers descriptor.copies payload indices, so a SEND is
+    // stored once no matter how many COPIES it has.
+    //
+    // With a counter_block above 1, shards lease that many values of a counter
+    // at once instead of all incrementing it for every payload. Values stay
+    // unique, but are only increasing within each shard.
     PayloadManager(std::vector<PayloadDescriptor> payloads,
-                   std::vector<std::vector<uint16_t>> steps);
+                   std::vector<std::vector<uint16_t>> steps,
+                   size_t render_limit = RENDER_LIMIT,
+                   uint32_t counter_block = 0);
 
     // Compute any runtime changes to packets and return the data to caller.
     //
+    // Counters are leased through leases if given (the calling shard's
+    // service), otherwise every value comes from the shared counter.
+    // Timestamps come from clock if given, otherwise the system clock.
+    //
     // Returns false if no payload exists.
-    bool fill_payload(size_t index, PreparedPayload & payload) const;
+    bool fill_payload(size_t index,
+                      PreparedPayload & payload,
+                      CounterLeaseService *leases = nullptr,
+                      ShardClock *clock = nullptr) const;
 
 private:
+    static PayloadProgram compile(const PayloadDescriptor & descriptor,
+                                  size_t render_limit);
+
+    // The descriptor a payload index falls in.
+    size_t resolve(uint64_t index) const;
+
+    // Write the counter or timestamp of a dynamic step at start.
+    void write_dynamic(const PayloadStep & step,
+                       size_t index,
+                       std::chrono::system_clock::duration now,
+                       CounterLeaseService *leases,
+                       uint8_t *start) const;
+
+    uint64_t next_counter(size_t index,
+                          size_t counter_index,
+                          CounterLeaseService *leases) const;
+
     void write_numeric(uint8_t *start,
                        uint64_t raw_numeric,
                        uint32_t length,
                        bool little_endian) const;
 
     std::vector<PayloadDescriptor> payloads_;
+    std::vector<PayloadProgram> programs_;
+
+    // First payload index of each descriptor.
+    std::vector<uint64_t> first_index_;
+    uint64_t payload_count_{0};
     mutable std::vector<std::vector<PayloadCounter>> counters_;
+
+    uint32_t counter_block_{0};
 };
@@ -23,6 +23,9 @@
 
 #include <boost/asio.hpp>
 
+#include <sys/mman.h>
+#include <unistd.h>
+
 // Handle case where we don't have the cache line size and set it to 64.
 #ifdef __cpp_lib_hardware_interference_size
 static constexpr size_t COUNTER_ALIGNMENT = std::hardware_destructive_interference_size;
@@ -141,6 +144,71 @@ struct PacketOperation
     static constexpr size_t MAX_TIMESTAMP_LENGTH = sizeof(uint64_t);
 };
 
+// A packet left on disk instead of being read into memory, sessions send
+// it straight from the file descriptor.
+//
+// Owned by the execution plan, which closes the file when the last copy
+// of the plan is destroyed.
+struct PacketFile
+{
+    PacketFile(int descriptor, uint64_t length)
+    :fd(descriptor),
+    size(length)
+    {
+    }
+
+    ~PacketFile()
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+    }
+
+    PacketFile(const PacketFile &) = delete;
+    PacketFile & operator=(const PacketFile &) = delete;
+    PacketFile(PacketFile &&) = delete;
+    PacketFile & operator=(PacketFile &&) = delete;
+
+    int fd{-1};
+    uint64_t size{0};
+};
+
+// A packet mapped read only instead of read into the plan's arena, payloads
+// point straight into the mapping.
+//
+// Owned by the execution plan, which unmaps it when the last copy of the
+// plan is destroyed.
+struct PacketMapping
+{
+    PacketMapping(void *address, size_t length)
+    :data(address),
+    size(length)
+    {
+    }
+
+    ~PacketMapping()
+    {
+        if (data != MAP_FAILED && data != nullptr)
+        {
+            ::munmap(data, size);
+        }
+    }
+
+    PacketMapping(const PacketMapping &) = delete;
+    PacketMapping & operator=(const PacketMapping &) = delete;
+    PacketMapping(PacketMapping &&) = delete;
+    PacketMapping & operator=(PacketMapping &&) = delete;
+
+    std::span<const uint8_t> bytes() const
+    {
+        return {static_cast<const uint8_t *>(data), size};
+    }
+
+    void *data{nullptr};
+    size_t size{0};
+};
+
 // Each PayloadDescriptor contains:
 // - A pointer to the raw packet data (after any inline computation during startup).
 // - A list of per Session operations to apply to the data.
@@ -150,6 +218,22 @@ struct PayloadDescriptor
     // that the shard does not shutdown until every Session is closed.
     std::span<const uint8_t> packet_data;
     std::vector<PacketOperation> ops;
+
+    // If set, IDENTITY operations refer to this file instead of packet_data.
+    const PacketFile *file{nullptr};
+
+    // Consecutive payload indices sent with this descriptor (SEND COPIES),
+    // all of them share its counters.
+    uint64_t copies{1};
+};
+
+// A range of a PacketFile to send before packet_slices[slice_index].
+struct FileSlice
+{
+    int fd;
+    uint64_t offset;
+    uint64_t length;
+    size_t slice_index;
 };
 
 // The goal of the prepared payload is to make scatter-gather IO easy for the calling Session.
@@ -172,6 +256,7 @@ struct PreparedPayload
     {
         temps.clear();
         packet_slices.clear();
+        file_slices.clear();
     }
 
     // Dynamic bytes we inserted (counters, timestamps).
@@ -183,4 +268,7 @@ struct PreparedPayload
 
     // Stores the read only slices of the base packet and the slices in temps.
     std::vector<boost::asio::const_buffer> packet_slices;
+
+    // Parts of the packet still on disk, only used by file backed payloads.
+    std::vector<FileSlice> file_slices;
 };
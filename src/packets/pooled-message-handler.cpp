@@ -0,0 +1,245 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "pooled-message-handler.h"
+
+#include <condition_variable>
+#include <mutex>
+
+#include <boost/asio.hpp>
+
+#include "shard-metrics.h"
+
+namespace asio = boost::asio;
+
+struct PooledMessageHandler::Inflight
+{
+    std::mutex mutex;
+    std::condition_variable idle;
+    size_t jobs{0};
+
+    // Set once the handler is gone, completions still queued on the
+    // io_context are dropped.
+    bool closed{false};
+};
+
+// Counts one job against its handler until the pool destroys the job,
+// whether or not the job ever ran.
+class PooledMessageHandler::InflightJob
+{
+public:
+    explicit InflightJob(std::shared_ptr<Inflight> inflight)
+    :inflight_(std::move(inflight))
+    {
+        std::lock_guard lock(inflight_->mutex);
+        inflight_->jobs += 1;
+    }
+
+    InflightJob(InflightJob && other) = default;
+
+    InflightJob(const InflightJob &) = delete;
+    InflightJob & operator=(const InflightJob &) = delete;
+    InflightJob & operator=(InflightJob &&) = delete;
+
+    ~InflightJob()
+    {
+        // Moved from.
+        if (!inflight_)
+        {
+            return;
+        }
+
+        std::lock_guard lock(inflight_->mutex);
+
+        inflight_->jobs -= 1;
+
+        if (inflight_->jobs == 0)
+        {
+            inflight_->idle.notify_all();
+        }
+    }
+
+private:
+    std::shared_ptr<Inflight> inflight_;
+};
+
+PooledMessageHandler::PooledMessageHandler(std::shared_ptr<HandlerPool> pool,
+                                           std::unique_ptr<MessageHandler> local)
+:pool_(std::move(pool)),
+local_(std::move(local)),
+inflight_(std::make_shared<Inflight>()),
+packets_(PacketPool::create())
+{
+}
+
+PooledMessageHandler::~PooledMessageHandler()
+{
+    // The shard may have been stopped with jobs outstanding (forced
+    // shutdown, or an exception on the shard thread). Their completions
+    // are only posted, the shard's io_context outlives its handler.
+    std::unique_lock lock(inflight_->mutex);
+    inflight_->idle.wait(lock, [this]{ return inflight_->jobs == 0; });
+
+    inflight_->closed = true;
+}
+
+void PooledMessageHandler::parse_message(std::span<const uint8_t> header,
+                                         std::span<const uint8_t> body,
+                                         std::function<void(ResponsePacket)> callback) const
+{
+    if (!cntx_)
+    {
+        local_->parse_message(header, body, std::move(callback));
+        return;
+    }
+
+    MessageView message{header, body};
+
+    dispatch(std::span<const MessageView>(&message, 1),
+             false,
+             [callback = std::move(callback)](std::vector<ResponsePacket> responses){
+                 callback(std::move(responses[0]));
+             });
+}
+
+HeaderResult PooledMessageHandler::parse_header(std::span<const uint8_t> buffer) const
+{
+    return local_->parse_header(buffer);
+}
+
+void PooledMessageHandler::generate_payload(uint32_t session_index,
+                                            size_t payload_index,
+                                            PreparedPayload & payload) const
+{
+    local_->generate_payload(session_index, payload_index, payload);
+}
+
+bool PooledMessageHandler::batches() const
+{
+    return local_->batches();
+}
+
+void PooledMessageHandler::parse_batch(std::span<const MessageView> messages,
+                                       std::function<void(std::vector<ResponsePacket>)> callback) const
+{
+    if (!cntx_)
+    {
+        local_->parse_batch(messages, std::move(callback));
+        return;
+    }
+
+    dispatch(messages,
+             true,
+             [callback = std::move(callback)](std::vector<ResponsePacket> responses){
+                 callback(std::move(responses));
+             });
+}
+
+void PooledMessageHandler::attach_metrics(ShardMetrics & metrics)
+{
+    metrics_ = &metrics;
+    local_->attach_metrics(metrics);
+}
+
+void PooledMessageHandler::attach_context(asio::io_context & cntx)
+{
+    cntx_ = &cntx;
+    local_->attach_context(cntx);
+}
+
+void PooledMessageHandler::set_current_session(uint32_t session_index) const
+{
+    session_index_ = session_index;
+    local_->set_current_session(session_index);
+}
+
+void PooledMessageHandler::dispatch(std::span<const MessageView> messages,
+                                    bool batch,
+                                    Completion complete) const
+{
+    HandlerPool::Job job;
+    job.session_index = session_index_;
+    job.batch = batch;
+    job.messages.reserve(messages.size());
+
+    for (const MessageView & message : messages)
+    {
+        job.bytes.insert(job.bytes.end(), message.header.begin(), message.header.end());
+        job.bytes.insert(job.bytes.end(), message.body.begin(), message.body.end());
+
+        job.messages.push_back({static_cast<uint32_t>(message.header.size()),
+                                static_cast<uint32_t>(message.body.size())});
+    }
+
+    // Runs on the worker, the work guard keeps the shard's io_context
+    // running until the result has been posted back.
+    //
+    // Everything that touches the io_context is moved into the posted
+    // completion, so once on_done returns the worker only releases the
+    // InflightJob. A completion still queued once the handler is gone is
+    // dropped instead of run.
+    job.on_done = [this,
+                   inflight = inflight_,
+                   pending = InflightJob(inflight_),
+                   work = asio::make_work_guard(*cntx_),
+                   complete = std::move(complete)](HandlerPool::Result result) mutable {
+
+        asio::post(*cntx_,
+            [this,
+             inflight,
+             work = std::move(work),
+             complete = std::move(complete),
+             result = std::move(result)]() mutable {
+            {
+                std::lock_guard lock(inflight->mutex);
+
+                if (inflight->closed)
+                {
+                    return;
+                }
+            }
+
+            if (metrics_)
+            {
+                metrics_->record_handler_wait(result.wait.count());
+                metrics_->add_handler_metrics(result.metrics);
+            }
+
+            std::vector<ResponsePacket> responses;
+            responses.reserve(result.sizes.size());
+
+            size_t offset = 0;
+
+            for (uint32_t size : result.sizes)
+            {
+                responses.push_back(packets_->copy(
+                    std::span<const uint8_t>(result.bytes.data() + offset, size)));
+                offset += size;
+            }
+
+            complete(std::move(responses));
+        });
+    };
+
+    job.queued_at = std::chrono::steady_clock::now();
+
+    size_t depth = pool_->submit(std::move(job));
+
+    if (metrics_)
+    {
+        metrics_->record_handler_queued(depth);
+    }
+}
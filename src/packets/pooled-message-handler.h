@@ -0,0 +1,92 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "handler-pool.h"
+#include "message-handler-interface.h"
+#include "packet-pool.h"
+
+// Shard side of a HandlerPool, hands messages to the pool's workers and
+// calls back on the shard's io_context once they are done.
+//
+// Headers still have to be parsed before the body can be read, so they go
+// through a local handler on the shard thread. Without an io_context (see
+// attach_context) everything runs on the local handler instead.
+class PooledMessageHandler : public MessageHandler
+{
+public:
+    PooledMessageHandler(std::shared_ptr<HandlerPool> pool,
+                         std::unique_ptr<MessageHandler> local);
+
+    // Waits for every job still held by the pool, so no worker posts back
+    // to the shard's io_context after the shard stops using this handler.
+    ~PooledMessageHandler() override;
+
+    void parse_message(std::span<const uint8_t> header,
+                       std::span<const uint8_t> body,
+                       std::function<void(ResponsePacket)> callback) const override;
+
+    HeaderResult parse_header(std::span<const uint8_t> buffer) const override;
+
+    // Payloads are generated on the shard by the local handler.
+    void generate_payload(uint32_t session_index,
+                          size_t payload_index,
+                          PreparedPayload & payload) const override;
+
+    bool batches() const override;
+
+    void parse_batch(std::span<const MessageView> messages,
+                     std::function<void(std::vector<ResponsePacket>)> callback) const override;
+
+    void attach_metrics(ShardMetrics & metrics) override;
+
+    void attach_context(boost::asio::io_context & cntx) override;
+
+    void set_current_session(uint32_t session_index) const override;
+
+private:
+    struct Inflight;
+    class InflightJob;
+
+    using Completion = std::move_only_function<void(std::vector<ResponsePacket>)>;
+
+    // Queue the messages, complete is called on the io_context with one
+    // response per message.
+    void dispatch(std::span<const MessageView> messages,
+                  bool batch,
+                  Completion complete) const;
+
+private:
+    std::shared_ptr<HandlerPool> pool_;
+    std::unique_ptr<MessageHandler> local_;
+
+    boost::asio::io_context *cntx_{nullptr};
+    ShardMetrics *metrics_{nullptr};
+
+    mutable uint32_t session_index_{0};
+
+    // Jobs submitted to the pool that it has not finished with yet.
+    std::shared_ptr<Inflight> inflight_;
+
+    // Worker responses are copied into these on the shard thread.
+    PacketPool::Owner packets_;
+};
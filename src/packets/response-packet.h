@@ -16,21 +16,81 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
-#include <vector>
+#include <utility>
 
-// TODO <optimization>: We would prefer to use a memory pool instead of passing
-//                      around memory that was freshly allocated.
-struct ResponsePacket {
-    std::shared_ptr<std::vector<uint8_t>> packet;
+class PacketPool;
 
-    inline const uint8_t * data()
+// Bytes behind a ResponsePacket, recycled by the PacketPool that made them.
+struct PacketBuffer
+{
+    std::unique_ptr<uint8_t[]> bytes;
+    size_t size{0};
+    size_t capacity{0};
+
+    // Either bytes or memory lent by the pool's owner, see PacketPool::lend.
+    const uint8_t *data{nullptr};
+    bool lent{false};
+
+    // Packets are made and released on their shard's thread, so the count
+    // does not need to be atomic.
+    uint32_t refs{0};
+    PacketPool *pool{nullptr};
+};
+
+// A response to send back to the server, empty if there is nothing to send.
+//
+// Copies share the same buffer, which goes back to its pool once the last
+// copy is destroyed. Copying a packet from any other thread is a data race.
+class ResponsePacket
+{
+public:
+    ResponsePacket() = default;
+
+    explicit ResponsePacket(PacketBuffer *buffer)
+    :buffer_(buffer)
+    {
+        if (buffer_)
+        {
+            buffer_->refs += 1;
+        }
+    }
+
+    ResponsePacket(const ResponsePacket & other)
+    :ResponsePacket(other.buffer_)
+    {
+    }
+
+    ResponsePacket(ResponsePacket && other) noexcept
+    :buffer_(std::exchange(other.buffer_, nullptr))
     {
-        return packet->data();
     }
 
-    inline size_t size()
+    ResponsePacket & operator=(ResponsePacket other) noexcept
     {
-        return packet->size();
+        std::swap(buffer_, other.buffer_);
+        return *this;
     }
+
+    ~ResponsePacket()
+    {
+        reset();
+    }
+
+    void reset();
+
+    inline const uint8_t * data() const
+    {
+        return buffer_ ? buffer_->data : nullptr;
+    }
+
+    inline size_t size() const
+    {
+        return buffer_ ? buffer_->size : 0;
+    }
+
+private:
+    PacketBuffer *buffer_{nullptr};
 };
@@ -0,0 +1,159 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "sha256.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+static constexpr std::array<uint32_t, 64> ROUND_CONSTANTS
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+SHA256::SHA256()
+:state_{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19}
+{
+}
+
+void SHA256::update(std::span<const uint8_t> bytes)
+{
+    length_ += bytes.size();
+
+    // Top up a partial block first.
+    if (block_size_ != 0)
+    {
+        size_t taken = std::min(bytes.size(), block_.size() - block_size_);
+
+        std::memcpy(block_.data() + block_size_, bytes.data(), taken);
+        block_size_ += taken;
+        bytes = bytes.subspan(taken);
+
+        if (block_size_ < block_.size())
+        {
+            return;
+        }
+
+        compress(block_.data());
+        block_size_ = 0;
+    }
+
+    while (bytes.size() >= block_.size())
+    {
+        compress(bytes.data());
+        bytes = bytes.subspan(block_.size());
+    }
+
+    std::memcpy(block_.data(), bytes.data(), bytes.size());
+    block_size_ = bytes.size();
+}
+
+SHA256::Digest SHA256::finish()
+{
+    uint64_t bit_length = length_ * 8;
+
+    // A one bit, zeros up to 8 bytes short of a block, then the length.
+    block_[block_size_++] = 0x80;
+
+    if (block_size_ > block_.size() - 8)
+    {
+        std::memset(block_.data() + block_size_, 0, block_.size() - block_size_);
+        compress(block_.data());
+        block_size_ = 0;
+    }
+
+    std::memset(block_.data() + block_size_, 0, block_.size() - 8 - block_size_);
+
+    for (size_t i = 0; i < 8; i++)
+    {
+        block_[block_.size() - 1 - i] = static_cast<uint8_t>(bit_length >> (8 * i));
+    }
+
+    compress(block_.data());
+
+    Digest digest;
+
+    for (size_t i = 0; i < state_.size(); i++)
+    {
+        for (size_t j = 0; j < 4; j++)
+        {
+            digest[4 * i + j] = static_cast<uint8_t>(state_[i] >> (24 - 8 * j));
+        }
+    }
+
+    return digest;
+}
+
+void SHA256::compress(const uint8_t *block)
+{
+    std::array<uint32_t, 64> w;
+
+    for (size_t i = 0; i < 16; i++)
+    {
+        w[i] = (static_cast<uint32_t>(block[4 * i]) << 24)
+               | (static_cast<uint32_t>(block[4 * i + 1]) << 16)
+               | (static_cast<uint32_t>(block[4 * i + 2]) << 8)
+               | static_cast<uint32_t>(block[4 * i + 3]);
+    }
+
+    for (size_t i = 16; i < 64; i++)
+    {
+        uint32_t s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    auto [a, b, c, d, e, f, g, h] = state_;
+
+    for (size_t i = 0; i < 64; i++)
+    {
+        uint32_t s1 = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+        uint32_t choice = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + choice + ROUND_CONSTANTS[i] + w[i];
+
+        uint32_t s0 = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+        uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + majority;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+    state_[4] += e;
+    state_[5] += f;
+    state_[6] += g;
+    state_[7] += h;
+}
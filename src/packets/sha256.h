@@ -0,0 +1,51 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+// SHA-256 (FIPS 180-4), used to key and check on disk caches. Feed bytes
+// with update, then take the digest once with finish.
+class SHA256
+{
+public:
+    using Digest = std::array<uint8_t, 32>;
+
+    SHA256();
+
+    void update(std::span<const uint8_t> bytes);
+
+    Digest finish();
+
+    static Digest digest(std::span<const uint8_t> bytes)
+    {
+        SHA256 sha;
+        sha.update(bytes);
+        return sha.finish();
+    }
+
+private:
+    void compress(const uint8_t *block);
+
+private:
+    std::array<uint32_t, 8> state_;
+    std::array<uint8_t, 64> block_{};
+    size_t block_size_{0};
+    uint64_t length_{0};
+};
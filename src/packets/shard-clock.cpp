@@ -0,0 +1,186 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+
+#include "shard-clock.h"
+
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define LOADSHEAR_HAS_TSC 1
+#endif
+
+namespace
+{
+
+struct TscCalibration
+{
+    bool available{false};
+    uint64_t base{0};
+    double ns_per_tick{0.0};
+    std::chrono::steady_clock::time_point steady_base{};
+    std::chrono::system_clock::duration system_base{};
+};
+
+#ifdef LOADSHEAR_HAS_TSC
+// The TSC only measures time if it ticks at a constant rate in every
+// power state, otherwise it measures cycles.
+bool invariant_tsc()
+{
+    unsigned int eax = 0;
+    unsigned int ebx = 0;
+    unsigned int ecx = 0;
+    unsigned int edx = 0;
+
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007)
+    {
+        return false;
+    }
+
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+
+    return (edx & (1u << 8)) != 0;
+}
+#endif
+
+TscCalibration calibrate()
+{
+    TscCalibration calibration;
+
+#ifdef LOADSHEAR_HAS_TSC
+    if (!invariant_tsc())
+    {
+        return calibration;
+    }
+
+    // Long enough that the cost of the clock reads themselves is noise.
+    auto steady_start = std::chrono::steady_clock::now();
+    uint64_t tsc_start = __rdtsc();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    auto steady_end = std::chrono::steady_clock::now();
+    uint64_t tsc_end = __rdtsc();
+    auto system_end = std::chrono::system_clock::now();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        steady_end - steady_start).count();
+
+    if (tsc_end <= tsc_start || elapsed <= 0)
+    {
+        return calibration;
+    }
+
+    calibration.available = true;
+    calibration.base = tsc_end;
+    calibration.ns_per_tick = static_cast<double>(elapsed)
+                              / static_cast<double>(tsc_end - tsc_start);
+    calibration.steady_base = steady_end;
+    calibration.system_base = system_end.time_since_epoch();
+#endif
+
+    return calibration;
+}
+
+// Shared by every shard so their TSC times agree.
+const TscCalibration & tsc_calibration()
+{
+    static const TscCalibration calibration = calibrate();
+    return calibration;
+}
+
+}
+
+asio::execution_context::id ShardClock::id;
+
+ShardClock::ShardClock(asio::io_context & cntx)
+:asio::execution_context::service(cntx)
+{
+}
+
+void ShardClock::set_mode(ClockMode mode)
+{
+    if (mode == ClockMode::TSC)
+    {
+        const TscCalibration & calibration = tsc_calibration();
+
+        if (!calibration.available)
+        {
+            mode = ClockMode::Coarse;
+        }
+
+        tsc_base_ = calibration.base;
+        tsc_ns_per_tick_ = calibration.ns_per_tick;
+        tsc_steady_base_ = calibration.steady_base;
+        tsc_system_base_ = calibration.system_base;
+    }
+
+    mode_ = mode;
+    tick();
+}
+
+bool ShardClock::tsc_available()
+{
+    return tsc_calibration().available;
+}
+
+std::chrono::steady_clock::time_point ShardClock::steady_now() const
+{
+    if (mode_ != ClockMode::TSC)
+    {
+        return std::chrono::steady_clock::now();
+    }
+
+    auto elapsed = std::chrono::nanoseconds(tsc_nanoseconds());
+
+    return tsc_steady_base_
+           + std::chrono::duration_cast<std::chrono::steady_clock::duration>(elapsed);
+}
+
+std::chrono::system_clock::duration ShardClock::system_now() const
+{
+    if (mode_ != ClockMode::TSC)
+    {
+        return std::chrono::system_clock::now().time_since_epoch();
+    }
+
+    // Wall clock adjustments made during the run are not picked up.
+    auto elapsed = std::chrono::nanoseconds(tsc_nanoseconds());
+
+    return tsc_system_base_
+           + std::chrono::duration_cast<std::chrono::system_clock::duration>(elapsed);
+}
+
+int64_t ShardClock::tsc_nanoseconds() const
+{
+#ifdef LOADSHEAR_HAS_TSC
+    // Signed, another core may read a few ticks behind the calibration.
+    int64_t ticks = static_cast<int64_t>(__rdtsc() - tsc_base_);
+
+    return static_cast<int64_t>(static_cast<double>(ticks) * tsc_ns_per_tick_);
+#else
+    return 0;
+#endif
+}
+
+void ShardClock::shutdown()
+{
+}
@@ -0,0 +1,138 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+
+#pragma once
+
+#include <boost/asio.hpp>
+
+#include <chrono>
+#include <cstdint>
+
+namespace asio = boost::asio;
+
+// Where a shard's clock reads come from, set by CLOCK.
+enum class ClockMode : uint8_t
+{
+    // Every read asks the OS.
+    System,
+
+    // Latency samples and TIMESTAMP fields down to milliseconds use a time
+    // read once per event loop iteration.
+    Coarse,
+
+    // Like Coarse, but the remaining reads come from the calibrated TSC.
+    TSC
+};
+
+// Clock for every session on one io_context (so one per shard), obtained
+// with asio::use_service<ShardClock>(cntx).
+//
+// The shard calls tick() at the start of every event loop iteration, the
+// first cached read after it reads the clock for the rest of the iteration.
+//
+// Not thread safe, every call must happen on the io_context thread.
+class ShardClock : public asio::execution_context::service
+{
+public:
+    static asio::execution_context::id id;
+
+    explicit ShardClock(asio::io_context & cntx);
+
+    ShardClock(const ShardClock &) = delete;
+    ShardClock & operator=(const ShardClock &) = delete;
+
+    // TSC falls back to Coarse when the TSC can't be trusted.
+    void set_mode(ClockMode mode);
+
+    ClockMode mode() const
+    {
+        return mode_;
+    }
+
+    // True if the CPU has an invariant TSC, calibrates it on the first call.
+    static bool tsc_available();
+
+    // Mark the cached time stale, called once per event loop iteration.
+    void tick()
+    {
+        steady_fresh_ = false;
+        system_fresh_ = false;
+    }
+
+    // Precise reads, from the TSC in TSC mode.
+    std::chrono::steady_clock::time_point steady_now() const;
+    std::chrono::system_clock::duration system_now() const;
+
+    // Time used for latency samples.
+    std::chrono::steady_clock::time_point sample_now()
+    {
+        if (mode_ == ClockMode::System)
+        {
+            return std::chrono::steady_clock::now();
+        }
+
+        if (!steady_fresh_)
+        {
+            steady_ = steady_now();
+            steady_fresh_ = true;
+        }
+
+        return steady_;
+    }
+
+    // Time since the epoch for TIMESTAMP fields, precise for formats finer
+    // than milliseconds.
+    std::chrono::system_clock::duration timestamp_now(bool precise)
+    {
+        if (mode_ == ClockMode::System)
+        {
+            return std::chrono::system_clock::now().time_since_epoch();
+        }
+
+        if (precise)
+        {
+            return system_now();
+        }
+
+        if (!system_fresh_)
+        {
+            system_ = system_now();
+            system_fresh_ = true;
+        }
+
+        return system_;
+    }
+
+private:
+    void shutdown() override;
+
+    int64_t tsc_nanoseconds() const;
+
+private:
+    ClockMode mode_{ClockMode::System};
+
+    std::chrono::steady_clock::time_point steady_{};
+    std::chrono::system_clock::duration system_{};
+    bool steady_fresh_{false};
+    bool system_fresh_{false};
+
+    // Copied from the process wide calibration in TSC mode.
+    uint64_t tsc_base_{0};
+    double tsc_ns_per_tick_{0.0};
+    std::chrono::steady_clock::time_point tsc_steady_base_{};
+    std::chrono::system_clock::duration tsc_system_base_{};
+};
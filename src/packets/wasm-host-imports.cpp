@@ -0,0 +1,109 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "wasm-host-imports.h"
+
+#include <any>
+#include <chrono>
+#include <random>
+
+WASMHostState::WASMHostState()
+{
+    std::random_device seed;
+
+    random_state = (static_cast<uint64_t>(seed()) << 32) | seed();
+}
+
+int64_t WASMHostState::clock()
+{
+    if (!clock_valid)
+    {
+        clock_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count();
+        clock_valid = true;
+    }
+
+    return clock_ns;
+}
+
+uint64_t WASMHostState::random()
+{
+    uint64_t z = (random_state += 0x9e3779b97f4a7c15);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+
+    return z ^ (z >> 31);
+}
+
+static WASMHostState & host_state(wasmtime::Caller & caller)
+{
+    return *std::any_cast<WASMHostState *>(caller.context().get_data());
+}
+
+std::string define_host_imports(wasmtime::Linker & linker)
+{
+    // Nanoseconds since the Unix epoch, the same for every call in one entry.
+    auto clock = linker.func_wrap(HOST_IMPORT_MODULE, "clock_ns",
+        [](wasmtime::Caller caller) -> int64_t {
+            return host_state(caller).clock();
+        });
+
+    if (!clock)
+    {
+        return clock.err().message();
+    }
+
+    // Returns the counter's value, then increments it.
+    auto counter = linker.func_wrap(HOST_IMPORT_MODULE, "counter_next",
+        [](wasmtime::Caller caller, int32_t id) -> wasmtime::Result<int64_t, wasmtime::Trap> {
+            auto & state = host_state(caller);
+
+            if (id < 0 || static_cast<size_t>(id) >= WASMHostState::NUM_COUNTERS)
+            {
+                return wasmtime::Trap("counter_next called with an invalid counter");
+            }
+
+            return state.counters[id]++;
+        });
+
+    if (!counter)
+    {
+        return counter.err().message();
+    }
+
+    auto session = linker.func_wrap(HOST_IMPORT_MODULE, "session_index",
+        [](wasmtime::Caller caller) -> int32_t {
+            return static_cast<int32_t>(host_state(caller).session_index);
+        });
+
+    if (!session)
+    {
+        return session.err().message();
+    }
+
+    auto random = linker.func_wrap(HOST_IMPORT_MODULE, "random_u64",
+        [](wasmtime::Caller caller) -> int64_t {
+            return static_cast<int64_t>(host_state(caller).random());
+        });
+
+    if (!random)
+    {
+        return random.err().message();
+    }
+
+    return {};
+}
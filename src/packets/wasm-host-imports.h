@@ -0,0 +1,62 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include <wasmtime.hh>
+
+// Per handler (so per shard) state behind the "loadshear" host imports.
+//
+// The handler stores a pointer to this as its store's data, the imports
+// find it through the caller. Nothing here is shared between threads.
+struct WASMHostState
+{
+    static constexpr size_t NUM_COUNTERS = 16;
+
+    WASMHostState();
+
+    // Script index of the session whose messages are being handled.
+    uint32_t session_index{0};
+
+    // Realtime clock read at most once per entry into the guest.
+    bool clock_valid{false};
+    int64_t clock_ns{0};
+
+    std::array<int64_t, NUM_COUNTERS> counters{};
+
+    // splitmix64 state, seeded per handler.
+    uint64_t random_state{0};
+
+    // Called whenever the host enters the guest, so the clock is read again.
+    void begin_entry()
+    {
+        clock_valid = false;
+    }
+
+    int64_t clock();
+
+    uint64_t random();
+};
+
+// Module name the imports are defined under.
+inline constexpr std::string_view HOST_IMPORT_MODULE = "loadshear";
+
+// Defines every host import on the linker, see docs/wasm-modules.md.
+std::string define_host_imports(wasmtime::Linker & linker);
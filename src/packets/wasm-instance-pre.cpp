@@ -0,0 +1,81 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "wasm-instance-pre.h"
+
+#include "wasm-host-imports.h"
+
+std::expected<std::shared_ptr<const WASMInstancePre>, std::string>
+WASMInstancePre::create(wasmtime::Engine & engine, const wasmtime::Module & module)
+{
+    // Handlers may only import what define_host_imports provides.
+    wasmtime::Linker linker(engine);
+
+    std::string import_error = define_host_imports(linker);
+
+    if (!import_error.empty())
+    {
+        return std::unexpected{"Failed to define host imports: " + import_error};
+    }
+
+    wasmtime_instance_pre_t *pre = nullptr;
+    wasmtime_error_t *error = wasmtime_linker_instantiate_pre(linker.capi(), module.capi(), &pre);
+
+    if (error)
+    {
+        return std::unexpected{"Failed to pre-instantiate WASM module: "
+                               + wasmtime::Error(error).message()};
+    }
+
+    return std::shared_ptr<const WASMInstancePre>(new WASMInstancePre(pre));
+}
+
+WASMInstancePre::WASMInstancePre(wasmtime_instance_pre_t *pre)
+:pre_(pre)
+{
+}
+
+WASMInstancePre::~WASMInstancePre()
+{
+    if (pre_)
+    {
+        wasmtime_instance_pre_delete(pre_);
+    }
+}
+
+std::expected<wasmtime::Instance, std::string>
+WASMInstancePre::instantiate(wasmtime::Store & store) const
+{
+    wasmtime_instance_t instance;
+    wasm_trap_t *trap = nullptr;
+
+    wasmtime_error_t *error = wasmtime_instance_pre_instantiate(pre_,
+                                                                wasmtime_store_context(store.capi()),
+                                                                &instance,
+                                                                &trap);
+
+    if (error)
+    {
+        return std::unexpected{wasmtime::Error(error).message()};
+    }
+
+    if (trap)
+    {
+        return std::unexpected{wasmtime::Trap(trap).message()};
+    }
+
+    return wasmtime::Instance(instance);
+}
@@ -0,0 +1,50 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <expected>
+#include <memory>
+#include <string>
+
+#include <wasmtime.hh>
+
+// A module with its imports already resolved and type checked, shared by
+// every shard so each one only has to create its own instance.
+//
+// The C++ API has no wrapper for this yet, so we hold the C handle.
+class WASMInstancePre
+{
+public:
+    static std::expected<std::shared_ptr<const WASMInstancePre>, std::string>
+    create(wasmtime::Engine & engine, const wasmtime::Module & module);
+
+    ~WASMInstancePre();
+
+    WASMInstancePre(const WASMInstancePre &) = delete;
+    WASMInstancePre & operator=(const WASMInstancePre &) = delete;
+    WASMInstancePre(WASMInstancePre &&) = delete;
+    WASMInstancePre & operator=(WASMInstancePre &&) = delete;
+
+    // Safe to call from any thread, the store must belong to the same engine.
+    std::expected<wasmtime::Instance, std::string> instantiate(wasmtime::Store & store) const;
+
+private:
+    explicit WASMInstancePre(wasmtime_instance_pre_t *pre);
+
+private:
+    wasmtime_instance_pre_t *pre_{nullptr};
+};
@@ -16,29 +16,60 @@
 
 #include "wasm-message-handler.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <utility>
 #include <iostream>
 
 // for memcpy
 #include <cstring>
 
+#include "epoch-ticker.h"
 #include "logger.h"
+#include "payload-structs.h"
+#include "shard-metrics.h"
 
 WASMMessageHandler::WASMMessageHandler(std::shared_ptr<wasmtime::Engine> engine,
-                                       std::shared_ptr<wasmtime::Module> module)
-:engine_(std::move(engine)),
+                                       std::shared_ptr<wasmtime::Module> module,
+                                       WASMHandlerOptions options)
+:length_field_(options.length_field),
+guest_memory_(options.guest_memory),
+epoch_deadline_(options.epoch_deadline),
+fuel_(options.fuel),
+engine_(std::move(engine)),
 module_(std::move(module)),
-store_(*engine_)
+store_(*engine_),
+packets_(PacketPool::create([this](std::span<const uint8_t> bytes){
+    return_response(bytes);
+}))
 {
-    auto tmp_instance = wasmtime::Instance::create(store_, *module_, {});
+    // Start functions run during instantiation.
+    arm_limits();
+
+    // Host imports find their state through the store.
+    store_.context().set_data(&host_);
+
+    // Handlers made on their own resolve the imports themselves.
+    if (!options.instance_pre)
+    {
+        auto pre = WASMInstancePre::create(*engine_, *module_);
+
+        if (!pre)
+        {
+            throw std::runtime_error(pre.error());
+        }
+
+        options.instance_pre = std::move(*pre);
+    }
+
+    auto tmp_instance = options.instance_pre->instantiate(store_);
 
     if (!tmp_instance)
     {
-        // We cannot proceed with execution, the program must end and caller must deal with the error.
-        throw std::runtime_error("WASM instance could not be created! Aborting!");
+        throw std::runtime_error("WASM instance could not be created: " + tmp_instance.error());
     }
 
-    instance_ = std::move(tmp_instance.unwrap());
+    instance_ = std::move(*tmp_instance);
 
     auto maybe_memory = instance_->get(store_, "memory");
 
@@ -116,6 +147,32 @@ store_(*engine_)
 
     handle_body_ = std::move(*body_ptr);
 
+    // Try to get handle_batch, otherwise messages are handled one at a time.
+    auto maybe_batch = instance_->get(store_, "handle_batch");
+
+    if (maybe_batch)
+    {
+        auto batch_ptr = std::get_if<decltype(handle_batch_)::value_type>(&*maybe_batch);
+
+        if (batch_ptr)
+        {
+            handle_batch_ = std::move(*batch_ptr);
+        }
+    }
+
+    // Try to get generate_payload, otherwise payloads are sent as they are.
+    auto maybe_generate = instance_->get(store_, "generate_payload");
+
+    if (maybe_generate)
+    {
+        auto generate_ptr = std::get_if<decltype(generate_payload_)::value_type>(&*maybe_generate);
+
+        if (generate_ptr)
+        {
+            generate_payload_ = std::move(*generate_ptr);
+        }
+    }
+
     // Try to get handle_header, otherwise we will use the header function provided.
     auto maybe_header = instance_->get(store_, "handle_header");
 
@@ -136,12 +193,14 @@ store_(*engine_)
     // Set the header parsing function to use the WASM header.
 
     set_header_parser([this](std::span<const uint8_t> buffer) -> HeaderResult {
+        arm_limits();
+
         try
         {
             // Call WASM otherwise (obscure protocol).
             uint32_t input_length = static_cast<uint32_t>(buffer.size());
 
-            auto alloc_res = alloc_->call(store_, {static_cast<int32_t>(buffer.size())}).unwrap();
+            auto alloc_res = call_guest(*alloc_, {static_cast<int32_t>(buffer.size())});
 
             uint32_t input_index = alloc_res[0].i32();
 
@@ -151,9 +210,9 @@ store_(*engine_)
 
                 Logger::warn(std::move(e_string));
 
-                dealloc_->call(store_,
-                               {static_cast<int32_t>(input_index),
-                                static_cast<int32_t>(input_length)}).unwrap();
+                call_guest(*dealloc_,
+                           {static_cast<int32_t>(input_index),
+                            static_cast<int32_t>(input_length)});
 
                 return {0, HeaderResult::Status::ERROR};
             }
@@ -171,9 +230,9 @@ store_(*engine_)
 
                 Logger::warn(std::move(e_string));
 
-                dealloc_->call(store_,
-                               {static_cast<int32_t>(input_index),
-                                static_cast<int32_t>(input_length)}).unwrap();
+                call_guest(*dealloc_,
+                           {static_cast<int32_t>(input_index),
+                            static_cast<int32_t>(input_length)});
 
                 return {0, HeaderResult::Status::ERROR};
             }
@@ -182,9 +241,10 @@ store_(*engine_)
                         buffer.data(),
                         buffer.size());
 
-            auto header_res = handle_header_->call(store_,
-                                                   {static_cast<int32_t>(input_index),
-                                                    static_cast<int32_t>(input_length)}).unwrap();
+            auto header_res = call_guest(*handle_header_,
+                                         {static_cast<int32_t>(input_index),
+                                          static_cast<int32_t>(input_length)},
+                                         true);
 
             uint32_t size = 0;
             int32_t signed_size = header_res[0].i32();
@@ -198,9 +258,9 @@ store_(*engine_)
 
                 Logger::warn(std::move(e_string));
 
-                dealloc_->call(store_,
-                               {static_cast<int32_t>(input_index),
-                                static_cast<int32_t>(input_length)}).unwrap();
+                call_guest(*dealloc_,
+                           {static_cast<int32_t>(input_index),
+                            static_cast<int32_t>(input_length)});
 
                 return {size, HeaderResult::Status::ERROR};
             }
@@ -208,9 +268,9 @@ store_(*engine_)
             size = static_cast<uint32_t>(signed_size);
 
             // Call dealloc
-            dealloc_->call(store_,
-                           {static_cast<int32_t>(input_index),
-                            static_cast<int32_t>(input_length)}).unwrap();
+            call_guest(*dealloc_,
+                       {static_cast<int32_t>(input_index),
+                        static_cast<int32_t>(input_length)});
 
             return {size, HeaderResult::Status::OK};
         }
@@ -236,16 +296,21 @@ void WASMMessageHandler::parse_message(std::span<const uint8_t> header,
     // Annotated with the required Host <-> Guest API contract.
     //
     // (CONTRACT 1) was already resolved, we found the required exports in the module.
+    uint32_t input_index = 0;
+    uint32_t input_length = 0;
+
+    arm_limits();
+
     try
     {
         // (CONTRACT 2): Allocate in the user's module.
 
         // Compute length. This is assumed to not overflow, any packet this large is unreasonable.
-        uint32_t input_length = static_cast<uint32_t>(header.size() + body.size());
+        input_length = static_cast<uint32_t>(header.size() + body.size());
 
-        auto alloc_res = alloc_->call(store_, {static_cast<int32_t>(input_length)}).unwrap();
+        auto alloc_res = call_guest(*alloc_, {static_cast<int32_t>(input_length)});
 
-        uint32_t input_index = alloc_res[0].i32();
+        input_index = alloc_res[0].i32();
 
         // Bad allocation if index is zero.
         if (input_index == 0)
@@ -254,7 +319,7 @@ void WASMMessageHandler::parse_message(std::span<const uint8_t> header,
 
             Logger::warn(std::move(e_msg));
 
-            callback({ std::make_shared<std::vector<uint8_t>>() });
+            callback({});
             return;
         }
 
@@ -272,11 +337,11 @@ void WASMMessageHandler::parse_message(std::span<const uint8_t> header,
 
             Logger::warn(std::move(e_msg));
 
-            dealloc_->call(store_,
-                           {static_cast<int32_t>(input_index),
-                            static_cast<int32_t>(input_length)}).unwrap();
+            call_guest(*dealloc_,
+                       {static_cast<int32_t>(input_index),
+                        static_cast<int32_t>(input_length)});
 
-            callback({ std::make_shared<std::vector<uint8_t>>() });
+            callback({});
             return;
         }
 
@@ -287,11 +352,145 @@ void WASMMessageHandler::parse_message(std::span<const uint8_t> header,
         std::memcpy(guest_memory + input_index + header.size(),
                     body.data(),
                     body.size());
+    }
+    catch (const wasmtime::Trap & error)
+    {
+        std::string e_string = "WASM Trap during packet processing: "
+                               + std::string(error.message());
+
+        Logger::warn(std::move(e_string));
+
+        callback({});
+        return;
+    }
+    catch (const std::exception & error)
+    {
+        std::string e_string = "WASM exception during packet processing: "
+                               + std::string(error.what());
+
+        Logger::warn(std::move(e_string));
+
+        callback({});
+        return;
+    }
+
+    handle_input(input_index, input_length, std::move(callback));
+}
+
+std::span<uint8_t> WASMMessageHandler::reserve_message(size_t length) const
+{
+    if (!guest_memory_ || length == 0 || length > UINT32_MAX)
+    {
+        return {};
+    }
+
+    arm_limits();
+
+    try
+    {
+        auto alloc_res = call_guest(*alloc_, {static_cast<int32_t>(length)});
+
+        uint32_t input_index = alloc_res[0].i32();
+
+        // Let the session fall back to its own buffers.
+        if (input_index == 0)
+        {
+            return {};
+        }
+
+        auto mem_view = memory_->data(store_);
+
+        // Try to prevent OOB memory access.
+        if (static_cast<uint64_t>(input_index) + static_cast<uint64_t>(length)
+            > mem_view.size())
+        {
+            std::string e_msg = "OOB behavior detected during input "
+                                "buffer reservation. Your WASM script "
+                                "violates the contract.";
+
+            Logger::warn(std::move(e_msg));
+
+            call_guest(*dealloc_,
+                       {static_cast<int32_t>(input_index),
+                        static_cast<int32_t>(length)});
+
+            return {};
+        }
+
+        return std::span<uint8_t>(mem_view.data() + input_index, length);
+    }
+    catch (...)
+    {
+        std::string e_string = "Exception during input buffer reservation. "
+                               "Your WASM script violates the contract.";
+
+        Logger::warn(std::move(e_string));
+
+        return {};
+    }
+}
+
+void WASMMessageHandler::parse_reserved(std::span<uint8_t> message,
+                                        std::function<void(ResponsePacket)> callback) const
+{
+    // (CONTRACT 2) and (CONTRACT 3) were done by reserve_message and the session.
+    auto input_index = guest_index(message);
+
+    if (!input_index)
+    {
+        std::string e_msg = "Reserved message is no longer in guest memory, "
+                            "dropping it.";
+
+        Logger::warn(std::move(e_msg));
+
+        callback({});
+        return;
+    }
+
+    arm_limits();
+
+    handle_input(*input_index,
+                 static_cast<uint32_t>(message.size()),
+                 std::move(callback));
+}
+
+void WASMMessageHandler::release_reserved(std::span<uint8_t> message) const
+{
+    auto input_index = guest_index(message);
 
+    if (!input_index)
+    {
+        return;
+    }
+
+    arm_limits();
+
+    try
+    {
+        call_guest(*dealloc_,
+                   {static_cast<int32_t>(*input_index),
+                    static_cast<int32_t>(message.size())});
+    }
+    catch (...)
+    {
+        std::string e_string = "Exception during input buffer release. "
+                               "Your WASM script violates the contract.";
+
+        Logger::warn(std::move(e_string));
+    }
+}
+
+void WASMMessageHandler::handle_input(uint32_t input_index,
+                                      uint32_t input_length,
+                                      std::function<void(ResponsePacket)> callback) const
+{
+    try
+    {
         // (CONTRACT 4): Host calls the required handler from Guest.
-        auto body_res = handle_body_->call(store_,
-                                           {static_cast<int32_t>(input_index),
-                                            static_cast<int32_t>(input_length)}).unwrap();
+        auto body_res = call_guest(*handle_body_,
+                                   {static_cast<int32_t>(input_index),
+                                    static_cast<int32_t>(input_length)},
+                                   true);
 
         uint64_t packed = body_res[0].i64();
 
@@ -300,13 +499,13 @@ void WASMMessageHandler::parse_message(std::span<const uint8_t> header,
         uint32_t out_length = static_cast<uint32_t>((packed >> 32) & 0xffffffffu);
 
         // (CONTRACT 6): Copy data from Guest to Host.
-        auto vec = std::make_shared<std::vector<uint8_t>>();
+        ResponsePacket response;
 
         if (out_length > 0)
         {
             // Handle guests changing their memory layout.
-            mem_view = memory_->data(store_);
-            guest_memory = memory_->data(store_).data();
+            auto mem_view = memory_->data(store_);
+            uint8_t *guest_memory = mem_view.data();
 
             // Try to prevent OOB memory access.
             if (static_cast<uint64_t>(out_index) + static_cast<uint64_t>(out_length)
@@ -318,36 +517,52 @@ void WASMMessageHandler::parse_message(std::span<const uint8_t> header,
 
                 Logger::warn(std::move(e_msg));
 
-                dealloc_->call(store_,
-                               {static_cast<int32_t>(out_index),
-                                static_cast<int32_t>(out_length)}).unwrap();
+                call_guest(*dealloc_,
+                           {static_cast<int32_t>(out_index),
+                            static_cast<int32_t>(out_length)});
 
-                dealloc_->call(store_,
-                               {static_cast<int32_t>(input_index),
-                                static_cast<int32_t>(input_length)}).unwrap();
+                call_guest(*dealloc_,
+                           {static_cast<int32_t>(input_index),
+                            static_cast<int32_t>(input_length)});
 
-                callback({ std::make_shared<std::vector<uint8_t>>() });
+                callback({});
                 return;
             }
 
-            // Copy data out of guest.
-            vec->resize(out_length);
-            std::memcpy(vec->data(), guest_memory + out_index, out_length);
+            std::span<const uint8_t> out_bytes(guest_memory + out_index, out_length);
+
+            // A response inside the input is freed with it below, copy those.
+            uint64_t out_end = static_cast<uint64_t>(out_index) + out_length;
+            uint64_t input_end = static_cast<uint64_t>(input_index) + input_length;
+
+            bool overlaps_input = out_index < input_end && input_index < out_end;
+
+            if (guest_memory_ && !overlaps_input)
+            {
+                // Written straight out of the guest, (CONTRACT 7) happens
+                // in return_response once the packet is released.
+                response = packets_->lend(out_bytes);
+            }
+            else
+            {
+                // Copy data out of guest, into a buffer recycled from an earlier response.
+                response = packets_->copy(out_bytes);
 
         // (CONTRACT 7): Host calls deallocate for Guest.
 
-            // Call dealloc on output buffer.
-            dealloc_->call(store_,
+                // Call dealloc on output buffer.
+                call_guest(*dealloc_,
                            {static_cast<int32_t>(out_index),
-                            static_cast<int32_t>(out_length)}).unwrap();
+                            static_cast<int32_t>(out_length)});
+            }
         }
 
         // Call dealloc on input buffer.
-        dealloc_->call(store_,
-                       {static_cast<int32_t>(input_index),
-                        static_cast<int32_t>(input_length)}).unwrap();
+        call_guest(*dealloc_,
+                   {static_cast<int32_t>(input_index),
+                    static_cast<int32_t>(input_length)});
 
-        callback({std::move(vec)});
+        callback(std::move(response));
         return;
     }
     catch (const wasmtime::Trap & error)
@@ -357,8 +572,7 @@ void WASMMessageHandler::parse_message(std::span<const uint8_t> header,
 
         Logger::warn(std::move(e_string));
 
-        auto vec = std::make_shared<std::vector<uint8_t>>();
-        callback({std::move(vec)});
+        callback({});
         return;
     }
     catch (const std::exception & error)
@@ -368,14 +582,393 @@ void WASMMessageHandler::parse_message(std::span<const uint8_t> header,
 
         Logger::warn(std::move(e_string));
 
-        auto vec = std::make_shared<std::vector<uint8_t>>();
-        callback({std::move(vec)});
+        callback({});
         return;
     }
 }
 
+bool WASMMessageHandler::batches() const
+{
+    return handle_batch_.has_value();
+}
+
+bool WASMMessageHandler::generates() const
+{
+    return generate_payload_.has_value();
+}
+
+// Same loop as handle_body, with the payload as the input. The generated
+// bytes are copied into the payload's temps, which keep their capacity
+// from one send to the next.
+void WASMMessageHandler::generate_payload(uint32_t session_index,
+                                          size_t payload_index,
+                                          PreparedPayload & payload) const
+{
+    // File slices are never read into memory.
+    if (!generate_payload_ || !payload.file_slices.empty())
+    {
+        return;
+    }
+
+    set_current_session(session_index);
+    arm_limits();
+
+    uint32_t input_length = 0;
+
+    for (const auto & slice : payload.packet_slices)
+    {
+        input_length += static_cast<uint32_t>(slice.size());
+    }
+
+    try
+    {
+        auto alloc_res = call_guest(*alloc_, {static_cast<int32_t>(input_length)});
+
+        uint32_t input_index = alloc_res[0].i32();
+
+        auto mem_view = memory_->data(store_);
+        uint8_t *guest_memory = mem_view.data();
+
+        if (input_index == 0
+            || static_cast<uint64_t>(input_index) + input_length > mem_view.size())
+        {
+            std::string e_msg = "Bad allocation detected for generated payload. "
+                                "Your WASM script violates the contract.";
+
+            Logger::warn(std::move(e_msg));
+
+            call_guest(*dealloc_,
+                       {static_cast<int32_t>(input_index),
+                        static_cast<int32_t>(input_length)});
+            return;
+        }
+
+        uint8_t *write_ptr = guest_memory + input_index;
+
+        for (const auto & slice : payload.packet_slices)
+        {
+            std::memcpy(write_ptr, slice.data(), slice.size());
+            write_ptr += slice.size();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        auto generate_res = call_guest(*generate_payload_,
+                                       {static_cast<int32_t>(input_index),
+                                        static_cast<int32_t>(input_length),
+                                        static_cast<int32_t>(payload_index)});
+
+        if (metrics_)
+        {
+            metrics_->record_generate_time(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count()));
+        }
+
+        uint64_t packed = generate_res[0].i64();
+
+        uint32_t out_index = static_cast<uint32_t>(packed & 0xffffffffu);
+        uint32_t out_length = static_cast<uint32_t>((packed >> 32) & 0xffffffffu);
+
+        // A size of 0 sends the payload unchanged.
+        if (out_length > 0)
+        {
+            // Handle guests changing their memory layout.
+            mem_view = memory_->data(store_);
+            guest_memory = mem_view.data();
+
+            if (static_cast<uint64_t>(out_index) + out_length > mem_view.size())
+            {
+                std::string e_msg = "OOB behavior detected during generated "
+                                    "payload read. Your WASM script violates "
+                                    "the contract.";
+
+                Logger::warn(std::move(e_msg));
+            }
+            else
+            {
+                // The old slices may point into temps, they are replaced below.
+                payload.temps.assign(guest_memory + out_index,
+                                     guest_memory + out_index + out_length);
+
+                payload.packet_slices.clear();
+                payload.packet_slices.emplace_back(payload.temps.data(), out_length);
+            }
+
+            call_guest(*dealloc_,
+                       {static_cast<int32_t>(out_index),
+                        static_cast<int32_t>(out_length)});
+        }
+
+        call_guest(*dealloc_,
+                   {static_cast<int32_t>(input_index),
+                    static_cast<int32_t>(input_length)});
+    }
+    catch (const std::exception & error)
+    {
+        std::string e_string = "WASM exception during payload generation: "
+                               + std::string(error.what());
+
+        Logger::warn(std::move(e_string));
+    }
+}
+
+// Entries of the batch tables are a little endian (index, size) pair.
+static void store_entry(uint8_t *entry, uint32_t index, uint32_t size)
+{
+    for (size_t i = 0; i < 4; i++)
+    {
+        entry[i] = static_cast<uint8_t>(index >> (8 * i));
+        entry[4 + i] = static_cast<uint8_t>(size >> (8 * i));
+    }
+}
+
+static std::pair<uint32_t, uint32_t> load_entry(const uint8_t *entry)
+{
+    uint32_t index = 0;
+    uint32_t size = 0;
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        index |= static_cast<uint32_t>(entry[i]) << (8 * i);
+        size |= static_cast<uint32_t>(entry[4 + i]) << (8 * i);
+    }
+
+    return {index, size};
+}
+
+void WASMMessageHandler::parse_batch(std::span<const MessageView> messages,
+                                     std::function<void(std::vector<ResponsePacket>)> callback) const
+{
+    // Same contract as parse_message, but the input is a table of
+    // (index, size) entries followed by the messages they point at, and the
+    // output is a table with one (index, size) entry per message.
+    std::vector<ResponsePacket> responses(messages.size());
+
+    if (messages.empty())
+    {
+        callback(std::move(responses));
+        return;
+    }
+
+    arm_limits();
+
+    try
+    {
+        uint64_t table_length = static_cast<uint64_t>(messages.size()) * BATCH_ENTRY_SIZE;
+        uint64_t input_length = table_length;
+
+        for (const MessageView & message : messages)
+        {
+            input_length += message.header.size() + message.body.size();
+        }
+
+        if (input_length > INT32_MAX)
+        {
+            std::string e_msg = "Batch is too large for guest memory";
+
+            Logger::warn(std::move(e_msg));
+
+            callback(std::move(responses));
+            return;
+        }
+
+        auto alloc_res = call_guest(*alloc_, {static_cast<int32_t>(input_length)});
+
+        uint32_t input_index = alloc_res[0].i32();
+
+        if (input_index == 0)
+        {
+            std::string e_msg = "Bad allocation detected for batch";
+
+            Logger::warn(std::move(e_msg));
+
+            callback(std::move(responses));
+            return;
+        }
+
+        auto mem_view = memory_->data(store_);
+        uint8_t *guest_memory = mem_view.data();
+
+        // Try to prevent OOB memory access.
+        if (static_cast<uint64_t>(input_index) + input_length > mem_view.size())
+        {
+            std::string e_msg = "OOB behavior detected during batch "
+                                "buffer write. Your WASM script "
+                                "violates the contract.";
+
+            Logger::warn(std::move(e_msg));
+
+            call_guest(*dealloc_,
+                       {static_cast<int32_t>(input_index),
+                        static_cast<int32_t>(input_length)});
+
+            callback(std::move(responses));
+            return;
+        }
+
+        // Messages go right after the table.
+        uint32_t message_index = input_index + static_cast<uint32_t>(table_length);
+
+        for (size_t i = 0; i < messages.size(); i++)
+        {
+            const MessageView & message = messages[i];
+
+            uint32_t message_length = static_cast<uint32_t>(message.header.size()
+                                                            + message.body.size());
+
+            store_entry(guest_memory + input_index + i * BATCH_ENTRY_SIZE,
+                        message_index,
+                        message_length);
+
+            std::memcpy(guest_memory + message_index,
+                        message.header.data(),
+                        message.header.size());
+
+            std::memcpy(guest_memory + message_index + message.header.size(),
+                        message.body.data(),
+                        message.body.size());
+
+            message_index += message_length;
+        }
+
+        auto batch_res = call_guest(*handle_batch_,
+                                    {static_cast<int32_t>(input_index),
+                                     static_cast<int32_t>(messages.size())},
+                                    true);
+
+        uint64_t packed = batch_res[0].i64();
+
+        uint32_t out_index = static_cast<uint32_t>(packed & 0xffffffffu);
+        uint32_t out_length = static_cast<uint32_t>((packed >> 32) & 0xffffffffu);
+
+        // A size of zero means no responses at all.
+        if (out_length > 0)
+        {
+            // Handle guests changing their memory layout.
+            mem_view = memory_->data(store_);
+            guest_memory = mem_view.data();
+
+            if (out_length != table_length
+                || static_cast<uint64_t>(out_index) + out_length > mem_view.size())
+            {
+                std::string e_msg = "Bad response table returned by "
+                                    "handle_batch. Your WASM script "
+                                    "violates the contract.";
+
+                Logger::warn(std::move(e_msg));
+            }
+            else
+            {
+                for (size_t i = 0; i < messages.size(); i++)
+                {
+                    auto [index, size] = load_entry(guest_memory + out_index
+                                                    + i * BATCH_ENTRY_SIZE);
+
+                    if (size == 0)
+                    {
+                        continue;
+                    }
+
+                    if (static_cast<uint64_t>(index) + size > mem_view.size())
+                    {
+                        std::string e_msg = "OOB behavior detected during batch "
+                                            "response read. Your WASM script "
+                                            "violates the contract.";
+
+                        Logger::warn(std::move(e_msg));
+
+                        continue;
+                    }
+
+                    responses[i] = packets_->copy(std::span<const uint8_t>(
+                                                    guest_memory + index,
+                                                    size));
+                }
+            }
+
+            call_guest(*dealloc_,
+                       {static_cast<int32_t>(out_index),
+                        static_cast<int32_t>(out_length)});
+        }
+
+        call_guest(*dealloc_,
+                   {static_cast<int32_t>(input_index),
+                    static_cast<int32_t>(input_length)});
+    }
+    catch (const wasmtime::Trap & error)
+    {
+        std::string e_string = "WASM Trap during batch processing: "
+                               + std::string(error.message());
+
+        Logger::warn(std::move(e_string));
+
+        // Don't hand out half a batch.
+        std::ranges::fill(responses, ResponsePacket{});
+    }
+    catch (const std::exception & error)
+    {
+        std::string e_string = "WASM exception during batch processing: "
+                               + std::string(error.what());
+
+        Logger::warn(std::move(e_string));
+
+        std::ranges::fill(responses, ResponsePacket{});
+    }
+
+    callback(std::move(responses));
+}
+
+std::optional<uint32_t> WASMMessageHandler::guest_index(std::span<const uint8_t> bytes) const
+{
+    auto mem_view = memory_->data(store_);
+
+    const uint8_t *begin = mem_view.data();
+    const uint8_t *end = begin + mem_view.size();
+
+    if (bytes.data() < begin || bytes.data() + bytes.size() > end)
+    {
+        return std::nullopt;
+    }
+
+    return static_cast<uint32_t>(bytes.data() - begin);
+}
+
+// Called by the packet pool once a lent response has been sent.
+void WASMMessageHandler::return_response(std::span<const uint8_t> bytes) const
+{
+    auto out_index = guest_index(bytes);
+
+    if (!out_index)
+    {
+        return;
+    }
+
+    arm_limits();
+
+    try
+    {
+        call_guest(*dealloc_,
+                   {static_cast<int32_t>(*out_index),
+                    static_cast<int32_t>(bytes.size())});
+    }
+    catch (...)
+    {
+        std::string e_string = "Exception during response buffer release. "
+                               "Your WASM script violates the contract.";
+
+        Logger::warn(std::move(e_string));
+    }
+}
+
 HeaderResult WASMMessageHandler::parse_header(std::span<const uint8_t> buffer) const
 {
+    if (length_field_)
+    {
+        // Native length field from the settings, no guest call needed.
+        return length_field_->decode(buffer);
+    }
+
     if (parse_header_func)
     {
         // Use C++ lambda if available.
@@ -385,7 +978,7 @@ HeaderResult WASMMessageHandler::parse_header(std::span<const uint8_t> buffer) c
     {
         std::string e_string = "No header parse function was found! Either "
                                "provide a WASM handle_header export or "
-                               "provide byte fields to read in config!";
+                               "provide LENGTHWIDTH in SETTINGS!";
 
         Logger::warn(std::move(e_string));
 
@@ -397,3 +990,100 @@ void WASMMessageHandler::set_header_parser(HeaderParseFunction parser)
 {
     parse_header_func = std::move(parser);
 }
+
+void WASMMessageHandler::attach_metrics(ShardMetrics & metrics)
+{
+    metrics_ = &metrics;
+}
+
+void WASMMessageHandler::set_current_session(uint32_t session_index) const
+{
+    host_.session_index = session_index;
+}
+
+void WASMMessageHandler::arm_limits() const
+{
+    host_.begin_entry();
+
+    if (epoch_deadline_ != 0)
+    {
+        // One extra tick, the next one may be just about to happen.
+        store_.context().set_epoch_deadline(epoch_deadline_ + 1);
+        armed_at_ = std::chrono::steady_clock::now();
+    }
+
+    if (fuel_ != 0)
+    {
+        // Only fails for engines without fuel, which the options rule out.
+        static_cast<void>(store_.context().set_fuel(fuel_));
+    }
+}
+
+std::vector<wasmtime::Val>
+WASMMessageHandler::call_guest(const wasmtime::Func & func,
+                               std::initializer_list<wasmtime::Val> params,
+                               bool timed) const
+{
+    timed = timed && metrics_;
+
+    std::chrono::steady_clock::time_point start;
+
+    if (timed)
+    {
+        start = std::chrono::steady_clock::now();
+    }
+
+    auto result = func.call(store_, params);
+
+    if (timed)
+    {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        metrics_->record_handler_time(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    if (!result)
+    {
+        if (limits_exhausted())
+        {
+            if (metrics_)
+            {
+                metrics_->record_handler_timeout();
+            }
+
+            throw std::runtime_error("handler was cut off by HANDLERTIMEOUT "
+                                     "or HANDLERFUEL");
+        }
+
+        if (metrics_)
+        {
+            metrics_->record_handler_trap();
+        }
+
+        throw std::runtime_error(result.err().message());
+    }
+
+    return result.unwrap();
+}
+
+bool WASMMessageHandler::limits_exhausted() const
+{
+    if (fuel_ != 0)
+    {
+        auto fuel = store_.context().get_fuel();
+
+        if (fuel && fuel.ok() == 0)
+        {
+            return true;
+        }
+    }
+
+    if (epoch_deadline_ != 0)
+    {
+        return std::chrono::steady_clock::now() - armed_at_
+               >= EpochTicker::TICK * static_cast<int64_t>(epoch_deadline_);
+    }
+
+    return false;
+}
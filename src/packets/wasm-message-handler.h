@@ -16,22 +16,51 @@
 
 #pragma once
 
+#include <chrono>
 #include <functional>
+#include <initializer_list>
 #include <optional>
 
 #include <wasmtime.hh>
 
+#include "length-field.h"
 #include "message-handler-interface.h"
+#include "packet-pool.h"
+#include "wasm-host-imports.h"
+#include "wasm-instance-pre.h"
+
+struct WASMHandlerOptions
+{
+    // Used instead of the handle_header export if set.
+    std::optional<LengthField> length_field;
+
+    // Messages may be read straight into the guest's linear memory (see
+    // reserve_message) and responses are written out of it without a copy,
+    // their buffers are deallocated once sent.
+    bool guest_memory{false};
+
+    // Shared across shards so each handler skips import resolution.
+    std::shared_ptr<const WASMInstancePre> instance_pre;
+
+    // Limits on every call into the guest, 0 to disable. The engine must
+    // have epoch interruption (driven by an EpochTicker) or fuel enabled.
+    uint64_t epoch_deadline{0};
+    uint64_t fuel{0};
+};
 
 class WASMMessageHandler : public MessageHandler
 {
 public:
     using HeaderParseFunction = std::function<HeaderResult(std::span<const uint8_t>)>;
 
+    // Bytes per (index, size) entry in handle_batch's tables.
+    static constexpr size_t BATCH_ENTRY_SIZE = 8;
+
 // Overrides
 public:
     WASMMessageHandler(std::shared_ptr<wasmtime::Engine> engine,
-                       std::shared_ptr<wasmtime::Module> module);
+                       std::shared_ptr<wasmtime::Module> module,
+                       WASMHandlerOptions options = {});
 
     // Input buffer + callback.
     //
@@ -42,15 +71,87 @@ public:
 
     HeaderResult parse_header(std::span<const uint8_t> buffer) const override;
 
+    // Allocates length bytes in the guest, only with guest_memory.
+    //
+    // The span stays valid while reads are pending since wasmtime reserves
+    // the whole 32 bit address space up front, so linear memory never moves
+    // when the guest grows it.
+    std::span<uint8_t> reserve_message(size_t length) const override;
+
+    void parse_reserved(std::span<uint8_t> message,
+                        std::function<void(ResponsePacket)> callback) const override;
+
+    void release_reserved(std::span<uint8_t> message) const override;
+
+    // True if the module exports handle_batch.
+    bool batches() const override;
+
+    // One alloc, handle_batch and pair of deallocs for the whole batch.
+    void parse_batch(std::span<const MessageView> messages,
+                     std::function<void(std::vector<ResponsePacket>)> callback) const override;
+
+    // Replaces the payload with what the module's generate_payload export
+    // returns, if it has one. File backed payloads are always sent as is.
+    void generate_payload(uint32_t session_index,
+                          size_t payload_index,
+                          PreparedPayload & payload) const override;
+
+    // True if the module exports generate_payload.
+    bool generates() const;
+
+    // Handler times, traps and timeouts are recorded from now on.
+    void attach_metrics(ShardMetrics & metrics) override;
+
+    void set_current_session(uint32_t session_index) const override;
+
     ~WASMMessageHandler() = default;
 
 public:
-    // TODO <feature>: allow the user to set index values instead of forcing WASM reads.
     void set_header_parser(HeaderParseFunction parser);
 
+private:
+    // Calls handle_body on a message already in guest memory and hands the
+    // response to the callback, the input is deallocated afterwards.
+    void handle_input(uint32_t input_index,
+                      uint32_t input_length,
+                      std::function<void(ResponsePacket)> callback) const;
+
+    // Index of bytes inside guest memory, or nullopt if they are not in it.
+    std::optional<uint32_t> guest_index(std::span<const uint8_t> bytes) const;
+
+    void return_response(std::span<const uint8_t> bytes) const;
+
+    // Resets the epoch deadline, fuel and host clock, called before entering
+    // the guest from the session so the whole entry shares one budget.
+    void arm_limits() const;
+
+    // Calls into the guest, throwing on traps instead of aborting like
+    // unwrap() does. Timed calls are recorded in the handler histogram.
+    std::vector<wasmtime::Val> call_guest(const wasmtime::Func & func,
+                                          std::initializer_list<wasmtime::Val> params,
+                                          bool timed = false) const;
+
+    // True if the last failed call was cut off by arm_limits' budget.
+    bool limits_exhausted() const;
+
 private:
     HeaderParseFunction parse_header_func;
 
+    // Skips the guest entirely for the common framing schemes.
+    std::optional<LengthField> length_field_;
+
+    // Read into and write out of guest memory directly.
+    bool guest_memory_{false};
+
+    uint64_t epoch_deadline_{0};
+    uint64_t fuel_{0};
+
+    // When the limits were last armed, tells timeouts apart from traps.
+    mutable std::chrono::steady_clock::time_point armed_at_;
+
+    // Set by the shard, null when the handler is used on its own.
+    ShardMetrics *metrics_{nullptr};
+
     //
     // WASM related members.
     //
@@ -66,8 +167,16 @@ private:
     std::optional<wasmtime::Func> dealloc_;
     std::optional<wasmtime::Func> handle_body_;
     std::optional<wasmtime::Func> handle_header_;
+    std::optional<wasmtime::Func> handle_batch_;
+    std::optional<wasmtime::Func> generate_payload_;
+
+    // Behind the host imports, must outlive the store.
+    mutable WASMHostState host_;
 
     // These cannot be shared across threads, so we must have a MessageHandler per thread.
     mutable wasmtime::Store store_;
     std::optional<wasmtime::Instance> instance_;
+
+    // Responses are only made and released on this handler's thread.
+    PacketPool::Owner packets_;
 };
@@ -0,0 +1,242 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "wasm-module-cache.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <span>
+#include <string_view>
+#include <system_error>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+static std::string to_hex(std::span<const uint8_t> bytes)
+{
+    static constexpr std::string_view DIGITS = "0123456789abcdef";
+
+    std::string hex;
+    hex.reserve(bytes.size() * 2);
+
+    for (uint8_t byte : bytes)
+    {
+        hex.push_back(DIGITS[byte >> 4]);
+        hex.push_back(DIGITS[byte & 0xf]);
+    }
+
+    return hex;
+}
+
+std::filesystem::path WASMModuleCache::default_directory()
+{
+    if (const char *dir = std::getenv("LOADSHEAR_CACHE_DIR"); dir && *dir)
+    {
+        return dir;
+    }
+
+    if (const char *dir = std::getenv("XDG_CACHE_HOME"); dir && *dir)
+    {
+        return std::filesystem::path(dir) / "loadshear";
+    }
+
+    if (const char *dir = std::getenv("HOME"); dir && *dir)
+    {
+        return std::filesystem::path(dir) / ".cache" / "loadshear";
+    }
+
+    return {};
+}
+
+WASMModuleCache::WASMModuleCache(std::filesystem::path directory, std::string engine_key)
+:directory_(std::move(directory)),
+engine_key_(std::move(engine_key))
+{
+}
+
+std::expected<wasmtime::Module, std::string>
+WASMModuleCache::load(wasmtime::Engine & engine,
+                      const std::vector<uint8_t> & bytes,
+                      bool & cached) const
+{
+    cached = false;
+
+    std::filesystem::path path;
+    SHA256::Digest key{};
+
+    if (!directory_.empty())
+    {
+        key = entry_key(bytes);
+        path = entry_path(key);
+
+        std::vector<uint8_t> serialized = read_entry(path, key);
+
+        if (!serialized.empty())
+        {
+            auto module = wasmtime::Module::deserialize(engine, serialized);
+
+            // Stale or damaged entries are compiled again and replaced.
+            if (module)
+            {
+                cached = true;
+                return module.unwrap();
+            }
+        }
+    }
+
+    auto module = wasmtime::Module::compile(engine, bytes);
+
+    if (!module)
+    {
+        return std::unexpected{"Failed to compile WASM module: "
+                               + module.err().message()};
+    }
+
+    if (!path.empty())
+    {
+        store(module.ok(), path, key);
+    }
+
+    return module.unwrap();
+}
+
+SHA256::Digest WASMModuleCache::entry_key(const std::vector<uint8_t> & bytes) const
+{
+    SHA256 sha;
+
+    // The engine key is length prefixed so it can't run into the module.
+    uint64_t key_size = engine_key_.size();
+
+    sha.update(std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(&key_size),
+                                        sizeof(key_size)));
+    sha.update(std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(engine_key_.data()),
+                                        engine_key_.size()));
+    sha.update(bytes);
+
+    return sha.finish();
+}
+
+std::filesystem::path WASMModuleCache::entry_path(const SHA256::Digest & key) const
+{
+    return directory_ / "modules" / (to_hex(key) + ".cwasm");
+}
+
+std::vector<uint8_t> WASMModuleCache::read_entry(const std::filesystem::path & path,
+                                                 const SHA256::Digest & key) const
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+    if (!file)
+    {
+        return {};
+    }
+
+    std::streamoff size = file.tellg();
+
+    if (size <= static_cast<std::streamoff>(key.size()))
+    {
+        return {};
+    }
+
+    file.seekg(0);
+
+    SHA256::Digest stored;
+    file.read(reinterpret_cast<char *>(stored.data()), stored.size());
+
+    if (!file || stored != key)
+    {
+        return {};
+    }
+
+    std::vector<uint8_t> serialized(static_cast<size_t>(size) - key.size());
+
+    file.read(reinterpret_cast<char *>(serialized.data()),
+              static_cast<std::streamsize>(serialized.size()));
+
+    if (!file)
+    {
+        return {};
+    }
+
+    return serialized;
+}
+
+void WASMModuleCache::store(const wasmtime::Module & module,
+                            const std::filesystem::path & path,
+                            const SHA256::Digest & key) const
+{
+    auto serialized = module.serialize();
+
+    if (!serialized)
+    {
+        return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+
+    if (ec)
+    {
+        return;
+    }
+
+    // Entries are loaded as native code, so only we may write to them.
+    // Directories left by older runs are tightened as well.
+    std::filesystem::path modules = path.parent_path();
+
+    if (::mkdir(modules.c_str(), 0700) != 0 && errno != EEXIST)
+    {
+        return;
+    }
+
+    std::filesystem::permissions(modules, std::filesystem::perms::owner_all, ec);
+
+    if (ec)
+    {
+        return;
+    }
+
+    // Write next to the entry and rename, so other runs never see half a file.
+    std::filesystem::path temporary = path;
+    temporary += "." + std::to_string(::getpid()) + ".tmp";
+
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+
+        const std::vector<uint8_t> & data = serialized.ok();
+
+        file.write(reinterpret_cast<const char *>(key.data()),
+                   static_cast<std::streamsize>(key.size()));
+        file.write(reinterpret_cast<const char *>(data.data()),
+                   static_cast<std::streamsize>(data.size()));
+
+        if (!file)
+        {
+            file.close();
+            std::filesystem::remove(temporary, ec);
+            return;
+        }
+    }
+
+    std::filesystem::rename(temporary, path, ec);
+
+    if (ec)
+    {
+        std::filesystem::remove(temporary, ec);
+    }
+}
@@ -0,0 +1,74 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <expected>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <wasmtime.hh>
+
+#include "sha256.h"
+
+// On disk cache of compiled handler modules.
+//
+// Compiling a large module can take seconds, so the compiled code is kept
+// under the SHA-256 of the module's bytes and the engine's settings. Later
+// runs deserialize it instead, wasmtime still refuses code compiled by a
+// different version or for a different host.
+//
+// Each entry starts with that digest, an entry whose digest differs from
+// the module being loaded is treated as a miss and replaced. The digest is
+// not a signature, anyone who can write to the cache can run code in the
+// handler. The directory must be trusted and writable only by the user,
+// modules/ is created with 0700 permissions.
+class WASMModuleCache
+{
+public:
+    // $LOADSHEAR_CACHE_DIR, $XDG_CACHE_HOME/loadshear or ~/.cache/loadshear,
+    // empty (no caching) if none of them are set.
+    static std::filesystem::path default_directory();
+
+    // engine_key must change whenever the engine's settings do.
+    WASMModuleCache(std::filesystem::path directory, std::string engine_key);
+
+    // Compile bytes, or load them from the cache if they were compiled
+    // before. cached is set if no compilation was needed.
+    std::expected<wasmtime::Module, std::string> load(wasmtime::Engine & engine,
+                                                      const std::vector<uint8_t> & bytes,
+                                                      bool & cached) const;
+
+private:
+    SHA256::Digest entry_key(const std::vector<uint8_t> & bytes) const;
+
+    std::filesystem::path entry_path(const SHA256::Digest & key) const;
+
+    // The serialized module of the entry at path, empty if it is missing
+    // or was stored under a different key.
+    std::vector<uint8_t> read_entry(const std::filesystem::path & path,
+                                    const SHA256::Digest & key) const;
+
+    // Best effort, a cache we can't write to just means compiling again.
+    void store(const wasmtime::Module & module,
+               const std::filesystem::path & path,
+               const SHA256::Digest & key) const;
+
+private:
+    std::filesystem::path directory_;
+    std::string engine_key_;
+};
@@ -16,6 +16,7 @@
 
 #include "resolver.h"
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 
@@ -141,6 +142,64 @@ namespace Resolver
         return size;
     }
 
+    std::vector<fs::path> list_directory_files(const fs::path & path,
+                                               std::string & error_string)
+    {
+        std::error_code ec;
+        std::vector<fs::path> files;
+
+        // Step with increment(ec), a range for would throw on errors
+        // while walking the directory.
+        for (fs::directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec))
+        {
+            // Entries we can't stat are skipped like any other non file.
+            std::error_code entry_ec;
+
+            if (it->is_regular_file(entry_ec))
+            {
+                files.push_back(it->path());
+            }
+        }
+
+        if (ec)
+        {
+            error_string = ec.message();
+            return {};
+        }
+
+        // Directory order is up to the filesystem, sends must be repeatable.
+        std::sort(files.begin(), files.end());
+
+        return files;
+    }
+
+    uintmax_t get_packet_size(const fs::path & path)
+    {
+        std::error_code ec;
+
+        if (!fs::is_directory(path, ec))
+        {
+            return get_file_size(path);
+        }
+
+        std::string error_string;
+        auto files = list_directory_files(path, error_string);
+
+        if (files.empty())
+        {
+            return 0;
+        }
+
+        uintmax_t smallest = get_file_size(files.front());
+
+        for (const auto & file : files)
+        {
+            smallest = std::min(smallest, get_file_size(file));
+        }
+
+        return smallest;
+    }
+
     std::vector<uint8_t> read_binary_file(const fs::path & path,
                                           std::string & error_string)
     {
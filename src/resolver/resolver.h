@@ -35,6 +35,14 @@ namespace Resolver
 
     uintmax_t get_file_size(const fs::path & path);
 
+    // Regular files directly inside a directory, sorted by name.
+    std::vector<fs::path> list_directory_files(const fs::path & path,
+                                               std::string & error_string);
+
+    // Size of a packet file, or of the smallest file in a packet directory.
+    // Returns 0 if the directory has no files.
+    uintmax_t get_packet_size(const fs::path & path);
+
     std::vector<uint8_t> read_binary_file(const fs::path & path,
                                           std::string & error_string);
 
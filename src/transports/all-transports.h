@@ -18,3 +18,4 @@
 
 #include "tcp-session.h"
 #include "udp-session.h"
+#include "tcp-uring-session.h"
@@ -0,0 +1,154 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "buffer-service.h"
+
+#include <algorithm>
+#include <utility>
+
+asio::execution_context::id BufferService::id;
+
+BufferService::BufferService(asio::io_context & cntx)
+:asio::execution_context::service(cntx)
+{
+}
+
+uint8_t * BufferService::scratch(size_t length)
+{
+    if (scratch_.size() < length)
+    {
+        scratch_.resize(length);
+    }
+
+    return scratch_.data();
+}
+
+BufferLease BufferService::lease(size_t length)
+{
+    BufferLease lease;
+    lease.pool_ = this;
+
+    size_t index = size_class(length);
+
+    if (index < NUM_CLASSES)
+    {
+        lease.size_ = MIN_LEASE_SIZE << index;
+
+        auto & free_list = free_[index];
+
+        if (!free_list.empty())
+        {
+            lease.buffer_ = std::move(free_list.back());
+            free_list.pop_back();
+            stats_.hits += 1;
+        }
+    }
+    else
+    {
+        lease.size_ = length;
+    }
+
+    if (!lease.buffer_)
+    {
+        lease.buffer_ = std::make_unique_for_overwrite<uint8_t[]>(lease.size_);
+        stats_.misses += 1;
+    }
+
+    leased_bytes_ += lease.size_;
+    stats_.high_water = std::max(stats_.high_water, leased_bytes_);
+
+    return lease;
+}
+
+void BufferService::give_back(std::unique_ptr<uint8_t[]> buffer, size_t size)
+{
+    leased_bytes_ -= size;
+
+    // Sessions can be torn down after the io_context shuts us down.
+    if (shut_down_)
+    {
+        return;
+    }
+
+    size_t index = size_class(size);
+
+    if (index < NUM_CLASSES)
+    {
+        free_[index].push_back(std::move(buffer));
+    }
+}
+
+size_t BufferService::size_class(size_t length)
+{
+    if (length <= MIN_LEASE_SIZE)
+    {
+        return 0;
+    }
+
+    if (length > MAX_LEASE_SIZE)
+    {
+        return NUM_CLASSES;
+    }
+
+    return std::bit_width(length - 1) - std::bit_width(MIN_LEASE_SIZE - 1);
+}
+
+void BufferService::shutdown()
+{
+    shut_down_ = true;
+
+    for (auto & free_list : free_)
+    {
+        free_list.clear();
+    }
+}
+
+BufferLease::BufferLease(BufferLease && other) noexcept
+:pool_(std::exchange(other.pool_, nullptr)),
+buffer_(std::move(other.buffer_)),
+size_(std::exchange(other.size_, 0))
+{
+}
+
+BufferLease & BufferLease::operator=(BufferLease && other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+
+        pool_ = std::exchange(other.pool_, nullptr);
+        buffer_ = std::move(other.buffer_);
+        size_ = std::exchange(other.size_, 0);
+    }
+
+    return *this;
+}
+
+BufferLease::~BufferLease()
+{
+    release();
+}
+
+void BufferLease::release()
+{
+    if (buffer_)
+    {
+        pool_->give_back(std::move(buffer_), size_);
+    }
+
+    pool_ = nullptr;
+    size_ = 0;
+}
@@ -0,0 +1,142 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <boost/asio.hpp>
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace asio = boost::asio;
+
+class BufferService;
+
+// A buffer borrowed from a BufferService, returned when released or destroyed.
+class BufferLease
+{
+public:
+    BufferLease() = default;
+
+    BufferLease(BufferLease && other) noexcept;
+    BufferLease & operator=(BufferLease && other) noexcept;
+
+    BufferLease(const BufferLease &) = delete;
+    BufferLease & operator=(const BufferLease &) = delete;
+
+    ~BufferLease();
+
+    void release();
+
+    uint8_t * data() const
+    {
+        return buffer_.get();
+    }
+
+    // Capacity of the size class, at least what was asked for.
+    size_t size() const
+    {
+        return size_;
+    }
+
+    explicit operator bool() const
+    {
+        return buffer_ != nullptr;
+    }
+
+private:
+    friend class BufferService;
+
+    BufferService *pool_{nullptr};
+    std::unique_ptr<uint8_t[]> buffer_;
+    size_t size_{0};
+};
+
+// Lease counters for the shard's metrics.
+struct BufferStats
+{
+    uint64_t hits{0};
+    uint64_t misses{0};
+
+    // Most bytes leased out at once.
+    uint64_t high_water{0};
+};
+
+// Buffers shared by every session on one io_context (so one per shard),
+// obtained with asio::use_service<BufferService>(cntx).
+//
+// Only one handler runs at a time on a shard, so a session can read a
+// message into the scratch buffer and hand it to the message handler
+// before any other session gets to touch it.
+//
+// Messages that must outlive a handler lease a buffer from power of two
+// size classes instead. Returned buffers are kept for the next lease, so
+// the memory held is bounded by how many messages are in flight at once.
+//
+// Not thread safe, every call must happen on the io_context thread.
+class BufferService : public asio::execution_context::service
+{
+public:
+    static asio::execution_context::id id;
+
+    // Size classes, anything larger is allocated for a single lease.
+    static constexpr size_t MIN_LEASE_SIZE = 8 * 1024;
+    static constexpr size_t MAX_LEASE_SIZE = 16 * 1024 * 1024;
+
+    static constexpr size_t NUM_CLASSES = std::bit_width(MAX_LEASE_SIZE)
+                                          - std::bit_width(MIN_LEASE_SIZE)
+                                          + 1;
+
+    explicit BufferService(asio::io_context & cntx);
+
+    BufferService(const BufferService &) = delete;
+    BufferService & operator=(const BufferService &) = delete;
+
+    // At least length bytes, only valid until the calling handler returns.
+    uint8_t * scratch(size_t length);
+
+    // At least length bytes, valid until the lease is released.
+    BufferLease lease(size_t length);
+
+    BufferStats stats() const
+    {
+        return stats_;
+    }
+
+private:
+    friend class BufferLease;
+
+    void shutdown() override;
+
+    void give_back(std::unique_ptr<uint8_t[]> buffer, size_t size);
+
+    static size_t size_class(size_t length);
+
+private:
+    // Grows to the largest message read on this shard.
+    std::vector<uint8_t> scratch_;
+
+    // Returned buffers per size class.
+    std::array<std::vector<std::unique_ptr<uint8_t[]>>, NUM_CLASSES> free_;
+
+    uint64_t leased_bytes_{0};
+    BufferStats stats_;
+
+    bool shut_down_{false};
+};
@@ -0,0 +1,533 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#ifdef __linux__
+
+#include "io-uring-service.h"
+
+#include "logger.h"
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+// We talk to the kernel directly rather than pulling in liburing,
+// the handful of calls we need are simple enough.
+namespace
+{
+
+int sys_io_uring_setup(unsigned entries, io_uring_params *params)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                       unsigned flags)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit,
+                                      min_complete, flags, nullptr, 0));
+}
+
+int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode,
+                                      arg, nr_args));
+}
+
+unsigned load_acquire(unsigned *ptr)
+{
+    return std::atomic_ref<unsigned>(*ptr).load(std::memory_order_acquire);
+}
+
+void store_release(unsigned *ptr, unsigned value)
+{
+    std::atomic_ref<unsigned>(*ptr).store(value, std::memory_order_release);
+}
+
+template<typename T>
+T * ring_offset(void *ring, uint32_t offset)
+{
+    return reinterpret_cast<T *>(static_cast<uint8_t *>(ring) + offset);
+}
+
+}
+
+asio::execution_context::id IoUringService::id;
+
+IoUringService::IoUringService(asio::io_context & cntx)
+:asio::execution_context::service(cntx),
+cntx_(cntx)
+{
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    // Keep submitting past a bad sqe instead of stopping the batch.
+    params.flags = IORING_SETUP_SUBMIT_ALL;
+
+    ring_fd_ = sys_io_uring_setup(RING_ENTRIES, &params);
+
+    // Older kernels do not know about SUBMIT_ALL.
+    if (ring_fd_ < 0 && errno == EINVAL)
+    {
+        std::memset(&params, 0, sizeof(params));
+        ring_fd_ = sys_io_uring_setup(RING_ENTRIES, &params);
+    }
+
+    if (ring_fd_ < 0)
+    {
+        return;
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP);
+
+    if (single_mmap)
+    {
+        sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        cq_ring_size_ = sq_ring_size_;
+    }
+
+    sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+
+    if (sq_ring_ == MAP_FAILED)
+    {
+        sq_ring_ = nullptr;
+        close_ring();
+        return;
+    }
+
+    if (single_mmap)
+    {
+        cq_ring_ = sq_ring_;
+    }
+    else
+    {
+        cq_ring_ = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ring_fd_,
+                          IORING_OFF_CQ_RING);
+
+        if (cq_ring_ == MAP_FAILED)
+        {
+            cq_ring_ = nullptr;
+            close_ring();
+            return;
+        }
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+
+    if (sqes == MAP_FAILED)
+    {
+        close_ring();
+        return;
+    }
+
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    sq_head_ = ring_offset<unsigned>(sq_ring_, params.sq_off.head);
+    sq_tail_ = ring_offset<unsigned>(sq_ring_, params.sq_off.tail);
+    sq_array_ = ring_offset<unsigned>(sq_ring_, params.sq_off.array);
+    sq_mask_ = *ring_offset<unsigned>(sq_ring_, params.sq_off.ring_mask);
+    sq_entries_ = *ring_offset<unsigned>(sq_ring_, params.sq_off.ring_entries);
+
+    cq_head_ = ring_offset<unsigned>(cq_ring_, params.cq_off.head);
+    cq_tail_ = ring_offset<unsigned>(cq_ring_, params.cq_off.tail);
+    cqes_ = ring_offset<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+    cq_mask_ = *ring_offset<unsigned>(cq_ring_, params.cq_off.ring_mask);
+
+    sq_local_tail_ = *sq_tail_;
+
+    // Completions are signaled through an eventfd so asio can wait on them.
+    event_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (event_fd_ < 0
+        || sys_io_uring_register(ring_fd_, IORING_REGISTER_EVENTFD,
+                                 &event_fd_, 1) < 0)
+    {
+        close_ring();
+        return;
+    }
+
+    event_ = std::make_unique<asio::posix::stream_descriptor>(cntx_, event_fd_);
+    event_fd_ = -1;
+}
+
+IoUringService::~IoUringService()
+{
+    close_ring();
+}
+
+bool IoUringService::supported()
+{
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    int fd = sys_io_uring_setup(1, &params);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    ::close(fd);
+    return true;
+}
+
+bool IoUringService::valid() const
+{
+    return ring_fd_ >= 0;
+}
+
+void IoUringService::connect(int fd,
+                             const sockaddr *addr,
+                             socklen_t addr_len,
+                             UringOperation & op)
+{
+    track(op);
+
+    io_uring_sqe *sqe = next_sqe();
+
+    if (!sqe)
+    {
+        complete_later(op, -EBUSY);
+        return;
+    }
+
+    sqe->opcode = IORING_OP_CONNECT;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(addr);
+    sqe->off = addr_len;
+    sqe->user_data = reinterpret_cast<uint64_t>(&op);
+
+    schedule_flush();
+}
+
+void IoUringService::recv(int fd, void *buffer, size_t length, UringOperation & op)
+{
+    track(op);
+
+    io_uring_sqe *sqe = next_sqe();
+
+    if (!sqe)
+    {
+        complete_later(op, -EBUSY);
+        return;
+    }
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = static_cast<uint32_t>(length);
+    sqe->user_data = reinterpret_cast<uint64_t>(&op);
+
+    schedule_flush();
+}
+
+void IoUringService::sendmsg(int fd, const msghdr *msg, int flags, UringOperation & op)
+{
+    track(op);
+
+    io_uring_sqe *sqe = next_sqe();
+
+    if (!sqe)
+    {
+        complete_later(op, -EBUSY);
+        return;
+    }
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(msg);
+    sqe->len = 1;
+    sqe->msg_flags = static_cast<uint32_t>(flags);
+    sqe->user_data = reinterpret_cast<uint64_t>(&op);
+
+    schedule_flush();
+}
+
+// Called by asio when the io_context is destroyed.
+void IoUringService::shutdown()
+{
+    // Tear the ring down first so the kernel stops touching session memory.
+    event_.reset();
+    close_ring();
+
+    // Release the sessions we were keeping alive.
+    while (in_flight_list_)
+    {
+        UringOperation *op = in_flight_list_;
+        untrack(*op);
+        op->release();
+    }
+}
+
+void IoUringService::close_ring()
+{
+    if (sqes_)
+    {
+        ::munmap(sqes_, sqes_size_);
+        sqes_ = nullptr;
+    }
+
+    if (cq_ring_ && cq_ring_ != sq_ring_)
+    {
+        ::munmap(cq_ring_, cq_ring_size_);
+    }
+    cq_ring_ = nullptr;
+
+    if (sq_ring_)
+    {
+        ::munmap(sq_ring_, sq_ring_size_);
+        sq_ring_ = nullptr;
+    }
+
+    if (event_fd_ >= 0)
+    {
+        ::close(event_fd_);
+        event_fd_ = -1;
+    }
+
+    if (ring_fd_ >= 0)
+    {
+        ::close(ring_fd_);
+        ring_fd_ = -1;
+    }
+}
+
+io_uring_sqe * IoUringService::next_sqe()
+{
+    if (ring_fd_ < 0)
+    {
+        return nullptr;
+    }
+
+    // If the ring is full, submit what we have early.
+    if (sq_local_tail_ - load_acquire(sq_head_) >= sq_entries_)
+    {
+        flush();
+
+        if (sq_local_tail_ - load_acquire(sq_head_) >= sq_entries_)
+        {
+            return nullptr;
+        }
+    }
+
+    unsigned index = sq_local_tail_ & sq_mask_;
+
+    io_uring_sqe *sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+
+    sq_array_[index] = index;
+    sq_local_tail_++;
+    to_submit_++;
+
+    return sqe;
+}
+
+// Used when we could not get a slot, the handler must never run inline.
+void IoUringService::complete_later(UringOperation & op, int result)
+{
+    asio::post(cntx_, [this, &op, result]{
+        untrack(op);
+        op.handler(op, result);
+    });
+}
+
+void IoUringService::track(UringOperation & op)
+{
+    op.prev = nullptr;
+    op.next = in_flight_list_;
+
+    if (in_flight_list_)
+    {
+        in_flight_list_->prev = &op;
+    }
+
+    in_flight_list_ = &op;
+    in_flight_++;
+}
+
+void IoUringService::untrack(UringOperation & op)
+{
+    if (op.prev)
+    {
+        op.prev->next = op.next;
+    }
+    else
+    {
+        in_flight_list_ = op.next;
+    }
+
+    if (op.next)
+    {
+        op.next->prev = op.prev;
+    }
+
+    op.prev = nullptr;
+    op.next = nullptr;
+    in_flight_--;
+}
+
+// One post per batch rather than one per request.
+void IoUringService::schedule_flush()
+{
+    if (flush_scheduled_)
+    {
+        return;
+    }
+
+    flush_scheduled_ = true;
+
+    asio::post(cntx_, [this]{
+        flush_scheduled_ = false;
+        flush();
+    });
+}
+
+void IoUringService::flush()
+{
+    if (to_submit_ > 0 && ring_fd_ >= 0)
+    {
+        store_release(sq_tail_, sq_local_tail_);
+
+        int submitted = 0;
+
+        do
+        {
+            submitted = sys_io_uring_enter(ring_fd_, to_submit_, 0, 0);
+        } while (submitted < 0 && errno == EINTR);
+
+        if (submitted > 0)
+        {
+            to_submit_ -= static_cast<unsigned>(submitted);
+        }
+
+        // Anything but a lack of resources will fail again, hand the
+        // requests back to their sessions instead of retrying forever.
+        if (submitted < 0 && errno != EAGAIN && errno != EBUSY)
+        {
+            fail_unsubmitted(errno);
+        }
+
+        // The kernel is out of resources (usually a full completion
+        // queue), try again once we have reaped some completions.
+        if (to_submit_ > 0)
+        {
+            schedule_flush();
+        }
+    }
+
+    arm_wait();
+}
+
+// Takes the requests the kernel refused back out of the ring and
+// completes them with -error.
+void IoUringService::fail_unsubmitted(int error)
+{
+    if (!enter_error_logged_)
+    {
+        enter_error_logged_ = true;
+
+        std::string e_msg = "io_uring_enter failed: ";
+        e_msg += std::strerror(error);
+
+        Logger::warn(std::move(e_msg));
+    }
+
+    // The kernel only reads the ring inside io_uring_enter, so the tail
+    // can still be moved back over requests it has not taken.
+    while (to_submit_ > 0)
+    {
+        sq_local_tail_--;
+        to_submit_--;
+
+        const io_uring_sqe & sqe = sqes_[sq_array_[sq_local_tail_ & sq_mask_]];
+
+        complete_later(*reinterpret_cast<UringOperation *>(sqe.user_data), -error);
+    }
+
+    store_release(sq_tail_, sq_local_tail_);
+}
+
+void IoUringService::arm_wait()
+{
+    if (waiting_ || in_flight_ == 0 || !event_)
+    {
+        return;
+    }
+
+    waiting_ = true;
+
+    event_->async_wait(asio::posix::stream_descriptor::wait_read,
+        [this](boost::system::error_code ec){
+            waiting_ = false;
+
+            if (ec)
+            {
+                return;
+            }
+
+            // Clear the eventfd before reaping so we never miss a wakeup.
+            uint64_t count = 0;
+            [[maybe_unused]] ssize_t r = ::read(event_->native_handle(),
+                                                &count,
+                                                sizeof(count));
+
+            reap();
+        });
+}
+
+void IoUringService::reap()
+{
+    unsigned head = *cq_head_;
+
+    while (cq_ring_ && head != load_acquire(cq_tail_))
+    {
+        const io_uring_cqe & cqe = cqes_[head & cq_mask_];
+
+        auto *op = reinterpret_cast<UringOperation *>(cqe.user_data);
+        int result = cqe.res;
+
+        // Free the slot before running the handler.
+        head++;
+        store_release(cq_head_, head);
+
+        if (!op)
+        {
+            continue;
+        }
+
+        untrack(*op);
+        op->handler(*op, result);
+    }
+
+    // Submit whatever the handlers queued without another post.
+    flush();
+}
+
+#endif
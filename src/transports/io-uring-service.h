@@ -0,0 +1,185 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#ifdef __linux__
+
+#include <boost/asio.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+
+#include <memory>
+#include <utility>
+
+#include "session-ref.h"
+
+namespace asio = boost::asio;
+
+// A single in-flight io_uring request owned by a session.
+//
+// The session embeds one of these per kind of request (connect, read, write)
+// and must not submit it again until the handler has been called.
+struct UringOperation
+{
+    // Called on the io_context thread with the cqe result (-errno on failure).
+    using Handler = void (*)(UringOperation & op, int result);
+
+    Handler handler{nullptr};
+
+    // Keeps the owning session alive while the kernel holds the request.
+    void *owner{nullptr};
+    void (*release_owner)(void *owner){nullptr};
+
+    template<typename Session>
+    void hold(SessionRef<Session> session)
+    {
+        owner = session.detach();
+        release_owner = [](void *held){
+            SessionRef<Session>::adopt(static_cast<Session *>(held)).reset();
+        };
+    }
+
+    // Hand the reference back to the completion handler.
+    template<typename Session>
+    SessionRef<Session> take()
+    {
+        release_owner = nullptr;
+        return SessionRef<Session>::adopt(
+            static_cast<Session *>(std::exchange(owner, nullptr)));
+    }
+
+    void release()
+    {
+        if (owner)
+        {
+            release_owner(std::exchange(owner, nullptr));
+        }
+    }
+
+    // Intrusive list of in-flight requests, used to release owners on shutdown.
+    UringOperation *prev{nullptr};
+    UringOperation *next{nullptr};
+};
+
+// One io_uring instance per io_context (so one per shard), obtained
+// with asio::use_service<IoUringService>(cntx).
+//
+// Submissions are batched: requests queued during a handler are submitted
+// together by a single io_uring_enter call once the handler returns.
+// Completions are signaled through an eventfd which is only waited on while
+// requests are in flight, so the io_context can still run out of work.
+//
+// Not thread safe, every call must happen on the io_context thread.
+class IoUringService : public asio::execution_context::service
+{
+public:
+    static asio::execution_context::id id;
+
+    explicit IoUringService(asio::io_context & cntx);
+
+    ~IoUringService();
+
+    IoUringService(const IoUringService &) = delete;
+    IoUringService & operator=(const IoUringService &) = delete;
+
+    // Check if the kernel lets us create a ring at all.
+    static bool supported();
+
+    bool valid() const;
+
+    void connect(int fd,
+                 const sockaddr *addr,
+                 socklen_t addr_len,
+                 UringOperation & op);
+
+    void recv(int fd, void *buffer, size_t length, UringOperation & op);
+
+    void sendmsg(int fd, const msghdr *msg, int flags, UringOperation & op);
+
+private:
+    void shutdown() override;
+
+    void close_ring();
+
+    io_uring_sqe * next_sqe();
+
+    void complete_later(UringOperation & op, int result);
+
+    void track(UringOperation & op);
+
+    void untrack(UringOperation & op);
+
+    void schedule_flush();
+
+    void flush();
+
+    void fail_unsubmitted(int error);
+
+    void arm_wait();
+
+    void reap();
+
+private:
+    // Enough slots to cover a burst of submissions from a full shard
+    // between two flushes, the ring is flushed early if it fills up.
+    static constexpr unsigned RING_ENTRIES = 4096;
+
+    asio::io_context & cntx_;
+
+    int ring_fd_{-1};
+    int event_fd_{-1};
+
+    // Shared ring memory.
+    void *sq_ring_{nullptr};
+    void *cq_ring_{nullptr};
+    size_t sq_ring_size_{0};
+    size_t cq_ring_size_{0};
+    io_uring_sqe *sqes_{nullptr};
+    size_t sqes_size_{0};
+
+    // Submission queue pointers into the shared ring.
+    unsigned *sq_head_{nullptr};
+    unsigned *sq_tail_{nullptr};
+    unsigned *sq_array_{nullptr};
+    unsigned sq_mask_{0};
+    unsigned sq_entries_{0};
+
+    // Completion queue pointers into the shared ring.
+    unsigned *cq_head_{nullptr};
+    unsigned *cq_tail_{nullptr};
+    io_uring_cqe *cqes_{nullptr};
+    unsigned cq_mask_{0};
+
+    // Local copy of the sq tail, published on flush.
+    unsigned sq_local_tail_{0};
+    unsigned to_submit_{0};
+
+    size_t in_flight_{0};
+    UringOperation *in_flight_list_{nullptr};
+
+    bool flush_scheduled_{false};
+    bool waiting_{false};
+
+    // Only the first io_uring_enter failure is logged.
+    bool enter_error_logged_{false};
+
+    std::unique_ptr<asio::posix::stream_descriptor> event_;
+};
+
+#endif
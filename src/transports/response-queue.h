@@ -0,0 +1,125 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "response-packet.h"
+
+// Ring of responses waiting to be written, holds at most capacity packets.
+//
+// Slots are allocated as the queue fills (doubling up to the capacity), so
+// sessions that never fall behind never pay for the full ring.
+class ResponseQueue
+{
+public:
+    explicit ResponseQueue(size_t capacity)
+    :capacity_(std::max<size_t>(capacity, 1))
+    {
+    }
+
+    ResponseQueue(const ResponseQueue &) = delete;
+    ResponseQueue & operator=(const ResponseQueue &) = delete;
+
+    // The caller must check full() first.
+    void push_back(ResponsePacket packet)
+    {
+        if (size_ == slot_count_)
+        {
+            grow();
+        }
+
+        slots_[index(size_)] = std::move(packet);
+        size_ += 1;
+    }
+
+    ResponsePacket & front()
+    {
+        return slots_[head_];
+    }
+
+    void pop_front()
+    {
+        slots_[head_].reset();
+
+        head_ = index(1);
+        size_ -= 1;
+    }
+
+    void clear()
+    {
+        while (size_ > 0)
+        {
+            pop_front();
+        }
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    size_t capacity() const
+    {
+        return capacity_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    bool full() const
+    {
+        return size_ == capacity_;
+    }
+
+private:
+    size_t index(size_t offset) const
+    {
+        size_t slot = head_ + offset;
+
+        return (slot >= slot_count_) ? slot - slot_count_ : slot;
+    }
+
+    void grow()
+    {
+        size_t slot_count = std::min(std::max<size_t>(slot_count_ * 2, 4), capacity_);
+
+        auto slots = std::make_unique<ResponsePacket[]>(slot_count);
+
+        for (size_t i = 0; i < size_; i++)
+        {
+            slots[i] = std::move(slots_[index(i)]);
+        }
+
+        slots_ = std::move(slots);
+        slot_count_ = slot_count;
+        head_ = 0;
+    }
+
+private:
+    std::unique_ptr<ResponsePacket[]> slots_;
+    size_t slot_count_{0};
+    size_t capacity_;
+
+    size_t head_{0};
+    size_t size_{0};
+};
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include "shard-clock.h"
+
 struct SessionConfig {
     size_t header_size;
     size_t payload_size_limit;
@@ -24,6 +26,36 @@ struct SessionConfig {
     // How often we should sample packet latencies.
     uint32_t packet_sample_rate;
 
+    // Datagrams moved per sendmmsg/recvmmsg call, only used by UDP.
+    uint32_t batch_size{1};
+
+    // Linux UDP segmentation offloads, only used by UDP.
+    bool udp_gso{false};
+    bool udp_gro{false};
+
+    // Slices at least this large are sent with MSG_ZEROCOPY, 0 disables.
+    size_t zerocopy_threshold{0};
+
+    // Wait for readability and read into the shard's buffers instead of
+    // holding a read buffer per session.
+    bool shared_buffers{false};
+
+    // Responses a session may hold before it stops reading or, with
+    // drop_responses, throws new responses away.
+    size_t response_queue_size{1024};
+    bool drop_responses{false};
+
+    // Queued responses are gathered into one TCP write up to this many
+    // bytes, 0 writes them one at a time.
+    size_t coalesce_limit{0};
+
+    // COUNTER values each shard leases at once, 0 increments the shared
+    // counter for every payload.
+    uint32_t counter_block{0};
+
+    // Where the shard's clock reads come from.
+    ClockMode clock_mode{ClockMode::System};
+
     SessionConfig(size_t h_size,
                   size_t p_size,
                   bool read,
@@ -39,7 +71,14 @@ struct SessionConfig {
 
 // We set the default ring buffer to 4 KiB for reading small messages.
 //
-// Expected memory usage:
+// TCP sessions read as much as fits and parse every complete message out of
+// the buffer, so many small messages cost a single read.
+//
+// The buffer is allocated when a session first reads. With
+// shared_buffers it is never allocated, sessions read into the shard's
+// scratch buffer and only hold memory for bodies that arrive in pieces.
+//
+// Expected memory usage (per-session buffers):
 //
 // Sessions |   Memory
 // ---------------------
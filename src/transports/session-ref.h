@@ -0,0 +1,323 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+template<typename Session>
+class SessionRef;
+
+template<typename Session>
+class SessionSlab;
+
+// Intrusive reference count for sessions, replaces enable_shared_from_this.
+//
+// A session and every handler that references it run on the same io_context
+// thread, so the count does not need to be atomic. Copying a SessionRef from
+// any other thread is a data race.
+//
+// When the count hits zero the session is destroyed by whoever allocated it,
+// either a SessionSlab or make_session.
+template<typename Session>
+class SessionRefCount
+{
+public:
+    SessionRef<Session> ref_from_this()
+    {
+        return SessionRef<Session>(static_cast<Session *>(this));
+    }
+
+    // Index of the session across the whole script, 0 outside a slab.
+    uint32_t session_index() const
+    {
+        return index_;
+    }
+
+protected:
+    SessionRefCount() = default;
+
+    ~SessionRefCount() = default;
+
+    SessionRefCount(const SessionRefCount &) = delete;
+    SessionRefCount & operator=(const SessionRefCount &) = delete;
+
+private:
+    friend class SessionRef<Session>;
+    friend class SessionSlab<Session>;
+
+    void add_ref()
+    {
+        refs_ += 1;
+    }
+
+    void release()
+    {
+        refs_ -= 1;
+
+        if (refs_ != 0)
+        {
+            return;
+        }
+
+        Session *session = static_cast<Session *>(this);
+
+        if (slab_)
+        {
+            slab_->destroy(session);
+        }
+        else
+        {
+            delete session;
+        }
+    }
+
+private:
+    uint32_t refs_{0};
+
+    uint32_t index_{0};
+
+    // Slab that holds our memory, or nullptr if we were allocated alone.
+    SessionSlab<Session> *slab_{nullptr};
+};
+
+// Owning pointer to a session, like shared_ptr but with the count
+// stored in the session itself.
+template<typename Session>
+class SessionRef
+{
+public:
+    SessionRef() = default;
+
+    explicit SessionRef(Session *session)
+    :session_(session)
+    {
+        if (session_)
+        {
+            session_->add_ref();
+        }
+    }
+
+    SessionRef(const SessionRef & other)
+    :SessionRef(other.session_)
+    {
+    }
+
+    SessionRef(SessionRef && other) noexcept
+    :session_(std::exchange(other.session_, nullptr))
+    {
+    }
+
+    SessionRef & operator=(SessionRef other) noexcept
+    {
+        std::swap(session_, other.session_);
+        return *this;
+    }
+
+    ~SessionRef()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        if (session_)
+        {
+            std::exchange(session_, nullptr)->release();
+        }
+    }
+
+    // Give up ownership without touching the count, see adopt().
+    Session * detach()
+    {
+        return std::exchange(session_, nullptr);
+    }
+
+    // Take over a reference previously given up with detach().
+    static SessionRef adopt(Session *session)
+    {
+        SessionRef ref;
+        ref.session_ = session;
+        return ref;
+    }
+
+    Session * get() const
+    {
+        return session_;
+    }
+
+    Session * operator->() const
+    {
+        return session_;
+    }
+
+    Session & operator*() const
+    {
+        return *session_;
+    }
+
+    explicit operator bool() const
+    {
+        return session_ != nullptr;
+    }
+
+private:
+    Session *session_{nullptr};
+};
+
+// Allocate a single session on the heap, mostly useful for tests.
+template<typename Session, typename... Args>
+SessionRef<Session> make_session(Args&&... args)
+{
+    return SessionRef<Session>(new Session(std::forward<Args>(args)...));
+}
+
+// Contiguous storage for a shard's sessions.
+//
+// The slab holds one reference to every session it creates. Once the owner
+// lets go (see Owner) those references are dropped, but the memory stays
+// alive until the last handler releases its session.
+template<typename Session>
+class SessionSlab
+{
+    struct Abandon
+    {
+        void operator()(SessionSlab *slab) const
+        {
+            slab->abandon();
+        }
+    };
+
+public:
+    using Owner = std::unique_ptr<SessionSlab, Abandon>;
+
+    // Sessions are numbered from first_index in the order they are emplaced.
+    static Owner create(size_t capacity, uint32_t first_index = 0)
+    {
+        return Owner(new SessionSlab(capacity, first_index));
+    }
+
+    SessionSlab(const SessionSlab &) = delete;
+    SessionSlab & operator=(const SessionSlab &) = delete;
+    SessionSlab(SessionSlab &&) = delete;
+    SessionSlab & operator=(SessionSlab &&) = delete;
+
+    // Construct the next session in place, returns false when full.
+    template<typename... Args>
+    bool emplace(Args&&... args)
+    {
+        if (size_ == capacity_)
+        {
+            return false;
+        }
+
+        Session *session = new (slot(size_)) Session(std::forward<Args>(args)...);
+
+        session->slab_ = this;
+        session->index_ = first_index_ + static_cast<uint32_t>(size_);
+        session->add_ref();
+
+        size_ += 1;
+        live_ += 1;
+
+        return true;
+    }
+
+    // Only valid while the owner holds the slab.
+    Session & operator[](size_t index)
+    {
+        return *std::launder(reinterpret_cast<Session *>(slot(index)));
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+private:
+    friend class SessionRefCount<Session>;
+
+    SessionSlab(size_t capacity, uint32_t first_index)
+    :storage_(static_cast<std::byte *>(
+        ::operator new(capacity * sizeof(Session),
+                       std::align_val_t{alignof(Session)}))),
+    capacity_(capacity),
+    first_index_(first_index)
+    {
+    }
+
+    ~SessionSlab()
+    {
+        ::operator delete(storage_, std::align_val_t{alignof(Session)});
+    }
+
+    std::byte * slot(size_t index)
+    {
+        return storage_ + index * sizeof(Session);
+    }
+
+    // Called when a session's last reference is dropped.
+    void destroy(Session *session)
+    {
+        session->~Session();
+
+        live_ -= 1;
+
+        if (abandoned_ && live_ == 0)
+        {
+            delete this;
+        }
+    }
+
+    void abandon()
+    {
+        abandoned_ = true;
+
+        // Hold ourselves open so the last release can't free us mid-loop.
+        live_ += 1;
+
+        for (size_t i = 0; i < size_; i++)
+        {
+            (*this)[i].release();
+        }
+
+        live_ -= 1;
+
+        if (live_ == 0)
+        {
+            delete this;
+        }
+    }
+
+private:
+    std::byte *storage_{nullptr};
+    size_t capacity_{0};
+    size_t size_{0};
+    uint32_t first_index_{0};
+
+    // Sessions that have not been destroyed yet.
+    size_t live_{0};
+    bool abandoned_{false};
+};
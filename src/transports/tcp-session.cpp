@@ -16,6 +16,20 @@
 
 #include "tcp-session.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <sys/sendfile.h>
+
+#include <cerrno>
+#include <climits>
+#endif
+
 TCPSession::TCPSession(asio::io_context & cntx,
                        const SessionConfig & config,
                        const MessageHandler & message_handler,
@@ -26,8 +40,12 @@ TCPSession::TCPSession(asio::io_context & cntx,
 strand_(cntx.get_executor()),
 socket_(cntx),
 incoming_header_(config_.header_size),
+buffers_(asio::use_service<BufferService>(cntx)),
+responses_(config_.response_queue_size),
 message_handler_(message_handler),
 payload_manager_(payload_manager),
+counter_leases_(asio::use_service<CounterLeaseService>(cntx)),
+clock_(asio::use_service<ShardClock>(cntx)),
 metrics_sink_(shard_metrics),
 write_sample_counter_(config_.packet_sample_rate),
 read_sample_counter_(config_.packet_sample_rate),
@@ -38,7 +56,7 @@ on_disconnect_(on_disconnect)
 // Always the first function called on the Session if any are called.
 void TCPSession::start(const Endpoints & endpoints)
 {
-    asio::post(strand_, [self = shared_from_this(), endpoints]{
+    asio::post(strand_, [self = ref_from_this(), endpoints]{
         self->live_ = true;
         self->connecting_ = true;
 
@@ -72,6 +90,10 @@ void TCPSession::start(const Endpoints & endpoints)
                 self->metrics_sink_.record_connection_latency(latency_us);
                 self->metrics_sink_.record_connection_success();
 
+#ifdef __linux__
+                self->enable_zerocopy();
+#endif
+
                 self->on_connect();
             }));
     });
@@ -80,7 +102,7 @@ void TCPSession::start(const Endpoints & endpoints)
 // Request enabling flood.
 void TCPSession::flood()
 {
-    asio::post(strand_, [self = shared_from_this()]{
+    asio::post(strand_, [self = ref_from_this()]{
 
         // If we are already flooding, don't try to open two flood loops.
         //
@@ -104,7 +126,7 @@ void TCPSession::flood()
 // Enqueue N payloads to be sent, if they exist.
 void TCPSession::send(size_t N)
 {
-    asio::post(strand_, [self = shared_from_this(), N]{
+    asio::post(strand_, [self = ref_from_this(), N]{
         self->writes_queued_ += N;
 
         if (self->live_ && !self->connecting_)
@@ -116,7 +138,7 @@ void TCPSession::send(size_t N)
 
 void TCPSession::drain()
 {
-    asio::post(strand_, [self = shared_from_this()]{
+    asio::post(strand_, [self = ref_from_this()]{
         self->draining_ = true;
 
         if (!self->writing_
@@ -131,7 +153,7 @@ void TCPSession::drain()
 // Stop the session and callback to the orchestrator
 void TCPSession::stop()
 {
-    asio::post(strand_, [self = shared_from_this()]{
+    asio::post(strand_, [self = ref_from_this()]{
         self->close_session();
     });
 }
@@ -142,6 +164,13 @@ void TCPSession::on_connect()
     // Start the header read loop if setting is enabled.
     if (config_.read_messages)
     {
+        // Shared buffer reads must never block the shard.
+        if (config_.shared_buffers)
+        {
+            boost::system::error_code ignored;
+            socket_.non_blocking(true, ignored);
+        }
+
         do_read_header();
     }
 
@@ -162,123 +191,525 @@ void TCPSession::do_read_header()
     // Every packet_sample_rate packets, record write latency.
     if (++read_sample_counter_ >= config_.packet_sample_rate)
     {
-        read_start_time_ = std::chrono::steady_clock::now();
+        read_start_time_ = clock_.sample_now();
+    }
+
+    reading_header_ = true;
+
+    if (config_.shared_buffers)
+    {
+        header_count_ = 0;
+        read_ready();
+        return;
+    }
+
+    read_frame();
+}
+
+// on_header runs inside a strand once the full header is read.
+void TCPSession::on_header()
+{
+    message_handler_.set_current_session(session_index());
+
+    // User defined message parsing to get message size
+    std::span<const uint8_t> header_bytes(incoming_header_);
+    HeaderResult result = message_handler_.parse_header(header_bytes);
+
+    // Handle errors, should only occur if we have a WASM call.
+    if (result.status != HeaderResult::Status::OK)
+    {
+        next_payload_size_ = 0;
+        do_read_header();
+        return;
+    }
+
+    next_payload_size_ = result.length;
+
+    // Handle the server sending messages that are too big.
+    if (next_payload_size_ > config_.payload_size_limit)
+    {
+        handle_stream_error(asio::error::message_size);
+        return;
+    }
+
+    do_read_body();
+}
+
+// do_read_body runs inside a strand
+void TCPSession::do_read_body()
+{
+    // Special case when we have to give a response but no body is expected.
+    if (next_payload_size_ == 0)
+    {
+        handle_message();
+        return;
+    }
+
+    if (config_.shared_buffers)
+    {
+        body_count_ = 0;
+        read_ready();
+        return;
+    }
+
+    if (next_payload_size_ <= MESSAGE_BUFFER_SIZE)
+    {
+        read_frame();
+        return;
+    }
+
+    // Too big for the read buffer, take what we have and read the rest
+    // straight into the message handler's memory if it has room for the
+    // whole message, otherwise into a leased buffer.
+    reserved_message_ = message_handler_.reserve_message(config_.header_size
+                                                         + next_payload_size_);
+
+    if (!reserved_message_.empty())
+    {
+        std::memcpy(reserved_message_.data(),
+                    incoming_header_.data(),
+                    config_.header_size);
+
+        body_buffer_ptr_ = reserved_message_.data() + config_.header_size;
+    }
+    else
+    {
+        body_lease_ = buffers_.lease(next_payload_size_);
+        body_buffer_ptr_ = body_lease_.data();
     }
 
+    size_t buffered = read_end_ - read_begin_;
+
+    std::memcpy(body_buffer_ptr_, body_buffer_.get() + read_begin_, buffered);
+
+    read_begin_ = 0;
+    read_end_ = 0;
+
     asio::async_read(socket_,
-        asio::buffer(incoming_header_, config_.header_size),
+        asio::buffer(body_buffer_ptr_ + buffered, next_payload_size_ - buffered),
         asio::bind_executor(strand_,
-            [self = shared_from_this()](boost::system::error_code ec, size_t count){
+            [self = ref_from_this()](boost::system::error_code ec, size_t count){
                 if (ec)
                 {
+                    // The read is over, the handler can have its memory back.
+                    if (!self->reserved_message_.empty())
+                    {
+                        self->message_handler_.release_reserved(
+                            std::exchange(self->reserved_message_, {}));
+                    }
+
                     self->handle_stream_error(ec);
                     return;
                 }
 
                 self->metrics_sink_.record_bytes_read(count);
 
-                // User defined message parsing to get message size
-                std::span<const uint8_t> header_bytes(self->incoming_header_);
-                HeaderResult result = self->message_handler_.parse_header(header_bytes);
+                self->on_body();
+            }));
+}
 
-                // Handle errors, should only occur if we have a WASM call.
-                if (result.status != HeaderResult::Status::OK)
-                {
-                    self->next_payload_size_ = 0;
-                    self->do_read_header();
-                    return;
-                }
+// Runs inside a strand. Takes the header or body we are waiting for out of
+// the read buffer, so a single read can carry many messages. Only reads
+// from the socket once the buffer has no complete frame left.
+void TCPSession::read_frame()
+{
+    // Handlers that batch get every complete message in the buffer at once.
+    if (reading_header_ && message_handler_.batches() && read_batch())
+    {
+        return;
+    }
+
+    size_t buffered = read_end_ - read_begin_;
+
+    if (reading_header_ && buffered >= config_.header_size)
+    {
+        std::memcpy(incoming_header_.data(),
+                    body_buffer_.get() + read_begin_,
+                    config_.header_size);
+
+        read_begin_ += config_.header_size;
+        reading_header_ = false;
+
+        on_header();
+        return;
+    }
+
+    if (!reading_header_ && buffered >= next_payload_size_)
+    {
+        // Only valid until the message is handled, the next read may move it.
+        body_buffer_ptr_ = body_buffer_.get() + read_begin_;
+
+        read_begin_ += next_payload_size_;
 
-                self->next_payload_size_ = result.length;
+        on_body();
+        return;
+    }
+
+    fill_read_buffer();
+}
+
+// Runs inside a strand, reads whatever the socket has after the partial frame.
+void TCPSession::fill_read_buffer()
+{
+    if (!body_buffer_)
+    {
+        body_buffer_ = std::make_unique_for_overwrite<uint8_t[]>(read_buffer_size());
+    }
 
-                // Handle the server sending messages that are too big.
-                if (self->next_payload_size_ > self->config_.payload_size_limit)
+    // Move the partial frame to the front to make room.
+    if (read_begin_ > 0)
+    {
+        std::memmove(body_buffer_.get(),
+                     body_buffer_.get() + read_begin_,
+                     read_end_ - read_begin_);
+
+        read_end_ -= read_begin_;
+        read_begin_ = 0;
+    }
+
+    socket_.async_read_some(
+        asio::buffer(body_buffer_.get() + read_end_, read_buffer_size() - read_end_),
+        asio::bind_executor(strand_,
+            [self = ref_from_this()](boost::system::error_code ec, size_t count){
+                if (ec)
                 {
                     self->handle_stream_error(ec);
                     return;
                 }
 
-                self->do_read_body();
-        }));
+                self->metrics_sink_.record_bytes_read(count);
+                self->metrics_sink_.record_read_call();
+
+                self->read_end_ += count;
+
+                self->read_frame();
+            }));
 }
 
-// do_read_body runs inside a strand
-void TCPSession::do_read_body()
+// Runs inside a strand. Gathers the complete messages at the front of the
+// read buffer, returns false if there are none.
+bool TCPSession::read_batch()
 {
-    // Special case when we have to give a response but no body is expected.
-    if (next_payload_size_ == 0)
+    message_handler_.set_current_session(session_index());
+
+    // Unless we drop responses, every response in the batch must fit.
+    size_t room = config_.drop_responses
+                  ? SIZE_MAX
+                  : responses_.capacity() - responses_.size();
+
+    size_t offset = read_begin_;
+
+    batch_messages_.clear();
+
+    while (batch_messages_.size() < room
+           && read_end_ - offset >= config_.header_size)
+    {
+        std::span<const uint8_t> header(body_buffer_.get() + offset,
+                                        config_.header_size);
+
+        HeaderResult result = message_handler_.parse_header(header);
+
+        // Leave bad headers and partial bodies to read_frame.
+        if (result.status != HeaderResult::Status::OK
+            || result.length > config_.payload_size_limit
+            || read_end_ - offset - config_.header_size < result.length)
+        {
+            break;
+        }
+
+        batch_messages_.push_back({header,
+                                   std::span<const uint8_t>(header.data() + header.size(),
+                                                            result.length)});
+
+        offset += config_.header_size + result.length;
+    }
+
+    if (batch_messages_.empty())
+    {
+        return false;
+    }
+
+    // The buffer is left alone until the handler calls back.
+    read_begin_ = offset;
+
+    handle_batch();
+
+    return true;
+}
+
+// Room for a full header or a body that doesn't need a lease.
+size_t TCPSession::read_buffer_size() const
+{
+    return std::max(MESSAGE_BUFFER_SIZE, config_.header_size);
+}
+
+// on_body runs inside a strand once the full body is read.
+void TCPSession::on_body()
+{
+    sample_read_latency();
+
+    handle_message();
+
+    // The message handler is done with the body.
+    body_lease_.release();
+}
+
+// Shared buffer mode, runs inside a strand.
+//
+// Reads whatever the socket has for the current header or body without
+// blocking, and only waits for readability when the socket is empty.
+void TCPSession::read_ready()
+{
+    if (!live_)
     {
-        handle_message();
         return;
     }
 
-    if (next_payload_size_ > MESSAGE_BUFFER_SIZE)
+    boost::system::error_code ec;
+    size_t count = 0;
+
+    if (reading_header_)
+    {
+        count = socket_.receive(
+            asio::buffer(incoming_header_.data() + header_count_,
+                         config_.header_size - header_count_),
+            0,
+            ec);
+    }
+    else if (!body_lease_)
     {
-        large_body_buffer_.resize(next_payload_size_);
-        body_buffer_ptr_ = large_body_buffer_.data();
+        // Try for the whole body at once, straight into the shard's buffer.
+        body_buffer_ptr_ = buffers_.scratch(next_payload_size_);
+
+        count = socket_.receive(asio::buffer(body_buffer_ptr_, next_payload_size_),
+                                0,
+                                ec);
     }
     else
     {
-        body_buffer_ptr_ = body_buffer_.data();
+        count = socket_.receive(
+            asio::buffer(body_lease_.data() + body_count_,
+                         next_payload_size_ - body_count_),
+            0,
+            ec);
     }
 
-    asio::async_read(socket_,
-        asio::buffer(body_buffer_ptr_, next_payload_size_),
+    if (ec == asio::error::would_block || ec == asio::error::try_again)
+    {
+        wait_readable();
+        return;
+    }
+
+    if (ec)
+    {
+        handle_stream_error(ec);
+        return;
+    }
+
+    metrics_sink_.record_bytes_read(count);
+    metrics_sink_.record_read_call();
+
+    if (reading_header_)
+    {
+        header_count_ += count;
+
+        // A short read means the socket is empty for now.
+        if (header_count_ < config_.header_size)
+        {
+            wait_readable();
+            return;
+        }
+
+        reading_header_ = false;
+        on_header();
+        return;
+    }
+
+    body_count_ += count;
+
+    if (body_count_ < next_payload_size_)
+    {
+        // The scratch buffer is only ours until we return, keep the
+        // rest of the body in a leased buffer.
+        if (!body_lease_)
+        {
+            body_lease_ = buffers_.lease(next_payload_size_);
+            std::memcpy(body_lease_.data(), body_buffer_ptr_, count);
+        }
+
+        wait_readable();
+        return;
+    }
+
+    if (body_lease_)
+    {
+        body_buffer_ptr_ = body_lease_.data();
+    }
+
+    on_body();
+}
+
+// Shared buffer mode, runs inside a strand.
+void TCPSession::wait_readable()
+{
+    socket_.async_wait(tcp::socket::wait_read,
         asio::bind_executor(strand_,
-            [self = shared_from_this()](boost::system::error_code ec, size_t count){
+            [self = ref_from_this()](boost::system::error_code ec){
                 if (ec)
                 {
                     self->handle_stream_error(ec);
                     return;
                 }
 
-                self->metrics_sink_.record_bytes_read(count);
+                self->read_ready();
+        }));
+}
 
-                // If we sampled, compute the latency.
-                if (self->read_sample_counter_ > self->config_.packet_sample_rate)
-                {
-                    auto end = std::chrono::steady_clock::now();
+// Runs inside a strand, records the read latency if we sampled this read.
+void TCPSession::sample_read_latency()
+{
+    if (read_sample_counter_ > config_.packet_sample_rate)
+    {
+        auto end = clock_.sample_now();
+
+        uint64_t latency_us = static_cast<uint64_t>(
+                std::chrono::duration_cast
+                    <std::chrono::microseconds>
+                        (
+                            end - read_start_time_
+                        ).count()
+                    );
 
-                    uint64_t latency_us = static_cast<uint64_t>(
-                            std::chrono::duration_cast
-                                <std::chrono::microseconds>
-                                    (
-                                        end - self->read_start_time_
-                                    ).count()
-                                );
+        metrics_sink_.record_read_latency(latency_us);
+
+        read_sample_counter_ = 0;
+    }
+}
+
+// Hands the messages gathered by read_batch to the handler in one call.
+void TCPSession::handle_batch()
+{
+    sample_read_latency();
+
+    metrics_sink_.record_packets_read(batch_messages_.size());
 
-                    self->metrics_sink_.record_read_latency(latency_us);
+    message_handler_.parse_batch(batch_messages_,
+        [self = ref_from_this()](std::vector<ResponsePacket> responses) {
 
-                    self->read_sample_counter_ = 0;
+            asio::post(self->strand_,
+                [self, responses = std::move(responses)]() mutable {
+                bool queued = false;
+
+                for (ResponsePacket & response_packet : responses)
+                {
+                    if (response_packet.size() > 0)
+                    {
+                        self->queue_response(std::move(response_packet));
+                        queued = true;
+                    }
                 }
 
-                self->handle_message();
-            }));
+                if (queued)
+                {
+                    self->try_start_write();
+                }
+
+                if (self->pause_reading())
+                {
+                    return;
+                }
+
+                self->do_read_header();
+            });
+
+    });
 }
 
 // Handles a server packet based on user set rules.
 void TCPSession::handle_message()
 {
-    // Give the message handler the header and body of the message.
-    message_handler_.parse_message(
-        std::span<const uint8_t>(incoming_header_.data(), incoming_header_.size()),
-        std::span<const uint8_t>(body_buffer_ptr_, body_buffer_ptr_ + next_payload_size_),
-        [self = shared_from_this()](ResponsePacket response_packet) {
+    message_handler_.set_current_session(session_index());
+
+    metrics_sink_.record_packets_read(1);
 
-            asio::post(self->strand_, [self, response_packet]() {
+    auto on_response = [self = ref_from_this()](ResponsePacket response_packet) {
+
+            asio::post(self->strand_,
+                [self, response_packet = std::move(response_packet)]() mutable {
                 // Add to our responses and try to write.
-                if (response_packet.packet->size() > 0)
+                if (response_packet.size() > 0)
                 {
-                    self->responses_.push_back(response_packet);
+                    self->queue_response(std::move(response_packet));
 
                     self->try_start_write();
                 }
 
+                if (self->pause_reading())
+                {
+                    return;
+                }
+
                 self->do_read_header();
             });
 
-    });
+    };
 
+    // The message was read into the handler's own memory.
+    if (!reserved_message_.empty())
+    {
+        message_handler_.parse_reserved(std::exchange(reserved_message_, {}),
+                                        std::move(on_response));
+        return;
+    }
+
+    // Give the message handler the header and body of the message.
+    message_handler_.parse_message(
+        std::span<const uint8_t>(incoming_header_.data(), incoming_header_.size()),
+        std::span<const uint8_t>(body_buffer_ptr_, body_buffer_ptr_ + next_payload_size_),
+        std::move(on_response));
+}
+
+// Called from a strand, drops the response if there is no room left.
+void TCPSession::queue_response(ResponsePacket packet)
+{
+    if (responses_.full())
+    {
+        metrics_sink_.record_response_dropped();
+        return;
+    }
+
+    responses_.push_back(std::move(packet));
+
+    metrics_sink_.record_response_queued(responses_.size());
+}
+
+// Called from a strand. Unless we drop responses, a full queue stops us
+// reading until the writer makes room, so the server backs up instead of us.
+bool TCPSession::pause_reading()
+{
+    if (config_.drop_responses || !responses_.full())
+    {
+        return false;
+    }
+
+    read_paused_ = true;
+
+    metrics_sink_.record_read_pause();
+
+    return true;
+}
+
+// Called from a strand once responses have left the queue.
+void TCPSession::resume_reading()
+{
+    if (!read_paused_ || !live_)
+    {
+        return;
+    }
+
+    read_paused_ = false;
+
+    do_read_header();
 }
 
 // Called from a strand.
@@ -312,57 +743,15 @@ void TCPSession::try_start_write()
 // Why not coalese the entire queue of payloads to write everything once then?
 // - The payloads might exceed SO_SNDBUF and so we again consume extra userspace memory
 // - If we wanted to simulate sending a maximally coalesced payload, we can supply a custom packet.
+//
+// Responses are small and made by us, so with COALESCE they are gathered up to a byte
+// budget, see write_responses().
 void TCPSession::do_write()
 {
     // Send responses first, then payloads.
     if (responses_.size() > 0)
     {
-        ResponsePacket packet = responses_.front();
-        responses_.pop_front();
-
-        writing_ = true;
-
-        // Every packet_sample_rate packets, record write latency.
-        if (++write_sample_counter_ >= config_.packet_sample_rate)
-        {
-            write_start_time_ = std::chrono::steady_clock::now();
-        }
-
-        asio::async_write(socket_, asio::buffer(packet.data(), packet.size()),
-            asio::bind_executor(strand_,
-                [self = shared_from_this(), packet](boost::system::error_code ec,
-                                                    size_t count){
-                    if (ec)
-                    {
-                        self->handle_stream_error(ec);
-                        return;
-                    }
-
-                    self->metrics_sink_.record_bytes_sent(count);
-
-                    // If we sampled, compute the latency.
-                    if (self->write_sample_counter_ > self->config_.packet_sample_rate)
-                    {
-                        auto end = std::chrono::steady_clock::now();
-
-                        uint64_t latency_us = static_cast<uint64_t>(
-                                std::chrono::duration_cast
-                                    <std::chrono::microseconds>
-                                        (
-                                            end - self->write_start_time_
-                                        ).count()
-                                    );
-
-                        self->metrics_sink_.record_send_latency(latency_us);
-
-                        self->write_sample_counter_ = 0;
-                    }
-
-                    // Call this function again to post another async_write call.
-                    self->do_write();
-
-                }));
-
+        write_responses();
         return;
     }
     else
@@ -372,7 +761,9 @@ void TCPSession::do_write()
         {
             // Grab the payload from the payload manger.
             bool valid_payload = payload_manager_.fill_payload(next_payload_index_,
-                                                               current_payload_);
+                                                               current_payload_,
+                                                               &counter_leases_,
+                                                               &clock_);
 
             if (!valid_payload)
             {
@@ -400,6 +791,11 @@ void TCPSession::do_write()
                 writes_queued_--;
             }
 
+            // Handlers with a payload generator may replace it.
+            message_handler_.generate_payload(session_index(),
+                                              next_payload_index_,
+                                              current_payload_);
+
             // If we get here, we have a valid payload to write.
             next_payload_index_++;
 
@@ -408,13 +804,27 @@ void TCPSession::do_write()
             // Every packet_sample_rate packets, record write latency.
             if (++write_sample_counter_ >= config_.packet_sample_rate)
             {
-                write_start_time_ = std::chrono::steady_clock::now();
+                write_start_time_ = clock_.sample_now();
+            }
+
+#ifdef __linux__
+            if (wants_zerocopy() || !current_payload_.file_slices.empty())
+            {
+                write_slice_ = 0;
+                write_offset_ = 0;
+                write_file_ = 0;
+                write_file_offset_ = 0;
+                write_count_ = 0;
+
+                send_slices();
+                return;
             }
+#endif
 
             asio::async_write(socket_, current_payload_.packet_slices,
             asio::bind_executor(strand_,
-                [self = shared_from_this()](boost::system::error_code ec,
-                                            size_t count){
+                [self = ref_from_this()](boost::system::error_code ec,
+                                         size_t count){
                     if (ec)
                     {
                         self->handle_stream_error(ec);
@@ -422,11 +832,12 @@ void TCPSession::do_write()
                     }
 
                     self->metrics_sink_.record_bytes_sent(count);
+                    self->metrics_sink_.record_packets_sent(1);
 
                     // If we sampled, compute the latency.
                     if (self->write_sample_counter_ > self->config_.packet_sample_rate)
                     {
-                        auto end = std::chrono::steady_clock::now();
+                        auto end = self->clock_.sample_now();
 
                         uint64_t latency_us = static_cast<uint64_t>(
                                 std::chrono::duration_cast
@@ -484,3 +895,446 @@ void TCPSession::handle_stream_error(boost::system::error_code ec)
     close_session();
     return;
 }
+
+// Called from a strand, writes queued responses in one gather write of up
+// to coalesce_limit bytes (or just the first one if coalescing is off).
+void TCPSession::write_responses()
+{
+    size_t total = 0;
+
+    write_responses_.clear();
+    response_buffers_.clear();
+
+    while (!responses_.empty())
+    {
+        ResponsePacket & packet = responses_.front();
+
+        // Always take the first, even if it is larger than the limit.
+        if (!write_responses_.empty()
+            && (config_.coalesce_limit == 0
+                || total + packet.size() > config_.coalesce_limit))
+        {
+            break;
+        }
+
+        total += packet.size();
+
+        response_buffers_.emplace_back(packet.data(), packet.size());
+        write_responses_.push_back(std::move(packet));
+
+        responses_.pop_front();
+    }
+
+    writing_ = true;
+
+    // Every packet_sample_rate packets, record write latency.
+    if (++write_sample_counter_ >= config_.packet_sample_rate)
+    {
+        write_start_time_ = clock_.sample_now();
+    }
+
+    // The buffers are left alone until the write finishes, so a span saves
+    // asio from copying the vector.
+    asio::async_write(socket_, std::span<const asio::const_buffer>(response_buffers_),
+        asio::bind_executor(strand_,
+            [self = ref_from_this()](boost::system::error_code ec,
+                                     size_t count){
+                if (ec)
+                {
+                    self->handle_stream_error(ec);
+                    return;
+                }
+
+                self->metrics_sink_.record_bytes_sent(count);
+                self->metrics_sink_.record_packets_sent(self->write_responses_.size());
+
+                // If we sampled, compute the latency.
+                if (self->write_sample_counter_ > self->config_.packet_sample_rate)
+                {
+                    auto end = self->clock_.sample_now();
+
+                    uint64_t latency_us = static_cast<uint64_t>(
+                            std::chrono::duration_cast
+                                <std::chrono::microseconds>
+                                    (
+                                        end - self->write_start_time_
+                                    ).count()
+                                );
+
+                    self->metrics_sink_.record_send_latency(latency_us);
+
+                    self->write_sample_counter_ = 0;
+                }
+
+                // Give the buffers back to the message handler's pool.
+                self->write_responses_.clear();
+
+                // Call this function again to post another async_write call.
+                self->do_write();
+
+            }));
+
+    // The queue has room again.
+    resume_reading();
+}
+
+#ifdef __linux__
+// Called after connecting, if the kernel refuses SO_ZEROCOPY we just copy.
+void TCPSession::enable_zerocopy()
+{
+    if (config_.zerocopy_threshold == 0)
+    {
+        return;
+    }
+
+    int enable = 1;
+    zerocopy_ = (::setsockopt(socket_.native_handle(),
+                              SOL_SOCKET,
+                              SO_ZEROCOPY,
+                              &enable,
+                              sizeof(enable)) == 0);
+}
+
+// Only worth it when the payload carries a large slice of the plan's data.
+bool TCPSession::wants_zerocopy() const
+{
+    if (!zerocopy_)
+    {
+        return false;
+    }
+
+    for (const auto & slice : current_payload_.packet_slices)
+    {
+        if (slice.size() >= config_.zerocopy_threshold)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Write current_payload_ with sendmsg and sendfile, runs in a strand.
+//
+// Large slices point into the plan's packet data which is never modified
+// during a run, so the kernel can keep referencing them after sendmsg
+// returns. Slices in temps are rewritten by the next fill_payload and must
+// always be copied.
+//
+// File slices are sent in place with sendfile, before the memory slice
+// they are ordered ahead of.
+void TCPSession::send_slices()
+{
+    const auto & slices = current_payload_.packet_slices;
+    const auto & files = current_payload_.file_slices;
+
+    const uint8_t *temps_begin = current_payload_.temps.data();
+    const uint8_t *temps_end = temps_begin + current_payload_.temps.size();
+
+    auto pinnable = [&](const asio::const_buffer & slice) {
+        auto data = static_cast<const uint8_t *>(slice.data());
+
+        return zerocopy_
+               && slice.size() >= config_.zerocopy_threshold
+               && (data < temps_begin || data >= temps_end);
+    };
+
+    auto wait_writable = [this]() {
+        socket_.async_wait(tcp::socket::wait_write,
+            asio::bind_executor(strand_,
+                [self = ref_from_this()](boost::system::error_code ec){
+                    if (ec)
+                    {
+                        self->handle_stream_error(ec);
+                        return;
+                    }
+
+                    self->send_slices();
+            }));
+    };
+
+    while (true)
+    {
+        // File ranges ordered before the current memory slice go first.
+        if (write_file_ < files.size()
+            && files[write_file_].slice_index <= write_slice_)
+        {
+            const auto & file = files[write_file_];
+
+            if (file.length == 0)
+            {
+                write_file_++;
+                continue;
+            }
+
+            off_t offset = static_cast<off_t>(file.offset + write_file_offset_);
+            size_t length = std::min<uint64_t>(file.length - write_file_offset_,
+                                               MAX_SENDFILE_CHUNK);
+
+            ssize_t sent = ::sendfile(socket_.native_handle(),
+                                      file.fd,
+                                      &offset,
+                                      length);
+
+            if (sent < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    wait_writable();
+                    return;
+                }
+
+                handle_stream_error(boost::system::error_code(errno,
+                                        boost::system::system_category()));
+                return;
+            }
+
+            // The file got shorter under us, we can't finish this packet.
+            if (sent == 0)
+            {
+                handle_stream_error(asio::error::eof);
+                return;
+            }
+
+            write_count_ += sent;
+            write_file_offset_ += sent;
+
+            if (write_file_offset_ >= file.length)
+            {
+                write_file_++;
+                write_file_offset_ = 0;
+            }
+
+            continue;
+        }
+
+        if (write_slice_ >= slices.size())
+        {
+            break;
+        }
+
+        // Don't gather memory slices past the next file range.
+        size_t limit = (write_file_ < files.size())
+                       ? files[write_file_].slice_index
+                       : slices.size();
+
+        write_iov_.clear();
+
+        int flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+
+        // Large slices go out alone, runs of small slices are copied together.
+        if (pinnable(slices[write_slice_]))
+        {
+            const auto & slice = slices[write_slice_];
+
+            write_iov_.push_back({
+                const_cast<uint8_t *>(static_cast<const uint8_t *>(slice.data()))
+                    + write_offset_,
+                slice.size() - write_offset_});
+
+            flags |= MSG_ZEROCOPY;
+        }
+        else
+        {
+            for (size_t i = write_slice_;
+                 i < limit
+                 && write_iov_.size() < IOV_MAX
+                 && !pinnable(slices[i]);
+                 i++)
+            {
+                size_t skip = (i == write_slice_) ? write_offset_ : 0;
+
+                write_iov_.push_back({
+                    const_cast<uint8_t *>(static_cast<const uint8_t *>(slices[i].data()))
+                        + skip,
+                    slices[i].size() - skip});
+            }
+        }
+
+        msghdr msg{};
+        msg.msg_iov = write_iov_.data();
+        msg.msg_iovlen = write_iov_.size();
+
+        ssize_t sent = ::sendmsg(socket_.native_handle(), &msg, flags);
+
+        // Out of socket option memory for notifications, reap what
+        // finished and copy this slice instead.
+        if (sent < 0 && errno == ENOBUFS && (flags & MSG_ZEROCOPY))
+        {
+            reap_zerocopy();
+            sent = ::sendmsg(socket_.native_handle(),
+                             &msg,
+                             flags & ~MSG_ZEROCOPY);
+            flags &= ~MSG_ZEROCOPY;
+        }
+
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            // Socket buffer is full, wait until we can write again.
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                wait_writable();
+                return;
+            }
+
+            handle_stream_error(boost::system::error_code(errno,
+                                    boost::system::system_category()));
+            return;
+        }
+
+        if (flags & MSG_ZEROCOPY)
+        {
+            zerocopy_pending_++;
+            wait_zerocopy();
+        }
+
+        write_count_ += sent;
+
+        // Advance past what the kernel took, including empty slices.
+        size_t left = static_cast<size_t>(sent);
+
+        while (write_slice_ < slices.size())
+        {
+            size_t available = slices[write_slice_].size() - write_offset_;
+
+            if (left < available)
+            {
+                write_offset_ += left;
+                break;
+            }
+
+            left -= available;
+            write_slice_++;
+            write_offset_ = 0;
+        }
+    }
+
+    on_slices_done();
+}
+
+void TCPSession::on_slices_done()
+{
+    metrics_sink_.record_bytes_sent(write_count_);
+    metrics_sink_.record_packets_sent(1);
+
+    // If we sampled, compute the latency.
+    if (write_sample_counter_ > config_.packet_sample_rate)
+    {
+        auto end = clock_.sample_now();
+
+        uint64_t latency_us = static_cast<uint64_t>(
+                std::chrono::duration_cast
+                    <std::chrono::microseconds>
+                        (
+                            end - write_start_time_
+                        ).count()
+                    );
+
+        metrics_sink_.record_send_latency(latency_us);
+
+        write_sample_counter_ = 0;
+    }
+
+    // The write may have finished inline, post so we don't recurse
+    // and other sessions on this shard get a turn.
+    asio::post(strand_, [self = ref_from_this()]{
+        self->do_write();
+    });
+}
+
+// Completions arrive on the socket error queue, which wakes the reactor
+// with EPOLLERR. Keep one wait outstanding while sends are unreported.
+void TCPSession::wait_zerocopy()
+{
+    if (zerocopy_waiting_ || zerocopy_pending_ == 0)
+    {
+        return;
+    }
+
+    zerocopy_waiting_ = true;
+
+    socket_.async_wait(tcp::socket::wait_error,
+        asio::bind_executor(strand_,
+            [self = ref_from_this()](boost::system::error_code ec){
+                self->zerocopy_waiting_ = false;
+
+                if (ec)
+                {
+                    return;
+                }
+
+                self->reap_zerocopy();
+                self->wait_zerocopy();
+        }));
+}
+
+// Drain zero copy notifications from the error queue.
+void TCPSession::reap_zerocopy()
+{
+    while (true)
+    {
+        // Room for the extended error and the offender address.
+        union
+        {
+            char buffer[CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in6))];
+            cmsghdr align;
+        } control;
+
+        msghdr msg{};
+        msg.msg_control = control.buffer;
+        msg.msg_controllen = sizeof(control.buffer);
+
+        if (::recvmsg(socket_.native_handle(),
+                      &msg,
+                      MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            return;
+        }
+
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+             cmsg != nullptr;
+             cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            bool recv_error = (cmsg->cmsg_level == SOL_IP
+                               && cmsg->cmsg_type == IP_RECVERR)
+                              || (cmsg->cmsg_level == SOL_IPV6
+                                  && cmsg->cmsg_type == IPV6_RECVERR);
+
+            if (!recv_error)
+            {
+                continue;
+            }
+
+            sock_extended_err err;
+            std::memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+
+            if (err.ee_errno != 0 || err.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+
+            // Each notification covers the inclusive range [ee_info, ee_data].
+            uint32_t completed = err.ee_data - err.ee_info + 1;
+
+            zerocopy_pending_ -= std::min(completed, zerocopy_pending_);
+
+            // The kernel copied anyways (loopback, no scatter gather), so
+            // zero copy only costs us notifications from here on.
+            if (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                zerocopy_ = false;
+            }
+        }
+    }
+}
+#endif
@@ -19,12 +19,21 @@
 #include <boost/asio.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
-#include <deque>
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
 
+#include <memory>
+#include <span>
+
+#include "buffer-service.h"
 #include "session-config.h"
+#include "session-ref.h"
 #include "message-handler-interface.h"
 #include "payload-manager.h"
 #include "response-packet.h"
+#include "response-queue.h"
 #include "shard-metrics.h"
 
 namespace asio = boost::asio;
@@ -40,7 +49,20 @@ namespace asio = boost::asio;
 // - Payloads that are shared across session instances are read only
 // - Server packets are handled by an interface passed to the session.
 //
-class TCPSession : public std::enable_shared_from_this<TCPSession>
+// On Linux, payloads with a read only slice of at least zerocopy_threshold
+// bytes are written with MSG_ZEROCOPY so the kernel pins the plan's pages
+// instead of copying them. Small slices (counters, timestamps) are copied.
+//
+// Payloads backed by a file on disk are sent with sendfile (Linux only).
+//
+// Large bodies are read straight into the message handler's memory when it
+// offers some (a WASM guest with GUESTMEMORY), saving a copy per message.
+//
+// With shared_buffers, the session waits for the socket to become readable
+// and reads bodies into the shard's scratch buffer. Only a body that arrives
+// in pieces is copied into a leased buffer, until it is handled.
+//
+class TCPSession : public SessionRefCount<TCPSession>
 {
 public:
     using tcp = asio::ip::tcp;
@@ -49,6 +71,9 @@ public:
 
     using DisconnectCallback = std::function<void()>;
 
+    // Linux caps a single sendfile call at this many bytes.
+    static constexpr size_t MAX_SENDFILE_CHUNK = 0x7ffff000;
+
 public:
     TCPSession(asio::io_context & cntx,
                const SessionConfig & config,
@@ -81,16 +106,58 @@ private:
 
     void do_read_body();
 
+    void read_frame();
+
+    bool read_batch();
+
+    void fill_read_buffer();
+
+    size_t read_buffer_size() const;
+
+    void on_header();
+
+    void on_body();
+
+    void read_ready();
+
+    void wait_readable();
+
+    void sample_read_latency();
+
+    void handle_batch();
+
     void handle_message();
 
+    void queue_response(ResponsePacket packet);
+
+    bool pause_reading();
+
+    void resume_reading();
+
     void try_start_write();
 
     void do_write();
 
+    void write_responses();
+
     void close_session();
 
     void handle_stream_error(boost::system::error_code ec);
 
+#ifdef __linux__
+    void enable_zerocopy();
+
+    bool wants_zerocopy() const;
+
+    void send_slices();
+
+    void on_slices_done();
+
+    void wait_zerocopy();
+
+    void reap_zerocopy();
+#endif
+
 public:
 
 private:
@@ -119,19 +186,43 @@ private:
     std::vector<uint8_t> incoming_header_;
     size_t next_payload_size_{0};
 
-    // Ring buffer to hold small messages
-    std::array<uint8_t, MESSAGE_BUFFER_SIZE> body_buffer_;
+    // Read buffer, allocated on the first read. Frames are parsed out of
+    // [read_begin_, read_end_) and a partial frame is kept for the next read.
+    std::unique_ptr<uint8_t[]> body_buffer_;
+    size_t read_begin_{0};
+    size_t read_end_{0};
 
-    // Vector for large messages
-    //
-    // TODO <optimization>: a memory pool like Boost.pool would
-    // be better so we can avoid allocations on large messages.
-    std::vector<uint8_t> large_body_buffer_;
+    // Large messages (and shared buffer bodies that arrive in pieces) borrow
+    // a buffer from the shard until the message is handled.
+    BufferLease body_lease_;
 
-    // Pointer to last server packet (fixed array or vector).
+    // Or are read into the message handler's memory when it offers some,
+    // holds the header and body (see MessageHandler::reserve_message).
+    std::span<uint8_t> reserved_message_;
+
+    // Pointer to last server packet (read buffer, lease or shard scratch).
     uint8_t *body_buffer_ptr_{nullptr};
 
-    std::deque<ResponsePacket> responses_;
+    // Whether the next frame we expect is a header or a body.
+    bool reading_header_{false};
+
+    // Complete messages out of one read, for handlers that batch.
+    std::vector<MessageView> batch_messages_;
+
+    // Shared buffer reads, recv may return less than we asked for.
+    BufferService & buffers_;
+    size_t header_count_{0};
+    size_t body_count_{0};
+
+    // Responses waiting to be written, bounded by the config.
+    ResponseQueue responses_;
+
+    // Set while a full queue keeps us from reading, see pause_reading().
+    bool read_paused_{false};
+
+    // The responses being written, kept alive until the write finishes.
+    std::vector<ResponsePacket> write_responses_;
+    std::vector<asio::const_buffer> response_buffers_;
 
     // Increasing index into the payloads that need to be sent by this session
     size_t next_payload_index_{0};
@@ -141,6 +232,24 @@ private:
     // Keep track of how many payload writes are requested if not flooding.
     size_t writes_queued_{0};
 
+#ifdef __linux__
+    // Set once the socket accepted SO_ZEROCOPY, cleared if the kernel
+    // tells us it had to copy anyways.
+    bool zerocopy_{false};
+    bool zerocopy_waiting_{false};
+
+    // Zero copy sends the kernel has not reported as finished.
+    uint32_t zerocopy_pending_{0};
+
+    // Progress through current_payload_ for the manual send loop.
+    size_t write_slice_{0};
+    size_t write_offset_{0};
+    size_t write_file_{0};
+    uint64_t write_file_offset_{0};
+    size_t write_count_{0};
+    std::vector<iovec> write_iov_;
+#endif
+
     //
     // Handlers & metrics
     //
@@ -151,6 +260,12 @@ private:
     // Reference to the Controller's payload manager.
     const PayloadManager & payload_manager_;
 
+    // Shard's leased blocks of COUNTER values.
+    CounterLeaseService & counter_leases_;
+
+    // Shard's clock, sampled latencies may use its cached time.
+    ShardClock & clock_;
+
     // Write metrics, keep track of connection times.
     ShardMetrics & metrics_sink_;
     uint32_t write_sample_counter_{0};
@@ -0,0 +1,690 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#ifdef __linux__
+
+#include "tcp-uring-session.h"
+
+#include <netinet/in.h>
+#include <unistd.h>
+
+TCPUringSession::TCPUringSession(asio::io_context & cntx,
+                                 const SessionConfig & config,
+                                 const MessageHandler & message_handler,
+                                 const PayloadManager & payload_manager,
+                                 ShardMetrics & shard_metrics,
+                                 DisconnectCallback & on_disconnect)
+:config_(config),
+cntx_(cntx),
+ring_(asio::use_service<IoUringService>(cntx)),
+buffers_(asio::use_service<BufferService>(cntx)),
+incoming_header_(config_.header_size),
+responses_(config_.response_queue_size),
+message_handler_(message_handler),
+payload_manager_(payload_manager),
+counter_leases_(asio::use_service<CounterLeaseService>(cntx)),
+clock_(asio::use_service<ShardClock>(cntx)),
+metrics_sink_(shard_metrics),
+write_sample_counter_(config_.packet_sample_rate),
+read_sample_counter_(config_.packet_sample_rate),
+on_disconnect_(on_disconnect)
+{
+    connect_op_.handler = &TCPUringSession::on_connect_complete;
+    read_op_.handler = &TCPUringSession::on_read_complete;
+    write_op_.handler = &TCPUringSession::on_write_complete;
+}
+
+TCPUringSession::~TCPUringSession()
+{
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+    }
+}
+
+// Always the first function called on the Session if any are called.
+void TCPUringSession::start(const Endpoints & endpoints)
+{
+    asio::post(cntx_, [self = ref_from_this(), endpoints]{
+        self->live_ = true;
+        self->connecting_ = true;
+
+        self->metrics_sink_.record_connection_attempt();
+
+        self->endpoints_ = endpoints;
+        self->next_endpoint_ = 0;
+        self->conn_start_ = std::chrono::steady_clock::now();
+
+        self->try_connect();
+    });
+}
+
+// Request enabling flood.
+void TCPUringSession::flood()
+{
+    asio::post(cntx_, [self = ref_from_this()]{
+
+        // If we are already flooding, don't try to open two flood loops.
+        if (self->flood_ || self->draining_)
+        {
+            return;
+        }
+
+        self->flood_ = true;
+
+        // If safe to start write, go ahead
+        if (self->live_ && !self->connecting_)
+        {
+            self->try_start_write();
+        }
+
+    });
+}
+
+// Enqueue N payloads to be sent, if they exist.
+void TCPUringSession::send(size_t N)
+{
+    asio::post(cntx_, [self = ref_from_this(), N]{
+        self->writes_queued_ += N;
+
+        if (self->live_ && !self->connecting_)
+        {
+            self->try_start_write();
+        }
+    });
+}
+
+void TCPUringSession::drain()
+{
+    asio::post(cntx_, [self = ref_from_this()]{
+        self->draining_ = true;
+
+        if (!self->writing_
+            && self->writes_queued_ == 0
+            && self->responses_.empty())
+        {
+            self->close_session();
+        }
+    });
+}
+
+// Stop the session and callback to the orchestrator
+void TCPUringSession::stop()
+{
+    asio::post(cntx_, [self = ref_from_this()]{
+        self->close_session();
+    });
+}
+
+// Try each endpoint in order, like asio::async_connect.
+void TCPUringSession::try_connect()
+{
+    if (!ring_.valid() || next_endpoint_ >= endpoints_.size())
+    {
+        connecting_ = false;
+        metrics_sink_.record_connection_fail();
+        close_session();
+        return;
+    }
+
+    const Endpoint & ep = endpoints_[next_endpoint_++];
+
+    fd_ = ::socket(ep.protocol().family(), SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+
+    if (fd_ < 0)
+    {
+        try_connect();
+        return;
+    }
+
+    pending_ops_++;
+    connect_op_.hold(ref_from_this());
+    ring_.connect(fd_, ep.data(), static_cast<socklen_t>(ep.size()), connect_op_);
+}
+
+void TCPUringSession::on_connect_complete(UringOperation & op, int result)
+{
+    auto self = op.take<TCPUringSession>();
+    self->pending_ops_--;
+
+    if (!self->live_)
+    {
+        self->release_socket();
+        return;
+    }
+
+    // Nothing else references the socket yet, move on to the next endpoint.
+    if (result < 0)
+    {
+        ::close(self->fd_);
+        self->fd_ = -1;
+        self->try_connect();
+        return;
+    }
+
+    self->connecting_ = false;
+
+    // Record connection time.
+    auto end = std::chrono::steady_clock::now();
+
+    uint64_t latency_us = static_cast<uint64_t>(
+            std::chrono::duration_cast
+                <std::chrono::microseconds>(end - self->conn_start_).count()
+        );
+
+    self->metrics_sink_.record_connection_latency(latency_us);
+    self->metrics_sink_.record_connection_success();
+
+    self->on_connect();
+}
+
+void TCPUringSession::on_connect()
+{
+    // Start the header read loop if setting is enabled.
+    if (config_.read_messages)
+    {
+        do_read_header();
+    }
+
+    if (writing_)
+    {
+        return;
+    }
+
+    if (flood_ || writes_queued_ > 0)
+    {
+        do_write();
+    }
+}
+
+void TCPUringSession::do_read_header()
+{
+    // Every packet_sample_rate packets, record read latency.
+    if (++read_sample_counter_ >= config_.packet_sample_rate)
+    {
+        read_start_time_ = clock_.sample_now();
+    }
+
+    reading_header_ = true;
+    start_read(incoming_header_.data(), config_.header_size);
+}
+
+void TCPUringSession::do_read_body()
+{
+    // Special case when we have to give a response but no body is expected.
+    if (next_payload_size_ == 0)
+    {
+        handle_message();
+        return;
+    }
+
+    if (next_payload_size_ > MESSAGE_BUFFER_SIZE)
+    {
+        body_lease_ = buffers_.lease(next_payload_size_);
+        body_buffer_ptr_ = body_lease_.data();
+    }
+    else
+    {
+        body_buffer_ptr_ = body_buffer_.data();
+    }
+
+    reading_header_ = false;
+    start_read(body_buffer_ptr_, next_payload_size_);
+}
+
+void TCPUringSession::start_read(uint8_t *buffer, size_t length)
+{
+    read_ptr_ = buffer;
+    read_remaining_ = length;
+    read_count_ = 0;
+
+    submit_read();
+}
+
+void TCPUringSession::submit_read()
+{
+    pending_ops_++;
+    read_op_.hold(ref_from_this());
+    ring_.recv(fd_, read_ptr_ + read_count_, read_remaining_, read_op_);
+}
+
+void TCPUringSession::on_read_complete(UringOperation & op, int result)
+{
+    auto self = op.take<TCPUringSession>();
+    self->pending_ops_--;
+
+    if (!self->live_)
+    {
+        self->release_socket();
+        return;
+    }
+
+    // Zero bytes means the server closed the connection.
+    if (result <= 0)
+    {
+        self->close_session();
+        return;
+    }
+
+    self->read_count_ += static_cast<size_t>(result);
+    self->read_remaining_ -= static_cast<size_t>(result);
+
+    if (self->read_remaining_ > 0)
+    {
+        self->submit_read();
+        return;
+    }
+
+    self->metrics_sink_.record_bytes_read(self->read_count_);
+
+    if (self->reading_header_)
+    {
+        self->on_header();
+    }
+    else
+    {
+        self->on_body();
+    }
+}
+
+void TCPUringSession::on_header()
+{
+    message_handler_.set_current_session(session_index());
+
+    // User defined message parsing to get message size
+    std::span<const uint8_t> header_bytes(incoming_header_);
+    HeaderResult result = message_handler_.parse_header(header_bytes);
+
+    // Handle errors, should only occur if we have a WASM call.
+    if (result.status != HeaderResult::Status::OK)
+    {
+        next_payload_size_ = 0;
+        do_read_header();
+        return;
+    }
+
+    next_payload_size_ = result.length;
+
+    // Handle the server sending messages that are too big.
+    if (next_payload_size_ > config_.payload_size_limit)
+    {
+        close_session();
+        return;
+    }
+
+    do_read_body();
+}
+
+void TCPUringSession::on_body()
+{
+    // If we sampled, compute the latency.
+    if (read_sample_counter_ > config_.packet_sample_rate)
+    {
+        auto end = clock_.sample_now();
+
+        uint64_t latency_us = static_cast<uint64_t>(
+                std::chrono::duration_cast
+                    <std::chrono::microseconds>
+                        (
+                            end - read_start_time_
+                        ).count()
+                    );
+
+        metrics_sink_.record_read_latency(latency_us);
+
+        read_sample_counter_ = 0;
+    }
+
+    handle_message();
+
+    // The message handler is done with the body.
+    body_lease_.release();
+}
+
+// Handles a server packet based on user set rules.
+void TCPUringSession::handle_message()
+{
+    message_handler_.set_current_session(session_index());
+
+    metrics_sink_.record_packets_read(1);
+
+    // Handlers answer on the shard thread, so unlike TCPSession we can
+    // act on the response directly instead of posting it back.
+    message_handler_.parse_message(
+        std::span<const uint8_t>(incoming_header_.data(), incoming_header_.size()),
+        std::span<const uint8_t>(body_buffer_ptr_, body_buffer_ptr_ + next_payload_size_),
+        [self = ref_from_this()](ResponsePacket response_packet) {
+
+            if (!self->live_)
+            {
+                return;
+            }
+
+            // Add to our responses and try to write.
+            if (response_packet.size() > 0)
+            {
+                self->queue_response(std::move(response_packet));
+
+                self->try_start_write();
+            }
+
+            if (self->pause_reading())
+            {
+                return;
+            }
+
+            self->do_read_header();
+    });
+}
+
+// Drops the response if there is no room left.
+void TCPUringSession::queue_response(ResponsePacket packet)
+{
+    if (responses_.full())
+    {
+        metrics_sink_.record_response_dropped();
+        return;
+    }
+
+    responses_.push_back(std::move(packet));
+
+    metrics_sink_.record_response_queued(responses_.size());
+}
+
+// Same policy as TCPSession::pause_reading().
+bool TCPUringSession::pause_reading()
+{
+    if (config_.drop_responses || !responses_.full())
+    {
+        return false;
+    }
+
+    read_paused_ = true;
+
+    metrics_sink_.record_read_pause();
+
+    return true;
+}
+
+// Called once responses have left the queue.
+void TCPUringSession::resume_reading()
+{
+    if (!read_paused_ || !live_)
+    {
+        return;
+    }
+
+    read_paused_ = false;
+
+    do_read_header();
+}
+
+void TCPUringSession::try_start_write()
+{
+    // Clearly we can't start another loop.
+    if (writing_)
+    {
+        return;
+    }
+
+    // If we have a response to deliver or payloads.
+    if (flood_ || writes_queued_ > 0 || responses_.size() > 0)
+    {
+        do_write();
+    }
+    // Handle draining but nothing queued.
+    else if (draining_)
+    {
+        close_session();
+    }
+}
+
+// Same write policy as TCPSession::do_write(), one outstanding write per socket.
+void TCPUringSession::do_write()
+{
+    write_iov_.clear();
+    write_iov_index_ = 0;
+    write_count_ = 0;
+
+    // Send responses first, then payloads.
+    if (responses_.size() > 0)
+    {
+        size_t total = 0;
+
+        // Gather up to coalesce_limit bytes, always taking the first.
+        while (!responses_.empty())
+        {
+            ResponsePacket & packet = responses_.front();
+
+            if (!write_responses_.empty()
+                && (config_.coalesce_limit == 0
+                    || total + packet.size() > config_.coalesce_limit))
+            {
+                break;
+            }
+
+            total += packet.size();
+
+            write_iov_.push_back({const_cast<uint8_t *>(packet.data()), packet.size()});
+            write_responses_.push_back(std::move(packet));
+
+            responses_.pop_front();
+        }
+    }
+    // If flooding or writes are queued, write payloads.
+    else if (flood_ || writes_queued_ > 0)
+    {
+        // Grab the payload from the payload manger.
+        bool valid_payload = payload_manager_.fill_payload(next_payload_index_,
+                                                           current_payload_,
+                                                           &counter_leases_,
+                                                           &clock_);
+
+        if (!valid_payload)
+        {
+            if (config_.loop_payloads && !draining_)
+            {
+                next_payload_index_ = 0;
+                do_write();
+                return;
+            }
+
+            // If not looping, stop writing, we are done.
+            writing_ = false;
+
+            if (draining_)
+            {
+                close_session();
+            }
+
+            return;
+        }
+
+        // Decrement after payload is valid.
+        if (!flood_)
+        {
+            writes_queued_--;
+        }
+
+        // Handlers with a payload generator may replace it.
+        message_handler_.generate_payload(session_index(),
+                                          next_payload_index_,
+                                          current_payload_);
+
+        // If we get here, we have a valid payload to write.
+        next_payload_index_++;
+
+        for (const auto & slice : current_payload_.packet_slices)
+        {
+            write_iov_.push_back({const_cast<void *>(slice.data()), slice.size()});
+        }
+    }
+    else
+    {
+        // We stopped writing, set to false.
+        writing_ = false;
+
+        if (draining_)
+        {
+            close_session();
+        }
+
+        return;
+    }
+
+    writing_ = true;
+
+    // Every packet_sample_rate packets, record write latency.
+    if (++write_sample_counter_ >= config_.packet_sample_rate)
+    {
+        write_start_time_ = clock_.sample_now();
+    }
+
+    submit_write();
+
+    // The queue has room again.
+    resume_reading();
+}
+
+void TCPUringSession::submit_write()
+{
+    write_msg_ = msghdr{};
+    write_msg_.msg_iov = write_iov_.data() + write_iov_index_;
+    write_msg_.msg_iovlen = write_iov_.size() - write_iov_index_;
+
+    pending_ops_++;
+    write_op_.hold(ref_from_this());
+    ring_.sendmsg(fd_, &write_msg_, MSG_NOSIGNAL, write_op_);
+}
+
+void TCPUringSession::on_write_complete(UringOperation & op, int result)
+{
+    auto self = op.take<TCPUringSession>();
+    self->pending_ops_--;
+
+    if (!self->live_)
+    {
+        self->release_socket();
+        return;
+    }
+
+    if (result < 0)
+    {
+        self->close_session();
+        return;
+    }
+
+    self->write_count_ += static_cast<size_t>(result);
+
+    // Skip past whatever the kernel accepted.
+    size_t sent = static_cast<size_t>(result);
+    auto & iov = self->write_iov_;
+
+    while (sent > 0 && self->write_iov_index_ < iov.size())
+    {
+        iovec & front = iov[self->write_iov_index_];
+
+        if (sent >= front.iov_len)
+        {
+            sent -= front.iov_len;
+            self->write_iov_index_++;
+        }
+        else
+        {
+            front.iov_base = static_cast<uint8_t *>(front.iov_base) + sent;
+            front.iov_len -= sent;
+            sent = 0;
+        }
+    }
+
+    // Skip empty slices so a short write never leaves us spinning on them.
+    while (self->write_iov_index_ < iov.size()
+           && iov[self->write_iov_index_].iov_len == 0)
+    {
+        self->write_iov_index_++;
+    }
+
+    if (self->write_iov_index_ < iov.size())
+    {
+        self->submit_write();
+        return;
+    }
+
+    self->on_write_done();
+}
+
+void TCPUringSession::on_write_done()
+{
+    metrics_sink_.record_bytes_sent(write_count_);
+    metrics_sink_.record_packets_sent(write_responses_.empty() ? 1 : write_responses_.size());
+
+    // If we sampled, compute the latency.
+    if (write_sample_counter_ > config_.packet_sample_rate)
+    {
+        auto end = clock_.sample_now();
+
+        uint64_t latency_us = static_cast<uint64_t>(
+                std::chrono::duration_cast
+                    <std::chrono::microseconds>
+                        (
+                            end - write_start_time_
+                        ).count()
+                    );
+
+        metrics_sink_.record_send_latency(latency_us);
+
+        write_sample_counter_ = 0;
+    }
+
+    write_responses_.clear();
+
+    do_write();
+}
+
+void TCPUringSession::close_session()
+{
+    // Prevent calling twice.
+    if (!live_)
+    {
+        return;
+    }
+
+    live_ = false;
+
+    // Wake up any request still parked on the socket, they complete
+    // with an error or EOF and release the socket afterwards.
+    if (fd_ >= 0)
+    {
+        ::shutdown(fd_, SHUT_RDWR);
+    }
+
+    release_socket();
+
+    on_disconnect_();
+}
+
+void TCPUringSession::release_socket()
+{
+    if (pending_ops_ > 0 || fd_ < 0)
+    {
+        return;
+    }
+
+    ::close(fd_);
+    fd_ = -1;
+}
+
+#endif
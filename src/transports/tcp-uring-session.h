@@ -0,0 +1,238 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#ifdef __linux__
+
+#include <boost/asio.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <sys/uio.h>
+
+#include "buffer-service.h"
+#include "io-uring-service.h"
+#include "session-config.h"
+#include "session-ref.h"
+#include "message-handler-interface.h"
+#include "payload-manager.h"
+#include "response-packet.h"
+#include "response-queue.h"
+#include "shard-metrics.h"
+
+namespace asio = boost::asio;
+
+// TCP session that drives connect, read and write through the shard's
+// io_uring instance instead of the asio reactor.
+//
+// Follows the same assumptions as TCPSession. Differences:
+//
+// - Completions run directly from the ring's reaper, there is no strand
+//   since every shard owns its io_context and runs it on a single thread.
+// - The socket is only closed once the kernel has returned every request
+//   that referenced it, so file descriptors are never reused under us.
+//
+class TCPUringSession : public SessionRefCount<TCPUringSession>
+{
+public:
+    using tcp = asio::ip::tcp;
+    using Endpoint = tcp::endpoint;
+    using Endpoints = std::vector<tcp::endpoint>;
+
+    using DisconnectCallback = std::function<void()>;
+
+public:
+    TCPUringSession(asio::io_context & cntx,
+                    const SessionConfig & config,
+                    const MessageHandler & message_handler,
+                    const PayloadManager & payload_manager,
+                    ShardMetrics & shard_metrics,
+                    DisconnectCallback & on_disconnect);
+
+    ~TCPUringSession();
+
+    // This class should not be moved or copied.
+    TCPUringSession(const TCPUringSession &) = delete;
+    TCPUringSession & operator=(const TCPUringSession &) = delete;
+    TCPUringSession(TCPUringSession &&) = delete;
+    TCPUringSession & operator=(TCPUringSession &&) = delete;
+
+    void start(const Endpoints & endpoints);
+
+    void flood();
+
+    void send(size_t N);
+
+    // Try to get all payloads out.
+    void drain();
+
+    void stop();
+
+private:
+    void try_connect();
+
+    void on_connect();
+
+    void do_read_header();
+
+    void do_read_body();
+
+    void start_read(uint8_t *buffer, size_t length);
+
+    void submit_read();
+
+    void on_header();
+
+    void on_body();
+
+    void handle_message();
+
+    void queue_response(ResponsePacket packet);
+
+    bool pause_reading();
+
+    void resume_reading();
+
+    void try_start_write();
+
+    void do_write();
+
+    void submit_write();
+
+    void on_write_done();
+
+    void close_session();
+
+    void release_socket();
+
+    static void on_connect_complete(UringOperation & op, int result);
+
+    static void on_read_complete(UringOperation & op, int result);
+
+    static void on_write_complete(UringOperation & op, int result);
+
+private:
+    const SessionConfig & config_;
+
+    asio::io_context & cntx_;
+
+    IoUringService & ring_;
+
+    BufferService & buffers_;
+
+    //
+    // Concurrency handling.
+    //
+    bool live_{false};
+    bool connecting_{false};
+    bool flood_{false};
+
+    // For graceful exits.
+    bool draining_{false};
+
+    // Ensures we don't have two writers for non-flooding scenario
+    bool writing_{false};
+
+    //
+    // Socket & ring state.
+    //
+    int fd_{-1};
+
+    // Requests the kernel still holds, the socket is closed when this hits zero.
+    uint32_t pending_ops_{0};
+
+    UringOperation connect_op_;
+    UringOperation read_op_;
+    UringOperation write_op_;
+
+    Endpoints endpoints_;
+    size_t next_endpoint_{0};
+    std::chrono::steady_clock::time_point conn_start_;
+
+    //
+    // Packet management.
+    //
+
+    // Header + body size
+    std::vector<uint8_t> incoming_header_;
+    size_t next_payload_size_{0};
+
+    // Ring buffer to hold small messages
+    std::array<uint8_t, MESSAGE_BUFFER_SIZE> body_buffer_;
+
+    // Large messages borrow a buffer from the shard until they are handled.
+    BufferLease body_lease_;
+
+    // Pointer to last server packet (fixed array or lease).
+    uint8_t *body_buffer_ptr_{nullptr};
+
+    // Current read, recv may return less than we asked for.
+    bool reading_header_{false};
+    uint8_t *read_ptr_{nullptr};
+    size_t read_remaining_{0};
+    size_t read_count_{0};
+
+    // Responses waiting to be written, bounded by the config.
+    ResponseQueue responses_;
+
+    // Set while a full queue keeps us from reading, see pause_reading().
+    bool read_paused_{false};
+
+    // The responses being written, keeps their buffers alive.
+    std::vector<ResponsePacket> write_responses_;
+
+    // Increasing index into the payloads that need to be sent by this session
+    size_t next_payload_index_{0};
+
+    PreparedPayload current_payload_;
+
+    // Current write, advanced in place on partial sends.
+    std::vector<iovec> write_iov_;
+    size_t write_iov_index_{0};
+    size_t write_count_{0};
+    msghdr write_msg_{};
+
+    // Keep track of how many payload writes are requested if not flooding.
+    size_t writes_queued_{0};
+
+    //
+    // Handlers & metrics
+    //
+
+    // Reference to the thread's message handler interface.
+    const MessageHandler & message_handler_;
+
+    // Reference to the Controller's payload manager.
+    const PayloadManager & payload_manager_;
+
+    // Shard's leased blocks of COUNTER values.
+    CounterLeaseService & counter_leases_;
+
+    // Shard's clock, sampled latencies may use its cached time.
+    ShardClock & clock_;
+
+    // Write metrics, keep track of connection times.
+    ShardMetrics & metrics_sink_;
+    uint32_t write_sample_counter_{0};
+    uint32_t read_sample_counter_{0};
+    std::chrono::steady_clock::time_point write_start_time_;
+    std::chrono::steady_clock::time_point read_start_time_;
+
+    //
+    const DisconnectCallback on_disconnect_;
+};
+
+#endif
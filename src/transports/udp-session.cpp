@@ -16,6 +16,11 @@
 
 #include "udp-session.h"
 
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+
 // TODO <feature>: report UDP errors when the endpoint does not exist, etc.
 
 UDPSession::UDPSession(asio::io_context & cntx,
@@ -27,8 +32,12 @@ UDPSession::UDPSession(asio::io_context & cntx,
 :config_(config),
 strand_(cntx.get_executor()),
 socket_(cntx),
+buffers_(asio::use_service<BufferService>(cntx)),
+responses_(config_.response_queue_size),
 message_handler_(message_handler),
 payload_manager_(payload_manager),
+counter_leases_(asio::use_service<CounterLeaseService>(cntx)),
+clock_(asio::use_service<ShardClock>(cntx)),
 metrics_sink_(shard_metrics),
 write_sample_counter_(config_.packet_sample_rate),
 read_sample_counter_(config_.packet_sample_rate),
@@ -37,7 +46,58 @@ on_disconnect_(on_disconnect)
     size_t expected_body = (config_.payload_size_limit < MAX_DATAGRAM_SIZE ?
                             config_.payload_size_limit : MAX_DATAGRAM_SIZE);
 
-    packet_buffer_.resize(expected_body);
+    batched_ = config_.batch_size > 1 || config_.udp_gso || config_.udp_gro;
+
+    max_datagram_ = expected_body;
+
+    // Datagrams are read into the shard's buffer instead.
+    if (!batched_ && config_.shared_buffers)
+    {
+        return;
+    }
+
+    if (!batched_)
+    {
+        packet_buffer_.resize(expected_body);
+        packet_ptr_ = packet_buffer_.data();
+        return;
+    }
+
+    size_t batch_size = config_.batch_size > 1 ? config_.batch_size : 1;
+
+    // GRO hands us several datagrams in one buffer, so every slot
+    // must hold the largest coalesced datagram.
+    size_t slot_size = config_.udp_gro ? MAX_DATAGRAM_SIZE : expected_body;
+
+    // Point every read slot at its own part of the packet buffer.
+    if (config_.read_messages)
+    {
+        packet_buffer_.resize(slot_size * batch_size);
+
+        read_msgs_.resize(batch_size);
+        read_iov_.resize(batch_size);
+
+        for (size_t i = 0; i < batch_size; i++)
+        {
+            read_iov_[i].iov_base = packet_buffer_.data() + i * slot_size;
+            read_iov_[i].iov_len = slot_size;
+
+            read_msgs_[i].msg_hdr = {};
+            read_msgs_[i].msg_hdr.msg_iov = &read_iov_[i];
+            read_msgs_[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+    packet_ptr_ = packet_buffer_.data();
+
+    write_msgs_.resize(batch_size);
+    batch_responses_.reserve(batch_size);
+    batch_payloads_.resize(batch_size);
+
+    if (config_.udp_gso)
+    {
+        write_segments_.resize(batch_size);
+    }
 }
 
 // Always the first function called on the Session if any are called.
@@ -46,7 +106,7 @@ on_disconnect_(on_disconnect)
 //       setting operating system primitives and filtering for this endpoint.
 void UDPSession::start(const Endpoints & endpoints)
 {
-    asio::post(strand_, [self = shared_from_this(), endpoints]{
+    asio::post(strand_, [self = ref_from_this(), endpoints]{
         self->live_ = true;
 
         self->metrics_sink_.record_connection_attempt();
@@ -73,6 +133,7 @@ void UDPSession::start(const Endpoints & endpoints)
         }
 
         self->metrics_sink_.record_connection_success();
+        self->enable_offloads();
         self->on_connect();
     });
 }
@@ -80,7 +141,7 @@ void UDPSession::start(const Endpoints & endpoints)
 // Request enabling flood.
 void UDPSession::flood()
 {
-    asio::post(strand_, [self = shared_from_this()]{
+    asio::post(strand_, [self = ref_from_this()]{
 
         // If we are already flooding, don't try to open two flood loops.
         //
@@ -104,7 +165,7 @@ void UDPSession::flood()
 // Enqueue N payloads to be sent, if they exist.
 void UDPSession::send(size_t N)
 {
-    asio::post(strand_, [self = shared_from_this(), N]{
+    asio::post(strand_, [self = ref_from_this(), N]{
         self->writes_queued_ += N;
 
         if (self->live_)
@@ -116,7 +177,7 @@ void UDPSession::send(size_t N)
 
 void UDPSession::drain()
 {
-    asio::post(strand_, [self = shared_from_this()]{
+    asio::post(strand_, [self = ref_from_this()]{
         self->draining_ = true;
 
         if (!self->writing_
@@ -131,7 +192,7 @@ void UDPSession::drain()
 // Stop the session and callback to the orchestrator
 void UDPSession::stop()
 {
-    asio::post(strand_, [self = shared_from_this()]{
+    asio::post(strand_, [self = ref_from_this()]{
         self->close_session();
     });
 }
@@ -142,6 +203,13 @@ void UDPSession::on_connect()
     // Start the header read loop if setting is enabled.
     if (config_.read_messages)
     {
+        // Shared buffer reads must never block the shard.
+        if (config_.shared_buffers && !batched_)
+        {
+            boost::system::error_code ignored;
+            socket_.non_blocking(true, ignored);
+        }
+
         do_read();
     }
 
@@ -159,74 +227,143 @@ void UDPSession::on_connect()
 // do_read_header runs inside of a strand
 void UDPSession::do_read()
 {
+    if (batched_)
+    {
+        do_read_batch();
+        return;
+    }
+
     // Every packet_sample_rate packets, record write latency.
     if (++read_sample_counter_ >= config_.packet_sample_rate)
     {
-        read_start_time_ = std::chrono::steady_clock::now();
+        read_start_time_ = clock_.sample_now();
+    }
+
+    if (config_.shared_buffers)
+    {
+        read_ready();
+        return;
     }
 
     socket_.async_receive(
         asio::buffer(packet_buffer_),
         asio::bind_executor(strand_,
-            [self = shared_from_this()](boost::system::error_code ec, size_t count){
+            [self = ref_from_this()](boost::system::error_code ec, size_t count){
                 if (ec)
                 {
                     self->close_session();
                     return;
                 }
 
-                self->packet_size_ = count;
-                self->metrics_sink_.record_bytes_read(count);
+                self->on_datagram(count);
+        }));
+}
 
-                // Handle the server sending messages that are too big.
-                if (self->packet_size_ > self->config_.payload_size_limit)
-                {
-                    self->close_session();
-                    return;
-                }
+// Shared buffer mode, runs inside a strand.
+//
+// Receives straight into the shard's buffer without blocking, and only
+// waits for readability when nothing is queued on the socket.
+void UDPSession::read_ready()
+{
+    if (!live_)
+    {
+        return;
+    }
 
-                // If we sampled, compute the latency.
-                if (self->read_sample_counter_ > self->config_.packet_sample_rate)
-                {
-                    auto end = std::chrono::steady_clock::now();
+    packet_ptr_ = buffers_.scratch(max_datagram_);
 
-                    uint64_t latency_us = static_cast<uint64_t>(
-                            std::chrono::duration_cast
-                                <std::chrono::microseconds>
-                                    (
-                                        end - self->read_start_time_
-                                    ).count()
-                                );
+    boost::system::error_code ec;
+    size_t count = socket_.receive(asio::buffer(packet_ptr_, max_datagram_), 0, ec);
 
-                    self->metrics_sink_.record_read_latency(latency_us);
+    if (ec == asio::error::would_block || ec == asio::error::try_again)
+    {
+        socket_.async_wait(udp::socket::wait_read,
+            asio::bind_executor(strand_,
+                [self = ref_from_this()](boost::system::error_code ec){
+                    if (ec)
+                    {
+                        self->close_session();
+                        return;
+                    }
 
-                    self->read_sample_counter_ = 0;
-                }
+                    self->read_ready();
+            }));
+        return;
+    }
 
-                // Handle the packet.
-                self->handle_message();
-        }));
+    if (ec)
+    {
+        close_session();
+        return;
+    }
+
+    on_datagram(count);
+}
+
+// on_datagram runs inside a strand once a single datagram is read.
+void UDPSession::on_datagram(size_t count)
+{
+    packet_size_ = count;
+    metrics_sink_.record_bytes_read(count);
+    metrics_sink_.record_packets_read(1);
+    metrics_sink_.record_read_call();
+
+    // Handle the server sending messages that are too big.
+    if (packet_size_ > config_.payload_size_limit)
+    {
+        close_session();
+        return;
+    }
+
+    // If we sampled, compute the latency.
+    if (read_sample_counter_ > config_.packet_sample_rate)
+    {
+        auto end = clock_.sample_now();
+
+        uint64_t latency_us = static_cast<uint64_t>(
+                std::chrono::duration_cast
+                    <std::chrono::microseconds>
+                        (
+                            end - read_start_time_
+                        ).count()
+                    );
+
+        metrics_sink_.record_read_latency(latency_us);
+
+        read_sample_counter_ = 0;
+    }
+
+    // Handle the packet.
+    handle_message();
 }
 
 // TODO <feature>: allow the user to split the header and body.
 // Handles a server packet based on user set rules.
 void UDPSession::handle_message()
 {
+    message_handler_.set_current_session(session_index());
+
     // Give the message handler the packet, there is no header to pass.
     message_handler_.parse_message(
-        std::span<const uint8_t>(packet_buffer_.data(), 0),
-        std::span<const uint8_t>(packet_buffer_.data(), packet_size_),
-        [self = shared_from_this()](ResponsePacket response_packet) {
+        std::span<const uint8_t>(packet_ptr_, 0),
+        std::span<const uint8_t>(packet_ptr_, packet_size_),
+        [self = ref_from_this()](ResponsePacket response_packet) {
 
-            asio::post(self->strand_, [self, response_packet]() {
+            asio::post(self->strand_,
+                [self, response_packet = std::move(response_packet)]() mutable {
                 // Add to our responses and try to write.
-                if (response_packet.packet->size() > 0)
+                if (response_packet.size() > 0)
                 {
-                    self->responses_.push_back(response_packet);
+                    self->queue_response(std::move(response_packet));
 
                     self->try_start_write();
                 }
 
+                if (self->pause_reading())
+                {
+                    return;
+                }
+
                 self->do_read();
             });
 
@@ -234,6 +371,48 @@ void UDPSession::handle_message()
 
 }
 
+// Called from a strand, drops the response if there is no room left.
+void UDPSession::queue_response(ResponsePacket packet)
+{
+    if (responses_.full())
+    {
+        metrics_sink_.record_response_dropped();
+        return;
+    }
+
+    responses_.push_back(std::move(packet));
+
+    metrics_sink_.record_response_queued(responses_.size());
+}
+
+// Called from a strand, same policy as TCPSession::pause_reading().
+bool UDPSession::pause_reading()
+{
+    if (config_.drop_responses || !responses_.full())
+    {
+        return false;
+    }
+
+    read_paused_ = true;
+
+    metrics_sink_.record_read_pause();
+
+    return true;
+}
+
+// Called from a strand once responses have left the queue.
+void UDPSession::resume_reading()
+{
+    if (!read_paused_ || !live_)
+    {
+        return;
+    }
+
+    read_paused_ = false;
+
+    do_read();
+}
+
 // Called from a strand on send or flood or connect.
 void UDPSession::try_start_write()
 {
@@ -257,10 +436,16 @@ void UDPSession::try_start_write()
 
 void UDPSession::do_write()
 {
+    if (batched_)
+    {
+        do_write_batch();
+        return;
+    }
+
     // Send responses first, then payloads.
     if (responses_.size() > 0)
     {
-        ResponsePacket packet = responses_.front();
+        ResponsePacket packet = std::move(responses_.front());
         responses_.pop_front();
 
         writing_ = true;
@@ -268,13 +453,13 @@ void UDPSession::do_write()
         // Every packet_sample_rate packets, record write latency.
         if (++write_sample_counter_ >= config_.packet_sample_rate)
         {
-            write_start_time_ = std::chrono::steady_clock::now();
+            write_start_time_ = clock_.sample_now();
         }
 
         socket_.async_send(asio::buffer(packet.data(), packet.size()),
             asio::bind_executor(strand_,
-                [self = shared_from_this(), packet](boost::system::error_code ec,
-                                                    size_t count){
+                [self = ref_from_this(), packet](boost::system::error_code ec,
+                                                 size_t count){
                     if (ec)
                     {
                         self->close_session();;
@@ -282,11 +467,13 @@ void UDPSession::do_write()
                     }
 
                     self->metrics_sink_.record_bytes_sent(count);
+                    self->metrics_sink_.record_packets_sent(1);
+                    self->metrics_sink_.record_send_call();
 
                     // If we sampled, compute the latency.
                     if (self->write_sample_counter_ > self->config_.packet_sample_rate)
                     {
-                        auto end = std::chrono::steady_clock::now();
+                        auto end = self->clock_.sample_now();
 
                         uint64_t latency_us = static_cast<uint64_t>(
                                 std::chrono::duration_cast
@@ -306,6 +493,9 @@ void UDPSession::do_write()
 
                 }));
 
+        // The queue has room again.
+        resume_reading();
+
         return;
     }
     else
@@ -315,7 +505,9 @@ void UDPSession::do_write()
         {
             // Grab the payload from the payload manger.
             bool valid_payload = payload_manager_.fill_payload(next_payload_index_,
-                                                               current_payload_);
+                                                               current_payload_,
+                                                               &counter_leases_,
+                                                               &clock_);
 
             if (!valid_payload)
             {
@@ -343,6 +535,11 @@ void UDPSession::do_write()
                 writes_queued_--;
             }
 
+            // Handlers with a payload generator may replace it.
+            message_handler_.generate_payload(session_index(),
+                                              next_payload_index_,
+                                              current_payload_);
+
             // If we get here, we have a valid payload to write.
             next_payload_index_++;
 
@@ -351,13 +548,13 @@ void UDPSession::do_write()
             // Every packet_sample_rate packets, record write latency.
             if (++write_sample_counter_ >= config_.packet_sample_rate)
             {
-                write_start_time_ = std::chrono::steady_clock::now();
+                write_start_time_ = clock_.sample_now();
             }
 
             socket_.async_send(current_payload_.packet_slices,
             asio::bind_executor(strand_,
-                [self = shared_from_this()](boost::system::error_code ec,
-                                            size_t count){
+                [self = ref_from_this()](boost::system::error_code ec,
+                                         size_t count){
                     if (ec)
                     {
                         self->close_session();
@@ -365,11 +562,13 @@ void UDPSession::do_write()
                     }
 
                     self->metrics_sink_.record_bytes_sent(count);
+                    self->metrics_sink_.record_packets_sent(1);
+                    self->metrics_sink_.record_send_call();
 
                     // If we sampled, compute the latency.
                     if (self->write_sample_counter_ > self->config_.packet_sample_rate)
                     {
-                        auto end = std::chrono::steady_clock::now();
+                        auto end = self->clock_.sample_now();
 
                         uint64_t latency_us = static_cast<uint64_t>(
                                 std::chrono::duration_cast
@@ -404,6 +603,749 @@ void UDPSession::do_write()
     }
 }
 
+// do_read_batch runs inside of a strand
+void UDPSession::do_read_batch()
+{
+    // Hand out datagrams left over from the last recvmmsg call first.
+    if (read_batch_index_ < read_batch_count_)
+    {
+        // Handlers that batch get them all at once.
+        if (message_handler_.batches())
+        {
+            handle_batch();
+            return;
+        }
+
+        next_datagram();
+
+        // Handle the server sending messages that are too big.
+        if (packet_size_ > config_.payload_size_limit)
+        {
+            close_session();
+            return;
+        }
+
+        handle_message();
+        return;
+    }
+
+    // Every packet_sample_rate batches, record read latency.
+    if (++read_sample_counter_ >= config_.packet_sample_rate)
+    {
+        read_start_time_ = clock_.sample_now();
+    }
+
+    receive_batch();
+}
+
+// Runs inside of a strand, points packet_ptr_ at the next datagram of the
+// last recvmmsg call. Returns false once they have all been handed out.
+bool UDPSession::next_datagram()
+{
+    if (read_batch_index_ >= read_batch_count_)
+    {
+        return false;
+    }
+
+    auto & msg = read_msgs_[read_batch_index_];
+    size_t slot_length = msg.msg_len;
+
+    if (read_slot_offset_ == 0)
+    {
+        read_segment_size_ = segment_size(msg);
+    }
+
+    // Split GRO buffers back into datagrams, the last may be short.
+    packet_ptr_ = static_cast<uint8_t *>(read_iov_[read_batch_index_].iov_base)
+                  + read_slot_offset_;
+    packet_size_ = std::min(read_segment_size_,
+                            slot_length - read_slot_offset_);
+
+    read_slot_offset_ += packet_size_;
+
+    if (read_slot_offset_ >= slot_length)
+    {
+        read_batch_index_++;
+        read_slot_offset_ = 0;
+    }
+
+    return true;
+}
+
+// Runs inside of a strand, hands the datagrams left in the read batch to the
+// message handler in one call.
+void UDPSession::handle_batch()
+{
+    message_handler_.set_current_session(session_index());
+
+    // Unless we drop responses, every response in the batch must fit.
+    size_t room = config_.drop_responses
+                  ? SIZE_MAX
+                  : responses_.capacity() - responses_.size();
+
+    batch_messages_.clear();
+
+    while (batch_messages_.size() < room && next_datagram())
+    {
+        // Handle the server sending messages that are too big.
+        if (packet_size_ > config_.payload_size_limit)
+        {
+            close_session();
+            return;
+        }
+
+        // There is no header to pass.
+        batch_messages_.push_back({std::span<const uint8_t>(packet_ptr_, 0),
+                                   std::span<const uint8_t>(packet_ptr_, packet_size_)});
+    }
+
+    message_handler_.parse_batch(batch_messages_,
+        [self = ref_from_this()](std::vector<ResponsePacket> responses) {
+
+            asio::post(self->strand_,
+                [self, responses = std::move(responses)]() mutable {
+                bool queued = false;
+
+                for (ResponsePacket & response_packet : responses)
+                {
+                    if (response_packet.size() > 0)
+                    {
+                        self->queue_response(std::move(response_packet));
+                        queued = true;
+                    }
+                }
+
+                if (queued)
+                {
+                    self->try_start_write();
+                }
+
+                if (self->pause_reading())
+                {
+                    return;
+                }
+
+                self->do_read();
+            });
+
+    });
+}
+
+// receive_batch runs inside of a strand
+void UDPSession::receive_batch()
+{
+    if (!live_)
+    {
+        return;
+    }
+
+#ifdef __linux__
+    // The kernel overwrites the control length on every receive.
+    if (gro_)
+    {
+        for (auto & msg : read_msgs_)
+        {
+            msg.msg_hdr.msg_controllen = sizeof(SegmentControl);
+        }
+    }
+#endif
+
+    int received = ::recvmmsg(socket_.native_handle(),
+                              read_msgs_.data(),
+                              static_cast<unsigned int>(read_msgs_.size()),
+                              MSG_DONTWAIT,
+                              nullptr);
+
+    if (received < 0)
+    {
+        // Nothing to read yet, wait until the socket has data.
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        {
+            socket_.async_wait(udp::socket::wait_read,
+                asio::bind_executor(strand_,
+                    [self = ref_from_this()](boost::system::error_code ec){
+                        if (ec)
+                        {
+                            self->close_session();
+                            return;
+                        }
+
+                        self->receive_batch();
+                }));
+            return;
+        }
+
+        close_session();
+        return;
+    }
+
+    size_t count = 0;
+    size_t packets = 0;
+
+    for (int i = 0; i < received; i++)
+    {
+        size_t length = read_msgs_[i].msg_len;
+        size_t segment = segment_size(read_msgs_[i]);
+
+        count += length;
+        packets += (segment > 0 && length > segment)
+                   ? (length + segment - 1) / segment
+                   : 1;
+    }
+
+    metrics_sink_.record_bytes_read(count);
+    metrics_sink_.record_packets_read(packets);
+    metrics_sink_.record_read_call();
+
+    // If we sampled, compute the latency.
+    if (read_sample_counter_ > config_.packet_sample_rate)
+    {
+        auto end = clock_.sample_now();
+
+        uint64_t latency_us = static_cast<uint64_t>(
+                std::chrono::duration_cast
+                    <std::chrono::microseconds>
+                        (
+                            end - read_start_time_
+                        ).count()
+                    );
+
+        metrics_sink_.record_read_latency(latency_us);
+
+        read_sample_counter_ = 0;
+    }
+
+    read_batch_count_ = static_cast<size_t>(received);
+    read_batch_index_ = 0;
+    read_slot_offset_ = 0;
+
+    do_read_batch();
+}
+
+// Called from a strand, sends up to batch_size datagrams per call.
+void UDPSession::do_write_batch()
+{
+    if (!live_)
+    {
+        writing_ = false;
+        return;
+    }
+
+    // Finish a batch the kernel only took part of.
+    if (write_batch_sent_ < write_batch_count_)
+    {
+        send_batch();
+        return;
+    }
+
+    fill_batch();
+
+    if (gso_)
+    {
+        join_segments();
+    }
+
+    if (write_batch_count_ == 0)
+    {
+        // We stopped writing, set to false.
+        writing_ = false;
+
+        if (draining_)
+        {
+            close_session();
+        }
+
+        return;
+    }
+
+    writing_ = true;
+
+    // Every packet_sample_rate batches, record write latency.
+    if (++write_sample_counter_ >= config_.packet_sample_rate)
+    {
+        write_start_time_ = clock_.sample_now();
+    }
+
+    send_batch();
+
+    // The batch may have taken queued responses.
+    resume_reading();
+}
+
+// Fill the write batch with responses first, then payloads.
+void UDPSession::fill_batch()
+{
+    write_batch_count_ = 0;
+    write_batch_sent_ = 0;
+
+    write_iov_.clear();
+    batch_responses_.clear();
+
+    size_t payload_slot = 0;
+
+    // Only wrap once per batch so an empty payload list can't spin.
+    bool wrapped = false;
+
+    while (write_batch_count_ < write_msgs_.size())
+    {
+        auto & hdr = write_msgs_[write_batch_count_].msg_hdr;
+        hdr = {};
+
+        if (responses_.size() > 0)
+        {
+            batch_responses_.push_back(std::move(responses_.front()));
+            responses_.pop_front();
+
+            ResponsePacket & packet = batch_responses_.back();
+
+            write_iov_.push_back({const_cast<uint8_t *>(packet.data()),
+                                  packet.size()});
+            hdr.msg_iovlen = 1;
+
+            write_batch_count_++;
+            continue;
+        }
+
+        if (!flood_ && writes_queued_ == 0)
+        {
+            break;
+        }
+
+        PreparedPayload & payload = batch_payloads_[payload_slot];
+
+        bool valid_payload = payload_manager_.fill_payload(next_payload_index_,
+                                                           payload,
+                                                           &counter_leases_,
+                                                           &clock_);
+
+        if (!valid_payload)
+        {
+            if (config_.loop_payloads && !draining_ && !wrapped)
+            {
+                next_payload_index_ = 0;
+                wrapped = true;
+                continue;
+            }
+
+            // If not looping, we are done.
+            break;
+        }
+
+        // Decrement after payload is valid.
+        if (!flood_)
+        {
+            writes_queued_--;
+        }
+
+        message_handler_.generate_payload(session_index(),
+                                          next_payload_index_,
+                                          payload);
+
+        next_payload_index_++;
+        payload_slot++;
+
+        for (const auto & slice : payload.packet_slices)
+        {
+            write_iov_.push_back({const_cast<void *>(slice.data()),
+                                  slice.size()});
+        }
+
+        hdr.msg_iovlen = payload.packet_slices.size();
+
+        write_batch_count_++;
+    }
+
+    // The iovec list is stable now, point each datagram at its slices.
+    size_t iov_offset = 0;
+
+    for (size_t i = 0; i < write_batch_count_; i++)
+    {
+        auto & hdr = write_msgs_[i].msg_hdr;
+
+        hdr.msg_iov = write_iov_.data() + iov_offset;
+        iov_offset += hdr.msg_iovlen;
+    }
+}
+
+// send_batch runs inside of a strand
+void UDPSession::send_batch()
+{
+    int sent = ::sendmmsg(socket_.native_handle(),
+                          write_msgs_.data() + write_batch_sent_,
+                          static_cast<unsigned int>(write_batch_count_
+                                                    - write_batch_sent_),
+                          MSG_DONTWAIT);
+
+    if (sent < 0)
+    {
+        // Socket buffer is full, wait until we can write again.
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        {
+            socket_.async_wait(udp::socket::wait_write,
+                asio::bind_executor(strand_,
+                    [self = ref_from_this()](boost::system::error_code ec){
+                        if (ec)
+                        {
+                            self->close_session();
+                            return;
+                        }
+
+                        self->send_batch();
+                }));
+            return;
+        }
+
+        // The kernel refused a joined message, most likely because the path
+        // MTU dropped under its segment size. Send those datagrams on their own.
+        if (errno == EINVAL && split_segments())
+        {
+            send_batch();
+            return;
+        }
+
+        close_session();
+        return;
+    }
+
+    size_t count = 0;
+    size_t packets = 0;
+    size_t joined = 0;
+
+    for (int i = 0; i < sent; i++)
+    {
+        size_t segments = gso_ ? write_segments_[write_batch_sent_ + i] : 1;
+
+        count += write_msgs_[write_batch_sent_ + i].msg_len;
+        packets += segments;
+        joined += (segments > 1);
+    }
+
+    write_batch_sent_ += sent;
+
+    metrics_sink_.record_bytes_sent(count);
+    metrics_sink_.record_packets_sent(packets);
+    metrics_sink_.record_send_call();
+    metrics_sink_.record_gso_sends(joined);
+
+    // If we sampled and the whole batch is out, compute the latency.
+    if (write_batch_sent_ == write_batch_count_
+        && write_sample_counter_ > config_.packet_sample_rate)
+    {
+        auto end = clock_.sample_now();
+
+        uint64_t latency_us = static_cast<uint64_t>(
+                std::chrono::duration_cast
+                    <std::chrono::microseconds>
+                        (
+                            end - write_start_time_
+                        ).count()
+                    );
+
+        metrics_sink_.record_send_latency(latency_us);
+
+        write_sample_counter_ = 0;
+    }
+
+    // The call completed inline, post the next batch so other sessions
+    // on this shard get a turn.
+    asio::post(strand_, [self = ref_from_this()]{
+        self->do_write_batch();
+    });
+}
+
+// Called after the socket is connected, turns on the offloads the config
+// asked for. If the kernel refuses them we fall back to plain batches.
+void UDPSession::enable_offloads()
+{
+#ifdef __linux__
+    int fd = socket_.native_handle();
+
+    if (config_.udp_gso)
+    {
+        // A zero segment size leaves plain sends alone, this only
+        // checks that the kernel knows about UDP_SEGMENT.
+        int segment = 0;
+        gso_ = (::setsockopt(fd,
+                             IPPROTO_UDP,
+                             UDP_SEGMENT,
+                             &segment,
+                             sizeof(segment)) == 0);
+
+        if (gso_)
+        {
+            gso_segment_limit_ = path_segment_limit();
+            write_control_.resize(write_msgs_.size());
+        }
+    }
+
+    if (config_.udp_gro && config_.read_messages)
+    {
+        int enable = 1;
+        gro_ = (::setsockopt(fd,
+                             IPPROTO_UDP,
+                             UDP_GRO,
+                             &enable,
+                             sizeof(enable)) == 0);
+
+        if (gro_)
+        {
+            read_control_.resize(read_msgs_.size());
+
+            for (size_t i = 0; i < read_msgs_.size(); i++)
+            {
+                read_msgs_[i].msg_hdr.msg_control = read_control_[i].buffer;
+                read_msgs_[i].msg_hdr.msg_controllen = sizeof(SegmentControl);
+            }
+        }
+    }
+#endif
+}
+
+// Join runs of equally sized datagrams into one UDP_SEGMENT message each.
+// Datagrams over gso_segment_limit_ are always sent on their own.
+//
+// fill_batch() lays the slices of every datagram out back to back, so a run
+// only needs its first iovec and the summed iovec count.
+void UDPSession::join_segments()
+{
+#ifdef __linux__
+    auto datagram_size = [](const msghdr & hdr) {
+        size_t size = 0;
+
+        for (size_t i = 0; i < hdr.msg_iovlen; i++)
+        {
+            size += hdr.msg_iov[i].iov_len;
+        }
+
+        return size;
+    };
+
+    size_t messages = 0;
+    size_t i = 0;
+
+    while (i < write_batch_count_)
+    {
+        // Copy, the joined message may overwrite this slot.
+        msghdr first = write_msgs_[i].msg_hdr;
+
+        size_t segment = datagram_size(first);
+        size_t total = segment;
+        size_t iov_count = first.msg_iovlen;
+        uint16_t segments = 1;
+
+        i++;
+
+        while (segment > 0
+               && segment <= gso_segment_limit_
+               && i < write_batch_count_
+               && segments < MAX_GSO_SEGMENTS)
+        {
+            const msghdr & next = write_msgs_[i].msg_hdr;
+            size_t size = datagram_size(next);
+
+            if (size == 0
+                || size > segment
+                || total + size > MAX_GSO_BYTES
+                || iov_count + next.msg_iovlen > IOV_MAX)
+            {
+                break;
+            }
+
+            total += size;
+            iov_count += next.msg_iovlen;
+            segments++;
+            i++;
+
+            // Only the last segment may be shorter than the rest.
+            if (size < segment)
+            {
+                break;
+            }
+        }
+
+        auto & hdr = write_msgs_[messages].msg_hdr;
+        hdr = {};
+        hdr.msg_iov = first.msg_iov;
+        hdr.msg_iovlen = iov_count;
+
+        if (segments > 1)
+        {
+            auto & control = write_control_[messages];
+
+            hdr.msg_control = control.buffer;
+            hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+
+            cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+            cmsg->cmsg_level = IPPROTO_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+
+            uint16_t segment_size = static_cast<uint16_t>(segment);
+            std::memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+        }
+
+        write_segments_[messages] = segments;
+        messages++;
+    }
+
+    write_batch_count_ = messages;
+#endif
+}
+
+// Undo join_segments() for the messages not sent yet, each datagram becomes
+// its own message again. Returns false if none of them were joined.
+//
+// Also lowers the segment limit under the refused size so later batches
+// do not hit the same error.
+bool UDPSession::split_segments()
+{
+#ifdef __linux__
+    auto joined_segment = [](msghdr & hdr) {
+        uint16_t segment = 0;
+        std::memcpy(&segment, CMSG_DATA(CMSG_FIRSTHDR(&hdr)), sizeof(segment));
+
+        return static_cast<size_t>(segment);
+    };
+
+    size_t largest = 0;
+
+    for (size_t i = write_batch_sent_; i < write_batch_count_; i++)
+    {
+        if (write_segments_[i] > 1)
+        {
+            largest = std::max(largest, joined_segment(write_msgs_[i].msg_hdr));
+        }
+    }
+
+    if (largest == 0)
+    {
+        return false;
+    }
+
+    // The batch never held more datagrams than write_msgs_ has slots, so
+    // the split messages always fit back in place.
+    std::vector<mmsghdr> joined(write_msgs_.begin() + write_batch_sent_,
+                                write_msgs_.begin() + write_batch_count_);
+    std::vector<uint16_t> segments(write_segments_.begin() + write_batch_sent_,
+                                   write_segments_.begin() + write_batch_count_);
+
+    size_t messages = write_batch_sent_;
+
+    auto add_message = [&](iovec *iov, size_t iov_count) {
+        auto & msg = write_msgs_[messages];
+        msg = {};
+        msg.msg_hdr.msg_iov = iov;
+        msg.msg_hdr.msg_iovlen = iov_count;
+
+        write_segments_[messages] = 1;
+        messages++;
+    };
+
+    for (size_t i = 0; i < joined.size(); i++)
+    {
+        msghdr & hdr = joined[i].msg_hdr;
+
+        if (segments[i] <= 1)
+        {
+            add_message(hdr.msg_iov, hdr.msg_iovlen);
+            continue;
+        }
+
+        size_t segment = joined_segment(hdr);
+
+        // Datagrams were joined whole, so each one ends on an iovec boundary.
+        iovec *start = hdr.msg_iov;
+        size_t size = 0;
+
+        for (size_t k = 0; k < hdr.msg_iovlen; k++)
+        {
+            size += hdr.msg_iov[k].iov_len;
+
+            if (size >= segment || k + 1 == hdr.msg_iovlen)
+            {
+                iovec *end = hdr.msg_iov + k + 1;
+
+                add_message(start, static_cast<size_t>(end - start));
+
+                start = end;
+                size = 0;
+            }
+        }
+    }
+
+    write_batch_count_ = messages;
+
+    gso_segment_limit_ = std::min(path_segment_limit(), largest - 1);
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Largest datagram we may join, the path MTU of the connected socket less
+// the ip and UDP headers. Zero if the MTU is unknown, which stops joining.
+size_t UDPSession::path_segment_limit()
+{
+#ifdef __linux__
+    boost::system::error_code ec;
+    bool v6 = (socket_.local_endpoint(ec).protocol() == udp::v6());
+
+    if (ec)
+    {
+        return 0;
+    }
+
+    int fd = socket_.native_handle();
+    int mtu = 0;
+    socklen_t length = sizeof(mtu);
+
+    int result = v6 ? ::getsockopt(fd, IPPROTO_IPV6, IPV6_MTU, &mtu, &length)
+                    : ::getsockopt(fd, IPPROTO_IP, IP_MTU, &mtu, &length);
+
+    size_t headers = (v6 ? 40 : 20) + 8;
+
+    if (result != 0 || mtu <= static_cast<int>(headers))
+    {
+        return 0;
+    }
+
+    return static_cast<size_t>(mtu) - headers;
+#else
+    return 0;
+#endif
+}
+
+// Size of each datagram in a received message, the message length
+// unless GRO joined several datagrams.
+size_t UDPSession::segment_size(mmsghdr & msg) const
+{
+#ifdef __linux__
+    if (gro_)
+    {
+        msghdr & hdr = msg.msg_hdr;
+
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+             cmsg != nullptr;
+             cmsg = CMSG_NXTHDR(&hdr, cmsg))
+        {
+            if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO)
+            {
+                int segment = 0;
+                std::memcpy(&segment, CMSG_DATA(cmsg), sizeof(segment));
+
+                if (segment > 0)
+                {
+                    return static_cast<size_t>(segment);
+                }
+            }
+        }
+    }
+#endif
+
+    return msg.msg_len;
+}
+
 // close_session runs in a strand
 void UDPSession::close_session()
 {
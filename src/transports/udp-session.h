@@ -19,12 +19,22 @@
 #include <boost/asio.hpp>
 #include <boost/asio/ip/udp.hpp>
 
-#include <deque>
+#include <sys/socket.h>
+#include <sys/uio.h>
 
+#ifdef __linux__
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#endif
+
+
+#include "buffer-service.h"
 #include "session-config.h"
+#include "session-ref.h"
 #include "message-handler-interface.h"
 #include "payload-manager.h"
 #include "response-packet.h"
+#include "response-queue.h"
 #include "shard-metrics.h"
 
 namespace asio = boost::asio;
@@ -40,7 +50,18 @@ namespace asio = boost::asio;
 // - Payloads that are shared across session instances are read only
 // - Server packets are handled by an interface passed to the session.
 //
-class UDPSession : public std::enable_shared_from_this<UDPSession>
+// When the config asks for a batch size above 1, datagrams are moved with
+// sendmmsg/recvmmsg instead of one async operation per datagram. The socket
+// is tried first and only waited on when the kernel would block.
+//
+// On Linux, GSO mode joins runs of equally sized datagrams in a batch into
+// one message that the kernel splits with UDP_SEGMENT, and GRO mode lets the
+// kernel hand us several datagrams in one buffer which we split again.
+//
+// With shared_buffers (unbatched only), the session waits for the socket to
+// become readable and receives each datagram into the shard's scratch buffer.
+//
+class UDPSession : public SessionRefCount<UDPSession>
 {
 public:
     using udp = asio::ip::udp;
@@ -58,6 +79,11 @@ public:
     // Typical max network fragment size, without ipv4 and udp header.
     static constexpr size_t SUGGESTED_PAYLOAD_SIZE = 1500 - 20 - 8;
 
+    // Kernel limits for one UDP_SEGMENT send, the total must fit in
+    // a single IPv4 datagram.
+    static constexpr size_t MAX_GSO_SEGMENTS = 64;
+    static constexpr size_t MAX_GSO_BYTES = 65535 - 20 - 8;
+
 public:
     UDPSession(asio::io_context & cntx,
                const SessionConfig & config,
@@ -88,12 +114,46 @@ private:
 
     void do_read();
 
+    void read_ready();
+
+    void on_datagram(size_t count);
+
     void handle_message();
 
+    void queue_response(ResponsePacket packet);
+
+    bool pause_reading();
+
+    void resume_reading();
+
     void try_start_write();
 
     void do_write();
 
+    void do_read_batch();
+
+    bool next_datagram();
+
+    void handle_batch();
+
+    void receive_batch();
+
+    void do_write_batch();
+
+    void fill_batch();
+
+    void send_batch();
+
+    void enable_offloads();
+
+    void join_segments();
+
+    bool split_segments();
+
+    size_t path_segment_limit();
+
+    size_t segment_size(mmsghdr & msg) const;
+
     void close_session();
 
 public:
@@ -119,11 +179,33 @@ private:
     //
     udp::socket socket_;
 
-    // We hold the maximum expected packet size in this buffer.
+    // We hold the maximum expected packet size in this buffer, once per
+    // datagram of a read batch.
     std::vector<uint8_t> packet_buffer_;
+    uint8_t *packet_ptr_{nullptr};
     size_t packet_size_{0};
 
-    std::deque<ResponsePacket> responses_;
+    // Shard scratch space for shared buffer reads.
+    BufferService & buffers_;
+    size_t max_datagram_{0};
+
+    // Read batch, datagrams are handed to the message handler one by one
+    // unless it takes them all at once through batch_messages_.
+    std::vector<mmsghdr> read_msgs_;
+    std::vector<iovec> read_iov_;
+    size_t read_batch_count_{0};
+    size_t read_batch_index_{0};
+    std::vector<MessageView> batch_messages_;
+
+    // With GRO a read slot can hold several datagrams of segment_size_.
+    size_t read_slot_offset_{0};
+    size_t read_segment_size_{0};
+
+    // Responses waiting to be written, bounded by the config.
+    ResponseQueue responses_;
+
+    // Set while a full queue keeps us from reading, see pause_reading().
+    bool read_paused_{false};
 
     // Increasing index into the payloads that need to be sent by this session
     size_t next_payload_index_{0};
@@ -132,6 +214,41 @@ private:
     // TODO <optimization>: we would prefer to store these in a pool.
     PreparedPayload current_payload_;
 
+    // Write batch, each datagram points into a response or payload slot
+    // which must stay alive until the kernel has copied it.
+    std::vector<mmsghdr> write_msgs_;
+    std::vector<iovec> write_iov_;
+    std::vector<ResponsePacket> batch_responses_;
+    std::vector<PreparedPayload> batch_payloads_;
+    size_t write_batch_count_{0};
+    size_t write_batch_sent_{0};
+
+    // Use sendmmsg/recvmmsg instead of one async operation per datagram.
+    bool batched_{false};
+
+    // Offloads actually enabled on the socket.
+    bool gso_{false};
+    bool gro_{false};
+
+    // Each segment goes out as its own datagram and the kernel refuses
+    // segments over the path MTU, larger datagrams are never joined.
+    size_t gso_segment_limit_{0};
+
+#ifdef __linux__
+    // Control message space for a UDP_SEGMENT (u16) or UDP_GRO (int) size.
+    union SegmentControl
+    {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        cmsghdr align;
+    };
+
+    std::vector<SegmentControl> write_control_;
+    std::vector<SegmentControl> read_control_;
+#endif
+
+    // Datagrams carried by each message of the write batch.
+    std::vector<uint16_t> write_segments_;
+
     // Keep track of how many payload writes are requested if not flooding.
     size_t writes_queued_{0};
 
@@ -145,6 +262,12 @@ private:
     // Reference to the Controller's payload manager.
     const PayloadManager & payload_manager_;
 
+    // Shard's leased blocks of COUNTER values.
+    CounterLeaseService & counter_leases_;
+
+    // Shard's clock, sampled latencies may use its cached time.
+    ShardClock & clock_;
+
     // Write metrics, keep track of connection times.
     ShardMetrics & metrics_sink_;
     uint32_t write_sample_counter_{0};
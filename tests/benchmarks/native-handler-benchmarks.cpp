@@ -0,0 +1,106 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <wasmtime.hh>
+
+#include "test-helpers.h"
+
+#include "native-library.h"
+#include "native-message-handler.h"
+#include "wasm-message-handler.h"
+
+// A ping header (type 2) with an empty body.
+static const std::vector<uint8_t> PING{0x2, 0x0, 0x0, 0x0, 0x0};
+
+// Compares the sample plugin against the WASM module it was ported from.
+TEST(NativeHandlerBenchmarks, Heartbeat)
+{
+    auto library = NativeLibrary::open(NATIVE_HEARTBEAT_PLUGIN);
+
+    ASSERT_TRUE(library) << library.error();
+
+    NativeMessageHandler native_handler(*library);
+
+    auto engine = std::make_shared<wasmtime::Engine>();
+
+    std::vector<uint8_t> wasm_bytes;
+
+    try {
+        wasm_bytes = read_binary_file("tests/modules/tcp-single-session-heartbeat.wasm");
+    }
+    catch (const std::exception & error)
+    {
+        std::cerr << error.what() << "\n";
+        FAIL();
+    }
+
+    auto module_tmp = wasmtime::Module::compile(*engine, wasm_bytes);
+
+    if (!module_tmp)
+    {
+        FAIL();
+    }
+
+    auto module = std::make_shared<wasmtime::Module>(module_tmp.unwrap());
+
+    std::unique_ptr<WASMMessageHandler> wasm_handler;
+
+    try {
+        wasm_handler = std::make_unique<WASMMessageHandler>(engine, module);
+    }
+    catch (const std::exception & error)
+    {
+        std::cerr << error.what() << "\n";
+        FAIL();
+    }
+
+    constexpr size_t rounds = 100000;
+
+    auto run = [&](const MessageHandler & handler, size_t & responses){
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t round = 0; round < rounds; round++)
+        {
+            handler.parse_message(PING,
+                                  {},
+                                  [&](ResponsePacket response){
+                                      responses += response.size() == 5;
+                                  });
+        }
+
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count()
+               / static_cast<double>(rounds);
+    };
+
+    size_t native_responses = 0;
+    size_t wasm_responses = 0;
+
+    double native_time = run(native_handler, native_responses);
+    double wasm_time = run(*wasm_handler, wasm_responses);
+
+    EXPECT_EQ(native_responses, rounds);
+    EXPECT_EQ(wasm_responses, rounds);
+
+    RecordProperty("native_ns_per_message", std::to_string(native_time));
+    RecordProperty("wasm_ns_per_message", std::to_string(wasm_time));
+}
@@ -0,0 +1,135 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "payload-manager.h"
+#include "test-helpers.h"
+
+// A packet with a counter at the front and a timestamp at byte 16.
+static PayloadDescriptor make_small_payload(const std::vector<uint8_t> & packet)
+{
+    PacketOperation counter_op;
+    counter_op.make_counter(8, true);
+
+    PacketOperation head_op;
+    head_op.make_identity(8);
+
+    PacketOperation timestamp_op;
+    timestamp_op.make_timestamp(8, false, TimestampFormat::Seconds);
+
+    PacketOperation tail_op;
+    tail_op.make_identity(packet.size() - 24);
+
+    return {{packet.data(), packet.size()},
+            std::vector<PacketOperation>{counter_op, head_op, timestamp_op, tail_op}};
+}
+
+// Fill cost per packet for a small packet, rendered and gathered, and for
+// a large packet which is always gathered.
+TEST(PayloadManagerBenchmarks, Fill)
+{
+    constexpr size_t rounds = 1000000;
+
+    std::vector<uint8_t> small_packet(64, 0x1);
+    std::vector<uint8_t> large_packet(64 * 1024, 0x1);
+
+    std::vector<std::vector<uint16_t>> steps{{1}};
+
+    auto per_fill = [&](const PayloadManager & manager){
+        PreparedPayload payload;
+        size_t slices = 0;
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t round = 0; round < rounds; round++)
+        {
+            manager.fill_payload(0, payload);
+            slices += payload.packet_slices.size();
+        }
+
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        EXPECT_GT(slices, 0);
+
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()
+               / static_cast<double>(rounds);
+    };
+
+    PayloadManager rendered({make_small_payload(small_packet)}, steps);
+    PayloadManager gathered({make_small_payload(small_packet)}, steps, 0);
+    PayloadManager large({make_small_payload(large_packet)}, steps);
+
+    RecordProperty("small_rendered_ns_per_fill", std::to_string(per_fill(rendered)));
+    RecordProperty("small_gathered_ns_per_fill", std::to_string(per_fill(gathered)));
+    RecordProperty("large_gathered_ns_per_fill", std::to_string(per_fill(large)));
+}
+
+// Fill cost per packet with every shard hitting one counter, compared to
+// leasing blocks of it.
+TEST(PayloadManagerBenchmarks, CounterContention)
+{
+    constexpr size_t threads = 4;
+    constexpr size_t rounds = 250000;
+
+    std::vector<uint8_t> packet(64);
+    std::vector<std::vector<uint16_t>> steps{{1}};
+
+    auto per_fill = [&](const PayloadManager & manager){
+        std::vector<std::thread> workers;
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&](){
+                asio::io_context cntx;
+                auto & leases = asio::use_service<CounterLeaseService>(cntx);
+
+                PreparedPayload payload;
+
+                for (size_t round = 0; round < rounds; round++)
+                {
+                    manager.fill_payload(0, payload, &leases);
+                }
+            });
+        }
+
+        for (auto & worker : workers)
+        {
+            worker.join();
+        }
+
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()
+               / static_cast<double>(rounds);
+    };
+
+    PayloadManager shared({make_small_payload(packet)}, steps);
+    PayloadManager leased({make_small_payload(packet)},
+                          steps,
+                          PayloadManager::RENDER_LIMIT,
+                          1024);
+
+    RecordProperty("threads", std::to_string(threads));
+    RecordProperty("shared_ns_per_fill", std::to_string(per_fill(shared)));
+    RecordProperty("leased_ns_per_fill", std::to_string(per_fill(leased)));
+}
@@ -0,0 +1,166 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#ifdef __linux__
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "test-helpers.h"
+#include "tcp-sink-server.h"
+
+#include "session-pool.h"
+#include "payload-manager.h"
+#include "nop-message-handler.h"
+#include "all-transports.h"
+
+// Resident set size of the test process in bytes.
+static size_t resident_bytes()
+{
+    std::ifstream statm("/proc/self/statm");
+
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    statm >> total_pages >> resident_pages;
+
+    return resident_pages * static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+// Records how long CREATE takes for a large pool, how much memory the
+// sessions use and how fast a subset of them can flood.
+TEST(SessionPoolBenchmarks, CreateAndFlood)
+{
+    constexpr size_t NUM_SESSIONS = 100000;
+    constexpr size_t NUM_CONNECTED = 256;
+
+    std::vector<uint8_t> packet_1 = read_binary_file("tests/packets/test-packet-heavy.bin");
+    size_t packet_size = packet_1.size();
+
+    // Startup basic server.
+    asio::io_context server_cntx;
+    asio::ip::tcp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    TCPSinkServer server(server_cntx,
+                         server_ep,
+                         packet_size);
+
+    std::thread server_thread([&]
+    {
+        server.start();
+        server_cntx.run();
+    });
+
+    PacketOperation identity_op;
+    identity_op.make_identity(packet_size);
+
+    // Enough payloads that no session runs out during the flood.
+    std::vector<PayloadDescriptor> payloads;
+
+    for (int i = 0; i < 4096; i++)
+    {
+        payloads.push_back({{packet_1.data(), packet_1.size()},
+                           std::vector<PacketOperation>{identity_op} });
+    }
+
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    asio::io_context cntx;
+    SessionConfig config(4, 12288, false, false, 100);
+    NOPMessageHandler handler;
+    ShardMetrics metrics;
+
+    SessionPool<TCPSession> pool(cntx,
+                                 config,
+                                 metrics,
+                                 [&](){ cntx.stop(); });
+
+    using clock = std::chrono::steady_clock;
+
+    size_t rss_before = resident_bytes();
+    auto create_start = clock::now();
+
+    ASSERT_TRUE(pool.create_sessions(NUM_SESSIONS,
+                                     cntx,
+                                     config,
+                                     handler,
+                                     payload_manager,
+                                     metrics));
+
+    auto create_end = clock::now();
+    size_t rss_after = resident_bytes();
+
+    const TCPSession::Endpoints endpoints{server_ep};
+    pool.start_sessions_range(endpoints, 0, NUM_CONNECTED);
+    pool.flood_sessions_range(0, NUM_CONNECTED);
+
+    // Flood for one second, then close everything.
+    asio::steady_timer stop_timer(cntx, std::chrono::seconds(1));
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        pool.shutdown();
+    });
+
+    rusage start_usage;
+    rusage end_usage;
+
+    getrusage(RUSAGE_THREAD, &start_usage);
+    cntx.run();
+    getrusage(RUSAGE_THREAD, &end_usage);
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    double create_ms = std::chrono::duration<double, std::milli>(create_end
+                                                                 - create_start).count();
+
+    auto to_seconds = [](const timeval & tv){
+        return static_cast<double>(tv.tv_sec)
+               + static_cast<double>(tv.tv_usec) / 1e6;
+    };
+
+    double cpu_seconds = (to_seconds(end_usage.ru_utime)
+                          + to_seconds(end_usage.ru_stime))
+                         - (to_seconds(start_usage.ru_utime)
+                            + to_seconds(start_usage.ru_stime));
+
+    auto snapshot = metrics.fetch_snapshot();
+    double mib = static_cast<double>(snapshot.bytes_sent) / (1024.0 * 1024.0);
+
+    RecordProperty("sessions", std::to_string(NUM_SESSIONS));
+    RecordProperty("create_ms", std::to_string(create_ms));
+    RecordProperty("rss_bytes_per_session",
+                   std::to_string((rss_after - rss_before) / NUM_SESSIONS));
+    RecordProperty("flood_sessions", std::to_string(NUM_CONNECTED));
+    RecordProperty("flood_mib_sent", std::to_string(mib));
+    RecordProperty("flood_mib_per_cpu_second",
+                   std::to_string(cpu_seconds > 0 ? mib / cpu_seconds : 0));
+
+    EXPECT_EQ(server.lifetime_connections_, NUM_CONNECTED);
+    EXPECT_GT(snapshot.bytes_sent, 0);
+}
+
+#endif
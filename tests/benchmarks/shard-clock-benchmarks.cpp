@@ -0,0 +1,79 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+
+#include "shard-clock.h"
+
+// Cost of one latency sample read for each clock mode.
+TEST(ShardClockBenchmarks, Read)
+{
+    constexpr size_t rounds = 1000000;
+
+    asio::io_context cntx;
+    auto & clock = asio::use_service<ShardClock>(cntx);
+
+    auto per_read = [&](ClockMode mode){
+        clock.set_mode(mode);
+
+        int64_t total = 0;
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t round = 0; round < rounds; round++)
+        {
+            total += clock.steady_now().time_since_epoch().count();
+        }
+
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        EXPECT_NE(total, 0);
+
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()
+               / static_cast<double>(rounds);
+    };
+
+    auto per_cached_read = [&](){
+        clock.set_mode(ClockMode::Coarse);
+
+        int64_t total = 0;
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t round = 0; round < rounds; round++)
+        {
+            total += clock.sample_now().time_since_epoch().count();
+        }
+
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        EXPECT_NE(total, 0);
+
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()
+               / static_cast<double>(rounds);
+    };
+
+    RecordProperty("system_ns_per_read", std::to_string(per_read(ClockMode::System)));
+    RecordProperty("cached_ns_per_read", std::to_string(per_cached_read()));
+
+    if (ShardClock::tsc_available())
+    {
+        RecordProperty("tsc_ns_per_read", std::to_string(per_read(ClockMode::TSC)));
+    }
+}
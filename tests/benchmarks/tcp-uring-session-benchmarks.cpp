@@ -0,0 +1,171 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#ifdef __linux__
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <memory>
+
+#include <sys/resource.h>
+
+#include "nop-message-handler.h"
+#include "tcp-session.h"
+#include "tcp-uring-session.h"
+
+#include "tcp-sink-server.h"
+#include "test-helpers.h"
+
+// Flood loopback with NUM_SESSIONS looping sessions on a single thread for a
+// fixed window. Returns bytes sent and the CPU time the session thread used.
+template<typename Session>
+std::pair<uint64_t, double> run_flood_benchmark(const std::vector<uint8_t> & packet,
+                                                size_t num_sessions,
+                                                std::chrono::milliseconds window)
+{
+    asio::io_context server_cntx;
+    asio::ip::tcp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    TCPSinkServer server(server_cntx,
+                         server_ep,
+                         packet.size());
+
+    std::thread server_thread([&]
+    {
+        server.start();
+        server_cntx.run();
+    });
+
+    asio::io_context session_cntx;
+
+    SessionConfig config(4, 12288, false, true, 100);
+
+    NOPMessageHandler handler;
+
+    std::vector<PayloadDescriptor> payloads;
+
+    PacketOperation identity_op;
+    identity_op.make_identity(packet.size());
+
+    payloads.push_back({{packet.data(), packet.size()},
+                        std::vector<PacketOperation>{identity_op}});
+
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    std::vector<SessionRef<Session>> sessions;
+
+    size_t closed = 0;
+    typename Session::DisconnectCallback cb = [&](){
+        if (++closed == num_sessions)
+        {
+            session_cntx.stop();
+        }
+    };
+
+    ShardMetrics metrics;
+
+    asio::post(session_cntx, [&](){
+        const typename Session::Endpoints endpoints{server_ep};
+
+        for (size_t i = 0; i < num_sessions; i++)
+        {
+            sessions.push_back(make_session<Session>(session_cntx,
+                                                     config,
+                                                     handler,
+                                                     payload_manager,
+                                                     metrics,
+                                                     cb));
+            sessions.back()->start(endpoints);
+            sessions.back()->flood();
+        }
+    });
+
+    asio::steady_timer stop_timer(session_cntx, window);
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        for (auto & session : sessions)
+        {
+            session->stop();
+        }
+    });
+
+    rusage start_usage;
+    rusage end_usage;
+
+    getrusage(RUSAGE_THREAD, &start_usage);
+    session_cntx.run();
+    getrusage(RUSAGE_THREAD, &end_usage);
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    auto to_seconds = [](const timeval & tv){
+        return static_cast<double>(tv.tv_sec)
+               + static_cast<double>(tv.tv_usec) / 1e6;
+    };
+
+    double cpu_seconds = (to_seconds(end_usage.ru_utime)
+                          + to_seconds(end_usage.ru_stime))
+                         - (to_seconds(start_usage.ru_utime)
+                            + to_seconds(start_usage.ru_stime));
+
+    return {metrics.fetch_snapshot().bytes_sent, cpu_seconds};
+}
+
+TEST(TCPUringSessionBenchmarks, Flood)
+{
+    if (!IoUringService::supported())
+    {
+        GTEST_SKIP() << "io_uring is not available on this system.";
+    }
+
+    std::vector<uint8_t> packet = read_binary_file("tests/packets/test-packet-heavy.bin");
+
+    size_t NUM_SESSIONS = 256;
+    auto WINDOW = std::chrono::milliseconds(2000);
+
+    auto [asio_bytes, asio_cpu] = run_flood_benchmark<TCPSession>(packet,
+                                                                  NUM_SESSIONS,
+                                                                  WINDOW);
+
+    auto [uring_bytes, uring_cpu] = run_flood_benchmark<TCPUringSession>(packet,
+                                                                         NUM_SESSIONS,
+                                                                         WINDOW);
+
+    auto report = [](const std::string & name, uint64_t bytes, double cpu){
+        double mib = static_cast<double>(bytes) / (1024.0 * 1024.0);
+
+        ::testing::Test::RecordProperty(name + "_mib_sent", std::to_string(mib));
+        ::testing::Test::RecordProperty(name + "_cpu_seconds", std::to_string(cpu));
+        ::testing::Test::RecordProperty(name + "_mib_per_cpu_second",
+                                        std::to_string(cpu > 0 ? mib / cpu : 0));
+    };
+
+    report("tcp", asio_bytes, asio_cpu);
+    report("tcp_uring", uring_bytes, uring_cpu);
+
+    EXPECT_GT(asio_bytes, 0);
+    EXPECT_GT(uring_bytes, 0);
+}
+
+#endif
@@ -0,0 +1,131 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "test-helpers.h"
+
+#include "payload-structs.h"
+#include "wasm-message-handler.h"
+
+// Compares handle_body per message against one handle_batch per read on the
+// same module, which fills every message with 0x55 and answers in place.
+TEST(WASMHandlerBenchmarks, BatchAgainstBody)
+{
+    wasmtime::Config WASM_config;
+    auto engine = std::make_shared<wasmtime::Engine>(std::move(WASM_config));
+
+    std::vector<uint8_t> wasm_bytes;
+
+    try {
+        wasm_bytes = read_binary_file("tests/modules/tcp-batch-parsing.wasm");
+    }
+    catch (const std::exception & error)
+    {
+        std::cerr << error.what() << "\n";
+        FAIL();
+    }
+
+    auto module_tmp = wasmtime::Module::compile(*engine, wasm_bytes);
+
+    if (!module_tmp)
+    {
+        FAIL();
+    }
+
+    auto module = std::make_shared<wasmtime::Module>(module_tmp.unwrap());
+
+    std::unique_ptr<WASMMessageHandler> handler;
+
+    try {
+        handler = std::make_unique<WASMMessageHandler>(engine, module);
+    }
+    catch (const std::exception & error)
+    {
+        std::cerr << error.what() << "\n";
+        FAIL();
+    }
+
+    ASSERT_TRUE(handler->batches());
+
+    // About what a 4 KiB read of small messages carries.
+    constexpr size_t batch_size = 64;
+    constexpr size_t rounds = 2000;
+
+    std::vector<uint8_t> frame(64, 0x1);
+    std::span<const uint8_t> frame_bytes(frame);
+
+    std::vector<MessageView> messages(batch_size,
+                                      {frame_bytes.first(4), frame_bytes.subspan(4)});
+
+    auto is_filled = [&](const ResponsePacket & response){
+        return response.size() == frame.size()
+               && std::all_of(response.data(),
+                              response.data() + response.size(),
+                              [](uint8_t byte){ return byte == 0x55; });
+    };
+
+    size_t single_responses = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t round = 0; round < rounds; round++)
+    {
+        for (const MessageView & message : messages)
+        {
+            handler->parse_message(message.header,
+                                   message.body,
+                                   [&](ResponsePacket response){
+                                       single_responses += is_filled(response);
+                                   });
+        }
+    }
+
+    auto single_time = std::chrono::steady_clock::now() - start;
+
+    size_t batch_responses = 0;
+
+    start = std::chrono::steady_clock::now();
+
+    for (size_t round = 0; round < rounds; round++)
+    {
+        handler->parse_batch(messages,
+                             [&](std::vector<ResponsePacket> responses){
+                                 for (const ResponsePacket & response : responses)
+                                 {
+                                     batch_responses += is_filled(response);
+                                 }
+                             });
+    }
+
+    auto batch_time = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(single_responses, rounds * batch_size);
+    EXPECT_EQ(batch_responses, rounds * batch_size);
+
+    auto per_message = [&](auto elapsed){
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()
+               / static_cast<double>(rounds * batch_size);
+    };
+
+    RecordProperty("handle_body_ns_per_message", std::to_string(per_message(single_time)));
+    RecordProperty("handle_batch_ns_per_message", std::to_string(per_message(batch_time)));
+}
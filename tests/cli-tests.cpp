@@ -19,6 +19,13 @@
 #include "test-helpers.h"
 #include "test-fixtures.h"
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+
+#include <unistd.h>
+
 TEST(CLITests, ValidTCPPlanGeneration)
 {
     DSLData correct_data = get_simple_valid_script_data();
@@ -53,3 +60,69 @@ TEST(CLITests, ValidTCPPlanGeneration)
         FAIL() << issues_str;
     }
 }
+
+// A packet directory is one payload per file in name order, mapped read only.
+TEST(CLITests, MappedPacketDirectory)
+{
+    auto packet_dir = std::filesystem::temp_directory_path()
+                      / ("loadshear-packets-test-" + std::to_string(::getpid()));
+
+    std::filesystem::remove_all(packet_dir);
+    std::filesystem::create_directories(packet_dir);
+
+    const std::vector<uint8_t> first(12, 0xAA);
+    const std::vector<uint8_t> second(16, 0xBB);
+
+    {
+        std::ofstream out(packet_dir / "b.bin", std::ios::binary);
+        out.write(reinterpret_cast<const char*>(second.data()), second.size());
+    }
+    {
+        std::ofstream out(packet_dir / "a.bin", std::ios::binary);
+        out.write(reinterpret_cast<const char*>(first.data()), first.size());
+    }
+
+    DSLData data = get_simple_valid_script_data();
+
+    data.settings.mmap = "ON";
+    data.settings.packet_identifiers["p1"] = packet_dir.string();
+
+    std::pmr::monotonic_buffer_resource arena(8 * 1024 * 1024,
+                                              std::pmr::get_default_resource());
+
+    auto plan = generate_execution_plan<TCPSession>(data, &arena);
+
+    std::filesystem::remove_all(packet_dir);
+
+    ASSERT_TRUE(plan.has_value()) << plan.error();
+
+    // Both p1 SENDs expand to the two files, the heavy packet stays single.
+    ASSERT_FALSE(plan->send_payloads.empty());
+    EXPECT_EQ(plan->send_payloads[0], 2u);
+    EXPECT_EQ(plan->payloads.size(),
+              std::accumulate(plan->send_payloads.begin(),
+                              plan->send_payloads.end(),
+                              size_t{0}));
+
+    const auto & a_payload = plan->payloads[0];
+    const auto & b_payload = plan->payloads[1];
+
+    EXPECT_TRUE(std::ranges::equal(a_payload.packet_data, first));
+    EXPECT_TRUE(std::ranges::equal(b_payload.packet_data, second));
+    EXPECT_EQ(a_payload.copies, 5u);
+    EXPECT_EQ(b_payload.copies, 5u);
+
+    // Every mapped packet is backed by a mapping, not the arena.
+    EXPECT_EQ(plan->packet_mappings.size(), 3u);
+    EXPECT_TRUE(plan->packet_data.empty());
+
+    // Sessions walk each file COPIES times, so the SEND covers both.
+    for (const auto & action : plan->actions)
+    {
+        if (action.type == ActionType::SEND)
+        {
+            EXPECT_EQ(action.count, 10u);
+            break;
+        }
+    }
+}
@@ -157,6 +157,87 @@ TEST(ShardMetrics, RecordLatencies)
     }
 }
 
+TEST(ShardMetrics, RecordHandlerTimes)
+{
+    ShardMetrics metrics;
+
+    // Bucket 0 is everything under 1us.
+    metrics.record_handler_time(0);
+    metrics.record_handler_time(999);
+
+    // Bucket 1
+    metrics.record_handler_time(1000);
+    metrics.record_handler_time(1999);
+
+    // Bucket 2
+    metrics.record_handler_time(2000);
+
+    // Bucket 10 holds 512us to 1ms.
+    metrics.record_handler_time(512000);
+    metrics.record_handler_time(1023999);
+
+    // Bucket 15 holds everything from ~16ms.
+    metrics.record_handler_time(16384000);
+    metrics.record_handler_time(5000000000);
+
+    metrics.record_handler_trap();
+    metrics.record_handler_timeout();
+    metrics.record_handler_timeout();
+
+    std::array<uint64_t, 16> bucket_values = {2, 2, 1, 0, 0, 0, 0, 0,
+                                              0, 0, 2, 0, 0, 0, 0, 2};
+
+    auto snapshot = metrics.fetch_snapshot();
+
+    EXPECT_EQ(snapshot.handler_time_buckets, bucket_values);
+    EXPECT_EQ(snapshot.handler_traps, 1u);
+    EXPECT_EQ(snapshot.handler_timeouts, 2u);
+}
+
+TEST(ShardMetrics, MoveHandlerMetrics)
+{
+    // A HANDLERTHREADS worker records into its own metrics.
+    ShardMetrics worker;
+
+    worker.record_handler_time(1000);
+    worker.record_handler_time(2000);
+    worker.record_handler_trap();
+    worker.record_handler_timeout();
+
+    HandlerMetrics taken = worker.take_handler_metrics();
+
+    EXPECT_EQ(taken.traps, 1u);
+    EXPECT_EQ(taken.timeouts, 1u);
+    EXPECT_EQ(taken.time_buckets[1], 1u);
+    EXPECT_EQ(taken.time_buckets[2], 1u);
+
+    // Taking leaves nothing behind for the next job.
+    auto worker_snapshot = worker.fetch_snapshot();
+
+    EXPECT_EQ(worker_snapshot.handler_traps, 0u);
+    EXPECT_EQ(worker_snapshot.handler_timeouts, 0u);
+    EXPECT_EQ(worker_snapshot.handler_time_buckets, (std::array<uint64_t, 16>{}));
+
+    // The shard adds them to its own, along with the queue metrics.
+    ShardMetrics shard;
+
+    shard.record_handler_time(1000);
+    shard.add_handler_metrics(taken);
+    shard.record_handler_queued(3);
+    shard.record_handler_queued(1);
+    shard.record_handler_wait(500);
+
+    auto snapshot = shard.fetch_snapshot();
+
+    EXPECT_EQ(snapshot.handler_traps, 1u);
+    EXPECT_EQ(snapshot.handler_timeouts, 1u);
+    EXPECT_EQ(snapshot.handler_time_buckets[1], 2u);
+    EXPECT_EQ(snapshot.handler_time_buckets[2], 1u);
+    EXPECT_EQ(snapshot.handler_jobs, 2u);
+    EXPECT_EQ(snapshot.handler_queue_peak, 3u);
+    EXPECT_EQ(snapshot.handler_wait_buckets[0], 1u);
+}
+
 TEST(ShardMetrics, RecordBytesTransmitted)
 {
     // Create a simple server that sends packets.
@@ -232,7 +313,7 @@ TEST(ShardMetrics, RecordBytesTransmitted)
     PayloadManager payload_manager(payloads, steps);
 
     std::shared_ptr<WASMMessageHandler> handler_ptr;
-    std::shared_ptr<TCPSession> session_ptr;
+    SessionRef<TCPSession> session_ptr;
 
     TCPSession::DisconnectCallback cb = [&](){
         session_cntx.stop();
@@ -268,12 +349,12 @@ TEST(ShardMetrics, RecordBytesTransmitted)
             return {size, HeaderResult::Status::OK};
         });
 
-        session_ptr = make_shared<TCPSession>(session_cntx,
-                                              config,
-                                              *handler_ptr,
-                                              payload_manager,
-                                              metrics,
-                                              cb);
+        session_ptr = make_session<TCPSession>(session_cntx,
+                                               config,
+                                               *handler_ptr,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
 
         const TCPSession::Endpoints endpoints{
                 TCPSession::tcp::endpoint(
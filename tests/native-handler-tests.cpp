@@ -0,0 +1,69 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include <gtest/gtest.h>
+
+#include "test-helpers.h"
+
+#include "native-library.h"
+#include "native-message-handler.h"
+
+// A ping header (type 2) with an empty body.
+static const std::vector<uint8_t> PING{0x2, 0x0, 0x0, 0x0, 0x0};
+
+TEST(NativeHandlerTests, MissingPlugin)
+{
+    auto library = NativeLibrary::open("tests/modules/does-not-exist.so");
+
+    EXPECT_FALSE(library);
+}
+
+TEST(NativeHandlerTests, Heartbeat)
+{
+    auto library = NativeLibrary::open(NATIVE_HEARTBEAT_PLUGIN);
+
+    ASSERT_TRUE(library) << library.error();
+
+    NativeMessageHandler handler(*library);
+
+    std::vector<uint8_t> header{0x4, 0x3, 0x0, 0x0, 0x0};
+
+    auto result = handler.parse_header(header);
+
+    EXPECT_EQ(result.status, HeaderResult::Status::OK);
+    EXPECT_EQ(result.length, 3u);
+
+    // Anything but a ping gets no response.
+    size_t responses = 0;
+
+    handler.parse_message(header,
+                          std::span<const uint8_t>(header).first(3),
+                          [&](ResponsePacket response){
+                              responses += response.size() > 0;
+                          });
+
+    EXPECT_EQ(responses, 0u);
+
+    handler.parse_message(PING,
+                          {},
+                          [&](ResponsePacket response){
+                              ASSERT_EQ(response.size(), 5u);
+                              EXPECT_EQ(response.data()[0], 0x3);
+                              responses += 1;
+                          });
+
+    EXPECT_EQ(responses, 1u);
+}
@@ -16,10 +16,18 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <thread>
+#include <unordered_set>
+
+#include <fcntl.h>
 
 #include "payload-manager.h"
+#include "packet-pool.h"
 #include "test-helpers.h"
 
 TEST(PayloadManagerTests, CheckPayloadBytes)
@@ -233,3 +241,474 @@ TEST(PayloadManagerTests, MultiCounterPayloads)
     }
 
 }
+
+TEST(PayloadManagerTests, FileBackedPayloads)
+{
+    std::string packet_path = "tests/packets/test-packet-1.bin";
+    size_t packet_size = std::filesystem::file_size(packet_path);
+
+    int fd = ::open(packet_path.c_str(), O_RDONLY | O_CLOEXEC);
+    ASSERT_GE(fd, 0) << "Failed to open " << packet_path;
+
+    PacketFile file(fd, packet_size);
+
+    std::vector<PayloadDescriptor> payloads;
+
+    // Counter at the front, the rest comes from the file.
+    {
+        PacketOperation counter_op;
+        counter_op.make_counter(4, false);
+
+        PacketOperation identity_op;
+        identity_op.make_identity(packet_size - 4);
+
+        PayloadDescriptor payload;
+        payload.ops = {counter_op, identity_op};
+        payload.file = &file;
+
+        payloads.push_back(payload);
+    }
+
+    // Counter in the middle of the file.
+    {
+        PacketOperation head_op;
+        head_op.make_identity(3);
+
+        PacketOperation counter_op;
+        counter_op.make_counter(2, true);
+
+        PacketOperation tail_op;
+        tail_op.make_identity(packet_size - 5);
+
+        PayloadDescriptor payload;
+        payload.ops = {head_op, counter_op, tail_op};
+        payload.file = &file;
+
+        payloads.push_back(payload);
+    }
+
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    PreparedPayload prepared;
+
+    ASSERT_TRUE(payload_manager.fill_payload(0, prepared));
+
+    // Only the counter is in memory, the file follows it.
+    ASSERT_EQ(prepared.packet_slices.size(), 1);
+    EXPECT_EQ(prepared.packet_slices[0].size(), 4);
+
+    ASSERT_EQ(prepared.file_slices.size(), 1);
+    EXPECT_EQ(prepared.file_slices[0].fd, fd);
+    EXPECT_EQ(prepared.file_slices[0].offset, 4);
+    EXPECT_EQ(prepared.file_slices[0].length, packet_size - 4);
+    EXPECT_EQ(prepared.file_slices[0].slice_index, 1);
+
+    ASSERT_TRUE(payload_manager.fill_payload(1, prepared));
+
+    // File range, then the counter, then the rest of the file.
+    ASSERT_EQ(prepared.packet_slices.size(), 1);
+    EXPECT_EQ(prepared.packet_slices[0].size(), 2);
+
+    ASSERT_EQ(prepared.file_slices.size(), 2);
+    EXPECT_EQ(prepared.file_slices[0].offset, 0);
+    EXPECT_EQ(prepared.file_slices[0].length, 3);
+    EXPECT_EQ(prepared.file_slices[0].slice_index, 0);
+    EXPECT_EQ(prepared.file_slices[1].offset, 5);
+    EXPECT_EQ(prepared.file_slices[1].length, packet_size - 5);
+    EXPECT_EQ(prepared.file_slices[1].slice_index, 1);
+}
+
+TEST(PayloadManagerTests, LargeFileRangesStaySplit)
+{
+    // Never read, the file slices only carry the descriptor.
+    PacketFile file(-1, static_cast<uint64_t>(PacketOperation::MAX_LENGTH) + 2);
+
+    PacketOperation head_op;
+    head_op.make_identity(PacketOperation::MAX_LENGTH);
+
+    PacketOperation tail_op;
+    tail_op.make_identity(2);
+
+    PayloadDescriptor payload;
+    payload.ops = {head_op, tail_op};
+    payload.file = &file;
+
+    std::vector<std::vector<uint16_t>> steps(1);
+    PayloadManager payload_manager({payload}, steps);
+
+    PreparedPayload prepared;
+
+    ASSERT_TRUE(payload_manager.fill_payload(0, prepared));
+
+    // Joining both ranges would overflow the step length.
+    EXPECT_EQ(prepared.packet_slices.size(), 0);
+
+    ASSERT_EQ(prepared.file_slices.size(), 2);
+    EXPECT_EQ(prepared.file_slices[0].offset, 0);
+    EXPECT_EQ(prepared.file_slices[0].length, PacketOperation::MAX_LENGTH);
+    EXPECT_EQ(prepared.file_slices[1].offset, PacketOperation::MAX_LENGTH);
+    EXPECT_EQ(prepared.file_slices[1].length, 2);
+}
+
+// A 64 byte packet with a counter at the front and a timestamp in the middle.
+static PayloadDescriptor make_small_payload(const std::vector<uint8_t> & packet)
+{
+    PacketOperation counter_op;
+    counter_op.make_counter(8, true);
+
+    PacketOperation head_op;
+    head_op.make_identity(8);
+
+    PacketOperation timestamp_op;
+    timestamp_op.make_timestamp(8, false, TimestampFormat::Seconds);
+
+    PacketOperation tail_op;
+    tail_op.make_identity(packet.size() - 24);
+
+    return {{packet.data(), packet.size()},
+            std::vector<PacketOperation>{counter_op, head_op, timestamp_op, tail_op}};
+}
+
+TEST(PayloadManagerTests, SmallPayloadsAreRendered)
+{
+    std::vector<uint8_t> packet(64);
+
+    for (size_t i = 0; i < packet.size(); i++)
+    {
+        packet[i] = static_cast<uint8_t>(i);
+    }
+
+    std::vector<std::vector<uint16_t>> steps{{3}};
+
+    PayloadManager rendered({make_small_payload(packet)}, steps);
+    PayloadManager gathered({make_small_payload(packet)}, steps, 0);
+
+    PreparedPayload rendered_payload;
+    PreparedPayload gathered_payload;
+
+    for (int i = 0; i < 3; i++)
+    {
+        ASSERT_TRUE(rendered.fill_payload(0, rendered_payload));
+        ASSERT_TRUE(gathered.fill_payload(0, gathered_payload));
+
+        // Counter, static range, timestamp and the rest of the packet.
+        EXPECT_EQ(rendered_payload.packet_slices.size(), 1);
+        EXPECT_EQ(gathered_payload.packet_slices.size(), 4);
+
+        auto rendered_bytes = slices_to_vector(rendered_payload.packet_slices);
+        auto gathered_bytes = slices_to_vector(gathered_payload.packet_slices);
+
+        ASSERT_EQ(rendered_bytes.size(), packet.size());
+        EXPECT_EQ(rendered_bytes[0], 3 * i);
+
+        // The two fills may land in different seconds, skip the timestamp.
+        std::fill_n(rendered_bytes.begin() + 16, 8, 0);
+        std::fill_n(gathered_bytes.begin() + 16, 8, 0);
+
+        EXPECT_VECTOR_EQ(rendered_bytes, gathered_bytes);
+    }
+
+    // The packet data itself is never written to.
+    EXPECT_EQ(packet[0], 0);
+    EXPECT_EQ(packet[16], 16);
+}
+
+// Read the little endian value at the front of a payload.
+static uint64_t read_front(const PreparedPayload & payload)
+{
+    auto bytes = slices_to_vector(payload.packet_slices);
+
+    uint64_t value = 0;
+    std::memcpy(&value, bytes.data(), sizeof(value));
+
+    return value;
+}
+
+TEST(PayloadManagerTests, LeasedCountersAreUnique)
+{
+    constexpr size_t threads = 4;
+    constexpr size_t fills = 1000;
+    constexpr uint32_t block = 16;
+
+    std::vector<uint8_t> packet(64);
+    std::vector<std::vector<uint16_t>> steps{{3}};
+
+    PayloadManager manager({make_small_payload(packet)},
+                           steps,
+                           PayloadManager::RENDER_LIMIT,
+                           block);
+
+    // Each thread stands in for a shard with its own lease service.
+    std::vector<std::vector<uint64_t>> values(threads);
+    std::vector<std::thread> workers;
+
+    for (size_t t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&, t](){
+            asio::io_context cntx;
+            auto & leases = asio::use_service<CounterLeaseService>(cntx);
+
+            PreparedPayload payload;
+
+            for (size_t i = 0; i < fills; i++)
+            {
+                manager.fill_payload(0, payload, &leases);
+                values[t].push_back(read_front(payload));
+            }
+        });
+    }
+
+    for (auto & worker : workers)
+    {
+        worker.join();
+    }
+
+    std::unordered_set<uint64_t> seen;
+
+    for (const auto & shard_values : values)
+    {
+        ASSERT_EQ(shard_values.size(), fills);
+
+        for (size_t i = 0; i < shard_values.size(); i++)
+        {
+            EXPECT_EQ(shard_values[i] % 3, 0);
+
+            // Increasing within a shard, but not across them.
+            if (i > 0)
+            {
+                EXPECT_GT(shard_values[i], shard_values[i - 1]);
+            }
+
+            EXPECT_TRUE(seen.insert(shard_values[i]).second);
+        }
+    }
+
+    // Nothing past the last block anyone leased.
+    uint64_t leased = (threads * fills + threads * block) * 3;
+
+    EXPECT_LT(*std::max_element(seen.begin(), seen.end()), leased);
+
+    // Without a lease service values come straight from the shared counter.
+    PreparedPayload payload;
+
+    uint64_t shared = 0;
+
+    for (int i = 0; i < 3; i++)
+    {
+        manager.fill_payload(0, payload);
+        uint64_t value = read_front(payload);
+
+        EXPECT_FALSE(seen.contains(value));
+
+        if (i > 0)
+        {
+            EXPECT_EQ(value, shared + 3);
+        }
+
+        shared = value;
+    }
+}
+
+// An 8 byte little endian timestamp and nothing else.
+static PayloadDescriptor make_timestamp_payload(const std::vector<uint8_t> & packet,
+                                                TimestampFormat format)
+{
+    PacketOperation timestamp_op;
+    timestamp_op.make_timestamp(8, true, format);
+
+    return {{packet.data(), packet.size()},
+            std::vector<PacketOperation>{timestamp_op}};
+}
+
+TEST(PayloadManagerTests, CoarseTimestampsAreCached)
+{
+    std::vector<uint8_t> packet(8);
+
+    PayloadManager manager({make_timestamp_payload(packet, TimestampFormat::Milliseconds),
+                            make_timestamp_payload(packet, TimestampFormat::Nanoseconds)},
+                           {{}, {}});
+
+    asio::io_context cntx;
+    auto & clock = asio::use_service<ShardClock>(cntx);
+
+    clock.set_mode(ClockMode::Coarse);
+
+    PreparedPayload payload;
+
+    auto fill = [&](size_t index){
+        manager.fill_payload(index, payload, nullptr, &clock);
+        return read_front(payload);
+    };
+
+    uint64_t coarse = fill(0);
+    uint64_t precise = fill(1);
+
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    uint64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+
+    EXPECT_LE(coarse, now_ms);
+    EXPECT_GE(coarse + 1000, now_ms);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    // Milliseconds come from the cached time until the next iteration,
+    // nanoseconds are always read.
+    EXPECT_EQ(fill(0), coarse);
+    EXPECT_GT(fill(1), precise);
+
+    clock.tick();
+
+    EXPECT_GT(fill(0), coarse);
+}
+
+TEST(PayloadManagerTests, CopiesShareOneDescriptor)
+{
+    constexpr uint64_t copies = 1000000;
+
+    std::vector<uint8_t> first(64, 0x1);
+    std::vector<uint8_t> second(64, 0x2);
+
+    PayloadDescriptor repeated = make_small_payload(first);
+    repeated.copies = copies;
+
+    // A SEND with no COPIES left covers no indices at all.
+    PayloadDescriptor empty = make_small_payload(first);
+    empty.copies = 0;
+
+    PayloadManager manager({repeated, empty, make_small_payload(second)},
+                           {{2}, {2}, {1}});
+
+    PreparedPayload payload;
+
+    // Every copy shares the counter of its SEND.
+    ASSERT_TRUE(manager.fill_payload(0, payload));
+    EXPECT_EQ(read_front(payload), 0);
+
+    ASSERT_TRUE(manager.fill_payload(copies / 2, payload));
+    EXPECT_EQ(read_front(payload), 2);
+
+    ASSERT_TRUE(manager.fill_payload(copies - 1, payload));
+    EXPECT_EQ(read_front(payload), 4);
+    EXPECT_EQ(slices_to_vector(payload.packet_slices)[8], 0x1);
+
+    ASSERT_TRUE(manager.fill_payload(copies, payload));
+    EXPECT_EQ(read_front(payload), 0);
+    EXPECT_EQ(slices_to_vector(payload.packet_slices)[8], 0x2);
+
+    EXPECT_FALSE(manager.fill_payload(copies + 1, payload));
+}
+
+TEST(ShardClockTests, TSCTracksSystemClock)
+{
+    if (!ShardClock::tsc_available())
+    {
+        GTEST_SKIP() << "No invariant TSC";
+    }
+
+    asio::io_context cntx;
+    auto & clock = asio::use_service<ShardClock>(cntx);
+
+    clock.set_mode(ClockMode::TSC);
+
+    ASSERT_EQ(clock.mode(), ClockMode::TSC);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    auto steady_drift = clock.steady_now() - std::chrono::steady_clock::now();
+    auto system_drift = clock.system_now()
+                        - std::chrono::system_clock::now().time_since_epoch();
+
+    EXPECT_LT(std::chrono::abs(steady_drift), std::chrono::milliseconds(1));
+    EXPECT_LT(std::chrono::abs(system_drift), std::chrono::milliseconds(1));
+}
+
+TEST(PacketPoolTests, ReusesReleasedBuffers)
+{
+    PacketPool::Owner pool = PacketPool::create();
+
+    std::vector<uint8_t> bytes{ 0x1, 0x2, 0x3, 0x4 };
+
+    // Empty responses never touch the pool.
+    ResponsePacket empty = pool->copy({});
+
+    EXPECT_EQ(empty.size(), 0);
+    EXPECT_EQ(empty.data(), nullptr);
+
+    ResponsePacket first = pool->copy(bytes);
+
+    ASSERT_EQ(first.size(), bytes.size());
+    EXPECT_TRUE(std::equal(bytes.begin(), bytes.end(), first.data()));
+
+    // Copies share the buffer, it is only recycled after the last one.
+    ResponsePacket shared = first;
+    const uint8_t *first_data = first.data();
+
+    first.reset();
+
+    ResponsePacket second = pool->copy(bytes);
+
+    EXPECT_NE(second.data(), first_data);
+    EXPECT_EQ(shared.data(), first_data);
+
+    shared.reset();
+
+    // A smaller response fits in the recycled buffer.
+    ResponsePacket third = pool->copy(std::span<const uint8_t>(bytes.data(), 2));
+
+    EXPECT_EQ(third.data(), first_data);
+    EXPECT_EQ(third.size(), 2);
+
+    // Packets may outlive the handler that made them.
+    pool.reset();
+
+    EXPECT_EQ(second.size(), bytes.size());
+    EXPECT_TRUE(std::equal(bytes.begin(), bytes.end(), second.data()));
+}
+
+TEST(PacketPoolTests, ReturnsLentBytes)
+{
+    std::vector<std::span<const uint8_t>> returned;
+
+    PacketPool::Owner pool = PacketPool::create([&](std::span<const uint8_t> bytes){
+        returned.push_back(bytes);
+    });
+
+    std::vector<uint8_t> bytes{ 0x1, 0x2, 0x3, 0x4 };
+
+    ResponsePacket lent = pool->lend(bytes);
+
+    // No copy is made, the packet points at the owner's bytes.
+    EXPECT_EQ(lent.data(), bytes.data());
+    EXPECT_EQ(lent.size(), bytes.size());
+
+    ResponsePacket shared = lent;
+
+    lent.reset();
+
+    EXPECT_TRUE(returned.empty());
+
+    shared.reset();
+
+    ASSERT_EQ(returned.size(), 1);
+    EXPECT_EQ(returned[0].data(), bytes.data());
+    EXPECT_EQ(returned[0].size(), bytes.size());
+
+    // A recycled buffer holds copies again.
+    ResponsePacket copied = pool->copy(bytes);
+
+    EXPECT_NE(copied.data(), bytes.data());
+    EXPECT_TRUE(std::equal(bytes.begin(), bytes.end(), copied.data()));
+
+    copied.reset();
+
+    EXPECT_EQ(returned.size(), 1);
+
+    // Once the owner lets go its memory is gone, nothing is returned.
+    ResponsePacket late = pool->lend(bytes);
+
+    pool.reset();
+    late.reset();
+
+    EXPECT_EQ(returned.size(), 1);
+}
@@ -0,0 +1,130 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "message-handler-interface.h"
+#include "packet-pool.h"
+
+// Message handler for tests that don't need a WASM module.
+//
+// Headers are a 4 byte big endian body length. Every body is compared
+// against the expected body and answered with reply (nothing by default).
+//
+// With reserve_, large messages are read into the handler's own memory.
+// With batch_, the messages of one read are handled together.
+class RecordingMessageHandler : public MessageHandler
+{
+public:
+    explicit RecordingMessageHandler(std::vector<uint8_t> expected_body,
+                                     std::vector<uint8_t> reply = {})
+    :expected_body_(std::move(expected_body)),
+    reply_(std::move(reply)),
+    packets_(PacketPool::create())
+    {
+    }
+
+    void parse_message(std::span<const uint8_t> header,
+                       std::span<const uint8_t> body,
+                       std::function<void(ResponsePacket)> callback) const override
+    {
+        messages_ += 1;
+
+        if (!std::ranges::equal(body, expected_body_))
+        {
+            mismatched_ += 1;
+        }
+
+        callback(packets_->copy(reply_));
+    }
+
+    // Only hands out space with reserve_, one message at a time.
+    std::span<uint8_t> reserve_message(size_t length) const override
+    {
+        if (!reserve_)
+        {
+            return {};
+        }
+
+        reservation_.resize(length);
+
+        return reservation_;
+    }
+
+    void parse_reserved(std::span<uint8_t> message,
+                        std::function<void(ResponsePacket)> callback) const override
+    {
+        reserved_ += 1;
+
+        // Skip the header, the body must have been read in place.
+        parse_message(message.first(4), message.subspan(4), std::move(callback));
+    }
+
+    void release_reserved(std::span<uint8_t> message) const override
+    {
+        released_ += 1;
+    }
+
+    bool batches() const override
+    {
+        return batch_;
+    }
+
+    void parse_batch(std::span<const MessageView> messages,
+                     std::function<void(std::vector<ResponsePacket>)> callback) const override
+    {
+        batches_ += 1;
+
+        MessageHandler::parse_batch(messages, std::move(callback));
+    }
+
+    HeaderResult parse_header(std::span<const uint8_t> buffer) const override
+    {
+        size_t size = 0;
+
+        for (size_t i = 0; i < 4 && i < buffer.size(); i++)
+        {
+            size <<= 8;
+            size |= buffer[i];
+        }
+
+        return {size, HeaderResult::Status::OK};
+    }
+
+public:
+    std::vector<uint8_t> expected_body_;
+    std::vector<uint8_t> reply_;
+    PacketPool::Owner packets_;
+
+    mutable size_t messages_{0};
+    mutable size_t mismatched_{0};
+
+    // Read messages into our own memory, see reserve_message.
+    bool reserve_{false};
+    mutable std::vector<uint8_t> reservation_;
+    mutable size_t reserved_{0};
+    mutable size_t released_{0};
+
+    // Take every message of a read at once, see parse_batch.
+    bool batch_{false};
+    mutable size_t batches_{0};
+};
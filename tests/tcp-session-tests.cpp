@@ -19,12 +19,20 @@
 #include <iostream>
 #include <thread>
 #include <memory>
+#include <filesystem>
+
+#ifdef __linux__
+#include <fcntl.h>
+#endif
 
 #include "wasm-message-handler.h"
+#include "nop-message-handler.h"
+#include "pooled-message-handler.h"
 #include "tcp-session.h"
 
 #include "tcp-broadcast-server.h"
 #include "tcp-sink-server.h"
+#include "recording-message-handler.h"
 #include "test-helpers.h"
 
 TEST(TCPSessionTests, SingleSessionParsing)
@@ -104,7 +112,7 @@ TEST(TCPSessionTests, SingleSessionParsing)
 
     // WASMMessageHandler handler(engine, module);
     std::shared_ptr<WASMMessageHandler> handler_ptr;
-    std::shared_ptr<TCPSession> session_ptr;
+    SessionRef<TCPSession> session_ptr;
 
     // Empty callback that just stops the context.
     TCPSession::DisconnectCallback cb = [&](){
@@ -138,34 +146,870 @@ TEST(TCPSessionTests, SingleSessionParsing)
                 }
             }
 
-            return {size, HeaderResult::Status::OK};
-        });
+            return {size, HeaderResult::Status::OK};
+        });
+
+        // Create the TCPSession instance.
+        session_ptr = make_session<TCPSession>(session_cntx,
+                                               config,
+                                               *handler_ptr,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
+
+        // Connection endpoint.
+        const TCPSession::Endpoints endpoints{
+                TCPSession::tcp::endpoint(
+                    asio::ip::make_address("127.0.0.1"),
+                    12345
+                )};
+
+        // Call to connect.
+        session_ptr->start(endpoints);
+
+    });
+
+    // Turn this test off after 100ms of responding.
+    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(100));
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        // This should stop the context.
+        session_ptr->stop();
+    });
+
+    session_cntx.run();
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    // Asserts after we finish testing.
+    EXPECT_EQ(server.lifetime_connections_, 1) << "Server only accepted "
+                                               << server.lifetime_connections_
+                                               << " of "
+                                               << 1
+                                               << "requests!";
+
+    // The server sends 8 bytes at a time, we read 4 as the header and 4 as the payload
+    // of which we send an equal amount of bytes 0x55 back.
+    EXPECT_EQ(server.lifetime_sent_,
+              server.lifetime_received_) << "Server was not responded to properly!";
+
+    SUCCEED();
+}
+
+//
+// Example fixed size header
+//
+
+enum class HeaderType : uint8_t
+{
+    Login,
+    Register,
+    Ping,
+    PingResponse,
+    SendDM
+};
+
+struct Header
+{
+    HeaderType type_;
+    uint32_t payload_len;
+
+    static constexpr size_t HEADER_SIZE = sizeof(payload_len) + sizeof(type_);
+};
+
+TEST(TCPSessionTests, SingleSessionSharedBuffers)
+{
+    // Setup basic server.
+    asio::io_context server_cntx;
+    asio::ip::tcp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    uint64_t server_interval_ms = 5;
+    uint64_t total_packets = 10;
+
+    // Large enough that the body won't arrive in one read.
+    std::vector<uint8_t> body(1024 * 1024);
+
+    for (size_t i = 0; i < body.size(); i++)
+    {
+        body[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    std::vector<uint8_t> packet{ 0x0, 0x10, 0x0, 0x0 };
+    packet.insert(packet.end(), body.begin(), body.end());
+
+    TCPBroadcastServer server(server_cntx,
+                              server_ep,
+                              server_interval_ms,
+                              packet,
+                              total_packets);
+
+    std::thread server_thread([&]
+    {
+        server.start();
+        server_cntx.run();
+    });
+
+    // Setup a TCPSession by itself.
+    asio::io_context session_cntx;
+
+    SessionConfig config(4, 2 * 1024 * 1024, true, false, 100);
+    config.shared_buffers = true;
+
+    RecordingMessageHandler handler(body);
+
+    // Empty payload manager.
+    std::vector<PayloadDescriptor> payloads;
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    SessionRef<TCPSession> session_ptr;
+
+    // Empty callback that just stops the context.
+    TCPSession::DisconnectCallback cb = [&](){
+        session_cntx.stop();
+    };
+
+    ShardMetrics metrics;
+
+    asio::post(session_cntx, [&](){
+        session_ptr = make_session<TCPSession>(session_cntx,
+                                               config,
+                                               handler,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
+
+        const TCPSession::Endpoints endpoints{server_ep};
+
+        session_ptr->start(endpoints);
+    });
+
+    // Turn this test off after 200ms of reading.
+    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(200));
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        session_ptr->stop();
+    });
+
+    session_cntx.run();
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    auto snapshot = metrics.fetch_snapshot();
+
+    EXPECT_EQ(handler.messages_, total_packets);
+    EXPECT_EQ(handler.mismatched_, 0) << "Bodies were corrupted by the shared buffer!";
+    EXPECT_EQ(snapshot.bytes_read, packet.size() * total_packets);
+    EXPECT_EQ(snapshot.packets_read, total_packets);
+}
+
+TEST(TCPSessionTests, SingleSessionLeasedBodies)
+{
+    // Setup basic server.
+    asio::io_context server_cntx;
+    asio::ip::tcp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    uint64_t server_interval_ms = 5;
+    uint64_t total_packets = 10;
+
+    // Too large for the session's own buffer.
+    std::vector<uint8_t> body(64 * 1024);
+
+    for (size_t i = 0; i < body.size(); i++)
+    {
+        body[i] = static_cast<uint8_t>(i * 3);
+    }
+
+    std::vector<uint8_t> packet{ 0x0, 0x1, 0x0, 0x0 };
+    packet.insert(packet.end(), body.begin(), body.end());
+
+    TCPBroadcastServer server(server_cntx,
+                              server_ep,
+                              server_interval_ms,
+                              packet,
+                              total_packets);
+
+    std::thread server_thread([&]
+    {
+        server.start();
+        server_cntx.run();
+    });
+
+    // Setup a TCPSession by itself.
+    asio::io_context session_cntx;
+
+    SessionConfig config(4, 1024 * 1024, true, false, 100);
+
+    RecordingMessageHandler handler(body);
+
+    // Empty payload manager.
+    std::vector<PayloadDescriptor> payloads;
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    SessionRef<TCPSession> session_ptr;
+
+    // Empty callback that just stops the context.
+    TCPSession::DisconnectCallback cb = [&](){
+        session_cntx.stop();
+    };
+
+    ShardMetrics metrics;
+
+    asio::post(session_cntx, [&](){
+        session_ptr = make_session<TCPSession>(session_cntx,
+                                               config,
+                                               handler,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
+
+        const TCPSession::Endpoints endpoints{server_ep};
+
+        session_ptr->start(endpoints);
+    });
+
+    // Turn this test off after 200ms of reading.
+    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(200));
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        session_ptr->stop();
+    });
+
+    session_cntx.run();
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    BufferStats stats = asio::use_service<BufferService>(session_cntx).stats();
+
+    EXPECT_EQ(handler.messages_, total_packets);
+    EXPECT_EQ(handler.mismatched_, 0);
+
+    // One allocation, every later message reuses it.
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.hits, total_packets - 1);
+    EXPECT_EQ(stats.high_water, body.size());
+}
+
+TEST(TCPSessionTests, SingleSessionReservedBodies)
+{
+    // Setup basic server.
+    asio::io_context server_cntx;
+    asio::ip::tcp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    uint64_t server_interval_ms = 5;
+    uint64_t total_packets = 10;
+
+    // Too large for the session's own buffer.
+    std::vector<uint8_t> body(64 * 1024);
+
+    for (size_t i = 0; i < body.size(); i++)
+    {
+        body[i] = static_cast<uint8_t>(i * 3);
+    }
+
+    std::vector<uint8_t> packet{ 0x0, 0x1, 0x0, 0x0 };
+    packet.insert(packet.end(), body.begin(), body.end());
+
+    TCPBroadcastServer server(server_cntx,
+                              server_ep,
+                              server_interval_ms,
+                              packet,
+                              total_packets);
+
+    std::thread server_thread([&]
+    {
+        server.start();
+        server_cntx.run();
+    });
+
+    // Setup a TCPSession by itself.
+    asio::io_context session_cntx;
+
+    SessionConfig config(4, 1024 * 1024, true, false, 100);
+
+    RecordingMessageHandler handler(body);
+    handler.reserve_ = true;
+
+    // Empty payload manager.
+    std::vector<PayloadDescriptor> payloads;
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    SessionRef<TCPSession> session_ptr;
+
+    // Empty callback that just stops the context.
+    TCPSession::DisconnectCallback cb = [&](){
+        session_cntx.stop();
+    };
+
+    ShardMetrics metrics;
+
+    asio::post(session_cntx, [&](){
+        session_ptr = make_session<TCPSession>(session_cntx,
+                                               config,
+                                               handler,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
+
+        const TCPSession::Endpoints endpoints{server_ep};
+
+        session_ptr->start(endpoints);
+    });
+
+    // Turn this test off after 200ms of reading.
+    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(200));
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        session_ptr->stop();
+    });
+
+    session_cntx.run();
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    BufferStats stats = asio::use_service<BufferService>(session_cntx).stats();
+
+    EXPECT_EQ(handler.messages_, total_packets);
+    EXPECT_EQ(handler.mismatched_, 0);
+
+    // Every body went straight into the handler's memory, none were leased.
+    EXPECT_EQ(handler.reserved_, total_packets);
+    EXPECT_EQ(stats.misses, 0);
+    EXPECT_EQ(stats.hits, 0);
+}
+
+TEST(TCPSessionTests, SingleSessionBufferedFrames)
+{
+    // Setup basic server.
+    asio::io_context server_cntx;
+    asio::ip::tcp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    uint64_t server_interval_ms = 5;
+    uint64_t total_writes = 10;
+
+    std::vector<uint8_t> body(60);
+
+    for (size_t i = 0; i < body.size(); i++)
+    {
+        body[i] = static_cast<uint8_t>(i);
+    }
+
+    // Many messages per server write, which don't line up with the
+    // session's 4 KiB reads so some frames straddle two reads.
+    size_t frames_per_write = 100;
+
+    std::vector<uint8_t> packet;
+
+    for (size_t i = 0; i < frames_per_write; i++)
+    {
+        packet.insert(packet.end(), { 0x0, 0x0, 0x0, 0x3c });
+        packet.insert(packet.end(), body.begin(), body.end());
+    }
+
+    TCPBroadcastServer server(server_cntx,
+                              server_ep,
+                              server_interval_ms,
+                              packet,
+                              total_writes);
+
+    std::thread server_thread([&]
+    {
+        server.start();
+        server_cntx.run();
+    });
+
+    // Setup a TCPSession by itself.
+    asio::io_context session_cntx;
+
+    SessionConfig config(4, 1024, true, false, 100);
+
+    RecordingMessageHandler handler(body);
+
+    // Empty payload manager.
+    std::vector<PayloadDescriptor> payloads;
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    SessionRef<TCPSession> session_ptr;
+
+    // Empty callback that just stops the context.
+    TCPSession::DisconnectCallback cb = [&](){
+        session_cntx.stop();
+    };
+
+    ShardMetrics metrics;
+
+    asio::post(session_cntx, [&](){
+        session_ptr = make_session<TCPSession>(session_cntx,
+                                               config,
+                                               handler,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
+
+        const TCPSession::Endpoints endpoints{server_ep};
+
+        session_ptr->start(endpoints);
+    });
+
+    // Turn this test off after 200ms of reading.
+    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(200));
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        session_ptr->stop();
+    });
+
+    session_cntx.run();
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    auto snapshot = metrics.fetch_snapshot();
+
+    uint64_t total_frames = frames_per_write * total_writes;
+
+    EXPECT_EQ(handler.messages_, total_frames);
+    EXPECT_EQ(handler.mismatched_, 0) << "Frames were split incorrectly!";
+    EXPECT_EQ(snapshot.bytes_read, packet.size() * total_writes);
+    EXPECT_EQ(snapshot.packets_read, total_frames);
+
+    // At most a couple of reads per server write, not two per message.
+    EXPECT_LE(snapshot.read_calls, 4 * total_writes);
+}
+
+TEST(TCPSessionTests, SingleSessionBatchedFrames)
+{
+    // Setup basic server.
+    asio::io_context server_cntx;
+    asio::ip::tcp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    uint64_t server_interval_ms = 5;
+    uint64_t total_writes = 10;
+
+    std::vector<uint8_t> body(60);
+
+    for (size_t i = 0; i < body.size(); i++)
+    {
+        body[i] = static_cast<uint8_t>(i);
+    }
+
+    // Many messages per server write, which don't line up with the
+    // session's 4 KiB reads so some frames straddle two reads.
+    size_t frames_per_write = 100;
+
+    std::vector<uint8_t> packet;
+
+    for (size_t i = 0; i < frames_per_write; i++)
+    {
+        packet.insert(packet.end(), { 0x0, 0x0, 0x0, 0x3c });
+        packet.insert(packet.end(), body.begin(), body.end());
+    }
+
+    TCPBroadcastServer server(server_cntx,
+                              server_ep,
+                              server_interval_ms,
+                              packet,
+                              total_writes);
+
+    std::thread server_thread([&]
+    {
+        server.start();
+        server_cntx.run();
+    });
+
+    // Setup a TCPSession by itself.
+    asio::io_context session_cntx;
+
+    SessionConfig config(4, 1024, true, false, 100);
+
+    RecordingMessageHandler handler(body);
+    handler.batch_ = true;
+
+    // Empty payload manager.
+    std::vector<PayloadDescriptor> payloads;
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    SessionRef<TCPSession> session_ptr;
+
+    // Empty callback that just stops the context.
+    TCPSession::DisconnectCallback cb = [&](){
+        session_cntx.stop();
+    };
+
+    ShardMetrics metrics;
+
+    asio::post(session_cntx, [&](){
+        session_ptr = make_session<TCPSession>(session_cntx,
+                                               config,
+                                               handler,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
+
+        const TCPSession::Endpoints endpoints{server_ep};
+
+        session_ptr->start(endpoints);
+    });
+
+    // Turn this test off after 200ms of reading.
+    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(200));
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        session_ptr->stop();
+    });
+
+    session_cntx.run();
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    auto snapshot = metrics.fetch_snapshot();
+
+    uint64_t total_frames = frames_per_write * total_writes;
+
+    EXPECT_EQ(handler.messages_, total_frames);
+    EXPECT_EQ(handler.mismatched_, 0) << "Frames were split incorrectly!";
+    EXPECT_EQ(snapshot.bytes_read, packet.size() * total_writes);
+    EXPECT_EQ(snapshot.packets_read, total_frames);
+
+    // Every complete frame of a read goes to the handler at once.
+    EXPECT_GT(handler.batches_, 0);
+    EXPECT_LE(handler.batches_, snapshot.read_calls);
+}
+
+TEST(TCPSessionTests, SingleSessionCoalescedResponses)
+{
+    // Setup basic server.
+    asio::io_context server_cntx;
+    asio::ip::tcp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    uint64_t server_interval_ms = 5;
+    uint64_t total_packets = 10;
+
+    std::vector<uint8_t> body{ 0xa, 0xb, 0xc, 0xd };
+
+    std::vector<uint8_t> packet{ 0x0, 0x0, 0x0, 0x4 };
+    packet.insert(packet.end(), body.begin(), body.end());
+
+    TCPBroadcastServer server(server_cntx,
+                              server_ep,
+                              server_interval_ms,
+                              packet,
+                              total_packets);
+
+    std::thread server_thread([&]
+    {
+        server.start();
+        server_cntx.run();
+    });
+
+    // Setup a TCPSession by itself.
+    asio::io_context session_cntx;
+
+    SessionConfig config(4, 1024, true, false, 100);
+
+    // With a queue of one the session pauses reading whenever a response is
+    // still waiting behind a write.
+    config.coalesce_limit = 64 * 1024;
+    config.response_queue_size = 1;
+
+    std::vector<uint8_t> reply{ 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8 };
+
+    RecordingMessageHandler handler(body, reply);
+
+    // Empty payload manager.
+    std::vector<PayloadDescriptor> payloads;
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    SessionRef<TCPSession> session_ptr;
+
+    // Empty callback that just stops the context.
+    TCPSession::DisconnectCallback cb = [&](){
+        session_cntx.stop();
+    };
+
+    ShardMetrics metrics;
+
+    asio::post(session_cntx, [&](){
+        session_ptr = make_session<TCPSession>(session_cntx,
+                                               config,
+                                               handler,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
+
+        const TCPSession::Endpoints endpoints{server_ep};
+
+        session_ptr->start(endpoints);
+    });
+
+    // Turn this test off after 200ms of reading.
+    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(200));
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        session_ptr->stop();
+    });
+
+    session_cntx.run();
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    auto snapshot = metrics.fetch_snapshot();
+
+    // Every message is still answered, nothing is dropped while paused.
+    EXPECT_EQ(handler.messages_, total_packets);
+    EXPECT_EQ(snapshot.responses_queued, total_packets);
+    EXPECT_EQ(snapshot.responses_dropped, 0);
+    EXPECT_EQ(snapshot.response_queue_peak, 1);
+    EXPECT_EQ(snapshot.packets_sent, total_packets);
+    EXPECT_EQ(snapshot.bytes_sent, reply.size() * total_packets);
+}
+
+TEST(TCPSessionTests, SingleSessionPooledHandler)
+{
+    // Setup basic server.
+    asio::io_context server_cntx;
+    asio::ip::tcp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    uint64_t server_interval_ms = 5;
+    uint64_t total_packets = 10;
+
+    std::vector<uint8_t> body{ 0xa, 0xb, 0xc, 0xd };
+
+    std::vector<uint8_t> packet{ 0x0, 0x0, 0x0, 0x4 };
+    packet.insert(packet.end(), body.begin(), body.end());
+
+    TCPBroadcastServer server(server_cntx,
+                              server_ep,
+                              server_interval_ms,
+                              packet,
+                              total_packets);
+
+    std::thread server_thread([&]
+    {
+        server.start();
+        server_cntx.run();
+    });
+
+    // Setup a TCPSession by itself.
+    asio::io_context session_cntx;
+
+    SessionConfig config(4, 1024, true, false, 100);
+
+    std::vector<uint8_t> reply{ 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8 };
+
+    // Bodies are answered on the pool's threads, headers on ours.
+    auto pool = std::make_shared<HandlerPool>(2, [&]() -> std::unique_ptr<MessageHandler> {
+        return std::make_unique<RecordingMessageHandler>(body, reply);
+    });
+
+    PooledMessageHandler handler(pool, std::make_unique<RecordingMessageHandler>(body));
+
+    ShardMetrics metrics;
+
+    handler.attach_metrics(metrics);
+    handler.attach_context(session_cntx);
+
+    // Empty payload manager.
+    std::vector<PayloadDescriptor> payloads;
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    SessionRef<TCPSession> session_ptr;
+
+    // Empty callback that just stops the context.
+    TCPSession::DisconnectCallback cb = [&](){
+        session_cntx.stop();
+    };
+
+    asio::post(session_cntx, [&](){
+        session_ptr = make_session<TCPSession>(session_cntx,
+                                               config,
+                                               handler,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
+
+        const TCPSession::Endpoints endpoints{server_ep};
+
+        session_ptr->start(endpoints);
+    });
+
+    // Turn this test off after 200ms of reading.
+    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(200));
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        session_ptr->stop();
+    });
+
+    session_cntx.run();
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    auto snapshot = metrics.fetch_snapshot();
+
+    uint64_t waits = 0;
+
+    for (uint64_t count : snapshot.handler_wait_buckets)
+    {
+        waits += count;
+    }
+
+    // Every message went through the pool and its reply was written.
+    EXPECT_EQ(snapshot.handler_jobs, total_packets);
+    EXPECT_GE(snapshot.handler_queue_peak, 1);
+    EXPECT_EQ(waits, total_packets);
+    EXPECT_EQ(snapshot.responses_queued, total_packets);
+    EXPECT_EQ(snapshot.packets_sent, total_packets);
+    EXPECT_EQ(snapshot.bytes_sent, reply.size() * total_packets);
+}
+
+TEST(TCPSessionTests, PooledHandlerOutlivesItsJobs)
+{
+    asio::io_context session_cntx;
+
+    std::vector<uint8_t> body{ 0xa, 0xb, 0xc, 0xd };
+    std::vector<uint8_t> header{ 0x0, 0x0, 0x0, 0x4 };
+    std::vector<uint8_t> reply{ 0x1, 0x2 };
+
+    auto pool = std::make_shared<HandlerPool>(1, [&]() -> std::unique_ptr<MessageHandler> {
+        return std::make_unique<RecordingMessageHandler>(body, reply);
+    });
+
+    size_t answered = 0;
+
+    {
+        PooledMessageHandler handler(pool, std::make_unique<RecordingMessageHandler>(body));
+        handler.attach_context(session_cntx);
+
+        for (int i = 0; i < 16; i++)
+        {
+            handler.parse_message(header, body, [&](ResponsePacket){
+                answered++;
+            });
+        }
+
+        // Like a shard that was forced to stop, the io_context never ran
+        // while the jobs were out. The handler waits for the pool here.
+    }
+
+    // Completions posted for the handler are dropped.
+    session_cntx.run();
+
+    EXPECT_EQ(answered, 0);
+}
+
+TEST(TCPSessionTests, SingleSessionNativeHeaders)
+{
+    // Setup basic server.
+    asio::io_context server_cntx;
+    asio::ip::tcp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    uint64_t server_interval_ms = 5;
+    uint64_t total_packets = 10;
+
+    // Type byte, then a little endian length that counts the 3 byte header.
+    std::vector<uint8_t> packet{ 0x7, 0x8, 0x0,
+                                 0x1, 0x2, 0x3, 0x4, 0x5 };
+
+    TCPBroadcastServer server(server_cntx,
+                              server_ep,
+                              server_interval_ms,
+                              packet,
+                              total_packets);
+
+    std::thread server_thread([&]
+    {
+        server.start();
+        server_cntx.run();
+    });
+
+    // Setup a TCPSession by itself.
+    asio::io_context session_cntx;
+
+    SessionConfig config(3, 1024, true, false, 100);
+
+    LengthField length_field;
+    length_field.offset = 1;
+    length_field.width = 2;
+    length_field.little_endian = true;
+    length_field.includes_header = true;
+
+    NOPMessageHandler handler(length_field);
+
+    // Empty payload manager.
+    std::vector<PayloadDescriptor> payloads;
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    SessionRef<TCPSession> session_ptr;
+
+    // Empty callback that just stops the context.
+    TCPSession::DisconnectCallback cb = [&](){
+        session_cntx.stop();
+    };
+
+    ShardMetrics metrics;
 
-        // Create the TCPSession instance.
-        session_ptr = make_shared<TCPSession>(session_cntx,
-                                              config,
-                                              *handler_ptr,
-                                              payload_manager,
-                                              metrics,
-                                              cb);
+    asio::post(session_cntx, [&](){
+        session_ptr = make_session<TCPSession>(session_cntx,
+                                               config,
+                                               handler,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
 
-        // Connection endpoint.
-        const TCPSession::Endpoints endpoints{
-                TCPSession::tcp::endpoint(
-                    asio::ip::make_address("127.0.0.1"),
-                    12345
-                )};
+        const TCPSession::Endpoints endpoints{server_ep};
 
-        // Call to connect.
         session_ptr->start(endpoints);
-
     });
 
-    // Turn this test off after 100ms of responding.
-    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(100));
+    // Turn this test off after 200ms of reading.
+    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(200));
     stop_timer.async_wait([&](const boost::system::error_code &)
     {
-        // This should stop the context.
         session_ptr->stop();
     });
 
@@ -178,41 +1022,137 @@ TEST(TCPSessionTests, SingleSessionParsing)
         server_thread.join();
     }
 
-    // Asserts after we finish testing.
-    EXPECT_EQ(server.lifetime_connections_, 1) << "Server only accepted "
-                                               << server.lifetime_connections_
-                                               << " of "
-                                               << 1
-                                               << "requests!";
-
-    // The server sends 8 bytes at a time, we read 4 as the header and 4 as the payload
-    // of which we send an equal amount of bytes 0x55 back.
-    EXPECT_EQ(server.lifetime_sent_,
-              server.lifetime_received_) << "Server was not responded to properly!";
+    auto snapshot = metrics.fetch_snapshot();
 
-    SUCCEED();
+    // A wrong length would split the stream at the wrong place.
+    EXPECT_EQ(snapshot.bytes_read, packet.size() * total_packets);
+    EXPECT_EQ(snapshot.packets_read, total_packets);
 }
 
-//
-// Example fixed size header
-//
+TEST(TCPSessionTests, LengthFieldDecoding)
+{
+    std::vector<uint8_t> header{ 0xff, 0x01, 0x02, 0x03, 0x04 };
 
-enum class HeaderType : uint8_t
+    LengthField field;
+    field.offset = 1;
+    field.width = 2;
+
+    HeaderResult result = field.decode(header);
+
+    EXPECT_EQ(result.status, HeaderResult::Status::OK);
+    EXPECT_EQ(result.length, 0x0102);
+
+    field.little_endian = true;
+    field.width = 4;
+
+    result = field.decode(header);
+
+    EXPECT_EQ(result.status, HeaderResult::Status::OK);
+    EXPECT_EQ(result.length, 0x04030201);
+
+    // Adjustments and the header size are taken off the length.
+    field.width = 1;
+    field.adjustment = -1;
+    field.includes_header = true;
+
+    result = field.decode(header);
+
+    EXPECT_EQ(result.status, HeaderResult::Status::ERROR);
+
+    header[1] = 0x10;
+    result = field.decode(header);
+
+    EXPECT_EQ(result.status, HeaderResult::Status::OK);
+    EXPECT_EQ(result.length, 0x10 - 1 - header.size());
+
+    // The field must fit in the header.
+    field.offset = 4;
+    field.width = 2;
+
+    result = field.decode(header);
+
+    EXPECT_EQ(result.status, HeaderResult::Status::ERROR);
+}
+
+TEST(TCPSessionTests, ResponseQueueRing)
 {
-    Login,
-    Register,
-    Ping,
-    PingResponse,
-    SendDM
-};
+    PacketPool::Owner pool = PacketPool::create();
 
-struct Header
+    ResponseQueue queue(6);
+
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.capacity(), 6);
+
+    // Push and pop enough to wrap around and grow past the first slots.
+    uint8_t next_push = 0;
+    uint8_t next_pop = 0;
+
+    for (int round = 0; round < 4; round++)
+    {
+        while (!queue.full())
+        {
+            queue.push_back(pool->copy(std::span<const uint8_t>(&next_push, 1)));
+            next_push++;
+        }
+
+        EXPECT_EQ(queue.size(), 6);
+
+        for (int i = 0; i < 4; i++)
+        {
+            ASSERT_EQ(queue.front().size(), 1);
+            EXPECT_EQ(queue.front().data()[0], next_pop);
+
+            queue.pop_front();
+            next_pop++;
+        }
+    }
+
+    queue.clear();
+
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(TCPSessionTests, BufferServiceLeases)
 {
-    HeaderType type_;
-    uint32_t payload_len;
+    asio::io_context cntx;
 
-    static constexpr size_t HEADER_SIZE = sizeof(payload_len) + sizeof(type_);
-};
+    BufferService & buffers = asio::use_service<BufferService>(cntx);
+
+    {
+        BufferLease first = buffers.lease(10 * 1024);
+        BufferLease second = buffers.lease(BufferService::MIN_LEASE_SIZE);
+
+        ASSERT_TRUE(first);
+        ASSERT_TRUE(second);
+
+        // Rounded up to the size class.
+        EXPECT_EQ(first.size(), 16 * 1024);
+        EXPECT_EQ(second.size(), BufferService::MIN_LEASE_SIZE);
+    }
+
+    BufferStats stats = buffers.stats();
+
+    EXPECT_EQ(stats.hits, 0);
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.high_water, 24 * 1024);
+
+    // Should get the buffer back that we just returned.
+    BufferLease again = buffers.lease(12 * 1024);
+    again.release();
+
+    EXPECT_FALSE(again);
+
+    // Too large to keep, always a miss.
+    BufferLease huge = buffers.lease(BufferService::MAX_LEASE_SIZE + 1);
+
+    EXPECT_EQ(huge.size(), BufferService::MAX_LEASE_SIZE + 1);
+
+    stats = buffers.stats();
+
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 3);
+    EXPECT_EQ(stats.high_water, BufferService::MAX_LEASE_SIZE + 1);
+}
 
 TEST(TCPSessionTests, SingleSessionHeartbeat)
 {
@@ -305,7 +1245,7 @@ TEST(TCPSessionTests, SingleSessionHeartbeat)
 
     // WASMMessageHandler handler(engine, module);
     std::shared_ptr<WASMMessageHandler> handler_ptr;
-    std::shared_ptr<TCPSession> session_ptr;
+    SessionRef<TCPSession> session_ptr;
 
     // Empty callback that just stops the context.
     TCPSession::DisconnectCallback cb = [&](){
@@ -326,12 +1266,12 @@ TEST(TCPSessionTests, SingleSessionHeartbeat)
         }
 
         // Create the TCPSession instance.
-        session_ptr = make_shared<TCPSession>(session_cntx,
-                                              config,
-                                              *handler_ptr,
-                                              payload_manager,
-                                              metrics,
-                                              cb);
+        session_ptr = make_session<TCPSession>(session_cntx,
+                                               config,
+                                               *handler_ptr,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
 
         // Connection endpoint.
         const TCPSession::Endpoints endpoints{
@@ -456,7 +1396,7 @@ TEST(TCPSessionTests, SingleSessionWriteOne)
     PayloadManager payload_manager(payloads, steps);
 
     std::shared_ptr<WASMMessageHandler> handler_ptr;
-    std::shared_ptr<TCPSession> session_ptr;
+    SessionRef<TCPSession> session_ptr;
 
     // Empty callback that just stops the context.
     TCPSession::DisconnectCallback cb = [&](){
@@ -495,12 +1435,12 @@ TEST(TCPSessionTests, SingleSessionWriteOne)
         });
 
         // Create the TCPSession instance.
-        session_ptr = make_shared<TCPSession>(session_cntx,
-                                              config,
-                                              *handler_ptr,
-                                              payload_manager,
-                                              metrics,
-                                              cb);
+        session_ptr = make_session<TCPSession>(session_cntx,
+                                               config,
+                                               *handler_ptr,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
 
         // Connection endpoint.
         const TCPSession::Endpoints endpoints{
@@ -637,7 +1577,7 @@ TEST(TCPSessionTests, SingleSessionCounterFlood)
     PayloadManager payload_manager(payloads, steps);
 
     std::shared_ptr<WASMMessageHandler> handler_ptr;
-    std::shared_ptr<TCPSession> session_ptr;
+    SessionRef<TCPSession> session_ptr;
 
     // Empty callback that just stops the context.
     TCPSession::DisconnectCallback cb = [&](){
@@ -676,12 +1616,12 @@ TEST(TCPSessionTests, SingleSessionCounterFlood)
         });
 
         // Create the TCPSession instance.
-        session_ptr = make_shared<TCPSession>(session_cntx,
-                                              config,
-                                              *handler_ptr,
-                                              payload_manager,
-                                              metrics,
-                                              cb);
+        session_ptr = make_session<TCPSession>(session_cntx,
+                                               config,
+                                               *handler_ptr,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
 
         // Connection endpoint.
         const TCPSession::Endpoints endpoints{
@@ -824,7 +1764,7 @@ TEST(TCPSessionTests, SingleSessionTimestampFlood)
     PayloadManager payload_manager(payloads, steps);
 
     std::shared_ptr<WASMMessageHandler> handler_ptr;
-    std::shared_ptr<TCPSession> session_ptr;
+    SessionRef<TCPSession> session_ptr;
 
     // Empty callback that just stops the context.
     TCPSession::DisconnectCallback cb = [&](){
@@ -863,12 +1803,12 @@ TEST(TCPSessionTests, SingleSessionTimestampFlood)
         });
 
         // Create the TCPSession instance.
-        session_ptr = make_shared<TCPSession>(session_cntx,
-                                              config,
-                                              *handler_ptr,
-                                              payload_manager,
-                                              metrics,
-                                              cb);
+        session_ptr = make_session<TCPSession>(session_cntx,
+                                               config,
+                                               *handler_ptr,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
 
         // Connection endpoint.
         const TCPSession::Endpoints endpoints{
@@ -1005,8 +1945,8 @@ TEST(TCPSessionTests, MultiSessionCounterFlood)
     PayloadManager payload_manager(payloads, steps);
 
     std::shared_ptr<WASMMessageHandler> handler_ptr;
-    std::shared_ptr<TCPSession> session_ptr;
-    std::shared_ptr<TCPSession> session_ptr_2;
+    SessionRef<TCPSession> session_ptr;
+    SessionRef<TCPSession> session_ptr_2;
 
     // Empty callback that just stops the context.
     TCPSession::DisconnectCallback cb = [&](){
@@ -1045,19 +1985,19 @@ TEST(TCPSessionTests, MultiSessionCounterFlood)
         });
 
         // Create the TCPSession instances.
-        session_ptr = make_shared<TCPSession>(session_cntx,
-                                              config,
-                                              *handler_ptr,
-                                              payload_manager,
-                                              metrics,
-                                              cb);
-
-        session_ptr_2 = make_shared<TCPSession>(session_cntx,
-                                                config,
-                                                *handler_ptr,
-                                                payload_manager,
-                                                metrics,
-                                                cb);
+        session_ptr = make_session<TCPSession>(session_cntx,
+                                               config,
+                                               *handler_ptr,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
+
+        session_ptr_2 = make_session<TCPSession>(session_cntx,
+                                                 config,
+                                                 *handler_ptr,
+                                                 payload_manager,
+                                                 metrics,
+                                                 cb);
 
         // Connection endpoint.
         const TCPSession::Endpoints endpoints{
@@ -1109,3 +2049,227 @@ TEST(TCPSessionTests, MultiSessionCounterFlood)
 
     SUCCEED();
 }
+
+#ifdef __linux__
+TEST(TCPSessionTests, SingleSessionZeroCopyFlood)
+{
+    std::vector<uint8_t> packet_1 = read_binary_file("tests/packets/test-packet-heavy.bin");
+    size_t packet_size = packet_1.size();
+
+    // Setup basic server.
+    asio::io_context server_cntx;
+    asio::ip::tcp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    TCPSinkServer server(server_cntx,
+                         server_ep,
+                         packet_size);
+
+    std::thread server_thread([&]
+    {
+        server.start();
+        server_cntx.run();
+    });
+
+    asio::io_context session_cntx;
+
+    // The identity slices are above the threshold, the counters are not.
+    SessionConfig config(4, 12288, false, false, 100);
+    config.zerocopy_threshold = 4096;
+
+    NOPMessageHandler handler;
+
+    // Create 9 payloads with decreasing sizes, so the counter lands
+    // in a different place in each one.
+    std::vector<PayloadDescriptor> payloads;
+
+    for (int i = 0; i < 9; i++)
+    {
+        PacketOperation identity_op_missing_bytes;
+        identity_op_missing_bytes.make_identity(packet_size - i);
+
+        PacketOperation counter_op;
+        counter_op.make_counter(i, (i % 2));
+
+        payloads.push_back({{packet_1.data(), packet_1.size()},
+                           std::vector<PacketOperation>{identity_op_missing_bytes, counter_op} });
+    }
+
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    SessionRef<TCPSession> session_ptr;
+
+    TCPSession::DisconnectCallback cb = [&](){
+        session_cntx.stop();
+    };
+
+    ShardMetrics metrics;
+
+    asio::post(session_cntx, [&](){
+        session_ptr = make_session<TCPSession>(session_cntx,
+                                               config,
+                                               handler,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
+
+        const TCPSession::Endpoints endpoints{server_ep};
+
+        session_ptr->start(endpoints);
+
+        // Send out all payloads as fast as possible.
+        session_ptr->flood();
+    });
+
+    // Turn this test off after 100ms of sending.
+    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(100));
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        session_ptr->stop();
+    });
+
+    session_cntx.run();
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    EXPECT_EQ(server.lifetime_connections_, 1) << "Server only accepted "
+                                               << server.lifetime_connections_
+                                               << " of "
+                                               << 1
+                                               << "requests!";
+
+    EXPECT_EQ(server.lifetime_received_,
+              packet_size * payloads.size()) << "Server only got "
+                                             << server.lifetime_received_
+                                             << " of "
+                                             << packet_size * payloads.size()
+                                             << " bytes!";
+
+    auto snapshot = metrics.fetch_snapshot();
+
+    EXPECT_EQ(snapshot.bytes_sent, packet_size * payloads.size());
+    EXPECT_EQ(snapshot.packets_sent, payloads.size());
+}
+
+TEST(TCPSessionTests, SingleSessionSendfileFlood)
+{
+    std::string packet_path = "tests/packets/test-packet-heavy.bin";
+    size_t packet_size = std::filesystem::file_size(packet_path);
+
+    int fd = ::open(packet_path.c_str(), O_RDONLY | O_CLOEXEC);
+    ASSERT_GE(fd, 0) << "Failed to open " << packet_path;
+
+    PacketFile file(fd, packet_size);
+
+    // Setup basic server.
+    asio::io_context server_cntx;
+    asio::ip::tcp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    TCPSinkServer server(server_cntx,
+                         server_ep,
+                         packet_size);
+
+    std::thread server_thread([&]
+    {
+        server.start();
+        server_cntx.run();
+    });
+
+    asio::io_context session_cntx;
+
+    SessionConfig config(4, 12288, false, false, 100);
+
+    NOPMessageHandler handler;
+
+    // Create 9 payloads read from disk, with a counter at a different
+    // place in each one.
+    std::vector<PayloadDescriptor> payloads;
+
+    for (int i = 0; i < 9; i++)
+    {
+        PacketOperation head_op;
+        head_op.make_identity(i * 100);
+
+        PacketOperation counter_op;
+        counter_op.make_counter(i, (i % 2));
+
+        PacketOperation tail_op;
+        tail_op.make_identity(packet_size - i * 101);
+
+        PayloadDescriptor payload;
+        payload.ops = {head_op, counter_op, tail_op};
+        payload.file = &file;
+
+        payloads.push_back(payload);
+    }
+
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    SessionRef<TCPSession> session_ptr;
+
+    TCPSession::DisconnectCallback cb = [&](){
+        session_cntx.stop();
+    };
+
+    ShardMetrics metrics;
+
+    asio::post(session_cntx, [&](){
+        session_ptr = make_session<TCPSession>(session_cntx,
+                                               config,
+                                               handler,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
+
+        const TCPSession::Endpoints endpoints{server_ep};
+
+        session_ptr->start(endpoints);
+
+        // Send out all payloads as fast as possible.
+        session_ptr->flood();
+    });
+
+    // Turn this test off after 100ms of sending.
+    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(100));
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        session_ptr->stop();
+    });
+
+    session_cntx.run();
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    EXPECT_EQ(server.lifetime_connections_, 1) << "Server only accepted "
+                                               << server.lifetime_connections_
+                                               << " of "
+                                               << 1
+                                               << "requests!";
+
+    // The counters overwrite file bytes, so every payload is a full packet.
+    size_t expected_bytes = packet_size * payloads.size();
+
+    EXPECT_EQ(server.lifetime_received_,
+              expected_bytes) << "Server only got "
+                              << server.lifetime_received_
+                              << " of "
+                              << expected_bytes
+                              << " bytes!";
+
+    auto snapshot = metrics.fetch_snapshot();
+
+    EXPECT_EQ(snapshot.bytes_sent, expected_bytes);
+    EXPECT_EQ(snapshot.packets_sent, payloads.size());
+}
+#endif
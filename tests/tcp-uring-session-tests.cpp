@@ -0,0 +1,286 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#ifdef __linux__
+
+#include <gtest/gtest.h>
+
+#include <iostream>
+#include <thread>
+#include <memory>
+
+#include "wasm-message-handler.h"
+#include "nop-message-handler.h"
+#include "tcp-session.h"
+#include "tcp-uring-session.h"
+
+#include "tcp-broadcast-server.h"
+#include "tcp-sink-server.h"
+#include "test-helpers.h"
+
+TEST(TCPUringSessionTests, SingleSessionParsing)
+{
+    if (!IoUringService::supported())
+    {
+        GTEST_SKIP() << "io_uring is not available on this system.";
+    }
+
+    // Setup basic server.
+    asio::io_context server_cntx;
+    asio::ip::tcp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    uint64_t server_interval_ms = 5;
+    uint64_t total_packets = 10;
+
+    std::vector<uint8_t> packet{ 0x1, 0x0, 0x0, 0x4, 0x0, 0x0, 0x0, 0x0 };
+
+    TCPBroadcastServer server(server_cntx,
+                              server_ep,
+                              server_interval_ms,
+                              packet,
+                              total_packets);
+
+    std::thread server_thread([&]
+    {
+        server.start();
+        server_cntx.run();
+    });
+
+    // Setup a TCPUringSession by itself.
+    asio::io_context session_cntx;
+
+    SessionConfig config(4, 12288, true, false, 100);
+
+    // Create mock header parsing function and WASM instance.
+    wasmtime::Config WASM_config;
+    auto engine = std::make_shared<wasmtime::Engine>(std::move(WASM_config));
+
+    std::vector<uint8_t> wasm_bytes;
+
+    try {
+        wasm_bytes = read_binary_file("tests/modules/tcp-single-session-parsing.wasm");
+    }
+    catch (const std::exception & error)
+    {
+        std::cerr << error.what() << "\n";
+        FAIL();
+    }
+
+    auto module_tmp = wasmtime::Module::compile(*engine, wasm_bytes);
+
+    if (!module_tmp)
+    {
+        server_cntx.stop();
+
+        if (server_thread.joinable())
+        {
+            server_thread.join();
+        }
+
+        FAIL();
+    }
+
+    auto module = std::make_shared<wasmtime::Module>(module_tmp.unwrap());
+
+    // Empty payload manager.
+    std::vector<PayloadDescriptor> payloads;
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    std::shared_ptr<WASMMessageHandler> handler_ptr;
+    SessionRef<TCPUringSession> session_ptr;
+
+    // Empty callback that just stops the context.
+    TCPUringSession::DisconnectCallback cb = [&](){
+        session_cntx.stop();
+    };
+
+    ShardMetrics metrics;
+
+    asio::post(session_cntx, [&](){
+        try {
+            handler_ptr = std::make_shared<WASMMessageHandler>(engine, module);
+        }
+        catch (const std::exception & error)
+        {
+            std::cerr << error.what() << "\n";
+            session_cntx.stop();
+            return;
+        }
+
+        std::array<bool, 4> bytes_to_read{0,0,0,1};
+        handler_ptr->set_header_parser([bytes_to_read](std::span<const uint8_t> buffer) -> HeaderResult
+        {
+            size_t size = 0;
+
+            for (size_t i = 0; i < bytes_to_read.size(); i++)
+            {
+                if (bytes_to_read[i])
+                {
+                    size <<= 8;
+                    size |= buffer[i];
+                }
+            }
+
+            return {size, HeaderResult::Status::OK};
+        });
+
+        session_ptr = make_session<TCPUringSession>(session_cntx,
+                                                    config,
+                                                    *handler_ptr,
+                                                    payload_manager,
+                                                    metrics,
+                                                    cb);
+
+        const TCPUringSession::Endpoints endpoints{server_ep};
+
+        session_ptr->start(endpoints);
+    });
+
+    // Turn this test off after 100ms of responding.
+    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(100));
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        // This should stop the context.
+        session_ptr->stop();
+    });
+
+    session_cntx.run();
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    EXPECT_EQ(server.lifetime_connections_, 1) << "Server only accepted "
+                                               << server.lifetime_connections_
+                                               << " of "
+                                               << 1
+                                               << "requests!";
+
+    // Each 8 byte packet should be answered with 4 bytes, as with TCPSession.
+    EXPECT_EQ(server.lifetime_sent_,
+              server.lifetime_received_) << "Server was not responded to properly!";
+}
+
+TEST(TCPUringSessionTests, SingleSessionCounterFlood)
+{
+    if (!IoUringService::supported())
+    {
+        GTEST_SKIP() << "io_uring is not available on this system.";
+    }
+
+    std::vector<uint8_t> packet_1 = read_binary_file("tests/packets/test-packet-1.bin");
+    size_t packet_size = packet_1.size();
+
+    // Setup basic server.
+    asio::io_context server_cntx;
+    asio::ip::tcp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    TCPSinkServer server(server_cntx,
+                         server_ep,
+                         packet_size);
+
+    std::thread server_thread([&]
+    {
+        server.start();
+        server_cntx.run();
+    });
+
+    asio::io_context session_cntx;
+
+    SessionConfig config(4, 12288, true, false, 100);
+
+    NOPMessageHandler handler;
+
+    // Create 9 payloads with decreasing sizes, so the counter lands
+    // in a different place in each one.
+    std::vector<PayloadDescriptor> payloads;
+
+    for (int i = 0; i < 9; i++)
+    {
+        PacketOperation identity_op_missing_bytes;
+        identity_op_missing_bytes.make_identity(packet_size - i);
+
+        PacketOperation counter_op;
+        counter_op.make_counter(i, (i % 2));
+
+        payloads.push_back({{packet_1.data(), packet_1.size()},
+                           std::vector<PacketOperation>{identity_op_missing_bytes, counter_op} });
+    }
+
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    SessionRef<TCPUringSession> session_ptr;
+
+    TCPUringSession::DisconnectCallback cb = [&](){
+        session_cntx.stop();
+    };
+
+    ShardMetrics metrics;
+
+    asio::post(session_cntx, [&](){
+        session_ptr = make_session<TCPUringSession>(session_cntx,
+                                                    config,
+                                                    handler,
+                                                    payload_manager,
+                                                    metrics,
+                                                    cb);
+
+        const TCPUringSession::Endpoints endpoints{server_ep};
+
+        session_ptr->start(endpoints);
+
+        // Send out all payloads as fast as possible.
+        session_ptr->flood();
+    });
+
+    // Turn this test off after 100ms of responding.
+    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(100));
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        session_ptr->stop();
+    });
+
+    session_cntx.run();
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    EXPECT_EQ(server.lifetime_connections_, 1) << "Server only accepted "
+                                               << server.lifetime_connections_
+                                               << " of "
+                                               << 1
+                                               << "requests!";
+
+    EXPECT_EQ(server.lifetime_received_,
+              packet_size * payloads.size()) << "Server only got "
+                                             << server.lifetime_received_
+                                             << " of "
+                                             << packet_size * payloads.size()
+                                             << " bytes!";
+
+    EXPECT_EQ(metrics.fetch_snapshot().bytes_sent, packet_size * payloads.size());
+}
+
+#endif
@@ -642,6 +642,15 @@ EXPECT_PLAN_EQ(const ExecutionPlan<Session> & expected,
             issues.push_back(issue);
         }
 
+        if (e_payload.copies != a_payload.copies)
+        {
+            std::string issue = "Payload copies differ! Expected "
+                            + std::to_string(e_payload.copies)
+                            + " Actual "
+                            + std::to_string(a_payload.copies);
+            issues.push_back(issue);
+        }
+
         if (e_payload.ops.size()
             != a_payload.ops.size())
         {
@@ -17,9 +17,12 @@
 #include <gtest/gtest.h>
 
 #include "wasm-message-handler.h"
+#include "nop-message-handler.h"
 #include "udp-session.h"
 
 #include "udp-broadcast-server.h"
+#include "udp-sink-server.h"
+#include "recording-message-handler.h"
 #include "test-helpers.h"
 
 TEST(UDPSessionTests, SingleSessionParsing)
@@ -109,7 +112,7 @@ TEST(UDPSessionTests, SingleSessionParsing)
 
     // WASMMessageHandler handler(engine, module);
     std::shared_ptr<WASMMessageHandler> handler_ptr;
-    std::shared_ptr<UDPSession> session_ptr;
+    SessionRef<UDPSession> session_ptr;
 
     // Empty callback that just stops the context.
     UDPSession::DisconnectCallback cb = [&](){
@@ -147,12 +150,12 @@ TEST(UDPSessionTests, SingleSessionParsing)
         });
 
         // Create the UDPSession instance.
-        session_ptr = make_shared<UDPSession>(session_cntx,
-                                              config,
-                                              *handler_ptr,
-                                              payload_manager,
-                                              metrics,
-                                              cb);
+        session_ptr = make_session<UDPSession>(session_cntx,
+                                               config,
+                                               *handler_ptr,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
 
         // Connection endpoint.
         const UDPSession::Endpoints endpoints{
@@ -200,3 +203,540 @@ TEST(UDPSessionTests, SingleSessionParsing)
 
     SUCCEED();
 }
+
+TEST(UDPSessionTests, SingleSessionSharedBuffers)
+{
+    // Setup basic server.
+    asio::io_context server_cntx;
+    asio::ip::udp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    uint64_t server_interval_ms = 5;
+    uint64_t total_packets = 10;
+
+    std::vector<uint8_t> packet(1200);
+
+    for (size_t i = 0; i < packet.size(); i++)
+    {
+        packet[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    UDPBroadcastServer server(server_cntx,
+                              server_ep,
+                              server_interval_ms,
+                              packet,
+                              total_packets);
+
+    std::thread server_thread([&]
+    {
+        server.start();
+        server_cntx.run();
+    });
+
+    asio::io_context session_cntx;
+
+    SessionConfig config(4, 12288, true, false, 100);
+    config.shared_buffers = true;
+
+    RecordingMessageHandler handler(packet);
+
+    // One payload so the server learns about us.
+    std::vector<uint8_t> packet_1 = read_binary_file("tests/packets/test-packet-1.bin");
+
+    std::vector<PayloadDescriptor> payloads;
+
+    PacketOperation identity_op;
+    identity_op.make_identity(packet_1.size());
+
+    payloads.push_back({{packet_1.data(), packet_1.size()},
+                       std::vector<PacketOperation>{identity_op} });
+
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    SessionRef<UDPSession> session_ptr;
+
+    UDPSession::DisconnectCallback cb = [&](){
+        session_cntx.stop();
+    };
+
+    ShardMetrics metrics;
+
+    asio::post(session_cntx, [&](){
+        session_ptr = make_session<UDPSession>(session_cntx,
+                                               config,
+                                               handler,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
+
+        session_ptr->start(server_ep);
+
+        session_ptr->send(1);
+    });
+
+    // Turn this test off after 100ms of reading.
+    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(100));
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        session_ptr->stop();
+    });
+
+    session_cntx.run();
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    auto snapshot = metrics.fetch_snapshot();
+
+    // Heartbeats sent before our payload arrived are not counted as broadcasts.
+    EXPECT_GT(handler.messages_, 0);
+    EXPECT_EQ(handler.messages_, server.lifetime_broadcasts_);
+    EXPECT_EQ(handler.mismatched_, 0) << "Datagrams were corrupted by the shared buffer!";
+    EXPECT_EQ(snapshot.bytes_read, packet.size() * handler.messages_);
+}
+
+TEST(UDPSessionTests, SingleSessionBatchedReads)
+{
+    // Setup basic server.
+    asio::io_context server_cntx;
+    asio::ip::udp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    uint64_t server_interval_ms = 5;
+    uint64_t total_packets = 10;
+
+    std::vector<uint8_t> packet(1200);
+
+    for (size_t i = 0; i < packet.size(); i++)
+    {
+        packet[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    UDPBroadcastServer server(server_cntx,
+                              server_ep,
+                              server_interval_ms,
+                              packet,
+                              total_packets);
+
+    std::thread server_thread([&]
+    {
+        server.start();
+        server_cntx.run();
+    });
+
+    asio::io_context session_cntx;
+
+    SessionConfig config(4, 12288, true, false, 100);
+    config.batch_size = 8;
+
+    RecordingMessageHandler handler(packet);
+    handler.batch_ = true;
+
+    // One payload so the server learns about us.
+    std::vector<uint8_t> packet_1 = read_binary_file("tests/packets/test-packet-1.bin");
+
+    std::vector<PayloadDescriptor> payloads;
+
+    PacketOperation identity_op;
+    identity_op.make_identity(packet_1.size());
+
+    payloads.push_back({{packet_1.data(), packet_1.size()},
+                       std::vector<PacketOperation>{identity_op} });
+
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    SessionRef<UDPSession> session_ptr;
+
+    UDPSession::DisconnectCallback cb = [&](){
+        session_cntx.stop();
+    };
+
+    ShardMetrics metrics;
+
+    asio::post(session_cntx, [&](){
+        session_ptr = make_session<UDPSession>(session_cntx,
+                                               config,
+                                               handler,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
+
+        session_ptr->start(server_ep);
+
+        session_ptr->send(1);
+    });
+
+    // Turn this test off after 100ms of reading.
+    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(100));
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        session_ptr->stop();
+    });
+
+    session_cntx.run();
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    auto snapshot = metrics.fetch_snapshot();
+
+    // Heartbeats sent before our payload arrived are not counted as broadcasts.
+    EXPECT_GT(handler.messages_, 0);
+    EXPECT_EQ(handler.messages_, server.lifetime_broadcasts_);
+    EXPECT_EQ(handler.mismatched_, 0);
+    EXPECT_EQ(snapshot.bytes_read, packet.size() * handler.messages_);
+
+    // Each recvmmsg call is handled as one batch.
+    EXPECT_GT(handler.batches_, 0);
+    EXPECT_LE(handler.batches_, snapshot.read_calls);
+}
+
+TEST(UDPSessionTests, SingleSessionBatchedFlood)
+{
+    std::vector<uint8_t> packet_1 = read_binary_file("tests/packets/test-packet-1.bin");
+    size_t packet_size = packet_1.size();
+
+    // Setup basic server.
+    asio::io_context server_cntx;
+    asio::ip::udp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    UDPSinkServer server(server_cntx, server_ep);
+
+    std::thread server_thread([&]
+    {
+        server.start();
+        server_cntx.run();
+    });
+
+    asio::io_context session_cntx;
+
+    // Batches of 4 datagrams, 9 payloads should take 3 calls.
+    SessionConfig config(4, 12288, false, false, 100);
+    config.batch_size = 4;
+
+    NOPMessageHandler handler;
+
+    // Create 9 payloads with decreasing sizes, so the counter lands
+    // in a different place in each one.
+    std::vector<PayloadDescriptor> payloads;
+
+    for (int i = 0; i < 9; i++)
+    {
+        PacketOperation identity_op_missing_bytes;
+        identity_op_missing_bytes.make_identity(packet_size - i);
+
+        PacketOperation counter_op;
+        counter_op.make_counter(i, (i % 2));
+
+        payloads.push_back({{packet_1.data(), packet_1.size()},
+                           std::vector<PacketOperation>{identity_op_missing_bytes, counter_op} });
+    }
+
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    SessionRef<UDPSession> session_ptr;
+
+    UDPSession::DisconnectCallback cb = [&](){
+        session_cntx.stop();
+    };
+
+    ShardMetrics metrics;
+
+    asio::post(session_cntx, [&](){
+        session_ptr = make_session<UDPSession>(session_cntx,
+                                               config,
+                                               handler,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
+
+        session_ptr->start(server_ep);
+
+        // Send out all payloads as fast as possible.
+        session_ptr->flood();
+    });
+
+    // Turn this test off after 100ms of sending.
+    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(100));
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        session_ptr->stop();
+    });
+
+    session_cntx.run();
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    auto snapshot = metrics.fetch_snapshot();
+
+    EXPECT_EQ(server.lifetime_received_,
+              packet_size * payloads.size()) << "Server only got "
+                                             << server.lifetime_received_
+                                             << " of "
+                                             << packet_size * payloads.size()
+                                             << " bytes!";
+
+    EXPECT_EQ(snapshot.bytes_sent, packet_size * payloads.size());
+    EXPECT_EQ(snapshot.packets_sent, payloads.size());
+
+    // The socket buffer never fills here, so every call sends a full batch.
+    EXPECT_EQ(snapshot.send_calls, 3);
+}
+
+#ifdef __linux__
+// Checks that the kernel accepts a UDP level socket option.
+static bool udp_option_supported(int option, int value)
+{
+    asio::io_context cntx;
+    asio::ip::udp::socket socket(cntx, asio::ip::udp::v4());
+
+    return ::setsockopt(socket.native_handle(),
+                        IPPROTO_UDP,
+                        option,
+                        &value,
+                        sizeof(value)) == 0;
+}
+
+TEST(UDPSessionTests, SingleSessionSegmentedFlood)
+{
+    if (!udp_option_supported(UDP_SEGMENT, 0))
+    {
+        GTEST_SKIP() << "UDP_SEGMENT is not available on this system.";
+    }
+
+    // A full 1500 byte MTU datagram over ipv4, the loopback MTU is larger
+    // so these must still be joined.
+    std::vector<uint8_t> packet(1500 - 20 - 8);
+
+    for (size_t i = 0; i < packet.size(); i++)
+    {
+        packet[i] = static_cast<uint8_t>(i * 3);
+    }
+
+    size_t packet_size = packet.size();
+
+    // Setup basic server.
+    asio::io_context server_cntx;
+    asio::ip::udp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    UDPSinkServer server(server_cntx, server_ep);
+
+    std::thread server_thread([&]
+    {
+        server.start();
+        server_cntx.run();
+    });
+
+    asio::io_context session_cntx;
+
+    // One batch of 8 equally sized datagrams, joined into one GSO send.
+    SessionConfig config(4, 12288, false, false, 100);
+    config.batch_size = 8;
+    config.udp_gso = true;
+
+    NOPMessageHandler handler;
+
+    std::vector<PayloadDescriptor> payloads;
+
+    for (int i = 0; i < 8; i++)
+    {
+        PacketOperation identity_op;
+        identity_op.make_identity(packet_size);
+
+        payloads.push_back({{packet.data(), packet.size()},
+                           std::vector<PacketOperation>{identity_op} });
+    }
+
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    SessionRef<UDPSession> session_ptr;
+
+    UDPSession::DisconnectCallback cb = [&](){
+        session_cntx.stop();
+    };
+
+    ShardMetrics metrics;
+
+    asio::post(session_cntx, [&](){
+        session_ptr = make_session<UDPSession>(session_cntx,
+                                               config,
+                                               handler,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
+
+        session_ptr->start(server_ep);
+
+        session_ptr->flood();
+    });
+
+    // Turn this test off after 100ms of sending.
+    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(100));
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        session_ptr->stop();
+    });
+
+    session_cntx.run();
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    auto snapshot = metrics.fetch_snapshot();
+
+    // The kernel must split the send back into the original datagrams.
+    EXPECT_EQ(server.lifetime_datagrams_, payloads.size());
+    EXPECT_EQ(server.lifetime_received_, packet_size * payloads.size());
+
+    EXPECT_EQ(snapshot.packets_sent, payloads.size());
+
+    // All 8 datagrams went out as one joined message.
+    EXPECT_EQ(snapshot.send_calls, 1);
+    EXPECT_EQ(snapshot.gso_sends, 1);
+}
+
+TEST(UDPSessionTests, SingleSessionSegmentedReads)
+{
+    if (!udp_option_supported(UDP_SEGMENT, 0) || !udp_option_supported(UDP_GRO, 1))
+    {
+        GTEST_SKIP() << "UDP_SEGMENT or UDP_GRO is not available on this system.";
+    }
+
+    constexpr size_t burst_size = 16;
+
+    std::vector<uint8_t> packet(1000);
+
+    for (size_t i = 0; i < packet.size(); i++)
+    {
+        packet[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    // The server answers our first payload with one segmented burst, which
+    // reaches a GRO socket as a single buffer of burst_size datagrams.
+    asio::io_context server_cntx;
+    asio::ip::udp::endpoint server_ep(asio::ip::make_address("127.0.0.1"), 12345);
+
+    asio::ip::udp::socket server(server_cntx, server_ep);
+
+    int segment = static_cast<int>(packet.size());
+    ::setsockopt(server.native_handle(),
+                 IPPROTO_UDP,
+                 UDP_SEGMENT,
+                 &segment,
+                 sizeof(segment));
+
+    std::vector<uint8_t> burst;
+
+    for (size_t i = 0; i < burst_size; i++)
+    {
+        burst.insert(burst.end(), packet.begin(), packet.end());
+    }
+
+    std::vector<uint8_t> request(4096);
+    asio::ip::udp::endpoint client_ep;
+
+    server.async_receive_from(asio::buffer(request),
+                              client_ep,
+                              [&](boost::system::error_code ec, size_t)
+                              {
+                                  if (!ec)
+                                  {
+                                      server.send_to(asio::buffer(burst), client_ep, 0, ec);
+                                  }
+                              });
+
+    std::thread server_thread([&]
+    {
+        server_cntx.run();
+    });
+
+    asio::io_context session_cntx;
+
+    // Without GRO the burst would take at least burst_size / 2 reads.
+    SessionConfig config(4, 12288, true, false, 100);
+    config.batch_size = 2;
+    config.udp_gro = true;
+
+    RecordingMessageHandler handler(packet);
+    handler.batch_ = true;
+
+    std::vector<uint8_t> packet_1 = read_binary_file("tests/packets/test-packet-1.bin");
+
+    std::vector<PayloadDescriptor> payloads;
+
+    PacketOperation identity_op;
+    identity_op.make_identity(packet_1.size());
+
+    payloads.push_back({{packet_1.data(), packet_1.size()},
+                       std::vector<PacketOperation>{identity_op} });
+
+    std::vector<std::vector<uint16_t>> steps(payloads.size(), {1});
+    PayloadManager payload_manager(payloads, steps);
+
+    SessionRef<UDPSession> session_ptr;
+
+    UDPSession::DisconnectCallback cb = [&](){
+        session_cntx.stop();
+    };
+
+    ShardMetrics metrics;
+
+    asio::post(session_cntx, [&](){
+        session_ptr = make_session<UDPSession>(session_cntx,
+                                               config,
+                                               handler,
+                                               payload_manager,
+                                               metrics,
+                                               cb);
+
+        session_ptr->start(server_ep);
+
+        session_ptr->send(1);
+    });
+
+    // Turn this test off after 100ms of reading.
+    asio::steady_timer stop_timer(session_cntx, std::chrono::milliseconds(100));
+    stop_timer.async_wait([&](const boost::system::error_code &)
+    {
+        session_ptr->stop();
+    });
+
+    session_cntx.run();
+
+    server_cntx.stop();
+
+    if (server_thread.joinable())
+    {
+        server_thread.join();
+    }
+
+    auto snapshot = metrics.fetch_snapshot();
+
+    // The handler must see every datagram of the burst, each at its own size.
+    EXPECT_EQ(handler.messages_, burst_size);
+    EXPECT_EQ(handler.mismatched_, 0);
+
+    EXPECT_EQ(snapshot.packets_read, burst_size);
+    EXPECT_EQ(snapshot.bytes_read, packet.size() * burst_size);
+    EXPECT_LT(snapshot.read_calls, burst_size / config.batch_size);
+}
+#endif
@@ -89,6 +89,7 @@ private:
                     }
 
                     lifetime_received_ += count;
+                    lifetime_datagrams_ += 1;
                 }
             });
     }
@@ -96,6 +97,7 @@ private:
 public:
     size_t lifetime_connections_{0};
     std::atomic<size_t> lifetime_received_{0};
+    std::atomic<size_t> lifetime_datagrams_{0};
 
 private:
     asio::io_context & cntx_;
@@ -0,0 +1,490 @@
+// Copyright (c) 2026 Liam Mercier
+//
+// This file is part of Loadshear.
+//
+// Loadshear is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// Loadshear is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU General Public License v3.0
+// along with Loadshear. If not, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include <unistd.h>
+
+#include "test-helpers.h"
+
+#include "epoch-ticker.h"
+#include "payload-structs.h"
+#include "shard-metrics.h"
+#include "wasm-instance-pre.h"
+#include "wasm-message-handler.h"
+#include "wasm-module-cache.h"
+
+// handle_body per message and one handle_batch per read must answer the
+// same, the module fills every message with 0x55 and answers in place.
+TEST(WASMHandlerTests, BatchMatchesBody)
+{
+    wasmtime::Config WASM_config;
+    auto engine = std::make_shared<wasmtime::Engine>(std::move(WASM_config));
+
+    std::vector<uint8_t> wasm_bytes;
+
+    try {
+        wasm_bytes = read_binary_file("tests/modules/tcp-batch-parsing.wasm");
+    }
+    catch (const std::exception & error)
+    {
+        std::cerr << error.what() << "\n";
+        FAIL();
+    }
+
+    auto module_tmp = wasmtime::Module::compile(*engine, wasm_bytes);
+
+    if (!module_tmp)
+    {
+        FAIL();
+    }
+
+    auto module = std::make_shared<wasmtime::Module>(module_tmp.unwrap());
+
+    std::unique_ptr<WASMMessageHandler> handler;
+
+    try {
+        handler = std::make_unique<WASMMessageHandler>(engine, module);
+    }
+    catch (const std::exception & error)
+    {
+        std::cerr << error.what() << "\n";
+        FAIL();
+    }
+
+    ASSERT_TRUE(handler->batches());
+
+    constexpr size_t batch_size = 64;
+    constexpr size_t rounds = 4;
+
+    std::vector<uint8_t> frame(64, 0x1);
+    std::span<const uint8_t> frame_bytes(frame);
+
+    std::vector<MessageView> messages(batch_size,
+                                      {frame_bytes.first(4), frame_bytes.subspan(4)});
+
+    auto is_filled = [&](const ResponsePacket & response){
+        return response.size() == frame.size()
+               && std::all_of(response.data(),
+                              response.data() + response.size(),
+                              [](uint8_t byte){ return byte == 0x55; });
+    };
+
+    size_t single_responses = 0;
+
+    for (size_t round = 0; round < rounds; round++)
+    {
+        for (const MessageView & message : messages)
+        {
+            handler->parse_message(message.header,
+                                   message.body,
+                                   [&](ResponsePacket response){
+                                       single_responses += is_filled(response);
+                                   });
+        }
+    }
+
+    size_t batch_responses = 0;
+
+    for (size_t round = 0; round < rounds; round++)
+    {
+        handler->parse_batch(messages,
+                             [&](std::vector<ResponsePacket> responses){
+                                 for (const ResponsePacket & response : responses)
+                                 {
+                                     batch_responses += is_filled(response);
+                                 }
+                             });
+    }
+
+    EXPECT_EQ(single_responses, rounds * batch_size);
+    EXPECT_EQ(batch_responses, rounds * batch_size);
+}
+
+// The second load must come from the cache and still produce a working handler.
+TEST(WASMHandlerTests, ModuleCacheRoundTrip)
+{
+    auto cache_dir = std::filesystem::temp_directory_path()
+                     / ("loadshear-cache-test-" + std::to_string(::getpid()));
+
+    std::filesystem::remove_all(cache_dir);
+
+    wasmtime::Config WASM_config;
+    auto engine = std::make_shared<wasmtime::Engine>(std::move(WASM_config));
+
+    std::vector<uint8_t> wasm_bytes;
+
+    try {
+        wasm_bytes = read_binary_file("tests/modules/tcp-batch-parsing.wasm");
+    }
+    catch (const std::exception & error)
+    {
+        std::cerr << error.what() << "\n";
+        FAIL();
+    }
+
+    WASMModuleCache cache(cache_dir, "test");
+
+    bool cached = true;
+    auto compiled = cache.load(*engine, wasm_bytes, cached);
+
+    ASSERT_TRUE(compiled.has_value()) << compiled.error();
+    EXPECT_FALSE(cached);
+
+    // Entries run as native code, only we may write to them.
+    auto modules_perms = std::filesystem::status(cache_dir / "modules").permissions();
+    EXPECT_EQ(modules_perms, std::filesystem::perms::owner_all);
+
+    auto loaded = cache.load(*engine, wasm_bytes, cached);
+
+    ASSERT_TRUE(loaded.has_value()) << loaded.error();
+    EXPECT_TRUE(cached);
+
+    // A different engine key must not reuse the entry.
+    WASMModuleCache other_cache(cache_dir, "other");
+
+    auto recompiled = other_cache.load(*engine, wasm_bytes, cached);
+
+    ASSERT_TRUE(recompiled.has_value()) << recompiled.error();
+    EXPECT_FALSE(cached);
+
+    // An entry whose stored key does not match is a miss, even at the
+    // right path, and gets replaced.
+    for (const auto & entry : std::filesystem::directory_iterator(cache_dir / "modules"))
+    {
+        std::fstream file(entry.path(), std::ios::binary | std::ios::in | std::ios::out);
+
+        char first = 0;
+        file.get(first);
+        file.seekp(0);
+        file.put(static_cast<char>(~first));
+    }
+
+    auto tampered = cache.load(*engine, wasm_bytes, cached);
+
+    ASSERT_TRUE(tampered.has_value()) << tampered.error();
+    EXPECT_FALSE(cached);
+
+    auto replaced = cache.load(*engine, wasm_bytes, cached);
+
+    ASSERT_TRUE(replaced.has_value()) << replaced.error();
+    EXPECT_TRUE(cached);
+
+    auto module = std::make_shared<wasmtime::Module>(std::move(*loaded));
+
+    auto instance_pre = WASMInstancePre::create(*engine, *module);
+
+    ASSERT_TRUE(instance_pre.has_value()) << instance_pre.error();
+
+    WASMHandlerOptions options;
+    options.instance_pre = *instance_pre;
+
+    std::unique_ptr<WASMMessageHandler> handler;
+
+    try {
+        handler = std::make_unique<WASMMessageHandler>(engine, module, options);
+    }
+    catch (const std::exception & error)
+    {
+        std::cerr << error.what() << "\n";
+        FAIL();
+    }
+
+    std::vector<uint8_t> frame(64, 0x1);
+    std::span<const uint8_t> frame_bytes(frame);
+
+    size_t response_size = 0;
+
+    handler->parse_message(frame_bytes.first(4),
+                           frame_bytes.subspan(4),
+                           [&](ResponsePacket response){
+                               response_size = response.size();
+                           });
+
+    EXPECT_EQ(response_size, frame.size());
+
+    handler.reset();
+    std::filesystem::remove_all(cache_dir);
+}
+
+// Runs one message that never returns and one that is echoed on a handler
+// limited by options, the first must be cut off without breaking the second.
+static void expect_runaway_cut_off(wasmtime::Config WASM_config,
+                                   WASMHandlerOptions options,
+                                   bool epoch)
+{
+    auto engine = std::make_shared<wasmtime::Engine>(std::move(WASM_config));
+
+    std::vector<uint8_t> wasm_bytes;
+
+    try {
+        wasm_bytes = read_binary_file("tests/modules/tcp-looping-handler.wasm");
+    }
+    catch (const std::exception & error)
+    {
+        std::cerr << error.what() << "\n";
+        FAIL();
+    }
+
+    auto module_tmp = wasmtime::Module::compile(*engine, wasm_bytes);
+
+    if (!module_tmp)
+    {
+        FAIL();
+    }
+
+    auto module = std::make_shared<wasmtime::Module>(module_tmp.unwrap());
+
+    std::unique_ptr<EpochTicker> ticker;
+
+    if (epoch)
+    {
+        ticker = std::make_unique<EpochTicker>(engine);
+    }
+
+    std::unique_ptr<WASMMessageHandler> handler;
+
+    try {
+        handler = std::make_unique<WASMMessageHandler>(engine, module, options);
+    }
+    catch (const std::exception & error)
+    {
+        std::cerr << error.what() << "\n";
+        FAIL();
+    }
+
+    ShardMetrics metrics;
+    handler->attach_metrics(metrics);
+
+    std::vector<uint8_t> runaway(16, 0xFF);
+    std::vector<uint8_t> echoed(16, 0x1);
+
+    size_t runaway_size = SIZE_MAX;
+    size_t echoed_size = 0;
+
+    handler->parse_message(std::span<const uint8_t>(runaway).first(4),
+                           std::span<const uint8_t>(runaway).subspan(4),
+                           [&](ResponsePacket response){
+                               runaway_size = response.size();
+                           });
+
+    handler->parse_message(std::span<const uint8_t>(echoed).first(4),
+                           std::span<const uint8_t>(echoed).subspan(4),
+                           [&](ResponsePacket response){
+                               echoed_size = response.size();
+                           });
+
+    auto snapshot = metrics.fetch_snapshot();
+
+    uint64_t handler_calls = 0;
+
+    for (uint64_t count : snapshot.handler_time_buckets)
+    {
+        handler_calls += count;
+    }
+
+    EXPECT_EQ(runaway_size, 0u);
+    EXPECT_EQ(echoed_size, echoed.size());
+    EXPECT_EQ(snapshot.handler_timeouts, 1u);
+    EXPECT_EQ(snapshot.handler_traps, 0u);
+    EXPECT_EQ(handler_calls, 2u);
+}
+
+TEST(WASMHandlerTests, FuelCutsOffRunawayHandler)
+{
+    wasmtime::Config WASM_config;
+    WASM_config.consume_fuel(true);
+
+    WASMHandlerOptions options;
+    options.fuel = 100000;
+
+    expect_runaway_cut_off(std::move(WASM_config), options, false);
+}
+
+TEST(WASMHandlerTests, DeadlineCutsOffRunawayHandler)
+{
+    wasmtime::Config WASM_config;
+    WASM_config.epoch_interruption(true);
+
+    WASMHandlerOptions options;
+    options.epoch_deadline = 20;
+
+    expect_runaway_cut_off(std::move(WASM_config), options, true);
+}
+
+TEST(WASMHandlerTests, HostImports)
+{
+    auto engine = std::make_shared<wasmtime::Engine>();
+
+    std::vector<uint8_t> wasm_bytes;
+
+    try {
+        wasm_bytes = read_binary_file("tests/modules/tcp-host-imports.wasm");
+    }
+    catch (const std::exception & error)
+    {
+        std::cerr << error.what() << "\n";
+        FAIL();
+    }
+
+    auto module_tmp = wasmtime::Module::compile(*engine, wasm_bytes);
+
+    if (!module_tmp)
+    {
+        FAIL();
+    }
+
+    auto module = std::make_shared<wasmtime::Module>(module_tmp.unwrap());
+
+    std::unique_ptr<WASMMessageHandler> handler;
+
+    try {
+        handler = std::make_unique<WASMMessageHandler>(engine, module);
+    }
+    catch (const std::exception & error)
+    {
+        std::cerr << error.what() << "\n";
+        FAIL();
+    }
+
+    // The module answers with clock_ns, counter_next(0), session_index
+    // and random_u64, each as 8 little endian bytes.
+    std::vector<std::array<int64_t, 4>> responses;
+
+    std::vector<uint8_t> message(16, 0x1);
+
+    int64_t before = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    handler->set_current_session(7);
+
+    for (int i = 0; i < 2; i++)
+    {
+        handler->parse_message(std::span<const uint8_t>(message).first(4),
+                               std::span<const uint8_t>(message).subspan(4),
+                               [&](ResponsePacket response){
+                                   ASSERT_EQ(response.size(), 32u);
+
+                                   std::array<int64_t, 4> fields;
+                                   std::memcpy(fields.data(), response.data(), response.size());
+                                   responses.push_back(fields);
+                               });
+    }
+
+    int64_t after = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    ASSERT_EQ(responses.size(), 2u);
+
+    for (const auto & fields : responses)
+    {
+        EXPECT_GE(fields[0], before);
+        EXPECT_LE(fields[0], after);
+        EXPECT_EQ(fields[2], 7);
+    }
+
+    EXPECT_EQ(responses[0][1], 0);
+    EXPECT_EQ(responses[1][1], 1);
+    EXPECT_NE(responses[0][3], responses[1][3]);
+}
+
+TEST(WASMHandlerTests, GeneratePayload)
+{
+    auto engine = std::make_shared<wasmtime::Engine>();
+
+    std::vector<uint8_t> wasm_bytes;
+
+    try {
+        wasm_bytes = read_binary_file("tests/modules/tcp-payload-generator.wasm");
+    }
+    catch (const std::exception & error)
+    {
+        std::cerr << error.what() << "\n";
+        FAIL();
+    }
+
+    auto module_tmp = wasmtime::Module::compile(*engine, wasm_bytes);
+
+    if (!module_tmp)
+    {
+        FAIL();
+    }
+
+    auto module = std::make_shared<wasmtime::Module>(module_tmp.unwrap());
+
+    std::unique_ptr<WASMMessageHandler> handler;
+
+    try {
+        handler = std::make_unique<WASMMessageHandler>(engine, module);
+    }
+    catch (const std::exception & error)
+    {
+        std::cerr << error.what() << "\n";
+        FAIL();
+    }
+
+    ASSERT_TRUE(handler->generates());
+
+    ShardMetrics metrics;
+    handler->attach_metrics(metrics);
+
+    const std::array<uint8_t, 3> base{0x1, 0x2, 0x3};
+
+    for (uint64_t i = 0; i < 2; i++)
+    {
+        // The payload is made of a static slice and one from temps.
+        PreparedPayload payload;
+        payload.temps.assign({0x4, 0x5});
+        payload.packet_slices.emplace_back(base.data(), base.size());
+        payload.packet_slices.emplace_back(payload.temps.data(), payload.temps.size());
+
+        handler->generate_payload(5, i, payload);
+
+        // The module sends counter_next(0) and session_index before the payload.
+        ASSERT_EQ(payload.packet_slices.size(), 1u);
+        ASSERT_EQ(payload.packet_slices[0].size(), 17u);
+
+        const uint8_t *bytes = static_cast<const uint8_t *>(payload.packet_slices[0].data());
+
+        uint64_t sequence = 0;
+        uint32_t session = 0;
+        std::memcpy(&sequence, bytes, sizeof(sequence));
+        std::memcpy(&session, bytes + 8, sizeof(session));
+
+        EXPECT_EQ(sequence, i);
+        EXPECT_EQ(session, 5u);
+
+        std::array<uint8_t, 5> expected{0x1, 0x2, 0x3, 0x4, 0x5};
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(), bytes + 12));
+    }
+
+    uint64_t generated = 0;
+
+    for (auto count : metrics.fetch_snapshot().generate_time_buckets)
+    {
+        generated += count;
+    }
+
+    EXPECT_EQ(generated, 2u);
+}